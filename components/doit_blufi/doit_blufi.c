@@ -256,8 +256,15 @@ static void wifi_event_handler(void* arg, esp_event_base_t event_base,
     return;
 }
 
+static bool wifi_initialised = false;
+
 static void initialise_wifi(void)
 {
+    // netif 和 WiFi 驱动只能初始化一次，重复初始化会 abort
+    if (wifi_initialised) {
+        return;
+    }
+    wifi_initialised = true;
     ESP_ERROR_CHECK(esp_netif_init());
     wifi_event_group = xEventGroupCreate();
     // ESP_ERROR_CHECK(esp_event_loop_create_default());
@@ -592,6 +599,13 @@ bool blufi_wifi_sta_get_connect_status(){
 }
 
 void blufi_wifi_start_connect() {
+    // 网络切换时 StopNetwork 之后再次连接：驱动和 STA 配置都还在，只需重新启动
+    if (wifi_initialised) {
+        ESP_LOGI(TAG, " ------ blufi_wifi_start_connect (restart)");
+        ESP_ERROR_CHECK(esp_wifi_start());
+        esp_wifi_connect();
+        return;
+    }
     initialise_wifi();
     ESP_LOGI(TAG, " ------ blufi_wifi_start_connect");
   
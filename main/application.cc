@@ -457,8 +457,18 @@ void Application::Start() {
     // Initialize the protocol
     display->SetStatus(Lang::Strings::LOADING_PROTOCOL);
 
+#if CONFIG_IOT_PROTOCOL_XIAOZHI
+    // IoT 命令在主循环中执行
+    iot::ThingManager::GetInstance().SetScheduler([this](std::function<void()> callback) {
+        Schedule(std::move(callback));
+    });
+#endif
+
     // Add MCP common tools before initializing the protocol
 #if CONFIG_IOT_PROTOCOL_MCP
+    McpServer::GetInstance().OnOutgoingMessage([this](std::shared_ptr<EnvelopeBuffer> message) {
+        SendMcpMessage(std::move(message));
+    });
     McpServer::GetInstance().AddCommonTools();
 #endif
 
@@ -471,7 +481,8 @@ void Application::Start() {
         protocol_ = std::make_unique<MqttProtocol>();
     }
 
-    protocol_->OnNetworkError([this](const std::string& message) {
+    protocol_->OnNetworkError([this, &board](const std::string& message) {
+        board.ReportNetworkError();
         SetDeviceState(kDeviceStateIdle);
         Alert(Lang::Strings::ERROR, message.c_str(), "sad", Lang::Sounds::P3_EXCLAMATION);
     });
@@ -483,6 +494,9 @@ void Application::Start() {
     });
     protocol_->OnAudioChannelOpened([this, codec, &board]() {
         board.SetPowerSaveMode(false);
+        congestion_.Reset();
+        congestion_.SetAggregationAvailable(protocol_->IsAggregationEnabled());
+        protocol_->SetMinAggregationLevel(congestion_.aggregation_level());
         if (protocol_->server_sample_rate() != codec->output_sample_rate()) {
             ESP_LOGW(TAG, "Server sample rate %d does not match device output sample rate %d, resampling may cause distortion",
                 protocol_->server_sample_rate(), codec->output_sample_rate());
@@ -490,7 +504,8 @@ void Application::Start() {
 
 #if CONFIG_IOT_PROTOCOL_XIAOZHI
         auto& thing_manager = iot::ThingManager::GetInstance();
-        protocol_->SendIotDescriptors(thing_manager.GetDescriptorsJson());
+        protocol_->SendIotDescriptors(thing_manager.GetDescriptors(), thing_manager.descriptors_generation());
+        // 新会话发送一次完整状态，会话之外累积的变化也包含在内
         std::string states;
         if (thing_manager.GetStatesJson(states, false)) {
             protocol_->SendIotStates(states);
@@ -499,102 +514,18 @@ void Application::Start() {
     });
     protocol_->OnAudioChannelClosed([this, &board]() {
         board.SetPowerSaveMode(true);
+        board.UpdateLinkStats(LinkStats());
+        congestion_.LogStats();
+        protocol_->LogMcpStats();
+        McpServer::GetInstance().LogStats();
         Schedule([this]() {
             auto display = Board::GetInstance().GetDisplay();
             display->SetChatMessage("system", "");
             SetDeviceState(kDeviceStateIdle);
         });
     });
-    protocol_->OnIncomingJson([this, display](const cJSON* root) {
-        // Parse JSON data
-        auto type = cJSON_GetObjectItem(root, "type");
-        if (strcmp(type->valuestring, "tts") == 0) {
-            auto state = cJSON_GetObjectItem(root, "state");
-            if (strcmp(state->valuestring, "start") == 0) {
-                Schedule([this]() {
-                    aborted_ = false;
-                    if (device_state_ == kDeviceStateIdle || device_state_ == kDeviceStateListening) {
-                        SetDeviceState(kDeviceStateSpeaking);
-                    }
-                });
-            } else if (strcmp(state->valuestring, "stop") == 0) {
-                Schedule([this]() {
-                    background_task_->WaitForCompletion();
-                    if (device_state_ == kDeviceStateSpeaking) {
-                        if (listening_mode_ == kListeningModeManualStop) {
-                            SetDeviceState(kDeviceStateIdle);
-                        } else {
-                            SetDeviceState(kDeviceStateListening);
-                        }
-                    }
-                });
-            } else if (strcmp(state->valuestring, "sentence_start") == 0) {
-                auto text = cJSON_GetObjectItem(root, "text");
-                if (cJSON_IsString(text)) {
-                    ESP_LOGI(TAG, "<< %s", text->valuestring);
-                    Schedule([this, display, message = std::string(text->valuestring)]() {
-                        display->SetChatMessage("assistant", message.c_str());
-                    });
-                }
-            }
-        } else if (strcmp(type->valuestring, "stt") == 0) {
-            auto text = cJSON_GetObjectItem(root, "text");
-            if (cJSON_IsString(text)) {
-                ESP_LOGI(TAG, ">> %s", text->valuestring);
-                Schedule([this, display, message = std::string(text->valuestring)]() {
-                    display->SetChatMessage("user", message.c_str());
-                });
-            }
-        } else if (strcmp(type->valuestring, "llm") == 0) {
-            auto emotion = cJSON_GetObjectItem(root, "emotion");
-            if (cJSON_IsString(emotion)) {
-                Schedule([this, display, emotion_str = std::string(emotion->valuestring)]() {
-                    display->SetEmotion(emotion_str.c_str());
-                });
-            }
-#if CONFIG_IOT_PROTOCOL_MCP
-        } else if (strcmp(type->valuestring, "mcp") == 0) {
-            auto payload = cJSON_GetObjectItem(root, "payload");
-            if (cJSON_IsObject(payload)) {
-                McpServer::GetInstance().ParseMessage(payload);
-            }
-#endif
-#if CONFIG_IOT_PROTOCOL_XIAOZHI
-        } else if (strcmp(type->valuestring, "iot") == 0) {
-            auto commands = cJSON_GetObjectItem(root, "commands");
-            if (cJSON_IsArray(commands)) {
-                auto& thing_manager = iot::ThingManager::GetInstance();
-                for (int i = 0; i < cJSON_GetArraySize(commands); ++i) {
-                    auto command = cJSON_GetArrayItem(commands, i);
-                    thing_manager.Invoke(command);
-                }
-            }
-#endif
-        } else if (strcmp(type->valuestring, "system") == 0) {
-            auto command = cJSON_GetObjectItem(root, "command");
-            if (cJSON_IsString(command)) {
-                ESP_LOGI(TAG, "System command: %s", command->valuestring);
-                if (strcmp(command->valuestring, "reboot") == 0) {
-                    // Do a reboot if user requests a OTA update
-                    Schedule([this]() {
-                        Reboot();
-                    });
-                } else {
-                    ESP_LOGW(TAG, "Unknown system command: %s", command->valuestring);
-                }
-            }
-        } else if (strcmp(type->valuestring, "alert") == 0) {
-            auto status = cJSON_GetObjectItem(root, "status");
-            auto message = cJSON_GetObjectItem(root, "message");
-            auto emotion = cJSON_GetObjectItem(root, "emotion");
-            if (cJSON_IsString(status) && cJSON_IsString(message) && cJSON_IsString(emotion)) {
-                Alert(status->valuestring, message->valuestring, emotion->valuestring, Lang::Sounds::P3_VIBRATION);
-            } else {
-                ESP_LOGW(TAG, "Alert command requires status, message and emotion");
-            }
-        } else {
-            ESP_LOGW(TAG, "Unknown message type: %s", type->valuestring);
-        }
+    protocol_->OnIncomingMessage([this](const ControlMessage& message) {
+        OnIncomingMessage(message);
     });
     bool protocol_started = protocol_->Start();
 
@@ -605,6 +536,7 @@ void Application::Start() {
             std::lock_guard<std::mutex> lock(mutex_);
             if (audio_send_queue_.size() >= MAX_AUDIO_PACKETS_IN_QUEUE) {
                 ESP_LOGW(TAG, "Too many audio packets in queue, drop the newest packet");
+                congestion_.OnDropped(kAudioDropInputOverflow);
                 return;
             }
         }
@@ -632,6 +564,7 @@ void Application::Start() {
                 if (audio_send_queue_.size() >= MAX_AUDIO_PACKETS_IN_QUEUE) {
                     ESP_LOGW(TAG, "Too many audio packets in queue, drop the oldest packet");
                     audio_send_queue_.pop_front();
+                    congestion_.OnDropped(kAudioDropQueueFull);
                 }
                 audio_send_queue_.emplace_back(std::move(packet));
                 xEventGroupSetBits(event_group_, SEND_AUDIO_EVENT);
@@ -717,12 +650,152 @@ void Application::Start() {
     MainEventLoop();
 }
 
+// Dispatch table for the inbound control messages, indexed by the `type` field
+struct IncomingMessageHandler {
+    std::string_view type;
+    void (Application::*handler)(const ControlMessage& message);
+};
+
+void Application::OnIncomingMessage(const ControlMessage& message) {
+    static const IncomingMessageHandler handlers[] = {
+        {"tts", &Application::HandleTtsMessage},
+        {"stt", &Application::HandleSttMessage},
+        {"llm", &Application::HandleLlmMessage},
+#if CONFIG_IOT_PROTOCOL_MCP
+        {"mcp", &Application::HandleMcpMessage},
+#endif
+#if CONFIG_IOT_PROTOCOL_XIAOZHI
+        {"iot", &Application::HandleIotMessage},
+#endif
+        {"system", &Application::HandleSystemMessage},
+        {"alert", &Application::HandleAlertMessage},
+    };
+
+    for (const auto& entry : handlers) {
+        if (message.type == entry.type) {
+            (this->*entry.handler)(message);
+            return;
+        }
+    }
+    ESP_LOGW(TAG, "Unknown message type: %.*s", (int)message.type.raw.size(), message.type.raw.data());
+}
+
+void Application::HandleTtsMessage(const ControlMessage& message) {
+    if (message.state == "start") {
+        Schedule([this]() {
+            aborted_ = false;
+            if (device_state_ == kDeviceStateIdle || device_state_ == kDeviceStateListening) {
+                SetDeviceState(kDeviceStateSpeaking);
+            }
+        });
+    } else if (message.state == "stop") {
+        Schedule([this]() {
+            background_task_->WaitForCompletion();
+            if (device_state_ == kDeviceStateSpeaking) {
+                if (listening_mode_ == kListeningModeManualStop) {
+                    SetDeviceState(kDeviceStateIdle);
+                } else {
+                    SetDeviceState(kDeviceStateListening);
+                }
+            }
+        });
+    } else if (message.state == "sentence_start") {
+        if (message.text.present) {
+            auto text = message.text.str();
+            ESP_LOGI(TAG, "<< %s", text.c_str());
+            Schedule([this, text = std::move(text)]() {
+                auto display = Board::GetInstance().GetDisplay();
+                display->SetChatMessage("assistant", text.c_str());
+            });
+        }
+    }
+}
+
+void Application::HandleSttMessage(const ControlMessage& message) {
+    if (message.text.present) {
+        auto text = message.text.str();
+        ESP_LOGI(TAG, ">> %s", text.c_str());
+        Schedule([this, text = std::move(text)]() {
+            auto display = Board::GetInstance().GetDisplay();
+            display->SetChatMessage("user", text.c_str());
+        });
+    }
+}
+
+void Application::HandleLlmMessage(const ControlMessage& message) {
+    if (message.emotion.present) {
+        Schedule([this, emotion = message.emotion.str()]() {
+            auto display = Board::GetInstance().GetDisplay();
+            display->SetEmotion(emotion.c_str());
+        });
+    }
+}
+
+void Application::HandleMcpMessage(const ControlMessage& message) {
+#if CONFIG_IOT_PROTOCOL_MCP
+    // MCP payloads are nested JSON-RPC objects, fall back to the full DOM
+    auto root = cJSON_ParseWithLength(message.json, message.length);
+    auto payload = cJSON_GetObjectItem(root, "payload");
+    if (cJSON_IsObject(payload) || cJSON_IsArray(payload)) {
+        McpServer::GetInstance().ParseMessage(payload);
+    }
+    cJSON_Delete(root);
+#endif
+}
+
+void Application::HandleIotMessage(const ControlMessage& message) {
+#if CONFIG_IOT_PROTOCOL_XIAOZHI
+    auto root = cJSON_ParseWithLength(message.json, message.length);
+    auto commands = cJSON_GetObjectItem(root, "commands");
+    if (cJSON_IsArray(commands)) {
+        iot::ThingManager::GetInstance().InvokeCommands(commands);
+    }
+    cJSON_Delete(root);
+#endif
+}
+
+void Application::HandleSystemMessage(const ControlMessage& message) {
+    if (message.command.present) {
+        auto command = message.command.str();
+        ESP_LOGI(TAG, "System command: %s", command.c_str());
+        if (command == "reboot") {
+            // Do a reboot if user requests a OTA update
+            Schedule([this]() {
+                Reboot();
+            });
+        } else {
+            ESP_LOGW(TAG, "Unknown system command: %s", command.c_str());
+        }
+    }
+}
+
+void Application::HandleAlertMessage(const ControlMessage& message) {
+    if (message.status.present && message.message.present && message.emotion.present) {
+        Alert(message.status.str().c_str(), message.message.str().c_str(), message.emotion.str().c_str(), Lang::Sounds::P3_VIBRATION);
+    } else {
+        ESP_LOGW(TAG, "Alert command requires status, message and emotion");
+    }
+}
+
 void Application::OnClockTimer() {
     clock_ticks_++;
 
     auto display = Board::GetInstance().GetDisplay();
     display->UpdateStatusBar();
 
+    // Probe the link quality at a low rate while the audio channel is open
+    if (clock_ticks_ % LINK_PROBE_INTERVAL_SECONDS == 0 && protocol_ &&
+        (device_state_ == kDeviceStateListening || device_state_ == kDeviceStateSpeaking)) {
+        Schedule([this]() {
+            if (protocol_->IsAudioChannelOpened()) {
+                protocol_->SendPing();
+                auto stats = protocol_->GetLinkStats();
+                congestion_.OnLinkStats(stats);
+                Board::GetInstance().UpdateLinkStats(stats);
+            }
+        });
+    }
+
     // Print the debug info every 10 seconds
     if (clock_ticks_ % 10 == 0) {
         // SystemInfo::PrintTaskCpuUsage(pdMS_TO_TICKS(1000));
@@ -744,6 +817,24 @@ void Application::OnClockTimer() {
     }
 }
 
+LinkStats Application::GetLinkStats() {
+    if (!protocol_) {
+        return LinkStats();
+    }
+    return protocol_->GetLinkStats();
+}
+
+bool Application::MigrateProtocol() {
+    if (!protocol_) {
+        return true;
+    }
+    if (!protocol_->MigrateTransport()) {
+        ESP_LOGE(TAG, "Failed to migrate protocol to the new network");
+        return false;
+    }
+    return true;
+}
+
 // Add a async task to MainLoop
 void Application::Schedule(std::function<void()> callback) {
     {
@@ -767,10 +858,31 @@ void Application::MainEventLoop() {
             std::unique_lock<std::mutex> lock(mutex_);
             auto packets = std::move(audio_send_queue_);
             lock.unlock();
+
+            // 严重拥塞时先丢弃最旧的包，把积压控制在队列溢出之前
+            size_t excess = congestion_.ExcessBacklog(packets.size());
+            if (excess > 0) {
+                for (size_t i = 0; i < excess; i++) {
+                    packets.pop_front();
+                }
+                congestion_.OnDropped(kAudioDropCongestion, excess);
+            }
+
+            auto start_time = esp_timer_get_time();
+            size_t sent = 0;
+            bool success = true;
             for (auto& packet : packets) {
                 if (!protocol_->SendAudio(packet)) {
+                    success = false;
                     break;
                 }
+                sent++;
+            }
+
+            int aggregation_level = congestion_.aggregation_level();
+            congestion_.OnBatchSent(packets.size(), sent, success, (esp_timer_get_time() - start_time) / 1000);
+            if (congestion_.aggregation_level() != aggregation_level) {
+                protocol_->SetMinAggregationLevel(congestion_.aggregation_level());
             }
         }
 
@@ -1060,8 +1172,9 @@ void Application::UpdateIotStates() {
 #if CONFIG_IOT_PROTOCOL_XIAOZHI
     auto& thing_manager = iot::ThingManager::GetInstance();
     std::string states;
-    if (thing_manager.GetStatesJson(states, true)) {
-        protocol_->SendIotStates(states);
+    std::string things;
+    if (thing_manager.GetStatesJson(states, true, &things)) {
+        protocol_->SendIotStates(states, things);
     }
 #endif
 }
@@ -1105,10 +1218,10 @@ bool Application::CanEnterSleepMode() {
     return true;
 }
 
-void Application::SendMcpMessage(const std::string& payload) {
-    Schedule([this, payload]() {
+void Application::SendMcpMessage(std::shared_ptr<EnvelopeBuffer> message) {
+    Schedule([this, message = std::move(message)]() {
         if (protocol_) {
-            protocol_->SendMcpMessage(payload);
+            protocol_->SendMcpMessage(message);
         }
     });
 }
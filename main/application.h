@@ -18,6 +18,7 @@
 #include <opus_resampler.h>
 
 #include "protocol.h"
+#include "congestion_controller.h"
 #include "ota.h"
 #include "background_task.h"
 #include "audio_processor.h"
@@ -78,10 +79,14 @@ public:
     void WakeWordInvoke(const std::string& wake_word);
     void PlaySound(const std::string_view& sound);
     bool CanEnterSleepMode();
-    void SendMcpMessage(const std::string& payload);
+    // 只传递缓冲区的引用，信封由协议层在缓冲区的预留空间中就地补上
+    void SendMcpMessage(std::shared_ptr<EnvelopeBuffer> message);
     void SetAecMode(AecMode mode);
     AecMode GetAecMode() const { return aec_mode_; }
     BackgroundTask* GetBackgroundTask() const { return background_task_; }
+    LinkStats GetLinkStats();
+    // 板卡切换网络后在主循环中调用，重建协议连接；只在空闲状态下切换，不迁移进行中的会话
+    bool MigrateProtocol();
 
 private:
     Application();
@@ -111,6 +116,7 @@ private:
     BackgroundTask* background_task_ = nullptr;
     std::chrono::steady_clock::time_point last_output_time_;
     std::list<AudioStreamPacket> audio_send_queue_;
+    CongestionController congestion_{OPUS_FRAME_DURATION_MS, MAX_AUDIO_PACKETS_IN_QUEUE};
     std::list<AudioStreamPacket> audio_decode_queue_;
     std::condition_variable audio_decode_cv_;
     std::list<AudioStreamPacket> audio_testing_queue_;
@@ -139,6 +145,16 @@ private:
     void AudioLoop();
     void EnterAudioTestingMode();
     void ExitAudioTestingMode();
+
+    // Inbound control messages
+    void OnIncomingMessage(const ControlMessage& message);
+    void HandleTtsMessage(const ControlMessage& message);
+    void HandleSttMessage(const ControlMessage& message);
+    void HandleLlmMessage(const ControlMessage& message);
+    void HandleMcpMessage(const ControlMessage& message);
+    void HandleIotMessage(const ControlMessage& message);
+    void HandleSystemMessage(const ControlMessage& message);
+    void HandleAlertMessage(const ControlMessage& message);
 };
 
 #endif // _APPLICATION_H_
@@ -21,6 +21,28 @@ Board::Board() {
     ESP_LOGI(TAG, "UUID=%s SKU=%s", uuid_.c_str(), BOARD_NAME);
 }
 
+void Board::UpdateLinkStats(const LinkStats& stats) {
+    std::lock_guard<std::mutex> lock(link_stats_mutex_);
+    link_stats_ = stats;
+}
+
+LinkStats Board::GetLinkStats() {
+    std::lock_guard<std::mutex> lock(link_stats_mutex_);
+    return link_stats_;
+}
+
+void Board::AddLinkStatsToJson(cJSON* network) {
+    auto stats = GetLinkStats();
+    if (!stats.valid) {
+        return;
+    }
+    auto link = cJSON_CreateObject();
+    cJSON_AddNumberToObject(link, "rtt_ms", stats.rtt_ms);
+    cJSON_AddNumberToObject(link, "jitter_ms", stats.jitter_ms);
+    cJSON_AddNumberToObject(link, "loss_percent", (int)(stats.loss * 100 + 0.5f));
+    cJSON_AddItemToObject(network, "link", link);
+}
+
 std::string Board::GenerateUuid() {
     // UUID v4 需要 16 字节的随机数据
     uint8_t uuid[16];
@@ -6,10 +6,13 @@
 #include <mqtt.h>
 #include <udp.h>
 #include <string>
+#include <mutex>
+#include <cJSON.h>
 
 #include "led/led.h"
 #include "backlight.h"
 #include "camera.h"
+#include "link_probe.h"
 
 void* create_board();
 class AudioCodec;
@@ -19,9 +22,15 @@ private:
     Board(const Board&) = delete; // 禁用拷贝构造函数
     Board& operator=(const Board&) = delete; // 禁用赋值操作
 
+    std::mutex link_stats_mutex_;
+    LinkStats link_stats_;
+
 protected:
     Board();
     std::string GenerateUuid();
+    // 在 network 对象中附加当前会话的链路质量
+    void AddLinkStatsToJson(cJSON* network);
+    LinkStats GetLinkStats();
 
     // 软件生成的设备唯一标识
     std::string uuid_;
@@ -45,7 +54,13 @@ public:
     virtual WebSocket* CreateWebSocket() = 0;
     virtual Mqtt* CreateMqtt() = 0;
     virtual Udp* CreateUdp() = 0;
+    // 将主机名解析为 IP，网络模块自己负责 DNS 的板卡原样返回
+    virtual std::string ResolveHost(const std::string& host) { return host; }
     virtual void StartNetwork() = 0;
+    // 协议层报告连接失败，支持自动切换网络的板卡据此判断链路质量
+    virtual void ReportNetworkError() {}
+    // 由 Application 在每次链路探测后传入，会话结束时传入无效的统计
+    virtual void UpdateLinkStats(const LinkStats& stats);
     virtual const char* GetNetworkStateIcon() = 0;
     virtual bool GetBatteryLevel(int &level, bool& charging, bool& discharging);
     virtual std::string GetJson();
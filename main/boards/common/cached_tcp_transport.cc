@@ -0,0 +1,21 @@
+#include "cached_tcp_transport.h"
+#include "dns_cache.h"
+
+#include <esp_log.h>
+
+#define TAG "CachedTcpTransport"
+
+bool CachedTcpTransport::Connect(const char* host, int port) {
+    auto& dns_cache = DnsCache::GetInstance();
+    std::string address = dns_cache.Resolve(host);
+    if (TcpTransport::Connect(address.c_str(), port)) {
+        return true;
+    }
+    if (address == host) {
+        return false;
+    }
+    ESP_LOGW(TAG, "Failed to connect to cached address %s, resolving %s again", address.c_str(), host);
+    dns_cache.Invalidate(host);
+    address = dns_cache.Resolve(host);
+    return TcpTransport::Connect(address.c_str(), port);
+}
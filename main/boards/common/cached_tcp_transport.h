@@ -0,0 +1,15 @@
+#ifndef CACHED_TCP_TRANSPORT_H
+#define CACHED_TCP_TRANSPORT_H
+
+#include <tcp_transport.h>
+
+/*
+ * 通过 DnsCache 解析主机名的 TCP 传输层，用于 ws://
+ * 缓存的地址连接失败时作废缓存，重新解析后再试一次。
+ */
+class CachedTcpTransport : public TcpTransport {
+public:
+    bool Connect(const char* host, int port) override;
+};
+
+#endif // CACHED_TCP_TRANSPORT_H
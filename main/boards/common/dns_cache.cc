@@ -0,0 +1,204 @@
+#include "dns_cache.h"
+#include "settings.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <lwip/netdb.h>
+#include <arpa/inet.h>
+#include <sstream>
+
+#define TAG "DnsCache"
+
+// 本次启动内解析结果的有效期
+#define DNS_CACHE_TTL_SECONDS 600
+#define DNS_CACHE_MAX_ENTRIES 8
+
+DnsCache::DnsCache() {
+    // 格式：每行 "host address"
+    Settings settings("dns", false);
+    std::istringstream stream(settings.GetString("entries"));
+    std::string host, address;
+    while (stream >> host >> address) {
+        entries_[host].address = address;
+    }
+    while (entries_.size() > DNS_CACHE_MAX_ENTRIES) {
+        EvictLeastRecentlyUsed("");
+    }
+    ESP_LOGI(TAG, "Loaded %u cached hosts", (unsigned)entries_.size());
+}
+
+static bool IsIpAddress(const std::string& host) {
+    struct in_addr addr;
+    return inet_pton(AF_INET, host.c_str(), &addr) == 1;
+}
+
+bool DnsCache::Lookup(const std::string& host, std::string& address) {
+    struct addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), nullptr, &hints, &result) != 0 || result == nullptr) {
+        ESP_LOGW(TAG, "Failed to resolve %s", host.c_str());
+        return false;
+    }
+    char buffer[INET_ADDRSTRLEN];
+    auto sin = (struct sockaddr_in*)result->ai_addr;
+    inet_ntop(AF_INET, &sin->sin_addr, buffer, sizeof(buffer));
+    freeaddrinfo(result);
+    address = buffer;
+    return true;
+}
+
+std::string DnsCache::Resolve(const std::string& host) {
+    if (host.empty() || IsIpAddress(host)) {
+        return host;
+    }
+
+    bool refresh = false;
+    std::string address;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(host);
+        if (it != entries_.end()) {
+            auto& entry = it->second;
+            auto now = esp_timer_get_time();
+            entry.last_used_us = now;
+            if (entry.expire_us > now) {
+                hits_++;
+                return entry.address;
+            }
+            stale_hits_++;
+            ESP_LOGD(TAG, "Stale hit %s -> %s", host.c_str(), entry.address.c_str());
+            if (!entry.refreshing) {
+                entry.refreshing = true;
+                refresh = true;
+            }
+            address = entry.address;
+        } else {
+            misses_++;
+            ESP_LOGD(TAG, "Miss %s", host.c_str());
+        }
+    }
+
+    if (!address.empty()) {
+        // 在锁外创建后台任务
+        if (refresh) {
+            RefreshAsync(host);
+        }
+        return address;
+    }
+
+    if (!Lookup(host, address)) {
+        return host;
+    }
+    Update(host, address);
+    return address;
+}
+
+std::string DnsCache::ResolveCached(const std::string& host) {
+    if (host.empty() || IsIpAddress(host)) {
+        return host;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(host);
+    if (it == entries_.end()) {
+        misses_++;
+        return host;
+    }
+    auto now = esp_timer_get_time();
+    it->second.last_used_us = now;
+    if (it->second.expire_us > now) {
+        hits_++;
+    } else {
+        stale_hits_++;
+    }
+    return it->second.address;
+}
+
+std::string DnsCache::GetStatsJson() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string json = "{\"hits\":" + std::to_string(hits_);
+    json += ",\"stale_hits\":" + std::to_string(stale_hits_);
+    json += ",\"misses\":" + std::to_string(misses_);
+    json += ",\"entries\":" + std::to_string(entries_.size()) + "}";
+    return json;
+}
+
+void DnsCache::Invalidate(const std::string& host) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.erase(host);
+}
+
+void DnsCache::Update(const std::string& host, const std::string& address) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& entry = entries_[host];
+    bool changed = entry.address != address;
+    entry.address = address;
+    auto now = esp_timer_get_time();
+    entry.expire_us = now + DNS_CACHE_TTL_SECONDS * 1000000LL;
+    entry.last_used_us = now;
+    entry.refreshing = false;
+
+    while (entries_.size() > DNS_CACHE_MAX_ENTRIES) {
+        EvictLeastRecentlyUsed(host);
+        changed = true;
+    }
+    if (changed) {
+        Save();
+    }
+}
+
+// 调用方需持有 mutex_，从 NVS 恢复且本次启动未使用过的条目 last_used_us 为 0，最先淘汰
+void DnsCache::EvictLeastRecentlyUsed(const std::string& keep) {
+    auto oldest = entries_.end();
+    for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+        if (it->first != keep && (oldest == entries_.end() || it->second.last_used_us < oldest->second.last_used_us)) {
+            oldest = it;
+        }
+    }
+    if (oldest != entries_.end()) {
+        ESP_LOGD(TAG, "Evict %s", oldest->first.c_str());
+        entries_.erase(oldest);
+    }
+}
+
+void DnsCache::RefreshAsync(const std::string& host) {
+    auto arg = new std::string(host);
+    auto ret = xTaskCreate([](void* arg) {
+        auto host = (std::string*)arg;
+        auto& cache = DnsCache::GetInstance();
+        std::string address;
+        if (Lookup(*host, address)) {
+            cache.Update(*host, address);
+        } else {
+            std::lock_guard<std::mutex> lock(cache.mutex_);
+            auto it = cache.entries_.find(*host);
+            if (it != cache.entries_.end()) {
+                it->second.refreshing = false;
+            }
+        }
+        delete host;
+        vTaskDelete(NULL);
+    }, "dns_refresh", 4096, arg, 1, NULL);
+    if (ret != pdPASS) {
+        delete arg;
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(host);
+        if (it != entries_.end()) {
+            it->second.refreshing = false;
+        }
+    }
+}
+
+// 调用方需持有 mutex_
+void DnsCache::Save() {
+    std::string value;
+    for (const auto& [host, entry] : entries_) {
+        value += host + " " + entry.address + "\n";
+    }
+    Settings settings("dns", true);
+    settings.SetString("entries", value);
+}
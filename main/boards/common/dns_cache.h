@@ -0,0 +1,67 @@
+#ifndef DNS_CACHE_H
+#define DNS_CACHE_H
+
+#include <string>
+#include <map>
+#include <mutex>
+#include <cstdint>
+
+/*
+ * 持久化的 DNS 缓存
+ * 解析结果保存在 NVS 中，重启后第一次连接可以直接使用上次的地址，不必等待 DNS。
+ * 策略为 stale-while-revalidate：
+ *   - 本次启动内解析过且未超过 TTL 的地址直接返回
+ *   - 过期或从 NVS 恢复的地址先返回旧值，同时在后台重新解析
+ *   - 没有缓存时同步解析
+ * 条目数超过上限时淘汰最久未使用的。
+ * 只用于连接时可以直接使用 IP 的场景：Wi-Fi 下的 ws:// 和 wss://（TLS 校验仍用原始主机名）、UDP 音频通道。
+ * esp-mqtt 和 esp_http_client 按 URL 中的主机名做证书校验，不经过缓存；
+ * ML307 由模组解析域名，只能通过 ResolveCached 使用 Wi-Fi 下解析并保存过的地址。
+ */
+class DnsCache {
+public:
+    static DnsCache& GetInstance() {
+        static DnsCache instance;
+        return instance;
+    }
+    // 删除拷贝构造函数和赋值运算符
+    DnsCache(const DnsCache&) = delete;
+    DnsCache& operator=(const DnsCache&) = delete;
+
+    // 返回可直接连接的 IP 地址，解析失败时原样返回 host
+    std::string Resolve(const std::string& host);
+    // 只查缓存，不发起解析，没有缓存时原样返回 host（由网络模组自己解析）
+    std::string ResolveCached(const std::string& host);
+    // 连接失败时调用，下次重新同步解析
+    void Invalidate(const std::string& host);
+
+    uint32_t hits() const { return hits_; }
+    uint32_t stale_hits() const { return stale_hits_; }
+    uint32_t misses() const { return misses_; }
+    // {"hits":N,"stale_hits":N,"misses":N,"entries":N}
+    std::string GetStatsJson();
+
+private:
+    DnsCache();
+
+    struct Entry {
+        std::string address;
+        int64_t expire_us = 0;      // 0 表示从 NVS 恢复，尚未在本次启动中验证
+        int64_t last_used_us = 0;   // 用于淘汰最久未使用的条目
+        bool refreshing = false;
+    };
+
+    std::mutex mutex_;
+    std::map<std::string, Entry> entries_;
+    uint32_t hits_ = 0;
+    uint32_t stale_hits_ = 0;
+    uint32_t misses_ = 0;
+
+    static bool Lookup(const std::string& host, std::string& address);
+    void Update(const std::string& host, const std::string& address);
+    void RefreshAsync(const std::string& host);
+    void EvictLeastRecentlyUsed(const std::string& keep);
+    void Save();
+};
+
+#endif // DNS_CACHE_H
@@ -4,9 +4,19 @@
 #include "assets/lang_config.h"
 #include "settings.h"
 #include <esp_log.h>
+#include <esp_timer.h>
 
 static const char *TAG = "DualNetworkBoard";
 
+// 链路质量采样间隔
+#define FAILOVER_SAMPLE_INTERVAL_MS 5000
+// 切回 WiFi 时等待连接的时间
+#define FAILOVER_WIFI_CONNECT_TIMEOUT_MS 15000
+
+static const char* NetworkTypeName(NetworkType type) {
+    return type == NetworkType::WIFI ? "WiFi" : "ML307";
+}
+
 DualNetworkBoard::DualNetworkBoard(gpio_num_t ml307_tx_pin, gpio_num_t ml307_rx_pin, size_t ml307_rx_buffer_size, int32_t default_net_type) 
     : Board(), 
       ml307_tx_pin_(ml307_tx_pin), 
@@ -15,11 +25,18 @@ DualNetworkBoard::DualNetworkBoard(gpio_num_t ml307_tx_pin, gpio_num_t ml307_rx_
     
     // 从Settings加载网络类型
     network_type_ = LoadNetworkTypeFromSettings(default_net_type);
+    failover_policy_ = NetworkFailoverPolicy(network_type_);
     
     // 只初始化当前网络类型对应的板卡
     InitializeCurrentBoard();
 }
 
+DualNetworkBoard::~DualNetworkBoard() {
+    if (failover_task_ != nullptr) {
+        vTaskDelete(failover_task_);
+    }
+}
+
 NetworkType DualNetworkBoard::LoadNetworkTypeFromSettings(int32_t default_net_type) {
     Settings settings("network", true);
     int network_type = settings.GetInt("type", default_net_type); // 默认使用ML307 (1)
@@ -35,10 +52,10 @@ void DualNetworkBoard::SaveNetworkTypeToSettings(NetworkType type) {
 void DualNetworkBoard::InitializeCurrentBoard() {
     if (network_type_ == NetworkType::ML307) {
         ESP_LOGI(TAG, "Initialize ML307 board");
-        current_board_ = std::make_unique<Ml307Board>(ml307_tx_pin_, ml307_rx_pin_, ml307_rx_buffer_size_);
+        boards_[static_cast<int>(NetworkType::ML307)] = std::make_unique<Ml307Board>(ml307_tx_pin_, ml307_rx_pin_, ml307_rx_buffer_size_);
     } else {
         ESP_LOGI(TAG, "Initialize WiFi board");
-        current_board_ = std::make_unique<WifiBoard>();
+        boards_[static_cast<int>(NetworkType::WIFI)] = std::make_unique<WifiBoard>();
     }
 }
 
@@ -58,7 +75,7 @@ void DualNetworkBoard::SwitchNetworkType() {
 
  
 std::string DualNetworkBoard::GetBoardType() {
-    return current_board_->GetBoardType();
+    return current_board().GetBoardType();
 }
 
 void DualNetworkBoard::StartNetwork() {
@@ -69,37 +86,244 @@ void DualNetworkBoard::StartNetwork() {
     } else {
         display->SetStatus(Lang::Strings::DETECTING_MODULE);
     }
-    current_board_->StartNetwork();
+    current_board().StartNetwork();
+
+    if (failover_task_ == nullptr) {
+        xTaskCreate([](void* arg) {
+            static_cast<DualNetworkBoard*>(arg)->FailoverTask();
+        }, "network_failover", 4096, this, 2, &failover_task_);
+    }
+}
+
+void DualNetworkBoard::ReportNetworkError() {
+    connect_failures_++;
+}
+
+void DualNetworkBoard::UpdateLinkStats(const LinkStats& stats) {
+    Board::UpdateLinkStats(stats);
+    current_board().UpdateLinkStats(stats);
+}
+
+NetworkSample DualNetworkBoard::SampleNetwork() {
+    NetworkSample sample;
+    if (network_type_ == NetworkType::WIFI) {
+        sample.connected = static_cast<WifiBoard&>(current_board()).IsConnected(sample.rssi);
+    } else {
+        sample.connected = static_cast<Ml307Board&>(current_board()).IsNetworkReady();
+    }
+
+    // 链路探测只在会话期间进行，会话结束时统计被置为无效
+    auto stats = GetLinkStats();
+    if (stats.valid) {
+        sample.rtt_ms = stats.rtt_ms;
+        sample.loss = stats.loss;
+    }
+    sample.connect_failures = connect_failures_.exchange(0);
+    return sample;
+}
+
+void DualNetworkBoard::FailoverTask() {
+    while (true) {
+        vTaskDelay(pdMS_TO_TICKS(FAILOVER_SAMPLE_INTERVAL_MS));
+        CheckFailover();
+    }
+}
+
+void DualNetworkBoard::CheckFailover() {
+    auto& app = Application::GetInstance();
+    auto state = app.GetDeviceState();
+
+    if (switch_pending_) {
+        // 目标网络已建立，等会话结束再切换，期间目标网络断开则放弃
+        auto target = pending_target_;
+        if (!IsReady(target)) {
+            ESP_LOGW(TAG, "%s lost while waiting to switch", NetworkTypeName(target));
+            if (target == NetworkType::WIFI) {
+                static_cast<WifiBoard&>(*boards_[static_cast<int>(NetworkType::WIFI)]).StopNetwork();
+            }
+            switch_pending_ = false;
+            failed_switch_count_++;
+            std::lock_guard<std::mutex> lock(failover_mutex_);
+            failover_policy_.OnSwitched(target, false, esp_timer_get_time() / 1000);
+        } else if (state == kDeviceStateIdle) {
+            app.Schedule([this, target]() {
+                CommitSwitch(target);
+            });
+        }
+        return;
+    }
+
+    if (state != kDeviceStateIdle && state != kDeviceStateConnecting &&
+        state != kDeviceStateListening && state != kDeviceStateSpeaking) {
+        return;
+    }
+
+    auto sample = SampleNetwork();
+    FailoverAction action;
+    {
+        std::lock_guard<std::mutex> lock(failover_mutex_);
+        action = failover_policy_.Evaluate(network_type_, sample, esp_timer_get_time() / 1000);
+    }
+    if (action == FailoverAction::kNone) {
+        return;
+    }
+
+    auto target = action == FailoverAction::kSwitchToMl307 ? NetworkType::ML307 : NetworkType::WIFI;
+    if (target == NetworkType::ML307) {
+        ESP_LOGW(TAG, "WiFi degraded (connected: %d, rssi: %d, rtt: %d ms, loss: %.2f, failures: %d)",
+            sample.connected, sample.rssi, sample.rtt_ms, sample.loss, sample.connect_failures);
+    }
+    ESP_LOGI(TAG, "Bringing up %s", NetworkTypeName(target));
+    int64_t start_time = esp_timer_get_time();
+    if (!BringUp(target)) {
+        failed_switch_count_++;
+        ESP_LOGW(TAG, "%s is not available, stay on %s", NetworkTypeName(target), NetworkTypeName(network_type_));
+        std::lock_guard<std::mutex> lock(failover_mutex_);
+        failover_policy_.OnSwitched(target, false, esp_timer_get_time() / 1000);
+        return;
+    }
+
+    pending_target_ = target;
+    pending_bringup_ms_ = (esp_timer_get_time() - start_time) / 1000;
+    switch_pending_ = true;
+    if (app.GetDeviceState() == kDeviceStateIdle) {
+        app.Schedule([this, target]() {
+            CommitSwitch(target);
+        });
+    } else {
+        ESP_LOGI(TAG, "%s ready, switch after the current session", NetworkTypeName(target));
+    }
+}
+
+// 在 failover 任务中执行，可能阻塞数十秒（WiFi 连接、4G 注册）
+bool DualNetworkBoard::BringUp(NetworkType target) {
+    auto& board = boards_[static_cast<int>(target)];
+    if (target == NetworkType::ML307) {
+        if (!board) {
+            auto ml307_board = std::make_unique<Ml307Board>(ml307_tx_pin_, ml307_rx_pin_, ml307_rx_buffer_size_);
+            ml307_board->SetActive(false);
+            board = std::move(ml307_board);
+        }
+        return static_cast<Ml307Board&>(*board).TryStartNetwork();
+    }
+    if (!board) {
+        board = std::make_unique<WifiBoard>();
+    }
+    return static_cast<WifiBoard&>(*board).TryStartNetwork(FAILOVER_WIFI_CONNECT_TIMEOUT_MS);
+}
+
+bool DualNetworkBoard::IsReady(NetworkType target) {
+    auto& board = boards_[static_cast<int>(target)];
+    if (!board) {
+        return false;
+    }
+    if (target == NetworkType::ML307) {
+        return static_cast<Ml307Board&>(*board).IsNetworkReady();
+    }
+    int rssi;
+    return static_cast<WifiBoard&>(*board).IsConnected(rssi);
+}
+
+void DualNetworkBoard::CommitSwitch(NetworkType target) {
+    auto& app = Application::GetInstance();
+    if (!switch_pending_ || pending_target_ != target) {
+        return;
+    }
+    // 调度期间可能开始了新的会话，留给下一次采样
+    if (app.GetDeviceState() != kDeviceStateIdle) {
+        return;
+    }
+
+    auto previous = network_type_.load();
+    int64_t start_time = esp_timer_get_time();
+    int bringup_ms = pending_bringup_ms_;
+    ESP_LOGI(TAG, "Switching network %s -> %s", NetworkTypeName(previous), NetworkTypeName(target));
+    auto display = GetDisplay();
+    display->ShowNotification(target == NetworkType::ML307 ? Lang::Strings::SWITCH_TO_4G_NETWORK : Lang::Strings::SWITCH_TO_WIFI_NETWORK);
+
+    network_type_ = target;
+    if (previous == NetworkType::WIFI) {
+        static_cast<WifiBoard&>(*boards_[static_cast<int>(NetworkType::WIFI)]).StopNetwork();
+    } else {
+        static_cast<Ml307Board&>(*boards_[static_cast<int>(NetworkType::ML307)]).SetActive(false);
+    }
+    if (target == NetworkType::ML307) {
+        static_cast<Ml307Board&>(*boards_[static_cast<int>(NetworkType::ML307)]).SetActive(true);
+    }
+    if (target == failover_policy_.preferred()) {
+        failback_count_++;
+    } else {
+        failover_count_++;
+    }
+    {
+        std::lock_guard<std::mutex> lock(failover_mutex_);
+        failover_policy_.OnSwitched(target, true, esp_timer_get_time() / 1000);
+    }
+    switch_pending_ = false;
+
+    bool migrated = app.MigrateProtocol();
+    last_switch_ms_ = bringup_ms + (esp_timer_get_time() - start_time) / 1000;
+    ESP_LOGI(TAG, "Switched to %s in %d ms, protocol migrated: %d, failovers: %lu, failbacks: %lu, failed: %lu",
+        NetworkTypeName(target), last_switch_ms_.load(), migrated, failover_count_.load(), failback_count_.load(), failed_switch_count_.load());
+    display->SetStatus(Lang::Strings::STANDBY);
+    display->UpdateStatusBar(true);
 }
 
 Http* DualNetworkBoard::CreateHttp() {
-    return current_board_->CreateHttp();
+    return current_board().CreateHttp();
 }
 
 WebSocket* DualNetworkBoard::CreateWebSocket() {
-    return current_board_->CreateWebSocket();
+    return current_board().CreateWebSocket();
 }
 
 Mqtt* DualNetworkBoard::CreateMqtt() {
-    return current_board_->CreateMqtt();
+    return current_board().CreateMqtt();
 }
 
 Udp* DualNetworkBoard::CreateUdp() {
-    return current_board_->CreateUdp();
+    return current_board().CreateUdp();
+}
+
+std::string DualNetworkBoard::ResolveHost(const std::string& host) {
+    return current_board().ResolveHost(host);
 }
 
 const char* DualNetworkBoard::GetNetworkStateIcon() {
-    return current_board_->GetNetworkStateIcon();
+    return current_board().GetNetworkStateIcon();
 }
 
 void DualNetworkBoard::SetPowerSaveMode(bool enabled) {
-    current_board_->SetPowerSaveMode(enabled);
+    current_board().SetPowerSaveMode(enabled);
 }
 
 std::string DualNetworkBoard::GetBoardJson() {   
-    return current_board_->GetBoardJson();
+    return current_board().GetBoardJson();
 }
 
 std::string DualNetworkBoard::GetDeviceStatusJson() {
-    return current_board_->GetDeviceStatusJson();
+    auto json = current_board().GetDeviceStatusJson();
+    if (failover_count_ == 0 && failback_count_ == 0 && failed_switch_count_ == 0) {
+        return json;
+    }
+
+    auto root = cJSON_Parse(json.c_str());
+    auto network = cJSON_GetObjectItem(root, "network");
+    if (network == nullptr) {
+        cJSON_Delete(root);
+        return json;
+    }
+    auto failover = cJSON_CreateObject();
+    cJSON_AddStringToObject(failover, "preferred", failover_policy_.preferred() == NetworkType::WIFI ? "wifi" : "cellular");
+    cJSON_AddNumberToObject(failover, "failovers", failover_count_.load());
+    cJSON_AddNumberToObject(failover, "failbacks", failback_count_.load());
+    cJSON_AddNumberToObject(failover, "failed", failed_switch_count_.load());
+    cJSON_AddNumberToObject(failover, "last_switch_ms", last_switch_ms_.load());
+    cJSON_AddItemToObject(network, "failover", failover);
+
+    auto str = cJSON_PrintUnformatted(root);
+    json = str;
+    cJSON_free(str);
+    cJSON_Delete(root);
+    return json;
 }
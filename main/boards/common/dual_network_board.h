@@ -4,20 +4,36 @@
 #include "board.h"
 #include "wifi_board.h"
 #include "ml307_board.h"
+#include "network_failover_policy.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <atomic>
 #include <memory>
-
-//enum NetworkType
-enum class NetworkType {
-    WIFI,
-    ML307
-};
+#include <mutex>
 
 // 双网络板卡类，可以在WiFi和ML307之间切换
+// Settings 中保存的是首选网络，运行时根据链路质量自动切换到另一个网络并在恢复后切回，不需要重启
 class DualNetworkBoard : public Board {
 private:
-    // 使用基类指针存储当前活动的板卡
-    std::unique_ptr<Board> current_board_;
-    NetworkType network_type_ = NetworkType::ML307;  // Default to ML307
+    // 按 NetworkType 下标保存两块板卡，创建后不再释放：
+    // 其他任务可能仍持有旧板卡创建的连接对象，ML307 的串口也只能打开一次
+    std::unique_ptr<Board> boards_[2];
+    // 当前活动的板卡，先创建好板卡再写入，读者拿到的下标总是指向已构造的板卡
+    std::atomic<NetworkType> network_type_{NetworkType::ML307};  // Default to ML307
+
+    // 自动切换，采样和目标网络的建立都在 failover 任务中进行，不阻塞主循环
+    TaskHandle_t failover_task_ = nullptr;
+    std::mutex failover_mutex_;         // 保护 failover_policy_，切换本身在主循环中提交
+    NetworkFailoverPolicy failover_policy_{NetworkType::ML307};
+    // 已建立好、等待设备空闲时提交的目标网络
+    std::atomic<bool> switch_pending_{false};
+    NetworkType pending_target_ = NetworkType::ML307;
+    int pending_bringup_ms_ = 0;
+    std::atomic<int> connect_failures_{0};
+    std::atomic<uint32_t> failover_count_{0};       // 切到备用网络的次数
+    std::atomic<uint32_t> failback_count_{0};       // 切回首选网络的次数
+    std::atomic<uint32_t> failed_switch_count_{0};  // 目标网络未就绪而放弃的次数
+    std::atomic<int> last_switch_ms_{0};            // 最近一次切换的耗时：建立目标网络加协议迁移，不含等待会话结束
 
     // ML307的引脚配置
     gpio_num_t ml307_tx_pin_;
@@ -32,10 +48,20 @@ private:
 
     // 初始化当前网络类型对应的板卡
     void InitializeCurrentBoard();
+    Board& current_board() const { return *boards_[static_cast<int>(network_type_.load())]; }
+
+    // 在 failover 任务中采样链路质量，必要时建立目标网络
+    void FailoverTask();
+    void CheckFailover();
+    NetworkSample SampleNetwork();
+    bool BringUp(NetworkType target);
+    bool IsReady(NetworkType target);
+    // 在主循环中提交切换，只在设备空闲（会话之间）时进行
+    void CommitSwitch(NetworkType target);
  
 public:
     DualNetworkBoard(gpio_num_t ml307_tx_pin, gpio_num_t ml307_rx_pin, size_t ml307_rx_buffer_size = 4096, int32_t default_net_type = 1);
-    virtual ~DualNetworkBoard() = default;
+    virtual ~DualNetworkBoard();
  
     // 切换网络类型
     void SwitchNetworkType();
@@ -44,7 +70,7 @@ public:
     NetworkType GetNetworkType() const { return network_type_; }
     
     // 获取当前活动的板卡引用
-    Board& GetCurrentBoard() const { return *current_board_; }
+    Board& GetCurrentBoard() const { return current_board(); }
     
     // 重写Board接口
     virtual std::string GetBoardType() override;
@@ -53,6 +79,9 @@ public:
     virtual WebSocket* CreateWebSocket() override;
     virtual Mqtt* CreateMqtt() override;
     virtual Udp* CreateUdp() override;
+    virtual std::string ResolveHost(const std::string& host) override;
+    virtual void ReportNetworkError() override;
+    virtual void UpdateLinkStats(const LinkStats& stats) override;
     virtual const char* GetNetworkStateIcon() override;
     virtual void SetPowerSaveMode(bool enabled) override;
     virtual std::string GetBoardJson() override;
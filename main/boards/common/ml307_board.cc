@@ -4,6 +4,7 @@
 #include "display.h"
 #include "font_awesome_symbols.h"
 #include "assets/lang_config.h"
+#include "dns_cache.h"
 
 #include <esp_log.h>
 #include <esp_timer.h>
@@ -26,6 +27,19 @@ std::string Ml307Board::GetBoardType() {
 void Ml307Board::StartNetwork() {
     auto display = Board::GetInstance().GetDisplay();
     display->SetStatus(Lang::Strings::DETECTING_MODULE);
+    InitializeModem();
+    WaitForNetworkReady();
+}
+
+bool Ml307Board::TryStartNetwork() {
+    if (!modem_initialized_) {
+        InitializeModem();
+    }
+    return WaitForNetworkReady(false);
+}
+
+void Ml307Board::InitializeModem() {
+    modem_initialized_ = true;
     modem_.SetDebug(false);
     modem_.SetBaudRate(921600);
 
@@ -33,26 +47,37 @@ void Ml307Board::StartNetwork() {
     // If low power, the material ready event will be triggered by the modem because of a reset
     modem_.OnMaterialReady([this, &application]() {
         ESP_LOGI(TAG, "ML307 material ready");
+        if (!active_) {
+            // 备用网络的模组复位，下次切换时由 TryStartNetwork 重新注册
+            return;
+        }
         application.Schedule([this, &application]() {
             application.SetDeviceState(kDeviceStateIdle);
             WaitForNetworkReady();
         });
     });
-
-    WaitForNetworkReady();
 }
 
-void Ml307Board::WaitForNetworkReady() {
+bool Ml307Board::WaitForNetworkReady(bool report_error) {
     auto& application = Application::GetInstance();
-    auto display = Board::GetInstance().GetDisplay();
-    display->SetStatus(Lang::Strings::REGISTERING_NETWORK);
+    // 自动切换时在后台注册，不能覆盖会话中的状态栏
+    if (report_error) {
+        auto display = Board::GetInstance().GetDisplay();
+        display->SetStatus(Lang::Strings::REGISTERING_NETWORK);
+    }
     int result = modem_.WaitForNetworkReady();
     if (result == -1) {
-        application.Alert(Lang::Strings::ERROR, Lang::Strings::PIN_ERROR, "sad", Lang::Sounds::P3_ERR_PIN);
-        return;
+        ESP_LOGE(TAG, "SIM card PIN error");
+        if (report_error) {
+            application.Alert(Lang::Strings::ERROR, Lang::Strings::PIN_ERROR, "sad", Lang::Sounds::P3_ERR_PIN);
+        }
+        return false;
     } else if (result == -2) {
-        application.Alert(Lang::Strings::ERROR, Lang::Strings::REG_ERROR, "sad", Lang::Sounds::P3_ERR_REG);
-        return;
+        ESP_LOGE(TAG, "Network registration failed");
+        if (report_error) {
+            application.Alert(Lang::Strings::ERROR, Lang::Strings::REG_ERROR, "sad", Lang::Sounds::P3_ERR_REG);
+        }
+        return false;
     }
 
     // Print the ML307 modem information
@@ -68,6 +93,7 @@ void Ml307Board::WaitForNetworkReady() {
 
     // Enable sleep mode
     modem_.SetSleepMode(true, 30);
+    return true;
 }
 
 Http* Ml307Board::CreateHttp() {
@@ -75,6 +101,7 @@ Http* Ml307Board::CreateHttp() {
 }
 
 WebSocket* Ml307Board::CreateWebSocket() {
+    // TLS 在模组内完成，AT 指令不支持会话恢复，4G 下不使用 TlsSessionCache
     return new WebSocket(new Ml307SslTransport(modem_, 0));
 }
 
@@ -86,6 +113,11 @@ Udp* Ml307Board::CreateUdp() {
     return new Ml307Udp(modem_, 0);
 }
 
+std::string Ml307Board::ResolveHost(const std::string& host) {
+    // 模组自己解析域名，这里只使用 Wi-Fi 下解析并保存过的地址，省去一次模组内的 DNS 查询
+    return DnsCache::GetInstance().ResolveCached(host);
+}
+
 const char* Ml307Board::GetNetworkStateIcon() {
     if (!modem_.network_ready()) {
         return FONT_AWESOME_SIGNAL_OFF;
@@ -116,6 +148,7 @@ std::string Ml307Board::GetBoardJson() {
     board_json += "\"csq\":\"" + std::to_string(modem_.GetCsq()) + "\",";
     board_json += "\"imei\":\"" + modem_.GetImei() + "\",";
     board_json += "\"iccid\":\"" + modem_.GetIccid() + "\",";
+    board_json += "\"dns_cache\":" + DnsCache::GetInstance().GetStatsJson() + ",";
     board_json += "\"cereg\":" + modem_.GetRegistrationState().ToString() + "}";
     return board_json;
 }
@@ -144,7 +177,12 @@ std::string Ml307Board::GetDeviceStatusJson() {
      *     "network": {
      *         "type": "cellular",
      *         "carrier": "CHINA MOBILE",
-     *         "csq": 10
+     *         "csq": 10,
+     *         "link": {
+     *             "rtt_ms": 120,
+     *             "jitter_ms": 15,
+     *             "loss_percent": 0
+     *         }
      *     }
      * }
      */
@@ -198,6 +236,7 @@ std::string Ml307Board::GetDeviceStatusJson() {
     } else if (csq >= 25 && csq <= 31) {
         cJSON_AddStringToObject(network, "signal", "strong");
     }
+    AddLinkStatsToJson(network);
     cJSON_AddItemToObject(root, "network", network);
 
     auto json_str = cJSON_PrintUnformatted(root);
@@ -3,21 +3,31 @@
 
 #include "board.h"
 #include <ml307_at_modem.h>
+#include <atomic>
 
 class Ml307Board : public Board {
 protected:
     Ml307AtModem modem_;
+    bool modem_initialized_ = false;
+    // DualNetworkBoard 中作为备用网络时为 false，模组复位不影响正在进行的会话
+    std::atomic<bool> active_{true};
     virtual std::string GetBoardJson() override;
-    void WaitForNetworkReady();
+    void InitializeModem();
+    bool WaitForNetworkReady(bool report_error = true);
 
 public:
     Ml307Board(gpio_num_t tx_pin, gpio_num_t rx_pin, size_t rx_buffer_size = 4096);
     virtual std::string GetBoardType() override;
     virtual void StartNetwork() override;
+    // 自动切换网络时使用：注册失败只返回 false，不弹出告警
+    bool TryStartNetwork();
+    bool IsNetworkReady() { return modem_.network_ready(); }
+    void SetActive(bool active) { active_ = active; }
     virtual Http* CreateHttp() override;
     virtual WebSocket* CreateWebSocket() override;
     virtual Mqtt* CreateMqtt() override;
     virtual Udp* CreateUdp() override;
+    virtual std::string ResolveHost(const std::string& host) override;
     virtual const char* GetNetworkStateIcon() override;
     virtual void SetPowerSaveMode(bool enabled) override;
     virtual AudioCodec* GetAudioCodec() override { return nullptr; }
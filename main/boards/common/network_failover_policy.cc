@@ -0,0 +1,80 @@
+#include "network_failover_policy.h"
+
+// 判定链路质量差的阈值
+#define FAILOVER_RSSI_THRESHOLD -80
+#define FAILOVER_RTT_THRESHOLD_MS 1500
+#define FAILOVER_LOSS_THRESHOLD 0.3f
+// 连续多少次质量差的采样才切换，采样间隔 5 秒时约 15 秒
+#define FAILOVER_BAD_SAMPLES 3
+// 两次切换之间的最短间隔
+#define FAILOVER_MIN_DWELL_MS (60 * 1000)
+// 切到备用网络后首次尝试切回的等待时间，失败后加倍，直到上限
+#define FAILBACK_INITIAL_BACKOFF_MS (5 * 60 * 1000)
+#define FAILBACK_MAX_BACKOFF_MS (60 * 60 * 1000)
+
+bool NetworkFailoverPolicy::IsBad(NetworkType active, const NetworkSample& sample) const {
+    if (active == NetworkType::WIFI && sample.rssi < FAILOVER_RSSI_THRESHOLD) {
+        return true;
+    }
+    return !sample.connected ||
+        sample.rtt_ms > FAILOVER_RTT_THRESHOLD_MS ||
+        sample.loss > FAILOVER_LOSS_THRESHOLD ||
+        sample.connect_failures > 0;
+}
+
+FailoverAction NetworkFailoverPolicy::SwitchTo(NetworkType target) {
+    return target == NetworkType::WIFI ? FailoverAction::kSwitchToWifi : FailoverAction::kSwitchToMl307;
+}
+
+FailoverAction NetworkFailoverPolicy::Evaluate(NetworkType active, const NetworkSample& sample, int64_t now_ms) {
+    if (IsBad(active, sample)) {
+        // 连接失败比信号波动更可信，多计一次
+        bad_samples_ += sample.connect_failures > 0 ? 2 : 1;
+    } else {
+        bad_samples_ = 0;
+    }
+
+    if (last_switch_ms_ >= 0 && now_ms - last_switch_ms_ < FAILOVER_MIN_DWELL_MS) {
+        return FailoverAction::kNone;
+    }
+
+    if (active == preferred_) {
+        if (bad_samples_ >= FAILOVER_BAD_SAMPLES) {
+            return SwitchTo(active == NetworkType::WIFI ? NetworkType::ML307 : NetworkType::WIFI);
+        }
+        return FailoverAction::kNone;
+    }
+
+    if (bad_samples_ >= FAILOVER_BAD_SAMPLES || now_ms >= next_failback_ms_) {
+        return SwitchTo(preferred_);
+    }
+    return FailoverAction::kNone;
+}
+
+void NetworkFailoverPolicy::OnSwitched(NetworkType target, bool success, int64_t now_ms) {
+    last_switch_ms_ = now_ms;
+    bad_samples_ = 0;
+
+    if (target != preferred_) {
+        if (success) {
+            failback_backoff_ms_ = FAILBACK_INITIAL_BACKOFF_MS;
+            next_failback_ms_ = now_ms + failback_backoff_ms_;
+        }
+        return;
+    }
+
+    if (success) {
+        failback_backoff_ms_ = 0;
+        return;
+    }
+    // 仍停留在备用网络，退避后再试
+    if (failback_backoff_ms_ == 0) {
+        failback_backoff_ms_ = FAILBACK_INITIAL_BACKOFF_MS;
+    } else {
+        failback_backoff_ms_ *= 2;
+        if (failback_backoff_ms_ > FAILBACK_MAX_BACKOFF_MS) {
+            failback_backoff_ms_ = FAILBACK_MAX_BACKOFF_MS;
+        }
+    }
+    next_failback_ms_ = now_ms + failback_backoff_ms_;
+}
@@ -0,0 +1,57 @@
+#ifndef NETWORK_FAILOVER_POLICY_H
+#define NETWORK_FAILOVER_POLICY_H
+
+#include <cstdint>
+
+enum class NetworkType {
+    WIFI,
+    ML307
+};
+
+// 一次链路质量采样，由板卡周期性采集，也可以在测试中直接构造
+struct NetworkSample {
+    bool connected = true;      // 当前网络是否可用
+    int rssi = 0;               // WiFi 信号强度，4G 时忽略
+    int rtt_ms = 0;             // 协议层探测到的 RTT，0 表示未知
+    float loss = 0;             // 协议层探测到的丢包率
+    int connect_failures = 0;   // 自上次采样以来协议连接失败的次数
+};
+
+enum class FailoverAction {
+    kNone,
+    kSwitchToMl307,
+    kSwitchToWifi
+};
+
+/*
+ * WiFi / 4G 自动切换策略
+ * 只依赖传入的采样和时间，不访问硬件，便于用模拟数据验证。
+ * - 首选网络连续 N 次采样质量差（断开、WiFi 信号弱、RTT 过高、丢包或连接失败）时切到备用网络
+ * - 在备用网络上至少停留一段时间，再周期性尝试切回首选网络，失败时退避时间加倍
+ * - 备用网络本身也变差时立即尝试切回
+ * 每次切换之间有最短间隔，避免在临界点来回抖动。
+ */
+class NetworkFailoverPolicy {
+public:
+    explicit NetworkFailoverPolicy(NetworkType preferred) : preferred_(preferred) {}
+
+    NetworkType preferred() const { return preferred_; }
+    FailoverAction Evaluate(NetworkType active, const NetworkSample& sample, int64_t now_ms);
+    // 切换完成后调用，success 表示目标网络是否已就绪
+    void OnSwitched(NetworkType target, bool success, int64_t now_ms);
+
+    int bad_samples() const { return bad_samples_; }
+    int64_t failback_backoff_ms() const { return failback_backoff_ms_; }
+
+private:
+    NetworkType preferred_;
+    int bad_samples_ = 0;
+    int64_t last_switch_ms_ = -1;
+    int64_t next_failback_ms_ = 0;
+    int64_t failback_backoff_ms_ = 0;
+
+    bool IsBad(NetworkType active, const NetworkSample& sample) const;
+    static FailoverAction SwitchTo(NetworkType target);
+};
+
+#endif // NETWORK_FAILOVER_POLICY_H
@@ -0,0 +1,120 @@
+#include "resumable_tls_transport.h"
+#include "tls_session_cache.h"
+#include "dns_cache.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_crt_bundle.h>
+#include <cstring>
+
+#define TAG "TlsTransport"
+
+ResumableTlsTransport::ResumableTlsTransport() {
+}
+
+ResumableTlsTransport::~ResumableTlsTransport() {
+    Disconnect();
+}
+
+bool ResumableTlsTransport::Connect(const char* host, int port) {
+    Disconnect();
+
+    tls_ = esp_tls_init();
+    if (tls_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to allocate esp_tls");
+        return false;
+    }
+
+    esp_tls_cfg_t cfg = {};
+    cfg.crt_bundle_attach = esp_crt_bundle_attach;
+    cfg.timeout_ms = 10000;
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    auto& cache = TlsSessionCache::GetInstance();
+    // 握手期间持有引用，防止其他连接更新缓存时释放
+    auto session = cache.Get(host, port);
+    cfg.client_session = session.get();
+#endif
+
+    // 连接缓存的地址，证书校验和 SNI 仍使用原始主机名
+    std::string address = DnsCache::GetInstance().Resolve(host);
+    cfg.common_name = host;
+
+    auto start_time = esp_timer_get_time();
+    int ret = esp_tls_conn_new_sync(address.c_str(), address.size(), port, &cfg, tls_);
+    if (ret != 1 && address != host) {
+        // 缓存的地址可能已失效，重新解析后再试一次
+        ESP_LOGW(TAG, "Failed to connect to cached address %s, resolving %s again", address.c_str(), host);
+        DnsCache::GetInstance().Invalidate(host);
+        esp_tls_conn_destroy(tls_);
+        tls_ = esp_tls_init();
+        address = DnsCache::GetInstance().Resolve(host);
+        ret = tls_ != nullptr ? esp_tls_conn_new_sync(address.c_str(), address.size(), port, &cfg, tls_) : -1;
+    }
+    if (ret != 1) {
+        ESP_LOGE(TAG, "Failed to connect to %s:%d", host, port);
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+        // 票据可能已被服务器拒绝，下次重新完整握手
+        cache.Remove(host, port);
+#endif
+        if (tls_ != nullptr) {
+            esp_tls_conn_destroy(tls_);
+            tls_ = nullptr;
+        }
+        return false;
+    }
+    int elapsed_ms = (esp_timer_get_time() - start_time) / 1000;
+
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    ESP_LOGI(TAG, "Connected to %s:%d in %d ms (%s)", host, port, elapsed_ms,
+        session ? "ticket offered" : "full handshake");
+    cache.RecordHandshake(session != nullptr, elapsed_ms);
+    cache.LogStats();
+    cache.Store(host, port, esp_tls_get_client_session(tls_));
+#else
+    ESP_LOGI(TAG, "Connected to %s:%d in %d ms", host, port, elapsed_ms);
+#endif
+    connected_ = true;
+    return true;
+}
+
+void ResumableTlsTransport::Disconnect() {
+    connected_ = false;
+    if (tls_ != nullptr) {
+        esp_tls_conn_destroy(tls_);
+        tls_ = nullptr;
+    }
+}
+
+int ResumableTlsTransport::Send(const char* data, size_t length) {
+    if (tls_ == nullptr) {
+        return -1;
+    }
+    size_t total = 0;
+    while (total < length) {
+        ssize_t ret = esp_tls_conn_write(tls_, data + total, length - total);
+        if (ret == ESP_TLS_ERR_SSL_WANT_READ || ret == ESP_TLS_ERR_SSL_WANT_WRITE) {
+            continue;
+        }
+        if (ret <= 0) {
+            ESP_LOGE(TAG, "Send failed: %d", (int)ret);
+            connected_ = false;
+            return -1;
+        }
+        total += ret;
+    }
+    return total;
+}
+
+int ResumableTlsTransport::Receive(char* buffer, size_t bufferSize) {
+    if (tls_ == nullptr) {
+        return -1;
+    }
+    ssize_t ret;
+    do {
+        ret = esp_tls_conn_read(tls_, buffer, bufferSize);
+    } while (ret == ESP_TLS_ERR_SSL_WANT_READ || ret == ESP_TLS_ERR_SSL_WANT_WRITE);
+    if (ret <= 0) {
+        connected_ = false;
+    }
+    return ret;
+}
@@ -0,0 +1,28 @@
+#ifndef RESUMABLE_TLS_TRANSPORT_H
+#define RESUMABLE_TLS_TRANSPORT_H
+
+#include <transport.h>
+#include <esp_tls.h>
+
+#include <string>
+
+/*
+ * 基于 esp-tls 的 TLS 传输层
+ * 连接时从 TlsSessionCache 取出同一服务器的会话票据尝试恢复，握手成功后更新缓存，
+ * 空闲断开后重新连接可以省去完整握手。
+ */
+class ResumableTlsTransport : public Transport {
+public:
+    ResumableTlsTransport();
+    ~ResumableTlsTransport();
+
+    bool Connect(const char* host, int port) override;
+    void Disconnect() override;
+    int Send(const char* data, size_t length) override;
+    int Receive(char* buffer, size_t bufferSize) override;
+
+private:
+    esp_tls_t* tls_ = nullptr;
+};
+
+#endif // RESUMABLE_TLS_TRANSPORT_H
@@ -0,0 +1,81 @@
+#include "tls_session_cache.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+
+#define TAG "TlsSessionCache"
+
+// 会话票据的本地有效期，服务器通常签发 1~2 小时的票据
+#define TLS_SESSION_MAX_AGE_SECONDS 3600
+#define TLS_SESSION_MAX_ENTRIES 4
+
+static std::string MakeKey(const std::string& host, int port) {
+    return host + ":" + std::to_string(port);
+}
+
+std::shared_ptr<esp_tls_client_session_t> TlsSessionCache::Get(const std::string& host, int port) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = sessions_.find(MakeKey(host, port));
+    if (it == sessions_.end()) {
+        misses_++;
+        return nullptr;
+    }
+    if (esp_timer_get_time() - it->second.created_us > TLS_SESSION_MAX_AGE_SECONDS * 1000000LL) {
+        sessions_.erase(it);
+        misses_++;
+        return nullptr;
+    }
+    hits_++;
+    return it->second.session;
+}
+
+void TlsSessionCache::Store(const std::string& host, int port, esp_tls_client_session_t* session) {
+    if (session == nullptr) {
+        return;
+    }
+    std::shared_ptr<esp_tls_client_session_t> entry(session, esp_tls_free_client_session);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (sessions_.size() >= TLS_SESSION_MAX_ENTRIES && sessions_.find(MakeKey(host, port)) == sessions_.end()) {
+        // 淘汰最早的会话
+        auto oldest = sessions_.begin();
+        for (auto it = sessions_.begin(); it != sessions_.end(); ++it) {
+            if (it->second.created_us < oldest->second.created_us) {
+                oldest = it;
+            }
+        }
+        sessions_.erase(oldest);
+    }
+    sessions_[MakeKey(host, port)] = Entry{entry, esp_timer_get_time()};
+    ESP_LOGD(TAG, "Stored TLS session for %s:%d", host.c_str(), port);
+}
+
+void TlsSessionCache::Remove(const std::string& host, int port) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sessions_.erase(MakeKey(host, port));
+}
+
+void TlsSessionCache::RecordHandshake(bool ticket_offered, int elapsed_ms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& stats = ticket_offered ? resumed_handshakes_ : full_handshakes_;
+    stats.count++;
+    stats.total_ms += elapsed_ms;
+    if ((uint32_t)elapsed_ms > stats.max_ms) {
+        stats.max_ms = elapsed_ms;
+    }
+}
+
+void TlsSessionCache::LogStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto average = [](const HandshakeStats& stats) {
+        return stats.count > 0 ? stats.total_ms / stats.count : 0;
+    };
+    ESP_LOGI(TAG, "TLS handshakes: full %lu (avg %lu ms, max %lu ms), with ticket %lu (avg %lu ms, max %lu ms), "
+        "cache hits: %lu, misses: %lu",
+        full_handshakes_.count, average(full_handshakes_), full_handshakes_.max_ms,
+        resumed_handshakes_.count, average(resumed_handshakes_), resumed_handshakes_.max_ms, hits_, misses_);
+}
+
+#endif // CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
@@ -0,0 +1,68 @@
+#ifndef TLS_SESSION_CACHE_H
+#define TLS_SESSION_CACHE_H
+
+#include <esp_tls.h>
+
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+/*
+ * TLS 会话缓存
+ * 按 host:port 保存最近一次握手得到的会话（session ticket），下次连接同一服务器时用于简化握手，
+ * 省去证书链交换和非对称运算。需要开启 CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS。
+ * 只有 ResumableTlsTransport（Wi-Fi 下的 wss://）使用：esp-mqtt 和 esp_http_client 不提供会话票据接口，
+ * ML307 的 TLS 在模组内完成，这些连接每次都是完整握手。
+ * 同时按是否带票据分别统计握手耗时，用于对比会话恢复的收益。
+ */
+class TlsSessionCache {
+public:
+    static TlsSessionCache& GetInstance() {
+        static TlsSessionCache instance;
+        return instance;
+    }
+    // 删除拷贝构造函数和赋值运算符
+    TlsSessionCache(const TlsSessionCache&) = delete;
+    TlsSessionCache& operator=(const TlsSessionCache&) = delete;
+
+    // 返回的会话在 shared_ptr 存活期间有效，即使缓存被更新
+    std::shared_ptr<esp_tls_client_session_t> Get(const std::string& host, int port);
+    // 接管 session 的所有权
+    void Store(const std::string& host, int port, esp_tls_client_session_t* session);
+    void Remove(const std::string& host, int port);
+
+    uint32_t hits() const { return hits_; }
+    uint32_t misses() const { return misses_; }
+
+    // ticket_offered: 握手时带了缓存的票据（服务器可能仍然拒绝，走完整握手）
+    void RecordHandshake(bool ticket_offered, int elapsed_ms);
+    void LogStats();
+
+private:
+    TlsSessionCache() = default;
+
+    struct HandshakeStats {
+        uint32_t count = 0;
+        uint32_t total_ms = 0;
+        uint32_t max_ms = 0;
+    };
+
+    struct Entry {
+        std::shared_ptr<esp_tls_client_session_t> session;
+        int64_t created_us;
+    };
+
+    std::mutex mutex_;
+    std::map<std::string, Entry> sessions_;
+    uint32_t hits_ = 0;
+    uint32_t misses_ = 0;
+    HandshakeStats full_handshakes_;
+    HandshakeStats resumed_handshakes_;
+};
+
+#endif // CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+
+#endif // TLS_SESSION_CACHE_H
@@ -6,6 +6,9 @@
 #include "font_awesome_symbols.h"
 #include "settings.h"
 #include "assets/lang_config.h"
+#include "resumable_tls_transport.h"
+#include "cached_tcp_transport.h"
+#include "dns_cache.h"
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
@@ -13,9 +16,9 @@
 #include <esp_mqtt.h>
 #include <esp_udp.h>
 #include <tcp_transport.h>
-#include <tls_transport.h>
 #include <web_socket.h>
 #include <esp_log.h>
+#include <esp_wifi.h>
 #include <doit_blufi.h>
 #include <wifi_station.h>
 #include <wifi_configuration_ap.h>
@@ -114,6 +117,28 @@ void WifiBoard::StartNetwork() {
 
     vTaskDelay(pdMS_TO_TICKS(1000));
 }
+
+bool WifiBoard::TryStartNetwork(int timeout_ms) {
+    if (!blufi_storage_read_has_config()) {
+        ESP_LOGW(TAG, "No WiFi configured");
+        return false;
+    }
+
+    blufi_wifi_start_connect();
+    for (int waited = 0; waited < timeout_ms; waited += 1000) {
+        vTaskDelay(pdMS_TO_TICKS(1000));
+        if (blufi_wifi_sta_get_connect_status()) {
+            return true;
+        }
+    }
+    StopNetwork();
+    return false;
+}
+
+void WifiBoard::StopNetwork() {
+    esp_wifi_disconnect();
+    esp_wifi_stop();
+}
 #else
 void WifiBoard::StartNetwork() {
     // User can press BOOT button while starting to enter WiFi configuration mode
@@ -159,6 +184,26 @@ void WifiBoard::StartNetwork() {
         return;
     }
 }
+
+bool WifiBoard::TryStartNetwork(int timeout_ms) {
+    auto& ssid_manager = SsidManager::GetInstance();
+    if (ssid_manager.GetSsidList().empty()) {
+        ESP_LOGW(TAG, "No WiFi SSID configured");
+        return false;
+    }
+
+    auto& wifi_station = WifiStation::GetInstance();
+    wifi_station.Start();
+    if (!wifi_station.WaitForConnected(timeout_ms)) {
+        wifi_station.Stop();
+        return false;
+    }
+    return true;
+}
+
+void WifiBoard::StopNetwork() {
+    WifiStation::GetInstance().Stop();
+}
 #endif
 Http* WifiBoard::CreateHttp() {
     return new EspHttp();
@@ -168,14 +213,15 @@ WebSocket* WifiBoard::CreateWebSocket() {
     Settings settings("websocket", false);
     std::string url = settings.GetString("url");
     if (url.find("wss://") == 0) {
-        return new WebSocket(new TlsTransport());
+        return new WebSocket(new ResumableTlsTransport());
     } else {
-        return new WebSocket(new TcpTransport());
+        return new WebSocket(new CachedTcpTransport());
     }
     return nullptr;
 }
 
 Mqtt* WifiBoard::CreateMqtt() {
+    // esp-mqtt 自己管理 TLS 连接，不提供会话票据接口，mqtts:// 不经过 TlsSessionCache
     return new EspMqtt();
 }
 
@@ -183,6 +229,19 @@ Udp* WifiBoard::CreateUdp() {
     return new EspUdp();
 }
 
+std::string WifiBoard::ResolveHost(const std::string& host) {
+    return DnsCache::GetInstance().Resolve(host);
+}
+
+bool WifiBoard::IsConnected(int& rssi) {
+    wifi_ap_record_t ap_info;
+    if (esp_wifi_sta_get_ap_info(&ap_info) != ESP_OK) {
+        return false;
+    }
+    rssi = ap_info.rssi;
+    return true;
+}
+
 const char* WifiBoard::GetNetworkStateIcon() {
     if (wifi_config_mode_) {
         return FONT_AWESOME_WIFI;
@@ -212,6 +271,7 @@ std::string WifiBoard::GetBoardJson() {
         board_json += "\"channel\":" + std::to_string(wifi_station.GetChannel()) + ",";
         board_json += "\"ip\":\"" + wifi_station.GetIpAddress() + "\",";
     }
+    board_json += "\"dns_cache\":" + DnsCache::GetInstance().GetStatsJson() + ",";
     board_json += "\"mac\":\"" + SystemInfo::GetMacAddress() + "\"}";
     return board_json;
 }
@@ -253,7 +313,12 @@ std::string WifiBoard::GetDeviceStatusJson() {
      *     "network": {
      *         "type": "wifi",
      *         "ssid": "Xiaozhi",
-     *         "rssi": -60
+     *         "rssi": -60,
+     *         "link": {
+     *             "rtt_ms": 120,
+     *             "jitter_ms": 15,
+     *             "loss_percent": 0
+     *         }
      *     },
      *     "chip": {
      *         "temperature": 25
@@ -307,6 +372,7 @@ std::string WifiBoard::GetDeviceStatusJson() {
     } else {
         cJSON_AddStringToObject(network, "signal", "weak");
     }
+    AddLinkStatsToJson(network);
     cJSON_AddItemToObject(root, "network", network);
 
     // Chip
@@ -13,10 +13,15 @@ public:
     WifiBoard();
     virtual std::string GetBoardType() override;
     virtual void StartNetwork() override;
+    // 自动切换网络时使用：连接失败只返回 false，不进入配网模式
+    bool TryStartNetwork(int timeout_ms);
+    void StopNetwork();
+    bool IsConnected(int& rssi);
     virtual Http* CreateHttp() override;
     virtual WebSocket* CreateWebSocket() override;
     virtual Mqtt* CreateMqtt() override;
     virtual Udp* CreateUdp() override;
+    virtual std::string ResolveHost(const std::string& host) override;
     virtual const char* GetNetworkStateIcon() override;
     virtual void SetPowerSaveMode(bool enabled) override;
     virtual void ResetWifiConfiguration();
@@ -111,7 +111,9 @@ private:
                                         .text_font = &font_puhui_20_4,
                                         .icon_font = &font_awesome_20_4,
                                         .emoji_font = font_emoji_64_init(),
-                                    });
+                                    },
+                                    // 240x240 屏多占 9.6KB DMA 内存，换取渲染和 SPI 传输并行
+                                    kSpiLcdRenderDoubleBuffer);
     }
 
     void InitializeButtons() {
@@ -0,0 +1,68 @@
+#include "chat_window.h"
+
+#include <algorithm>
+
+ChatWindow::ChatWindow(size_t pool_size, size_t max_messages) : order_(pool_size), max_messages_(max_messages) {
+    for (size_t i = 0; i < pool_size; i++) {
+        order_[i] = i;
+    }
+}
+
+ChatWindowChange ChatWindow::Append(ChatRole role, const char* text) {
+    ChatWindowChange change;
+    bool tail = at_tail();
+    if (role == kChatRoleSystem && !history_.empty() && history_.back().role == kChatRoleSystem) {
+        // 折叠连续的系统消息：原地替换最后一条
+        history_.back().text = text;
+        change.folded = true;
+        if (tail && size_ > 0) {
+            change.slot = order_[size_ - 1];
+        } else {
+            Reset();
+            change.rebind_all = true;
+        }
+        return change;
+    }
+
+    history_.push_back({role, text});
+    if (history_.size() > max_messages_) {
+        history_.pop_front();
+        if (start_ > 0) {
+            start_--;
+        }
+    }
+
+    if (!tail) {
+        // 正在查看历史消息，直接跳回最新的窗口
+        Reset();
+        change.rebind_all = true;
+    } else if (!full()) {
+        change.slot = order_[size_++];
+        change.move_to_end = true;
+    } else {
+        // 回收最旧的槽位
+        std::rotate(order_.begin(), order_.begin() + 1, order_.end());
+        start_++;
+        change.slot = order_.back();
+        change.move_to_end = true;
+        change.recycled = true;
+    }
+    return change;
+}
+
+void ChatWindow::Reset() {
+    size_ = std::min(history_.size(), order_.size());
+    start_ = history_.size() - size_;
+}
+
+size_t ChatWindow::ShiftBackward() {
+    std::rotate(order_.rbegin(), order_.rbegin() + 1, order_.rend());
+    start_--;
+    return order_.front();
+}
+
+size_t ChatWindow::ShiftForward() {
+    std::rotate(order_.begin(), order_.begin() + 1, order_.end());
+    start_++;
+    return order_.back();
+}
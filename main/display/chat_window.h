@@ -0,0 +1,70 @@
+#ifndef CHAT_WINDOW_H
+#define CHAT_WINDOW_H
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <vector>
+
+enum ChatRole {
+    kChatRoleUser,
+    kChatRoleAssistant,
+    kChatRoleSystem,
+};
+
+struct ChatMessage {
+    ChatRole role;
+    std::string text;
+};
+
+// Append 的结果：整体重绑窗口，或者只绑定 slot 这一个槽位
+struct ChatWindowChange {
+    bool rebind_all = false;
+    size_t slot = 0;
+    bool move_to_end = false;   // 新启用或回收的槽位，需要移到列表末尾
+    bool recycled = false;
+    bool folded = false;        // 折叠进了上一条系统消息，没有新增消息
+};
+
+/*
+ * 虚拟化聊天列表的窗口记账，不涉及 LVGL
+ * history_ 只保存消息文本，最多 max_messages 条；槽位 0 ~ pool_size-1 对应预建的气泡，
+ * order_ 按显示顺序记录槽位，前 size_ 个绑定 history_[start_ ...] 这一段窗口。
+ * 新消息回收最旧的槽位，滚动到窗口边缘时再把槽位换绑到更早或更晚的消息。
+ */
+class ChatWindow {
+public:
+    ChatWindow(size_t pool_size, size_t max_messages);
+
+    // 追加一条消息，连续的系统消息折叠为最后一条
+    ChatWindowChange Append(ChatRole role, const char* text);
+    // 窗口跳回最新的消息，调用方按 slot(i)/message(i) 重绑全部槽位，其余槽位隐藏
+    void Reset();
+
+    // 只有窗口已满时才需要换绑
+    bool CanShiftBackward() const { return full() && start_ > 0; }
+    bool CanShiftForward() const { return full() && start_ + size_ < history_.size(); }
+    // 把最后一个槽位移到最前面，返回的槽位应绑定 message(0)
+    size_t ShiftBackward();
+    // 把第一个槽位移到最后面，返回的槽位应绑定 message(size() - 1)
+    size_t ShiftForward();
+
+    // 按显示顺序的第 index 个槽位及其绑定的消息，index < size()
+    size_t slot(size_t index) const { return order_[index]; }
+    const ChatMessage& message(size_t index) const { return history_[start_ + index]; }
+    size_t size() const { return size_; }
+    size_t start() const { return start_; }
+    size_t pool_size() const { return order_.size(); }
+    size_t history_size() const { return history_.size(); }
+    bool full() const { return size_ == order_.size(); }
+    bool at_tail() const { return start_ + size_ == history_.size(); }
+
+private:
+    std::deque<ChatMessage> history_;
+    std::vector<size_t> order_;
+    size_t max_messages_;
+    size_t start_ = 0;
+    size_t size_ = 0;
+};
+
+#endif // CHAT_WINDOW_H
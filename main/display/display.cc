@@ -19,6 +19,11 @@ Display::Display() {
     esp_timer_create_args_t notification_timer_args = {
         .callback = [](void *arg) {
             Display *display = static_cast<Display*>(arg);
+            if (display->command_queue_started_) {
+                display->command_queue_.HideNotification();
+                display->refresh_scheduler_.RequestWake();
+                return;
+            }
             DisplayLockGuard lock(display);
             lv_obj_add_flag(display->notification_label_, LV_OBJ_FLAG_HIDDEN);
             lv_obj_clear_flag(display->status_label_, LV_OBJ_FLAG_HIDDEN);
@@ -61,8 +66,99 @@ Display::~Display() {
     }
 }
 
-void Display::SetStatus(const char* status) {
+void Display::StartUpdateLoop() {
+    refresh_scheduler_.Start(display_);
+
+    // 与屏幕刷新同周期检查命令，LVGL 暂停时由 RequestWake 恢复
+    DisplayLockGuard lock(this);
+    command_timer_ = lv_timer_create(OnCommandTimer, LV_DEF_REFR_PERIOD, this);
+    command_queue_started_ = true;
+}
+
+void Display::StopUpdateLoop() {
+    if (command_timer_ == nullptr) {
+        return;
+    }
+    // 基类析构时 Lock 已不可用，且此时 LVGL 显示已被销毁，所以由派生类提前调用
     DisplayLockGuard lock(this);
+    lv_timer_delete(command_timer_);
+    command_timer_ = nullptr;
+    command_queue_started_ = false;
+}
+
+void Display::RecordLockWait(int64_t wait_us) {
+    lock_waits_++;
+    lock_wait_us_ += wait_us;
+    int64_t max_wait = lock_wait_max_us_;
+    while (wait_us > max_wait && !lock_wait_max_us_.compare_exchange_weak(max_wait, wait_us)) {
+    }
+}
+
+void Display::OnCommandTimer(lv_timer_t* timer) {
+    auto self = static_cast<Display*>(lv_timer_get_user_data(timer));
+    if (!self->command_queue_.empty()) {
+        self->DrainCommands();
+    }
+}
+
+void Display::DrainCommands() {
+    // 先处理通知到期，此时若已有新的通知排队，代次不同不会隐藏
+    if (command_queue_.TakeHideNotification() && notification_label_ != nullptr) {
+        lv_obj_add_flag(notification_label_, LV_OBJ_FLAG_HIDDEN);
+        lv_obj_clear_flag(status_label_, LV_OBJ_FLAG_HIDDEN);
+    }
+
+    // 状态和通知互相隐藏，按入队顺序执行
+    auto status = command_queue_.TakeStatus();
+    auto notification = command_queue_.TakeNotification();
+    if (status && notification && notification->seq < status->seq) {
+        ApplyNotification(notification->text.c_str(), notification->duration_ms);
+        notification.reset();
+    }
+    if (status) {
+        ApplyStatus(status->text.c_str());
+    }
+    if (notification) {
+        ApplyNotification(notification->text.c_str(), notification->duration_ms);
+    }
+
+    auto emotion = command_queue_.TakeEmotion();
+    if (emotion) {
+        if (emotion->is_icon) {
+            ApplyIcon(emotion->text.c_str());
+        } else {
+            ApplyEmotion(emotion->text.c_str());
+        }
+    }
+
+    command_queue_.TakeChatMessages([this](const ChatCommand& command) {
+        ApplyChatMessage(command.role.c_str(), command.content.c_str());
+    });
+
+    // 每分钟输出一次队列和等锁统计
+    int64_t now = esp_timer_get_time();
+    if (now - last_stats_time_ >= 60 * 1000 * 1000) {
+        last_stats_time_ = now;
+        command_queue_.LogStats();
+        uint32_t waits = lock_waits_.exchange(0);
+        int64_t wait_us = lock_wait_us_.exchange(0);
+        ESP_LOGI(TAG, "Lock waits: %lu, avg %lld us, max %lld us", waits, waits > 0 ? wait_us / waits : 0,
+            lock_wait_max_us_.exchange(0));
+        LogStats();
+    }
+}
+
+void Display::SetStatus(const char* status) {
+    if (!command_queue_started_) {
+        DisplayLockGuard lock(this);
+        ApplyStatus(status);
+        return;
+    }
+    command_queue_.SetStatus(status);
+    refresh_scheduler_.RequestWake();
+}
+
+void Display::ApplyStatus(const char* status) {
     if (status_label_ == nullptr) {
         return;
     }
@@ -76,7 +172,16 @@ void Display::ShowNotification(const std::string &notification, int duration_ms)
 }
 
 void Display::ShowNotification(const char* notification, int duration_ms) {
-    DisplayLockGuard lock(this);
+    if (!command_queue_started_) {
+        DisplayLockGuard lock(this);
+        ApplyNotification(notification, duration_ms);
+        return;
+    }
+    command_queue_.ShowNotification(notification, duration_ms);
+    refresh_scheduler_.RequestWake();
+}
+
+void Display::ApplyNotification(const char* notification, int duration_ms) {
     if (notification_label_ == nullptr) {
         return;
     }
@@ -91,31 +196,23 @@ void Display::ShowNotification(const char* notification, int duration_ms) {
 void Display::UpdateStatusBar(bool update_all) {
     auto& board = Board::GetInstance();
     auto codec = board.GetAudioCodec();
-
-    {
-        DisplayLockGuard lock(this);
-        if (mute_label_ == nullptr) {
-            return;
-        }
-
-        // 如果静音状态改变，则更新图标
-        if (codec->output_volume() == 0 && !muted_) {
-            muted_ = true;
-            lv_label_set_text(mute_label_, FONT_AWESOME_VOLUME_MUTE);
-        } else if (codec->output_volume() > 0 && muted_) {
-            muted_ = false;
-            lv_label_set_text(mute_label_, "");
-        }
+    if (mute_label_ == nullptr) {
+        return;
     }
 
+    // 先在锁外算出各图标的新状态，只有确实变化时才加一次锁更新界面，
+    // 避免每秒多次抢占显示锁，也不会无谓地唤醒 LVGL
     esp_pm_lock_acquire(pm_lock_);
+    bool muted = codec->output_volume() == 0;
+
     // 更新电池图标
+    const char* battery_icon = battery_icon_;
+    bool show_low_battery = low_battery_shown_;
     int battery_level;
     bool charging, discharging;
-    const char* icon = nullptr;
     if (board.GetBatteryLevel(battery_level, charging, discharging)) {
         if (charging) {
-            icon = FONT_AWESOME_BATTERY_CHARGING;
+            battery_icon = FONT_AWESOME_BATTERY_CHARGING;
         } else {
             const char* levels[] = {
                 FONT_AWESOME_BATTERY_EMPTY, // 0-19%
@@ -125,31 +222,13 @@ void Display::UpdateStatusBar(bool update_all) {
                 FONT_AWESOME_BATTERY_FULL, // 80-99%
                 FONT_AWESOME_BATTERY_FULL, // 100%
             };
-            icon = levels[battery_level / 20];
-        }
-        DisplayLockGuard lock(this);
-        if (battery_label_ != nullptr && battery_icon_ != icon) {
-            battery_icon_ = icon;
-            lv_label_set_text(battery_label_, battery_icon_);
-        }
-
-        if (low_battery_popup_ != nullptr) {
-            if (strcmp(icon, FONT_AWESOME_BATTERY_EMPTY) == 0 && discharging) {
-                if (lv_obj_has_flag(low_battery_popup_, LV_OBJ_FLAG_HIDDEN)) { // 如果低电量提示框隐藏，则显示
-                    lv_obj_clear_flag(low_battery_popup_, LV_OBJ_FLAG_HIDDEN);
-                    auto& app = Application::GetInstance();
-                    app.PlaySound(Lang::Sounds::P3_LOW_BATTERY);
-                }
-            } else {
-                // Hide the low battery popup when the battery is not empty
-                if (!lv_obj_has_flag(low_battery_popup_, LV_OBJ_FLAG_HIDDEN)) { // 如果低电量提示框显示，则隐藏
-                    lv_obj_add_flag(low_battery_popup_, LV_OBJ_FLAG_HIDDEN);
-                }
-            }
+            battery_icon = levels[battery_level / 20];
         }
+        show_low_battery = strcmp(battery_icon, FONT_AWESOME_BATTERY_EMPTY) == 0 && discharging;
     }
 
     // 每 10 秒更新一次网络图标
+    const char* network_icon = network_icon_;
     static int seconds_counter = 0;
     if (update_all || seconds_counter++ % 10 == 0) {
         // 升级固件时，不读取 4G 网络状态，避免占用 UART 资源
@@ -162,13 +241,45 @@ void Display::UpdateStatusBar(bool update_all) {
             kDeviceStateActivating,
         };
         if (std::find(allowed_states.begin(), allowed_states.end(), device_state) != allowed_states.end()) {
-            icon = board.GetNetworkStateIcon();
-            if (network_label_ != nullptr && icon != nullptr && network_icon_ != icon) {
-                DisplayLockGuard lock(this);
-                network_icon_ = icon;
+            const char* icon = board.GetNetworkStateIcon();
+            if (icon != nullptr) {
+                network_icon = icon;
+            }
+        }
+    }
+
+    bool low_battery_changed = low_battery_popup_ != nullptr && show_low_battery != low_battery_shown_;
+    if (muted != muted_ || battery_icon != battery_icon_ || network_icon != network_icon_ || low_battery_changed) {
+        DisplayLockGuard lock(this);
+        if (muted != muted_) {
+            muted_ = muted;
+            lv_label_set_text(mute_label_, muted_ ? FONT_AWESOME_VOLUME_MUTE : "");
+        }
+        if (battery_icon != battery_icon_) {
+            battery_icon_ = battery_icon;
+            if (battery_label_ != nullptr) {
+                lv_label_set_text(battery_label_, battery_icon_);
+            }
+        }
+        if (network_icon != network_icon_) {
+            network_icon_ = network_icon;
+            if (network_label_ != nullptr) {
                 lv_label_set_text(network_label_, network_icon_);
             }
         }
+        if (low_battery_changed) {
+            low_battery_shown_ = show_low_battery;
+            if (low_battery_shown_) {
+                lv_obj_clear_flag(low_battery_popup_, LV_OBJ_FLAG_HIDDEN);
+            } else {
+                lv_obj_add_flag(low_battery_popup_, LV_OBJ_FLAG_HIDDEN);
+            }
+        }
+    }
+
+    if (low_battery_changed && show_low_battery) {
+        auto& app = Application::GetInstance();
+        app.PlaySound(Lang::Sounds::P3_LOW_BATTERY);
     }
 
     esp_pm_lock_release(pm_lock_);
@@ -176,6 +287,36 @@ void Display::UpdateStatusBar(bool update_all) {
 
 
 void Display::SetEmotion(const char* emotion) {
+    if (!command_queue_started_) {
+        DisplayLockGuard lock(this);
+        ApplyEmotion(emotion);
+        return;
+    }
+    command_queue_.SetEmotion(emotion, false);
+    refresh_scheduler_.RequestWake();
+}
+
+void Display::SetIcon(const char* icon) {
+    if (!command_queue_started_) {
+        DisplayLockGuard lock(this);
+        ApplyIcon(icon);
+        return;
+    }
+    command_queue_.SetEmotion(icon, true);
+    refresh_scheduler_.RequestWake();
+}
+
+void Display::SetChatMessage(const char* role, const char* content) {
+    if (!command_queue_started_) {
+        DisplayLockGuard lock(this);
+        ApplyChatMessage(role, content);
+        return;
+    }
+    command_queue_.SetChatMessage(role, content);
+    refresh_scheduler_.RequestWake();
+}
+
+void Display::ApplyEmotion(const char* emotion) {
     struct Emotion {
         const char* icon;
         const char* text;
@@ -210,7 +351,6 @@ void Display::SetEmotion(const char* emotion) {
     auto it = std::find_if(emotions.begin(), emotions.end(),
         [&emotion_view](const Emotion& e) { return e.text == emotion_view; });
     
-    DisplayLockGuard lock(this);
     if (emotion_label_ == nullptr) {
         return;
     }
@@ -223,8 +363,7 @@ void Display::SetEmotion(const char* emotion) {
     }
 }
 
-void Display::SetIcon(const char* icon) {
-    DisplayLockGuard lock(this);
+void Display::ApplyIcon(const char* icon) {
     if (emotion_label_ == nullptr) {
         return;
     }
@@ -235,8 +374,7 @@ void Display::SetPreviewImage(const lv_img_dsc_t* image) {
     // Do nothing
 }
 
-void Display::SetChatMessage(const char* role, const char* content) {
-    DisplayLockGuard lock(this);
+void Display::ApplyChatMessage(const char* role, const char* content) {
     if (chat_message_label_ == nullptr) {
         return;
     }
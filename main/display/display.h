@@ -6,8 +6,12 @@
 #include <esp_log.h>
 #include <esp_pm.h>
 
+#include <atomic>
 #include <string>
 
+#include "lvgl_refresh_scheduler.h"
+#include "display_command_queue.h"
+
 struct DisplayFonts {
     const lv_font_t* text_font = nullptr;
     const lv_font_t* icon_font = nullptr;
@@ -19,12 +23,13 @@ public:
     Display();
     virtual ~Display();
 
-    virtual void SetStatus(const char* status);
-    virtual void ShowNotification(const char* notification, int duration_ms = 3000);
-    virtual void ShowNotification(const std::string &notification, int duration_ms = 3000);
-    virtual void SetEmotion(const char* emotion);
-    virtual void SetChatMessage(const char* role, const char* content);
-    virtual void SetIcon(const char* icon);
+    // 以下 setter 只把命令放进队列，由 LVGL 任务执行，调用方不等待显示锁
+    void SetStatus(const char* status);
+    void ShowNotification(const char* notification, int duration_ms = 3000);
+    void ShowNotification(const std::string &notification, int duration_ms = 3000);
+    void SetEmotion(const char* emotion);
+    void SetChatMessage(const char* role, const char* content);
+    void SetIcon(const char* icon);
     virtual void SetPreviewImage(const lv_img_dsc_t* image);
     virtual void SetTheme(const std::string& theme_name);
     virtual std::string GetTheme() { return current_theme_name_; }
@@ -39,6 +44,7 @@ protected:
     
     esp_pm_lock_handle_t pm_lock_ = nullptr;
     lv_display_t *display_ = nullptr;
+    LvglRefreshScheduler refresh_scheduler_;
 
     lv_obj_t *emotion_label_ = nullptr;
     lv_obj_t *network_label_ = nullptr;
@@ -53,11 +59,40 @@ protected:
     const char* battery_icon_ = nullptr;
     const char* network_icon_ = nullptr;
     bool muted_ = false;
+    bool low_battery_shown_ = false;
     std::string current_theme_name_;
 
     esp_timer_handle_t notification_timer_ = nullptr;
 
+    DisplayCommandQueue command_queue_;
+    lv_timer_t* command_timer_ = nullptr;
+    bool command_queue_started_ = false;
+    int64_t last_stats_time_ = 0;
+
+    // 统计：调用方在 DisplayLockGuard 中等待显示锁的次数和时间
+    std::atomic<uint32_t> lock_waits_ = 0;
+    std::atomic<int64_t> lock_wait_us_ = 0;
+    std::atomic<int64_t> lock_wait_max_us_ = 0;
+
+    // 启动刷新调度和命令队列，在 LVGL 显示创建、界面搭建完成后调用
+    void StartUpdateLoop();
+    // 停止命令队列，派生类在析构函数中销毁 LVGL 显示之前调用
+    void StopUpdateLoop();
+    // 在 LVGL 任务中（已持有显示锁）执行所有待处理的命令
+    void DrainCommands();
+    static void OnCommandTimer(lv_timer_t* timer);
+
+    // 命令的实际执行，调用时已持有显示锁
+    virtual void ApplyStatus(const char* status);
+    virtual void ApplyNotification(const char* notification, int duration_ms);
+    virtual void ApplyEmotion(const char* emotion);
+    virtual void ApplyChatMessage(const char* role, const char* content);
+    virtual void ApplyIcon(const char* icon);
+    // 派生类的统计，和命令队列统计一起每分钟在 LVGL 任务中输出
+    virtual void LogStats() {}
+
     friend class DisplayLockGuard;
+    void RecordLockWait(int64_t wait_us);
     virtual bool Lock(int timeout_ms = 0) = 0;
     virtual void Unlock() = 0;
 };
@@ -66,9 +101,11 @@ protected:
 class DisplayLockGuard {
 public:
     DisplayLockGuard(Display *display) : display_(display) {
+        int64_t start_time = esp_timer_get_time();
         if (!display_->Lock(30000)) {
             ESP_LOGE("Display", "Failed to lock display");
         }
+        display_->RecordLockWait(esp_timer_get_time() - start_time);
     }
     ~DisplayLockGuard() {
         display_->Unlock();
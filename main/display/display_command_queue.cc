@@ -0,0 +1,122 @@
+#include "display_command_queue.h"
+
+#include <esp_log.h>
+
+#define TAG "DisplayCommands"
+
+DisplayCommandQueue::~DisplayCommandQueue() {
+    delete status_.exchange(nullptr);
+    delete notification_.exchange(nullptr);
+    delete emotion_.exchange(nullptr);
+    ChatCommand* node = chat_head_.exchange(nullptr);
+    while (node != nullptr) {
+        ChatCommand* next = node->next;
+        delete node;
+        node = next;
+    }
+}
+
+template <typename T>
+void DisplayCommandQueue::Put(std::atomic<T*>& slot, T* command) {
+    T* old = slot.exchange(command);
+    if (old != nullptr) {
+        delete old;
+        coalesced_++;
+        enqueued_++;
+    } else {
+        OnEnqueued();
+    }
+}
+
+void DisplayCommandQueue::OnEnqueued() {
+    enqueued_++;
+    int depth = ++depth_;
+    int max_depth = max_depth_;
+    while (depth > max_depth && !max_depth_.compare_exchange_weak(max_depth, depth)) {
+    }
+}
+
+void DisplayCommandQueue::SetStatus(const char* status) {
+    Put(status_, new StatusCommand{++seq_, status});
+}
+
+void DisplayCommandQueue::ShowNotification(const char* notification, int duration_ms) {
+    Put(notification_, new NotificationCommand{++seq_, ++notification_generation_, notification, duration_ms});
+}
+
+void DisplayCommandQueue::HideNotification() {
+    hide_notification_ = true;
+}
+
+void DisplayCommandQueue::SetEmotion(const char* emotion, bool is_icon) {
+    Put(emotion_, new EmotionCommand{is_icon, emotion});
+}
+
+void DisplayCommandQueue::SetChatMessage(const char* role, const char* content) {
+    auto command = new ChatCommand{role, content};
+    command->next = chat_head_.load();
+    while (!chat_head_.compare_exchange_weak(command->next, command)) {
+    }
+    OnEnqueued();
+}
+
+std::unique_ptr<StatusCommand> DisplayCommandQueue::TakeStatus() {
+    std::unique_ptr<StatusCommand> command(status_.exchange(nullptr));
+    if (command) {
+        depth_--;
+    }
+    return command;
+}
+
+std::unique_ptr<NotificationCommand> DisplayCommandQueue::TakeNotification() {
+    std::unique_ptr<NotificationCommand> command(notification_.exchange(nullptr));
+    if (command) {
+        depth_--;
+        shown_generation_ = command->generation;
+    }
+    return command;
+}
+
+bool DisplayCommandQueue::TakeHideNotification() {
+    if (!hide_notification_.exchange(false)) {
+        return false;
+    }
+    // 定时器到期后又来了新的通知，由新通知重新计时
+    return shown_generation_ == notification_generation_;
+}
+
+std::unique_ptr<EmotionCommand> DisplayCommandQueue::TakeEmotion() {
+    std::unique_ptr<EmotionCommand> command(emotion_.exchange(nullptr));
+    if (command) {
+        depth_--;
+    }
+    return command;
+}
+
+void DisplayCommandQueue::TakeChatMessages(const std::function<void(const ChatCommand& command)>& callback) {
+    ChatCommand* node = chat_head_.exchange(nullptr);
+    if (node == nullptr) {
+        return;
+    }
+
+    // 反转成入队顺序
+    ChatCommand* ordered = nullptr;
+    while (node != nullptr) {
+        ChatCommand* next = node->next;
+        node->next = ordered;
+        ordered = node;
+        node = next;
+    }
+
+    while (ordered != nullptr) {
+        std::unique_ptr<ChatCommand> command(ordered);
+        ordered = ordered->next;
+        depth_--;
+        callback(*command);
+    }
+}
+
+void DisplayCommandQueue::LogStats() {
+    ESP_LOGI(TAG, "Enqueued: %lu, coalesced: %lu, max depth: %d",
+        (uint32_t)enqueued_, (uint32_t)coalesced_, (int)max_depth_);
+}
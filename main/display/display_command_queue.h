@@ -0,0 +1,85 @@
+#ifndef DISPLAY_COMMAND_QUEUE_H
+#define DISPLAY_COMMAND_QUEUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+struct StatusCommand {
+    uint32_t seq;
+    std::string text;
+};
+
+struct NotificationCommand {
+    uint32_t seq;
+    uint32_t generation;
+    std::string text;
+    int duration_ms;
+};
+
+// 表情和图标显示在同一个位置，共用一个槽
+struct EmotionCommand {
+    bool is_icon;
+    std::string text;
+};
+
+struct ChatCommand {
+    std::string role;
+    std::string content;
+    ChatCommand* next = nullptr;
+};
+
+/*
+ * 显示命令队列
+ * Display 的 setter 只把命令放进队列，由 LVGL 任务在持有显示锁时统一执行，调用方不再等待显示锁。
+ * 状态、通知、表情/图标只保留最新的一条：新命令直接替换尚未执行的旧命令（计为合并）。
+ * 聊天消息按顺序全部保留。入队和取出都只用原子操作，不加锁。
+ * 状态和通知会互相隐藏，带有序号以便按入队顺序执行。
+ */
+class DisplayCommandQueue {
+public:
+    ~DisplayCommandQueue();
+
+    void SetStatus(const char* status);
+    void ShowNotification(const char* notification, int duration_ms);
+    // 通知定时器到期，只有期间没有新的通知时才隐藏
+    void HideNotification();
+    void SetEmotion(const char* emotion, bool is_icon);
+    void SetChatMessage(const char* role, const char* content);
+
+    // 以下只在 LVGL 任务中调用
+    std::unique_ptr<StatusCommand> TakeStatus();
+    std::unique_ptr<NotificationCommand> TakeNotification();
+    bool TakeHideNotification();
+    std::unique_ptr<EmotionCommand> TakeEmotion();
+    // 按入队顺序回调所有聊天消息
+    void TakeChatMessages(const std::function<void(const ChatCommand& command)>& callback);
+
+    bool empty() const { return depth_ == 0 && !hide_notification_; }
+    void LogStats();
+
+private:
+    std::atomic<uint32_t> seq_ = 0;
+    std::atomic<uint32_t> notification_generation_ = 0;
+    uint32_t shown_generation_ = 0;
+    std::atomic<bool> hide_notification_ = false;
+
+    std::atomic<StatusCommand*> status_ = nullptr;
+    std::atomic<NotificationCommand*> notification_ = nullptr;
+    std::atomic<EmotionCommand*> emotion_ = nullptr;
+    std::atomic<ChatCommand*> chat_head_ = nullptr;     // 后进先出链表，取出时反转
+
+    // 统计
+    std::atomic<int> depth_ = 0;
+    std::atomic<int> max_depth_ = 0;
+    std::atomic<uint32_t> enqueued_ = 0;
+    std::atomic<uint32_t> coalesced_ = 0;
+
+    template <typename T>
+    void Put(std::atomic<T*>& slot, T* command);
+    void OnEnqueued();
+};
+
+#endif // DISPLAY_COMMAND_QUEUE_H
@@ -86,7 +86,7 @@ LcdDisplay::LcdDisplay(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_handle_
 
 SpiLcdDisplay::SpiLcdDisplay(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_handle_t panel,
                            int width, int height, int offset_x, int offset_y, bool mirror_x, bool mirror_y, bool swap_xy,
-                           DisplayFonts fonts)
+                           DisplayFonts fonts, SpiLcdRenderMode render_mode)
     : LcdDisplay(panel_io, panel, fonts, width, height) {
 
     // draw white
@@ -106,16 +106,24 @@ SpiLcdDisplay::SpiLcdDisplay(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_h
     lvgl_port_cfg_t port_cfg = ESP_LVGL_PORT_INIT_CONFIG();
     port_cfg.task_priority = 1;
     port_cfg.timer_period_ms = 50;
+    port_cfg.task_max_sleep_ms = LVGL_TASK_MAX_SLEEP_MS;
     lvgl_port_init(&port_cfg);
 
-    ESP_LOGI(TAG, "Adding LCD display");
+    if (render_mode == kSpiLcdRenderPsramFrame && heap_caps_get_free_size(MALLOC_CAP_SPIRAM) < width_ * height_ * sizeof(uint16_t) * 2) {
+        ESP_LOGW(TAG, "Not enough PSRAM for frame buffers, falling back to double buffering");
+        render_mode = kSpiLcdRenderDoubleBuffer;
+    }
+    bool psram_frame = render_mode == kSpiLcdRenderPsramFrame;
+
+    ESP_LOGI(TAG, "Adding LCD display, render mode: %d", render_mode);
     const lvgl_port_display_cfg_t display_cfg = {
         .io_handle = panel_io_,
         .panel_handle = panel_,
         .control_handle = nullptr,
-        .buffer_size = static_cast<uint32_t>(width_ * 20),
-        .double_buffer = false,
-        .trans_size = 0,
+        .buffer_size = static_cast<uint32_t>(psram_frame ? width_ * height_ : width_ * 20),
+        .double_buffer = render_mode != kSpiLcdRenderPartial,
+        // PSRAM 缓冲区不能直接用于 SPI DMA，经 SRAM 中转缓冲区分块传输
+        .trans_size = static_cast<uint32_t>(psram_frame ? width_ * 20 : 0),
         .hres = static_cast<uint32_t>(width_),
         .vres = static_cast<uint32_t>(height_),
         .monochrome = false,
@@ -126,8 +134,8 @@ SpiLcdDisplay::SpiLcdDisplay(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_h
         },
         .color_format = LV_COLOR_FORMAT_RGB565,
         .flags = {
-            .buff_dma = 1,
-            .buff_spiram = 0,
+            .buff_dma = !psram_frame,
+            .buff_spiram = psram_frame,
             .sw_rotate = 0,
             .swap_bytes = 1,
             .full_refresh = 0,
@@ -145,7 +153,16 @@ SpiLcdDisplay::SpiLcdDisplay(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_h
         lv_display_set_offset(display_, offset_x, offset_y);
     }
 
+    if (psram_frame) {
+        // 全帧缓冲区下按整行合并脏区域，减少分块传输和窗口设置的次数
+        lv_display_add_event_cb(display_, OnInvalidateArea, LV_EVENT_INVALIDATE_AREA, this);
+    }
+#if CONFIG_USE_DISPLAY_RENDER_STATS
+    EnableRenderStats();
+#endif
+
     SetupUI();
+    StartUpdateLoop();
 }
 
 // RGB LCD实现
@@ -168,6 +185,7 @@ RgbLcdDisplay::RgbLcdDisplay(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_h
     lvgl_port_cfg_t port_cfg = ESP_LVGL_PORT_INIT_CONFIG();
     port_cfg.task_priority = 1;
     port_cfg.timer_period_ms = 50;
+    port_cfg.task_max_sleep_ms = LVGL_TASK_MAX_SLEEP_MS;
     lvgl_port_init(&port_cfg);
 
     ESP_LOGI(TAG, "Adding LCD display");
@@ -209,6 +227,7 @@ RgbLcdDisplay::RgbLcdDisplay(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_h
     }
 
     SetupUI();
+    StartUpdateLoop();
 }
 
 MipiLcdDisplay::MipiLcdDisplay(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_handle_t panel,
@@ -226,6 +245,7 @@ MipiLcdDisplay::MipiLcdDisplay(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel
 
     ESP_LOGI(TAG, "Initialize LVGL port");
     lvgl_port_cfg_t port_cfg = ESP_LVGL_PORT_INIT_CONFIG();
+    port_cfg.task_max_sleep_ms = LVGL_TASK_MAX_SLEEP_MS;
     lvgl_port_init(&port_cfg);
 
     ESP_LOGI(TAG, "Adding LCD display");
@@ -267,9 +287,11 @@ MipiLcdDisplay::MipiLcdDisplay(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel
     }
 
     SetupUI();
+    StartUpdateLoop();
 }
 
 LcdDisplay::~LcdDisplay() {
+    StopUpdateLoop();
     // 然后再清理 LVGL 对象
     if (content_ != nullptr) {
         lv_obj_del(content_);
@@ -286,6 +308,16 @@ LcdDisplay::~LcdDisplay() {
     if (display_ != nullptr) {
         lv_display_delete(display_);
     }
+    lv_style_reset(&styles_.screen);
+    lv_style_reset(&styles_.container);
+    lv_style_reset(&styles_.status_bar);
+    lv_style_reset(&styles_.content);
+    lv_style_reset(&styles_.chat_row);
+    lv_style_reset(&styles_.bubble);
+    lv_style_reset(&styles_.user_bubble);
+    lv_style_reset(&styles_.assistant_bubble);
+    lv_style_reset(&styles_.system_bubble);
+    lv_style_reset(&styles_.popup);
 
     if (panel_ != nullptr) {
         esp_lcd_panel_del(panel_);
@@ -295,6 +327,58 @@ LcdDisplay::~LcdDisplay() {
     }
 }
 
+void LcdDisplay::EnableRenderStats() {
+    lv_display_add_event_cb(display_, OnRenderStatsEvent, LV_EVENT_RENDER_START, this);
+    lv_display_add_event_cb(display_, OnRenderStatsEvent, LV_EVENT_RENDER_READY, this);
+    lv_display_add_event_cb(display_, OnRenderStatsEvent, LV_EVENT_FLUSH_WAIT_START, this);
+    lv_display_add_event_cb(display_, OnRenderStatsEvent, LV_EVENT_FLUSH_WAIT_FINISH, this);
+}
+
+void LcdDisplay::OnRenderStatsEvent(lv_event_t* e) {
+    auto self = static_cast<LcdDisplay*>(lv_event_get_user_data(e));
+    int64_t now = esp_timer_get_time();
+    switch (lv_event_get_code(e)) {
+        case LV_EVENT_RENDER_START:
+            self->render_start_us_ = now;
+            if (self->render_window_start_us_ == 0) {
+                self->render_window_start_us_ = now;
+            }
+            break;
+        case LV_EVENT_FLUSH_WAIT_START:
+            self->flush_wait_start_us_ = now;
+            break;
+        case LV_EVENT_FLUSH_WAIT_FINISH:
+            self->flush_wait_us_ += now - self->flush_wait_start_us_;
+            break;
+        case LV_EVENT_RENDER_READY: {
+            self->render_time_us_ += now - self->render_start_us_;
+            self->rendered_frames_++;
+            // 窗口从第一帧开始计时，每 10 秒输出一次
+            int64_t window = now - self->render_window_start_us_;
+            if (window >= 10 * 1000 * 1000) {
+                uint32_t frames = self->rendered_frames_;
+                ESP_LOGI(TAG, "Render: %.1f fps, %lld us/frame, flush wait %lld us/frame (%d%% of render time)",
+                    frames * 1000000.0f / window, self->render_time_us_ / frames, self->flush_wait_us_ / frames,
+                    self->render_time_us_ > 0 ? (int)(self->flush_wait_us_ * 100 / self->render_time_us_) : 0);
+                self->render_window_start_us_ = 0;
+                self->render_time_us_ = 0;
+                self->flush_wait_us_ = 0;
+                self->rendered_frames_ = 0;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void LcdDisplay::OnInvalidateArea(lv_event_t* e) {
+    auto area = static_cast<lv_area_t*>(lv_event_get_param(e));
+    auto display = static_cast<lv_display_t*>(lv_event_get_current_target(e));
+    area->x1 = 0;
+    area->x2 = lv_display_get_horizontal_resolution(display) - 1;
+}
+
 bool LcdDisplay::Lock(int timeout_ms) {
     return lvgl_port_lock(timeout_ms);
 }
@@ -303,14 +387,58 @@ void LcdDisplay::Unlock() {
     lvgl_port_unlock();
 }
 
+void LcdDisplay::InitThemeStyles() {
+    lv_style_init(&styles_.screen);
+    lv_style_init(&styles_.container);
+    lv_style_init(&styles_.status_bar);
+    lv_style_init(&styles_.content);
+    lv_style_init(&styles_.chat_row);
+    lv_style_init(&styles_.bubble);
+    lv_style_init(&styles_.user_bubble);
+    lv_style_init(&styles_.assistant_bubble);
+    lv_style_init(&styles_.system_bubble);
+    lv_style_init(&styles_.popup);
+
+    // 与主题无关的属性只设置一次
+    lv_style_set_bg_opa(&styles_.chat_row, LV_OPA_TRANSP);
+    lv_style_set_border_width(&styles_.chat_row, 0);
+    lv_style_set_pad_all(&styles_.chat_row, 0);
+    lv_style_set_radius(&styles_.bubble, 8);
+    lv_style_set_border_width(&styles_.bubble, 1);
+    lv_style_set_pad_all(&styles_.bubble, 8);
+    lv_style_set_radius(&styles_.popup, 10);
+
+    ApplyThemeStyles();
+}
+
+void LcdDisplay::ApplyThemeStyles() {
+    lv_style_set_bg_color(&styles_.screen, current_theme_.background);
+    lv_style_set_text_color(&styles_.screen, current_theme_.text);
+    lv_style_set_bg_color(&styles_.container, current_theme_.background);
+    lv_style_set_border_color(&styles_.container, current_theme_.border);
+    lv_style_set_bg_color(&styles_.status_bar, current_theme_.background);
+    lv_style_set_text_color(&styles_.status_bar, current_theme_.text);
+    lv_style_set_bg_color(&styles_.content, current_theme_.chat_background);
+    lv_style_set_border_color(&styles_.content, current_theme_.border);
+    lv_style_set_text_color(&styles_.content, current_theme_.text);
+    lv_style_set_border_color(&styles_.bubble, current_theme_.border);
+    lv_style_set_bg_color(&styles_.user_bubble, current_theme_.user_bubble);
+    lv_style_set_text_color(&styles_.user_bubble, current_theme_.text);
+    lv_style_set_bg_color(&styles_.assistant_bubble, current_theme_.assistant_bubble);
+    lv_style_set_text_color(&styles_.assistant_bubble, current_theme_.text);
+    lv_style_set_bg_color(&styles_.system_bubble, current_theme_.system_bubble);
+    lv_style_set_text_color(&styles_.system_bubble, current_theme_.system_text);
+    lv_style_set_bg_color(&styles_.popup, current_theme_.low_battery);
+}
+
 #if CONFIG_USE_WECHAT_MESSAGE_STYLE
 void LcdDisplay::SetupUI() {
     DisplayLockGuard lock(this);
+    InitThemeStyles();
 
     auto screen = lv_screen_active();
     lv_obj_set_style_text_font(screen, fonts_.text_font, 0);
-    lv_obj_set_style_text_color(screen, current_theme_.text, 0);
-    lv_obj_set_style_bg_color(screen, current_theme_.background, 0);
+    lv_obj_add_style(screen, &styles_.screen, 0);
 
     /* Container */
     container_ = lv_obj_create(screen);
@@ -319,15 +447,13 @@ void LcdDisplay::SetupUI() {
     lv_obj_set_style_pad_all(container_, 0, 0);
     lv_obj_set_style_border_width(container_, 0, 0);
     lv_obj_set_style_pad_row(container_, 0, 0);
-    lv_obj_set_style_bg_color(container_, current_theme_.background, 0);
-    lv_obj_set_style_border_color(container_, current_theme_.border, 0);
+    lv_obj_add_style(container_, &styles_.container, 0);
 
     /* Status bar */
     status_bar_ = lv_obj_create(container_);
     lv_obj_set_size(status_bar_, LV_HOR_RES, LV_SIZE_CONTENT);
     lv_obj_set_style_radius(status_bar_, 0, 0);
-    lv_obj_set_style_bg_color(status_bar_, current_theme_.background, 0);
-    lv_obj_set_style_text_color(status_bar_, current_theme_.text, 0);
+    lv_obj_add_style(status_bar_, &styles_.status_bar, 0);
     
     /* Content - Chat area */
     content_ = lv_obj_create(container_);
@@ -335,8 +461,7 @@ void LcdDisplay::SetupUI() {
     lv_obj_set_width(content_, LV_HOR_RES);
     lv_obj_set_flex_grow(content_, 1);
     lv_obj_set_style_pad_all(content_, 10, 0);
-    lv_obj_set_style_bg_color(content_, current_theme_.chat_background, 0); // Background for chat area
-    lv_obj_set_style_border_color(content_, current_theme_.border, 0); // Border color for chat area
+    lv_obj_add_style(content_, &styles_.content, 0);
 
     // Enable scrolling for chat content
     lv_obj_set_scrollbar_mode(content_, LV_SCROLLBAR_MODE_OFF);
@@ -347,8 +472,12 @@ void LcdDisplay::SetupUI() {
     lv_obj_set_flex_align(content_, LV_FLEX_ALIGN_START, LV_FLEX_ALIGN_START, LV_FLEX_ALIGN_START);
     lv_obj_set_style_pad_row(content_, 10, 0); // Space between messages
 
-    // We'll create chat messages dynamically in SetChatMessage
+    // 预建聊天气泡池，SetChatMessage 只做换绑
     chat_message_label_ = nullptr;
+    CreateBubblePool();
+    lv_obj_add_event_cb(content_, OnChatScrollEnd, LV_EVENT_SCROLL_END, this);
+    lv_display_add_event_cb(display_, OnRenderEvent, LV_EVENT_RENDER_START, this);
+    lv_display_add_event_cb(display_, OnRenderEvent, LV_EVENT_RENDER_READY, this);
 
     /* Status bar */
     lv_obj_set_flex_flow(status_bar_, LV_FLEX_FLOW_ROW);
@@ -366,14 +495,12 @@ void LcdDisplay::SetupUI() {
     // 创建emotion_label_在状态栏最左侧
     emotion_label_ = lv_label_create(status_bar_);
     lv_obj_set_style_text_font(emotion_label_, &font_awesome_30_4, 0);
-    lv_obj_set_style_text_color(emotion_label_, current_theme_.text, 0);
     lv_label_set_text(emotion_label_, FONT_AWESOME_AI_CHIP);
     lv_obj_set_style_margin_right(emotion_label_, 5, 0); // 添加右边距，与后面的元素分隔
 
     notification_label_ = lv_label_create(status_bar_);
     lv_obj_set_flex_grow(notification_label_, 1);
     lv_obj_set_style_text_align(notification_label_, LV_TEXT_ALIGN_CENTER, 0);
-    lv_obj_set_style_text_color(notification_label_, current_theme_.text, 0);
     lv_label_set_text(notification_label_, "");
     lv_obj_add_flag(notification_label_, LV_OBJ_FLAG_HIDDEN);
 
@@ -381,246 +508,288 @@ void LcdDisplay::SetupUI() {
     lv_obj_set_flex_grow(status_label_, 1);
     lv_label_set_long_mode(status_label_, LV_LABEL_LONG_SCROLL_CIRCULAR);
     lv_obj_set_style_text_align(status_label_, LV_TEXT_ALIGN_CENTER, 0);
-    lv_obj_set_style_text_color(status_label_, current_theme_.text, 0);
     lv_label_set_text(status_label_, Lang::Strings::INITIALIZING);
     
     mute_label_ = lv_label_create(status_bar_);
     lv_label_set_text(mute_label_, "");
     lv_obj_set_style_text_font(mute_label_, fonts_.icon_font, 0);
-    lv_obj_set_style_text_color(mute_label_, current_theme_.text, 0);
 
     network_label_ = lv_label_create(status_bar_);
     lv_label_set_text(network_label_, "");
     lv_obj_set_style_text_font(network_label_, fonts_.icon_font, 0);
-    lv_obj_set_style_text_color(network_label_, current_theme_.text, 0);
     lv_obj_set_style_margin_left(network_label_, 5, 0); // 添加左边距，与前面的元素分隔
 
     battery_label_ = lv_label_create(status_bar_);
     lv_label_set_text(battery_label_, "");
     lv_obj_set_style_text_font(battery_label_, fonts_.icon_font, 0);
-    lv_obj_set_style_text_color(battery_label_, current_theme_.text, 0);
     lv_obj_set_style_margin_left(battery_label_, 5, 0); // 添加左边距，与前面的元素分隔
 
     low_battery_popup_ = lv_obj_create(screen);
     lv_obj_set_scrollbar_mode(low_battery_popup_, LV_SCROLLBAR_MODE_OFF);
     lv_obj_set_size(low_battery_popup_, LV_HOR_RES * 0.9, fonts_.text_font->line_height * 2);
     lv_obj_align(low_battery_popup_, LV_ALIGN_BOTTOM_MID, 0, 0);
-    lv_obj_set_style_bg_color(low_battery_popup_, current_theme_.low_battery, 0);
-    lv_obj_set_style_radius(low_battery_popup_, 10, 0);
+    lv_obj_add_style(low_battery_popup_, &styles_.popup, 0);
     low_battery_label_ = lv_label_create(low_battery_popup_);
     lv_label_set_text(low_battery_label_, Lang::Strings::BATTERY_NEED_CHARGE);
     lv_obj_set_style_text_color(low_battery_label_, lv_color_white(), 0);
     lv_obj_center(low_battery_label_);
     lv_obj_add_flag(low_battery_popup_, LV_OBJ_FLAG_HIDDEN);
 }
-#if CONFIG_IDF_TARGET_ESP32P4
-#define  MAX_MESSAGES 40
-#else
-#define  MAX_MESSAGES 20
-#endif
-void LcdDisplay::SetChatMessage(const char* role, const char* content) {
-    DisplayLockGuard lock(this);
-    if (content_ == nullptr) {
-        return;
+static_assert(CHAT_BUBBLE_POOL_SIZE < MAX_MESSAGES, "Bubble pool must be smaller than the message history");
+
+void LcdDisplay::CreateBubblePool() {
+    for (int i = 0; i < CHAT_BUBBLE_POOL_SIZE; i++) {
+        ChatBubble slot;
+        // 全宽透明行容器，用于控制气泡左/右/居中对齐
+        slot.row = lv_obj_create(content_);
+        lv_obj_set_width(slot.row, lv_pct(100));
+        lv_obj_set_height(slot.row, LV_SIZE_CONTENT);
+        lv_obj_add_style(slot.row, &styles_.chat_row, 0);
+        lv_obj_set_scrollbar_mode(slot.row, LV_SCROLLBAR_MODE_OFF);
+        lv_obj_remove_flag(slot.row, LV_OBJ_FLAG_SCROLLABLE);
+        lv_obj_add_flag(slot.row, LV_OBJ_FLAG_HIDDEN);
+
+        slot.bubble = lv_obj_create(slot.row);
+        lv_obj_set_scrollbar_mode(slot.bubble, LV_SCROLLBAR_MODE_OFF);
+        lv_obj_remove_flag(slot.bubble, LV_OBJ_FLAG_SCROLLABLE);
+        lv_obj_add_style(slot.bubble, &styles_.bubble, 0);
+        lv_obj_set_size(slot.bubble, LV_SIZE_CONTENT, LV_SIZE_CONTENT);
+
+        slot.label = lv_label_create(slot.bubble);
+        lv_label_set_long_mode(slot.label, LV_LABEL_LONG_WRAP);
+        lv_obj_set_style_text_font(slot.label, fonts_.text_font, 0);
+        bubble_pool_.push_back(slot);
     }
-    
-    //避免出现空的消息框
-    if(strlen(content) == 0) return;
-    
-    // 检查消息数量是否超过限制
-    uint32_t child_count = lv_obj_get_child_cnt(content_);
-    if (child_count >= MAX_MESSAGES) {
-        // 删除最早的消息（第一个子对象）
-        lv_obj_t* first_child = lv_obj_get_child(content_, 0);
-        lv_obj_t* last_child = lv_obj_get_child(content_, child_count - 1);
-        if (first_child != nullptr) {
-            lv_obj_del(first_child);
-        }
-        // Scroll to the last message immediately
-        if (last_child != nullptr) {
-            lv_obj_scroll_to_view_recursive(last_child, LV_ANIM_OFF);
-        }
+}
+
+lv_style_t* LcdDisplay::GetBubbleStyle(ChatRole role) {
+    switch (role) {
+        case kChatRoleUser:
+            return &styles_.user_bubble;
+        case kChatRoleSystem:
+            return &styles_.system_bubble;
+        default:
+            return &styles_.assistant_bubble;
     }
-    
-    // 折叠系统消息（如果是系统消息，检查最后一个消息是否也是系统消息）
-    if (strcmp(role, "system") == 0 && child_count > 0) {
-        // 获取最后一个消息容器
-        lv_obj_t* last_container = lv_obj_get_child(content_, child_count - 1);
-        if (last_container != nullptr && lv_obj_get_child_cnt(last_container) > 0) {
-            // 获取容器内的气泡
-            lv_obj_t* last_bubble = lv_obj_get_child(last_container, 0);
-            if (last_bubble != nullptr) {
-                // 检查气泡类型是否为系统消息
-                void* bubble_type_ptr = lv_obj_get_user_data(last_bubble);
-                if (bubble_type_ptr != nullptr && strcmp((const char*)bubble_type_ptr, "system") == 0) {
-                    // 如果最后一个消息也是系统消息，则删除它
-                    lv_obj_del(last_container);
-                }
-            }
-        }
+}
+
+void LcdDisplay::ApplyBubbleRole(ChatBubble& slot, ChatRole role) {
+    // 换用角色对应的共享样式，颜色随主题切换自动更新
+    if (slot.role >= 0) {
+        lv_obj_remove_style(slot.bubble, GetBubbleStyle((ChatRole)slot.role), 0);
     }
-    
-    // Create a message bubble
-    lv_obj_t* msg_bubble = lv_obj_create(content_);
-    lv_obj_set_style_radius(msg_bubble, 8, 0);
-    lv_obj_set_scrollbar_mode(msg_bubble, LV_SCROLLBAR_MODE_OFF);
-    lv_obj_set_style_border_width(msg_bubble, 1, 0);
-    lv_obj_set_style_border_color(msg_bubble, current_theme_.border, 0);
-    lv_obj_set_style_pad_all(msg_bubble, 8, 0);
-
-    // Create the message text
-    lv_obj_t* msg_text = lv_label_create(msg_bubble);
-    lv_label_set_text(msg_text, content);
-    
-    // 计算文本实际宽度
-    lv_coord_t text_width = lv_txt_get_width(content, strlen(content), fonts_.text_font, 0);
+    lv_obj_add_style(slot.bubble, GetBubbleStyle(role), 0);
+    switch (role) {
+        case kChatRoleUser:
+            lv_obj_align(slot.bubble, LV_ALIGN_RIGHT_MID, 0, 0);
+            break;
+        case kChatRoleSystem:
+            lv_obj_align(slot.bubble, LV_ALIGN_CENTER, 0, 0);
+            break;
+        default:
+            lv_obj_align(slot.bubble, LV_ALIGN_LEFT_MID, 0, 0);
+            break;
+    }
+    slot.role = role;
+}
 
-    // 计算气泡宽度
-    lv_coord_t max_width = LV_HOR_RES * 85 / 100 - 16;  // 屏幕宽度的85%
-    lv_coord_t min_width = 20;  
-    lv_coord_t bubble_width;
-    
-    // 确保文本宽度不小于最小宽度
+void LcdDisplay::BindBubble(ChatBubble& slot, const ChatMessage& message) {
+    lv_label_set_text(slot.label, message.text.c_str());
+
+    // 气泡宽度跟随文本宽度，最宽为屏幕的 85%
+    lv_coord_t text_width = lv_txt_get_width(message.text.c_str(), message.text.size(), fonts_.text_font, 0);
+    lv_coord_t max_width = LV_HOR_RES * 85 / 100 - 16;
+    lv_coord_t min_width = 20;
     if (text_width < min_width) {
         text_width = min_width;
     }
+    lv_obj_set_width(slot.label, text_width < max_width ? text_width : max_width);
 
-    // 如果文本宽度小于最大宽度，使用文本宽度
-    if (text_width < max_width) {
-        bubble_width = text_width; 
+    // 角色不变时颜色和对齐方式都不用重设
+    if (slot.role != message.role) {
+        ApplyBubbleRole(slot, message.role);
+    }
+    lv_obj_remove_flag(slot.row, LV_OBJ_FLAG_HIDDEN);
+    chat_message_label_ = slot.label;
+}
+
+void LcdDisplay::RebindChatWindow() {
+    for (size_t i = 0; i < chat_window_.pool_size(); i++) {
+        auto& slot = bubble_pool_[chat_window_.slot(i)];
+        if (i < chat_window_.size()) {
+            lv_obj_move_to_index(slot.row, -1);
+            BindBubble(slot, chat_window_.message(i));
+        } else {
+            lv_obj_add_flag(slot.row, LV_OBJ_FLAG_HIDDEN);
+        }
+    }
+}
+
+void LcdDisplay::ShiftChatWindow(bool backward) {
+    // 换绑会打乱图片预览和消息的相对位置，滑出窗口时直接丢弃预览
+    if (preview_bubble_ != nullptr) {
+        lv_obj_del(preview_bubble_);
+        preview_bubble_ = nullptr;
+    }
+
+    if (backward) {
+        // 最后一个槽位移到最前面，绑定窗口之前的一条消息
+        auto& slot = bubble_pool_[chat_window_.ShiftBackward()];
+        lv_obj_move_to_index(slot.row, 0);
+        BindBubble(slot, chat_window_.message(0));
+        // 保持当前可见内容不动
+        lv_obj_update_layout(content_);
+        lv_obj_scroll_by(content_, 0, -(lv_obj_get_height(slot.row) + lv_obj_get_style_pad_row(content_, 0)), LV_ANIM_OFF);
     } else {
-        bubble_width = max_width;
+        auto& slot = bubble_pool_[chat_window_.ShiftForward()];
+        lv_obj_update_layout(content_);
+        lv_coord_t removed = lv_obj_get_height(slot.row) + lv_obj_get_style_pad_row(content_, 0);
+        lv_obj_move_to_index(slot.row, -1);
+        BindBubble(slot, chat_window_.message(chat_window_.size() - 1));
+        lv_obj_update_layout(content_);
+        lv_obj_scroll_by(content_, 0, removed, LV_ANIM_OFF);
     }
-    
-    // 设置消息文本的宽度
-    lv_obj_set_width(msg_text, bubble_width);  // 减去padding
-    lv_label_set_long_mode(msg_text, LV_LABEL_LONG_WRAP);
-    lv_obj_set_style_text_font(msg_text, fonts_.text_font, 0);
+    chat_recycled_++;
+}
 
-    // 设置气泡宽度
-    lv_obj_set_width(msg_bubble, bubble_width);
-    lv_obj_set_height(msg_bubble, LV_SIZE_CONTENT);
+void LcdDisplay::ScrollToLatest(lv_anim_enable_t anim) {
+    if (chat_window_.size() > 0) {
+        lv_obj_scroll_to_view_recursive(bubble_pool_[chat_window_.slot(chat_window_.size() - 1)].row, anim);
+    }
+}
 
-    // Set alignment and style based on message role
-    if (strcmp(role, "user") == 0) {
-        // User messages are right-aligned with green background
-        lv_obj_set_style_bg_color(msg_bubble, current_theme_.user_bubble, 0);
-        // Set text color for contrast
-        lv_obj_set_style_text_color(msg_text, current_theme_.text, 0);
-        
-        // 设置自定义属性标记气泡类型
-        lv_obj_set_user_data(msg_bubble, (void*)"user");
-        
-        // Set appropriate width for content
-        lv_obj_set_width(msg_bubble, LV_SIZE_CONTENT);
-        lv_obj_set_height(msg_bubble, LV_SIZE_CONTENT);
-        
-        // Don't grow
-        lv_obj_set_style_flex_grow(msg_bubble, 0, 0);
-    } else if (strcmp(role, "assistant") == 0) {
-        // Assistant messages are left-aligned with white background
-        lv_obj_set_style_bg_color(msg_bubble, current_theme_.assistant_bubble, 0);
-        // Set text color for contrast
-        lv_obj_set_style_text_color(msg_text, current_theme_.text, 0);
-        
-        // 设置自定义属性标记气泡类型
-        lv_obj_set_user_data(msg_bubble, (void*)"assistant");
-        
-        // Set appropriate width for content
-        lv_obj_set_width(msg_bubble, LV_SIZE_CONTENT);
-        lv_obj_set_height(msg_bubble, LV_SIZE_CONTENT);
-        
-        // Don't grow
-        lv_obj_set_style_flex_grow(msg_bubble, 0, 0);
-    } else if (strcmp(role, "system") == 0) {
-        // System messages are center-aligned with light gray background
-        lv_obj_set_style_bg_color(msg_bubble, current_theme_.system_bubble, 0);
-        // Set text color for contrast
-        lv_obj_set_style_text_color(msg_text, current_theme_.system_text, 0);
-        
-        // 设置自定义属性标记气泡类型
-        lv_obj_set_user_data(msg_bubble, (void*)"system");
-        
-        // Set appropriate width for content
-        lv_obj_set_width(msg_bubble, LV_SIZE_CONTENT);
-        lv_obj_set_height(msg_bubble, LV_SIZE_CONTENT);
-        
-        // Don't grow
-        lv_obj_set_style_flex_grow(msg_bubble, 0, 0);
+void LcdDisplay::OnChatScrollEnd(lv_event_t* e) {
+    auto self = static_cast<LcdDisplay*>(lv_event_get_user_data(e));
+    // 窗口未满或内容不足一屏时不需要换绑
+    if (!self->chat_window_.full() ||
+        lv_obj_get_scroll_top(self->content_) + lv_obj_get_scroll_bottom(self->content_) <= 0) {
+        return;
+    }
+    if (lv_obj_get_scroll_top(self->content_) <= 0 && self->chat_window_.CanShiftBackward()) {
+        self->ShiftChatWindow(true);
+    } else if (lv_obj_get_scroll_bottom(self->content_) <= 0 && self->chat_window_.CanShiftForward()) {
+        self->ShiftChatWindow(false);
+    }
+}
+
+void LcdDisplay::OnRenderEvent(lv_event_t* e) {
+    auto self = static_cast<LcdDisplay*>(lv_event_get_user_data(e));
+    if (!self->chat_render_pending_) {
+        return;
+    }
+    if (lv_event_get_code(e) == LV_EVENT_RENDER_START) {
+        if (self->chat_render_start_us_ == 0) {
+            self->chat_render_start_us_ = esp_timer_get_time();
+        }
+        return;
+    }
+    if (self->chat_render_start_us_ != 0) {
+        int64_t elapsed = esp_timer_get_time() - self->chat_render_start_us_;
+        self->chat_frames_++;
+        self->chat_frame_us_ += elapsed;
+        if (elapsed > self->chat_frame_max_us_) {
+            self->chat_frame_max_us_ = elapsed;
+        }
+        ESP_LOGD(TAG, "Chat frame rendered in %lld us", elapsed);
+    }
+    self->chat_render_start_us_ = 0;
+    self->chat_render_pending_ = false;
+}
+
+void LcdDisplay::ApplyChatMessage(const char* role, const char* content) {
+    if (content_ == nullptr) {
+        return;
     }
     
-    // Create a full-width container for user messages to ensure right alignment
+    //避免出现空的消息框
+    if(strlen(content) == 0) return;
+
+    int64_t start_time = esp_timer_get_time();
+    size_t free_heap = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+
+    ChatRole chat_role = kChatRoleAssistant;
     if (strcmp(role, "user") == 0) {
-        // Create a full-width container
-        lv_obj_t* container = lv_obj_create(content_);
-        lv_obj_set_width(container, LV_HOR_RES);
-        lv_obj_set_height(container, LV_SIZE_CONTENT);
-        
-        // Make container transparent and borderless
-        lv_obj_set_style_bg_opa(container, LV_OPA_TRANSP, 0);
-        lv_obj_set_style_border_width(container, 0, 0);
-        lv_obj_set_style_pad_all(container, 0, 0);
-        
-        // Move the message bubble into this container
-        lv_obj_set_parent(msg_bubble, container);
-        
-        // Right align the bubble in the container
-        lv_obj_align(msg_bubble, LV_ALIGN_RIGHT_MID, -25, 0);
-        
-        // Auto-scroll to this container
-        lv_obj_scroll_to_view_recursive(container, LV_ANIM_ON);
+        chat_role = kChatRoleUser;
     } else if (strcmp(role, "system") == 0) {
-        // 为系统消息创建全宽容器以确保居中对齐
-        lv_obj_t* container = lv_obj_create(content_);
-        lv_obj_set_width(container, LV_HOR_RES);
-        lv_obj_set_height(container, LV_SIZE_CONTENT);
-        
-        // 使容器透明且无边框
-        lv_obj_set_style_bg_opa(container, LV_OPA_TRANSP, 0);
-        lv_obj_set_style_border_width(container, 0, 0);
-        lv_obj_set_style_pad_all(container, 0, 0);
-        
-        // 将消息气泡移入此容器
-        lv_obj_set_parent(msg_bubble, container);
-        
-        // 将气泡居中对齐在容器中
-        lv_obj_align(msg_bubble, LV_ALIGN_CENTER, 0, 0);
-        
-        // 自动滚动底部
-        lv_obj_scroll_to_view_recursive(container, LV_ANIM_ON);
+        chat_role = kChatRoleSystem;
+    }
+
+    auto change = chat_window_.Append(chat_role, content);
+    if (change.rebind_all) {
+        RebindChatWindow();
     } else {
-        // For assistant messages
-        // Left align assistant messages
-        lv_obj_align(msg_bubble, LV_ALIGN_LEFT_MID, 0, 0);
+        auto& slot = bubble_pool_[change.slot];
+        if (change.move_to_end) {
+            lv_obj_move_to_index(slot.row, -1);
+        }
+        BindBubble(slot, chat_window_.message(chat_window_.size() - 1));
+    }
+    if (change.recycled) {
+        chat_recycled_++;
+    }
 
-        // Auto-scroll to the message bubble
-        lv_obj_scroll_to_view_recursive(msg_bubble, LV_ANIM_ON);
+    if (!change.folded) {
+        chat_messages_++;
+        // 图片预览不进入历史，被足够多的新消息挤出窗口后释放
+        if (preview_bubble_ != nullptr && ++preview_age_ >= CHAT_BUBBLE_POOL_SIZE) {
+            lv_obj_del(preview_bubble_);
+            preview_bubble_ = nullptr;
+        }
     }
-    
-    // Store reference to the latest message label
-    chat_message_label_ = msg_text;
+
+    ScrollToLatest(LV_ANIM_ON);
+
+    int64_t elapsed = esp_timer_get_time() - start_time;
+    int heap_delta = (int)free_heap - (int)heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    chat_binds_++;
+    chat_bind_us_ += elapsed;
+    if (elapsed > chat_bind_max_us_) {
+        chat_bind_max_us_ = elapsed;
+    }
+    chat_heap_delta_ += heap_delta;
+    chat_render_pending_ = true;
+    ESP_LOGD(TAG, "Chat message %lu bound in %lld us (max %lld us), recycled: %lu, heap delta: %d",
+        chat_messages_, elapsed, chat_bind_max_us_, chat_recycled_, heap_delta);
+}
+
+void LcdDisplay::LogStats() {
+    if (chat_binds_ == 0) {
+        return;
+    }
+    ESP_LOGI(TAG, "Chat: %lu messages, %lu recycled, bind avg %lld us max %lld us, frame avg %lld us max %lld us, heap delta %lld",
+        chat_messages_, chat_recycled_, chat_bind_us_ / chat_binds_, chat_bind_max_us_,
+        chat_frames_ > 0 ? chat_frame_us_ / chat_frames_ : 0, chat_frame_max_us_, chat_heap_delta_);
+    chat_messages_ = 0;
+    chat_recycled_ = 0;
+    chat_binds_ = 0;
+    chat_bind_us_ = 0;
+    chat_bind_max_us_ = 0;
+    chat_heap_delta_ = 0;
+    chat_frames_ = 0;
+    chat_frame_us_ = 0;
+    chat_frame_max_us_ = 0;
 }
 
 void LcdDisplay::SetPreviewImage(const lv_img_dsc_t* img_dsc) {
     DisplayLockGuard lock(this);
+    // 先执行排队中的命令，保持与之前调用的先后顺序
+    DrainCommands();
     if (content_ == nullptr) {
         return;
     }
     
+    // 只保留最近一张预览图
+    if (preview_bubble_ != nullptr) {
+        lv_obj_del(preview_bubble_);
+        preview_bubble_ = nullptr;
+    }
+
     if (img_dsc != nullptr) {
         // Create a message bubble for image preview
         lv_obj_t* img_bubble = lv_obj_create(content_);
-        lv_obj_set_style_radius(img_bubble, 8, 0);
         lv_obj_set_scrollbar_mode(img_bubble, LV_SCROLLBAR_MODE_OFF);
-        lv_obj_set_style_border_width(img_bubble, 1, 0);
-        lv_obj_set_style_border_color(img_bubble, current_theme_.border, 0);
-        lv_obj_set_style_pad_all(img_bubble, 8, 0);
-        
-        // Set image bubble background color (similar to system message)
-        lv_obj_set_style_bg_color(img_bubble, current_theme_.assistant_bubble, 0);
-        
-        // 设置自定义属性标记气泡类型
-        lv_obj_set_user_data(img_bubble, (void*)"image");
+        lv_obj_add_style(img_bubble, &styles_.bubble, 0);
+        lv_obj_add_style(img_bubble, &styles_.assistant_bubble, 0);
         
         // Create the image object inside the bubble
         lv_obj_t* preview_image = lv_image_create(img_bubble);
@@ -700,16 +869,18 @@ void LcdDisplay::SetPreviewImage(const lv_img_dsc_t* img_dsc) {
 
         // Auto-scroll to the image bubble
         lv_obj_scroll_to_view_recursive(img_bubble, LV_ANIM_ON);
+        preview_bubble_ = img_bubble;
+        preview_age_ = 0;
     }
 }
 #else
 void LcdDisplay::SetupUI() {
     DisplayLockGuard lock(this);
+    InitThemeStyles();
 
     auto screen = lv_screen_active();
     lv_obj_set_style_text_font(screen, fonts_.text_font, 0);
-    lv_obj_set_style_text_color(screen, current_theme_.text, 0);
-    lv_obj_set_style_bg_color(screen, current_theme_.background, 0);
+    lv_obj_add_style(screen, &styles_.screen, 0);
 
     /* Container */
     container_ = lv_obj_create(screen);
@@ -718,15 +889,13 @@ void LcdDisplay::SetupUI() {
     lv_obj_set_style_pad_all(container_, 0, 0);
     lv_obj_set_style_border_width(container_, 0, 0);
     lv_obj_set_style_pad_row(container_, 0, 0);
-    lv_obj_set_style_bg_color(container_, current_theme_.background, 0);
-    lv_obj_set_style_border_color(container_, current_theme_.border, 0);
+    lv_obj_add_style(container_, &styles_.container, 0);
 
     /* Status bar */
     status_bar_ = lv_obj_create(container_);
     lv_obj_set_size(status_bar_, LV_HOR_RES, fonts_.text_font->line_height);
     lv_obj_set_style_radius(status_bar_, 0, 0);
-    lv_obj_set_style_bg_color(status_bar_, current_theme_.background, 0);
-    lv_obj_set_style_text_color(status_bar_, current_theme_.text, 0);
+    lv_obj_add_style(status_bar_, &styles_.status_bar, 0);
     
     /* Content */
     content_ = lv_obj_create(container_);
@@ -735,15 +904,13 @@ void LcdDisplay::SetupUI() {
     lv_obj_set_width(content_, LV_HOR_RES);
     lv_obj_set_flex_grow(content_, 1);
     lv_obj_set_style_pad_all(content_, 5, 0);
-    lv_obj_set_style_bg_color(content_, current_theme_.chat_background, 0);
-    lv_obj_set_style_border_color(content_, current_theme_.border, 0); // Border color for content
+    lv_obj_add_style(content_, &styles_.content, 0);
 
     lv_obj_set_flex_flow(content_, LV_FLEX_FLOW_COLUMN); // 垂直布局（从上到下）
     lv_obj_set_flex_align(content_, LV_FLEX_ALIGN_CENTER, LV_FLEX_ALIGN_CENTER, LV_FLEX_ALIGN_SPACE_EVENLY); // 子对象居中对齐，等距分布
 
     emotion_label_ = lv_label_create(content_);
     lv_obj_set_style_text_font(emotion_label_, &font_awesome_30_4, 0);
-    lv_obj_set_style_text_color(emotion_label_, current_theme_.text, 0);
     lv_label_set_text(emotion_label_, FONT_AWESOME_AI_CHIP);
 
     preview_image_ = lv_image_create(content_);
@@ -756,7 +923,6 @@ void LcdDisplay::SetupUI() {
     lv_obj_set_width(chat_message_label_, LV_HOR_RES * 0.9); // 限制宽度为屏幕宽度的 90%
     lv_label_set_long_mode(chat_message_label_, LV_LABEL_LONG_WRAP); // 设置为自动换行模式
     lv_obj_set_style_text_align(chat_message_label_, LV_TEXT_ALIGN_CENTER, 0); // 设置文本居中对齐
-    lv_obj_set_style_text_color(chat_message_label_, current_theme_.text, 0);
 
     /* Status bar */
     lv_obj_set_flex_flow(status_bar_, LV_FLEX_FLOW_ROW);
@@ -769,12 +935,10 @@ void LcdDisplay::SetupUI() {
     network_label_ = lv_label_create(status_bar_);
     lv_label_set_text(network_label_, "");
     lv_obj_set_style_text_font(network_label_, fonts_.icon_font, 0);
-    lv_obj_set_style_text_color(network_label_, current_theme_.text, 0);
 
     notification_label_ = lv_label_create(status_bar_);
     lv_obj_set_flex_grow(notification_label_, 1);
     lv_obj_set_style_text_align(notification_label_, LV_TEXT_ALIGN_CENTER, 0);
-    lv_obj_set_style_text_color(notification_label_, current_theme_.text, 0);
     lv_label_set_text(notification_label_, "");
     lv_obj_add_flag(notification_label_, LV_OBJ_FLAG_HIDDEN);
 
@@ -782,24 +946,20 @@ void LcdDisplay::SetupUI() {
     lv_obj_set_flex_grow(status_label_, 1);
     lv_label_set_long_mode(status_label_, LV_LABEL_LONG_SCROLL_CIRCULAR);
     lv_obj_set_style_text_align(status_label_, LV_TEXT_ALIGN_CENTER, 0);
-    lv_obj_set_style_text_color(status_label_, current_theme_.text, 0);
     lv_label_set_text(status_label_, Lang::Strings::INITIALIZING);
     mute_label_ = lv_label_create(status_bar_);
     lv_label_set_text(mute_label_, "");
     lv_obj_set_style_text_font(mute_label_, fonts_.icon_font, 0);
-    lv_obj_set_style_text_color(mute_label_, current_theme_.text, 0);
 
     battery_label_ = lv_label_create(status_bar_);
     lv_label_set_text(battery_label_, "");
     lv_obj_set_style_text_font(battery_label_, fonts_.icon_font, 0);
-    lv_obj_set_style_text_color(battery_label_, current_theme_.text, 0);
 
     low_battery_popup_ = lv_obj_create(screen);
     lv_obj_set_scrollbar_mode(low_battery_popup_, LV_SCROLLBAR_MODE_OFF);
     lv_obj_set_size(low_battery_popup_, LV_HOR_RES * 0.9, fonts_.text_font->line_height * 2);
     lv_obj_align(low_battery_popup_, LV_ALIGN_BOTTOM_MID, 0, 0);
-    lv_obj_set_style_bg_color(low_battery_popup_, current_theme_.low_battery, 0);
-    lv_obj_set_style_radius(low_battery_popup_, 10, 0);
+    lv_obj_add_style(low_battery_popup_, &styles_.popup, 0);
     low_battery_label_ = lv_label_create(low_battery_popup_);
     lv_label_set_text(low_battery_label_, Lang::Strings::BATTERY_NEED_CHARGE);
     lv_obj_set_style_text_color(low_battery_label_, lv_color_white(), 0);
@@ -809,6 +969,8 @@ void LcdDisplay::SetupUI() {
 
 void LcdDisplay::SetPreviewImage(const lv_img_dsc_t* img_dsc) {
     DisplayLockGuard lock(this);
+    // 先执行排队中的命令，保持与之前调用的先后顺序
+    DrainCommands();
     if (preview_image_ == nullptr) {
         return;
     }
@@ -833,7 +995,7 @@ void LcdDisplay::SetPreviewImage(const lv_img_dsc_t* img_dsc) {
 }
 #endif
 
-void LcdDisplay::SetEmotion(const char* emotion) {
+void LcdDisplay::ApplyEmotion(const char* emotion) {
     struct Emotion {
         const char* icon;
         const char* text;
@@ -868,7 +1030,6 @@ void LcdDisplay::SetEmotion(const char* emotion) {
     auto it = std::find_if(emotions.begin(), emotions.end(),
         [&emotion_view](const Emotion& e) { return e.text == emotion_view; });
 
-    DisplayLockGuard lock(this);
     if (emotion_label_ == nullptr) {
         return;
     }
@@ -890,8 +1051,7 @@ void LcdDisplay::SetEmotion(const char* emotion) {
 #endif
 }
 
-void LcdDisplay::SetIcon(const char* icon) {
-    DisplayLockGuard lock(this);
+void LcdDisplay::ApplyIcon(const char* icon) {
     if (emotion_label_ == nullptr) {
         return;
     }
@@ -920,183 +1080,9 @@ void LcdDisplay::SetTheme(const std::string& theme_name) {
         return;
     }
     
-    // Get the active screen
-    lv_obj_t* screen = lv_screen_active();
-    
-    // Update the screen colors
-    lv_obj_set_style_bg_color(screen, current_theme_.background, 0);
-    lv_obj_set_style_text_color(screen, current_theme_.text, 0);
-    
-    // Update container colors
-    if (container_ != nullptr) {
-        lv_obj_set_style_bg_color(container_, current_theme_.background, 0);
-        lv_obj_set_style_border_color(container_, current_theme_.border, 0);
-    }
-    
-    // Update status bar colors
-    if (status_bar_ != nullptr) {
-        lv_obj_set_style_bg_color(status_bar_, current_theme_.background, 0);
-        lv_obj_set_style_text_color(status_bar_, current_theme_.text, 0);
-        
-        // Update status bar elements
-        if (network_label_ != nullptr) {
-            lv_obj_set_style_text_color(network_label_, current_theme_.text, 0);
-        }
-        if (status_label_ != nullptr) {
-            lv_obj_set_style_text_color(status_label_, current_theme_.text, 0);
-        }
-        if (notification_label_ != nullptr) {
-            lv_obj_set_style_text_color(notification_label_, current_theme_.text, 0);
-        }
-        if (mute_label_ != nullptr) {
-            lv_obj_set_style_text_color(mute_label_, current_theme_.text, 0);
-        }
-        if (battery_label_ != nullptr) {
-            lv_obj_set_style_text_color(battery_label_, current_theme_.text, 0);
-        }
-        if (emotion_label_ != nullptr) {
-            lv_obj_set_style_text_color(emotion_label_, current_theme_.text, 0);
-        }
-    }
-    
-    // Update content area colors
-    if (content_ != nullptr) {
-        lv_obj_set_style_bg_color(content_, current_theme_.chat_background, 0);
-        lv_obj_set_style_border_color(content_, current_theme_.border, 0);
-        
-        // If we have the chat message style, update all message bubbles
-#if CONFIG_USE_WECHAT_MESSAGE_STYLE
-        // Iterate through all children of content (message containers or bubbles)
-        uint32_t child_count = lv_obj_get_child_cnt(content_);
-        for (uint32_t i = 0; i < child_count; i++) {
-            lv_obj_t* obj = lv_obj_get_child(content_, i);
-            if (obj == nullptr) continue;
-            
-            lv_obj_t* bubble = nullptr;
-            
-            // 检查这个对象是容器还是气泡
-            // 如果是容器（用户或系统消息），则获取其子对象作为气泡
-            // 如果是气泡（助手消息），则直接使用
-            if (lv_obj_get_child_cnt(obj) > 0) {
-                // 可能是容器，检查它是否为用户或系统消息容器
-                // 用户和系统消息容器是透明的
-                lv_opa_t bg_opa = lv_obj_get_style_bg_opa(obj, 0);
-                if (bg_opa == LV_OPA_TRANSP) {
-                    // 这是用户或系统消息的容器
-                    bubble = lv_obj_get_child(obj, 0);
-                } else {
-                    // 这可能是助手消息的气泡自身
-                    bubble = obj;
-                }
-            } else {
-                // 没有子元素，可能是其他UI元素，跳过
-                continue;
-            }
-            
-            if (bubble == nullptr) continue;
-            
-            // 使用保存的用户数据来识别气泡类型
-            void* bubble_type_ptr = lv_obj_get_user_data(bubble);
-            if (bubble_type_ptr != nullptr) {
-                const char* bubble_type = static_cast<const char*>(bubble_type_ptr);
-                
-                // 根据气泡类型应用正确的颜色
-                if (strcmp(bubble_type, "user") == 0) {
-                    lv_obj_set_style_bg_color(bubble, current_theme_.user_bubble, 0);
-                } else if (strcmp(bubble_type, "assistant") == 0) {
-                    lv_obj_set_style_bg_color(bubble, current_theme_.assistant_bubble, 0); 
-                } else if (strcmp(bubble_type, "system") == 0) {
-                    lv_obj_set_style_bg_color(bubble, current_theme_.system_bubble, 0);
-                } else if (strcmp(bubble_type, "image") == 0) {
-                    lv_obj_set_style_bg_color(bubble, current_theme_.system_bubble, 0);
-                }
-                
-                // Update border color
-                lv_obj_set_style_border_color(bubble, current_theme_.border, 0);
-                
-                // Update text color for the message
-                if (lv_obj_get_child_cnt(bubble) > 0) {
-                    lv_obj_t* text = lv_obj_get_child(bubble, 0);
-                    if (text != nullptr) {
-                        // 根据气泡类型设置文本颜色
-                        if (strcmp(bubble_type, "system") == 0) {
-                            lv_obj_set_style_text_color(text, current_theme_.system_text, 0);
-                        } else {
-                            lv_obj_set_style_text_color(text, current_theme_.text, 0);
-                        }
-                    }
-                }
-            } else {
-                // 如果没有标记，回退到之前的逻辑（颜色比较）
-                // ...保留原有的回退逻辑...
-                lv_color_t bg_color = lv_obj_get_style_bg_color(bubble, 0);
-            
-                // 改进bubble类型检测逻辑，不仅使用颜色比较
-                bool is_user_bubble = false;
-                bool is_assistant_bubble = false;
-                bool is_system_bubble = false;
-            
-                // 检查用户bubble
-                if (lv_color_eq(bg_color, DARK_USER_BUBBLE_COLOR) || 
-                    lv_color_eq(bg_color, LIGHT_USER_BUBBLE_COLOR) ||
-                    lv_color_eq(bg_color, current_theme_.user_bubble)) {
-                    is_user_bubble = true;
-                }
-                // 检查系统bubble
-                else if (lv_color_eq(bg_color, DARK_SYSTEM_BUBBLE_COLOR) || 
-                         lv_color_eq(bg_color, LIGHT_SYSTEM_BUBBLE_COLOR) ||
-                         lv_color_eq(bg_color, current_theme_.system_bubble)) {
-                    is_system_bubble = true;
-                }
-                // 剩余的都当作助手bubble处理
-                else {
-                    is_assistant_bubble = true;
-                }
-            
-                // 根据bubble类型应用正确的颜色
-                if (is_user_bubble) {
-                    lv_obj_set_style_bg_color(bubble, current_theme_.user_bubble, 0);
-                } else if (is_assistant_bubble) {
-                    lv_obj_set_style_bg_color(bubble, current_theme_.assistant_bubble, 0);
-                } else if (is_system_bubble) {
-                    lv_obj_set_style_bg_color(bubble, current_theme_.system_bubble, 0);
-                }
-                
-                // Update border color
-                lv_obj_set_style_border_color(bubble, current_theme_.border, 0);
-                
-                // Update text color for the message
-                if (lv_obj_get_child_cnt(bubble) > 0) {
-                    lv_obj_t* text = lv_obj_get_child(bubble, 0);
-                    if (text != nullptr) {
-                        // 回退到颜色检测逻辑
-                        if (lv_color_eq(bg_color, current_theme_.system_bubble) ||
-                            lv_color_eq(bg_color, DARK_SYSTEM_BUBBLE_COLOR) || 
-                            lv_color_eq(bg_color, LIGHT_SYSTEM_BUBBLE_COLOR)) {
-                            lv_obj_set_style_text_color(text, current_theme_.system_text, 0);
-                        } else {
-                            lv_obj_set_style_text_color(text, current_theme_.text, 0);
-                        }
-                    }
-                }
-            }
-        }
-#else
-        // Simple UI mode - just update the main chat message
-        if (chat_message_label_ != nullptr) {
-            lv_obj_set_style_text_color(chat_message_label_, current_theme_.text, 0);
-        }
-        
-        if (emotion_label_ != nullptr) {
-            lv_obj_set_style_text_color(emotion_label_, current_theme_.text, 0);
-        }
-#endif
-    }
-    
-    // Update low battery popup
-    if (low_battery_popup_ != nullptr) {
-        lv_obj_set_style_bg_color(low_battery_popup_, current_theme_.low_battery, 0);
-    }
+    // 对象只引用共享样式，修改样式后通知 LVGL 刷新即可
+    ApplyThemeStyles();
+    lv_obj_report_style_change(nullptr);
 
     // No errors occurred. Save theme to settings
     Display::SetTheme(theme_name);
@@ -2,12 +2,15 @@
 #define LCD_DISPLAY_H
 
 #include "display.h"
+#include "chat_window.h"
 
 #include <esp_lcd_panel_io.h>
 #include <esp_lcd_panel_ops.h>
 #include <font_emoji.h>
 
 #include <atomic>
+#include <string>
+#include <vector>
 
 // Theme color structure
 struct ThemeColors {
@@ -22,6 +25,38 @@ struct ThemeColors {
     lv_color_t low_battery;
 };
 
+// 按角色共享的主题样式：对象只引用样式，切换主题时只修改这些样式本身
+struct ThemeStyles {
+    lv_style_t screen;
+    lv_style_t container;
+    lv_style_t status_bar;
+    lv_style_t content;
+    lv_style_t chat_row;            // 气泡所在的透明行容器
+    lv_style_t bubble;              // 气泡公共部分：圆角、边框、内边距
+    lv_style_t user_bubble;
+    lv_style_t assistant_bubble;
+    lv_style_t system_bubble;
+    lv_style_t popup;
+};
+
+#if CONFIG_USE_WECHAT_MESSAGE_STYLE
+#if CONFIG_IDF_TARGET_ESP32P4
+#define  MAX_MESSAGES 40
+#define  CHAT_BUBBLE_POOL_SIZE 12
+#else
+#define  MAX_MESSAGES 20
+#define  CHAT_BUBBLE_POOL_SIZE 8
+#endif
+
+// 气泡池中的一个槽位：全宽行容器 + 气泡 + 文本，创建一次后原地复用
+struct ChatBubble {
+    lv_obj_t* row = nullptr;
+    lv_obj_t* bubble = nullptr;
+    lv_obj_t* label = nullptr;
+    int role = -1;
+};
+#endif
+
 
 class LcdDisplay : public Display {
 protected:
@@ -37,7 +72,53 @@ protected:
 
     DisplayFonts fonts_;
     ThemeColors current_theme_;
+    ThemeStyles styles_ = {};
+
+#if CONFIG_USE_WECHAT_MESSAGE_STYLE
+    // 虚拟化聊天列表：bubble_pool_ 是固定数量的预建气泡，由 chat_window_ 决定每个槽位绑定哪条消息
+    ChatWindow chat_window_{CHAT_BUBBLE_POOL_SIZE, MAX_MESSAGES};
+    std::vector<ChatBubble> bubble_pool_;
+    lv_obj_t* preview_bubble_ = nullptr;
+    int preview_age_ = 0;
+
+    // 统计：绑定耗时、LVGL 堆占用变化和随后一帧的渲染耗时，由 LogStats 每分钟输出并清零
+    uint32_t chat_messages_ = 0;
+    uint32_t chat_recycled_ = 0;
+    uint32_t chat_binds_ = 0;
+    int64_t chat_bind_us_ = 0;
+    int64_t chat_bind_max_us_ = 0;
+    int64_t chat_heap_delta_ = 0;
+    uint32_t chat_frames_ = 0;
+    int64_t chat_frame_us_ = 0;
+    int64_t chat_frame_max_us_ = 0;
+    int64_t chat_render_start_us_ = 0;
+    bool chat_render_pending_ = false;
+
+    void CreateBubblePool();
+    lv_style_t* GetBubbleStyle(ChatRole role);
+    void ApplyBubbleRole(ChatBubble& slot, ChatRole role);
+    void BindBubble(ChatBubble& slot, const ChatMessage& message);
+    void RebindChatWindow();
+    void ShiftChatWindow(bool backward);
+    void ScrollToLatest(lv_anim_enable_t anim);
+    static void OnChatScrollEnd(lv_event_t* e);
+    static void OnRenderEvent(lv_event_t* e);
+#endif
 
+    // 渲染统计：帧率、渲染耗时，以及等待上一次刷新完成的时间（等待越少，渲染和传输重叠越多）
+    int64_t render_window_start_us_ = 0;
+    int64_t render_start_us_ = 0;
+    int64_t render_time_us_ = 0;
+    int64_t flush_wait_start_us_ = 0;
+    int64_t flush_wait_us_ = 0;
+    uint32_t rendered_frames_ = 0;
+
+    void EnableRenderStats();
+    static void OnRenderStatsEvent(lv_event_t* e);
+    static void OnInvalidateArea(lv_event_t* e);
+
+    void InitThemeStyles();
+    void ApplyThemeStyles();
     void SetupUI();
     virtual bool Lock(int timeout_ms = 0) override;
     virtual void Unlock() override;
@@ -46,14 +127,16 @@ protected:
     // 添加protected构造函数
     LcdDisplay(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_handle_t panel, DisplayFonts fonts, int width, int height);
     
+    virtual void ApplyEmotion(const char* emotion) override;
+    virtual void ApplyIcon(const char* icon) override;
+#if CONFIG_USE_WECHAT_MESSAGE_STYLE
+    virtual void ApplyChatMessage(const char* role, const char* content) override; 
+    virtual void LogStats() override;
+#endif  
+
 public:
     ~LcdDisplay();
-    virtual void SetEmotion(const char* emotion) override;
-    virtual void SetIcon(const char* icon) override;
     virtual void SetPreviewImage(const lv_img_dsc_t* img_dsc) override;
-#if CONFIG_USE_WECHAT_MESSAGE_STYLE
-    virtual void SetChatMessage(const char* role, const char* content) override; 
-#endif  
 
     // Add theme switching function
     virtual void SetTheme(const std::string& theme_name) override;
@@ -77,13 +160,27 @@ public:
                    DisplayFonts fonts);
 };
 
+/*
+ * SPI 屏渲染模式，由板子在 SRAM 占用和流畅度之间取舍
+ * Partial:      单个 20 行 DMA 缓冲区，每次刷新都要等 SPI 传输完成才能继续渲染
+ * DoubleBuffer: 两个 20 行 DMA 缓冲区，渲染下一块的同时传输上一块，多占一份 SRAM
+ * PsramFrame:   PSRAM 中的两份全帧缓冲区，经 20 行 SRAM 中转缓冲区传输，
+ *               脏区域按整行合并，SRAM 占用最小但传输需要额外拷贝；没有 PSRAM 时退回 DoubleBuffer
+ * 开启 CONFIG_USE_DISPLAY_RENDER_STATS 后每 10 秒输出帧率和刷新等待时间，用于比较各模式
+ */
+enum SpiLcdRenderMode {
+    kSpiLcdRenderPartial,
+    kSpiLcdRenderDoubleBuffer,
+    kSpiLcdRenderPsramFrame,
+};
+
 // // SPI LCD显示器
 class SpiLcdDisplay : public LcdDisplay {
 public:
     SpiLcdDisplay(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_handle_t panel,
                   int width, int height, int offset_x, int offset_y,
                   bool mirror_x, bool mirror_y, bool swap_xy,
-                  DisplayFonts fonts);
+                  DisplayFonts fonts, SpiLcdRenderMode render_mode = kSpiLcdRenderPartial);
 };
 
 // QSPI LCD显示器
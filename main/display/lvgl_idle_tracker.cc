@@ -0,0 +1,41 @@
+#include "lvgl_idle_tracker.h"
+
+void LvglIdleTracker::Start(int64_t now) {
+    stats_start_us_ = now;
+}
+
+bool LvglIdleTracker::Check(bool active) {
+    if (active) {
+        idle_ms_ = 0;
+        return false;
+    }
+    idle_ms_ += LVGL_IDLE_CHECK_MS;
+    return idle_ms_ >= LVGL_IDLE_TIMEOUT_MS;
+}
+
+void LvglIdleTracker::OnSleep(int64_t now) {
+    sleep_start_us_ = now;
+    idle_ms_ = 0;
+}
+
+void LvglIdleTracker::OnWake(int64_t now) {
+    wakeups_++;
+    // 跨过统计周期的暂停只计入当前周期的部分
+    int64_t start = sleep_start_us_;
+    int64_t stats_start = stats_start_us_;
+    slept_us_ += now - (start > stats_start ? start : stats_start);
+}
+
+bool LvglIdleTracker::TakeStatsIfDue(int64_t now, LvglIdleStats& stats) {
+    int64_t elapsed = now - stats_start_us_;
+    if (elapsed < LVGL_STATS_INTERVAL_US) {
+        return false;
+    }
+    stats.elapsed_us = elapsed;
+    stats.slept_us = slept_us_.exchange(0);
+    stats.wakeups = wakeups_.exchange(0);
+    stats.refreshes = refreshes_;
+    stats_start_us_ = now;
+    refreshes_ = 0;
+    return true;
+}
@@ -0,0 +1,46 @@
+#ifndef LVGL_IDLE_TRACKER_H
+#define LVGL_IDLE_TRACKER_H
+
+#include <atomic>
+#include <cstdint>
+
+// 空闲检查周期
+#define LVGL_IDLE_CHECK_MS 250
+// 连续空闲多久后暂停 LVGL
+#define LVGL_IDLE_TIMEOUT_MS 1000
+// 统计输出周期
+#define LVGL_STATS_INTERVAL_US (60 * 1000 * 1000)
+
+struct LvglIdleStats {
+    int64_t elapsed_us;
+    int64_t slept_us;
+    uint32_t wakeups;
+    uint32_t refreshes;
+};
+
+/*
+ * LvglRefreshScheduler 的空闲判定和统计，不涉及 LVGL，时间由调用方传入
+ * Check 每个空闲检查周期调用一次；OnWake 可在任意任务中调用，其余都在持有 LVGL 锁时调用。
+ */
+class LvglIdleTracker {
+public:
+    void Start(int64_t now);
+    // active 表示这一周期内有对象失效、动画、唤醒请求或输入设备；返回 true 时应暂停 LVGL
+    bool Check(bool active);
+    // 在暂停之前调用，保证并发的唤醒能算出暂停时长
+    void OnSleep(int64_t now);
+    void OnWake(int64_t now);
+    void OnRefresh() { refreshes_++; }
+    // 距上次取出已满 LVGL_STATS_INTERVAL_US 时取出统计并清零
+    bool TakeStatsIfDue(int64_t now, LvglIdleStats& stats);
+
+private:
+    int idle_ms_ = 0;
+    std::atomic<int64_t> stats_start_us_ = 0;
+    std::atomic<int64_t> sleep_start_us_ = 0;
+    std::atomic<int64_t> slept_us_ = 0;
+    std::atomic<uint32_t> wakeups_ = 0;
+    uint32_t refreshes_ = 0;
+};
+
+#endif // LVGL_IDLE_TRACKER_H
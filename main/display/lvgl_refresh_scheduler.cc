@@ -0,0 +1,103 @@
+#include "lvgl_refresh_scheduler.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_lvgl_port.h>
+
+#define TAG "LvglRefresh"
+
+// 动画和滚动期间的屏幕刷新周期
+#define LVGL_FAST_REFR_PERIOD_MS 16
+
+void LvglRefreshScheduler::Start(lv_display_t* display) {
+    if (!lvgl_port_lock(0)) {
+        ESP_LOGE(TAG, "Failed to lock LVGL");
+        return;
+    }
+    display_ = display;
+    tracker_.Start(esp_timer_get_time());
+    lv_tick_set_cb(GetTick);
+    lv_display_add_event_cb(display_, OnInvalidateArea, LV_EVENT_INVALIDATE_AREA, this);
+    lv_display_add_event_cb(display_, OnRefreshReady, LV_EVENT_REFR_READY, this);
+    idle_timer_ = lv_timer_create(OnIdleCheck, LVGL_IDLE_CHECK_MS, this);
+    lvgl_port_unlock();
+}
+
+uint32_t LvglRefreshScheduler::GetTick() {
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+void LvglRefreshScheduler::Sleep() {
+    tracker_.OnSleep(esp_timer_get_time());
+    sleeping_ = true;
+    if (lvgl_port_stop() != ESP_OK) {
+        sleeping_ = false;
+        return;
+    }
+    // 暂停的同时有人请求唤醒时，对方可能在 stop 之前就已经 resume，这里无条件恢复
+    if (wake_requested_.exchange(false)) {
+        sleeping_ = false;
+        lvgl_port_resume();
+    }
+}
+
+bool LvglRefreshScheduler::Wake() {
+    if (!sleeping_.exchange(false)) {
+        return false;
+    }
+    lvgl_port_resume();
+    lvgl_port_task_wake(LVGL_PORT_EVENT_USER, nullptr);
+    tracker_.OnWake(esp_timer_get_time());
+    return true;
+}
+
+void LvglRefreshScheduler::RequestWake() {
+    wake_requested_ = true;
+    Wake();
+}
+
+void LvglRefreshScheduler::LogStatsIfDue(int64_t now) {
+    LvglIdleStats stats;
+    if (!tracker_.TakeStatsIfDue(now, stats)) {
+        return;
+    }
+    ESP_LOGI(TAG, "Last %lld s: slept %d%%, %lu wakeups, %lu refreshes, LVGL idle %lu%% while running",
+        stats.elapsed_us / 1000000, (int)(stats.slept_us * 100 / stats.elapsed_us), stats.wakeups, stats.refreshes,
+        lv_timer_get_idle());
+}
+
+void LvglRefreshScheduler::OnIdleCheck(lv_timer_t* timer) {
+    auto self = static_cast<LvglRefreshScheduler*>(lv_timer_get_user_data(timer));
+    bool animating = lv_anim_count_running() > 0;
+    if (!animating && self->fast_) {
+        self->fast_ = false;
+        lv_timer_set_period(lv_display_get_refr_timer(self->display_), LV_DEF_REFR_PERIOD);
+    }
+
+    // 有输入设备时需要持续读取输入，不能暂停
+    bool wake_requested = self->wake_requested_.exchange(false);
+    bool active = self->invalidated_ || wake_requested || animating || lv_indev_get_next(nullptr) != nullptr;
+    self->invalidated_ = false;
+    if (self->tracker_.Check(active)) {
+        self->Sleep();
+    }
+    self->LogStatsIfDue(esp_timer_get_time());
+}
+
+void LvglRefreshScheduler::OnInvalidateArea(lv_event_t* e) {
+    auto self = static_cast<LvglRefreshScheduler*>(lv_event_get_user_data(e));
+    self->invalidated_ = true;
+    if (self->Wake()) {
+        self->LogStatsIfDue(esp_timer_get_time());
+    }
+    // 动画开始后立即提高刷新率，结束后由空闲检查恢复
+    if (!self->fast_ && lv_anim_count_running() > 0) {
+        self->fast_ = true;
+        lv_timer_set_period(lv_display_get_refr_timer(self->display_), LVGL_FAST_REFR_PERIOD_MS);
+    }
+}
+
+void LvglRefreshScheduler::OnRefreshReady(lv_event_t* e) {
+    auto self = static_cast<LvglRefreshScheduler*>(lv_event_get_user_data(e));
+    self->tracker_.OnRefresh();
+}
@@ -0,0 +1,51 @@
+#ifndef LVGL_REFRESH_SCHEDULER_H
+#define LVGL_REFRESH_SCHEDULER_H
+
+#include "lvgl_idle_tracker.h"
+
+#include <lvgl.h>
+
+#include <atomic>
+#include <cstdint>
+
+// 暂停期间 LVGL 任务最长睡眠时间，ESP_LVGL_PORT_INIT_CONFIG 默认为 500ms
+#define LVGL_TASK_MAX_SLEEP_MS 1000
+
+/*
+ * LVGL 空闲感知刷新调度
+ * esp_lvgl_port 以固定周期驱动 LVGL 的 tick 和定时器，界面没有任何变化时也会持续唤醒。
+ * 调度器每 LVGL_IDLE_CHECK_MS 检查一次：连续 LVGL_IDLE_TIMEOUT_MS 没有对象失效、没有动画、
+ * 也没有输入设备时，调用 lvgl_port_stop 暂停 tick 和全部 LVGL 定时器。
+ * 任何对象失效（LV_EVENT_INVALIDATE_AREA）都会恢复定时器并立即唤醒 LVGL 任务。
+ * 动画（包括滚动动画）运行期间把屏幕刷新周期缩短为 LVGL_FAST_REFR_PERIOD_MS。
+ *
+ * tick 改为直接读取 esp_timer，不再受 timer_period_ms 的粒度影响。
+ * 除 RequestWake 外，所有回调都在持有 LVGL 锁的情况下执行。
+ */
+class LvglRefreshScheduler {
+public:
+    void Start(lv_display_t* display);
+    // 可在任意任务中调用：有待执行的显示命令时恢复暂停的 LVGL，并阻止随后的空闲暂停
+    void RequestWake();
+
+private:
+    lv_display_t* display_ = nullptr;
+    lv_timer_t* idle_timer_ = nullptr;
+    std::atomic<bool> sleeping_ = false;
+    std::atomic<bool> wake_requested_ = false;
+    bool invalidated_ = false;
+    bool fast_ = false;
+    // 空闲判定，以及唤醒次数、暂停总时长和刷新次数的统计
+    LvglIdleTracker tracker_;
+
+    void Sleep();
+    bool Wake();
+    void LogStatsIfDue(int64_t now);
+
+    static uint32_t GetTick();
+    static void OnIdleCheck(lv_timer_t* timer);
+    static void OnInvalidateArea(lv_event_t* e);
+    static void OnRefreshReady(lv_event_t* e);
+};
+
+#endif // LVGL_REFRESH_SCHEDULER_H
@@ -23,6 +23,7 @@ OledDisplay::OledDisplay(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_handl
     lvgl_port_cfg_t port_cfg = ESP_LVGL_PORT_INIT_CONFIG();
     port_cfg.task_priority = 1;
     port_cfg.timer_period_ms = 50;
+    port_cfg.task_max_sleep_ms = LVGL_TASK_MAX_SLEEP_MS;
     lvgl_port_init(&port_cfg);
 
     ESP_LOGI(TAG, "Adding OLED display");
@@ -61,9 +62,11 @@ OledDisplay::OledDisplay(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_handl
     } else {
         SetupUI_128x32();
     }
+    StartUpdateLoop();
 }
 
 OledDisplay::~OledDisplay() {
+    StopUpdateLoop();
     if (content_ != nullptr) {
         lv_obj_del(content_);
     }
@@ -94,8 +97,7 @@ void OledDisplay::Unlock() {
     lvgl_port_unlock();
 }
 
-void OledDisplay::SetChatMessage(const char* role, const char* content) {
-    DisplayLockGuard lock(this);
+void OledDisplay::ApplyChatMessage(const char* role, const char* content) {
     if (chat_message_label_ == nullptr) {
         return;
     }
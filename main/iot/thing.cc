@@ -1,5 +1,5 @@
 #include "thing.h"
-#include "application.h"
+#include "thing_manager.h"
 
 #include <esp_log.h>
 
@@ -52,40 +52,61 @@ std::string Thing::GetStateJson() {
     return json_str;
 }
 
-void Thing::Invoke(const cJSON* command) {
+void Thing::NotifyStateChanged() {
+    // 先标记设备再通知管理器，保证管理器看到通知时能找到被标记的设备
+    dirty_ = true;
+    ThingManager::GetInstance().OnStateChanged();
+}
+
+bool Thing::Bind(const cJSON* command, Invocation& invocation) const {
     auto method_name = cJSON_GetObjectItem(command, "method");
-    auto input_params = cJSON_GetObjectItem(command, "parameters");
+    if (!cJSON_IsString(method_name)) {
+        ESP_LOGE(TAG, "Missing method for %s", name_.c_str());
+        return false;
+    }
+    auto method = methods_.Find(method_name->valuestring);
+    if (method == nullptr) {
+        ESP_LOGE(TAG, "Method not found: %s", method_name->valuestring);
+        return false;
+    }
 
-    try {
-        auto& method = methods_[method_name->valuestring];
-        for (auto& param : method.parameters()) {
-            auto input_param = cJSON_GetObjectItem(input_params, param.name().c_str());
-            if (param.required() && input_param == nullptr) {
-                throw std::runtime_error("Parameter " + param.name() + " is required");
+    // 每次调用使用独立的参数帧，不修改 Method 中的参数声明
+    auto input_params = cJSON_GetObjectItem(command, "parameters");
+    ParameterList arguments = method->parameters();
+    for (auto& param : arguments) {
+        auto input_param = cJSON_GetObjectItem(input_params, param.name().c_str());
+        if (param.required() && input_param == nullptr) {
+            ESP_LOGE(TAG, "Parameter %s is required", param.name().c_str());
+            return false;
+        }
+        if (param.type() == kValueTypeNumber) {
+            if (cJSON_IsNumber(input_param)) {
+                param.set_number(input_param->valueint);
+            }
+        } else if (param.type() == kValueTypeString) {
+            if (cJSON_IsString(input_param)) {
+                param.set_string(input_param->valuestring);
             }
-            if (param.type() == kValueTypeNumber) {
-                if (cJSON_IsNumber(input_param)) {
-                    param.set_number(input_param->valueint);
-                }
-            } else if (param.type() == kValueTypeString) {
-                if (cJSON_IsString(input_param) || cJSON_IsObject(input_param) || cJSON_IsArray(input_param)) {
-                    std::string value_str = input_param->valuestring;
-                    param.set_string(value_str);
-                }
-            } else if (param.type() == kValueTypeBoolean) {
-                if (cJSON_IsBool(input_param)) {
-                    param.set_boolean(input_param->valueint == 1);
-                }
+        } else if (param.type() == kValueTypeBoolean) {
+            if (cJSON_IsBool(input_param)) {
+                param.set_boolean(input_param->valueint == 1);
             }
         }
+    }
 
-        Application::GetInstance().Schedule([&method]() {
-            method.Invoke();
-        });
-    } catch (const std::runtime_error& e) {
-        ESP_LOGE(TAG, "Method not found: %s", method_name->valuestring);
+    invocation.method = method;
+    invocation.arguments = std::move(arguments);
+    return true;
+}
+
+void Thing::Invoke(const cJSON* command) {
+    Invocation invocation;
+    if (!Bind(command, invocation)) {
         return;
     }
+    ThingManager::GetInstance().Schedule([invocation = std::move(invocation)]() {
+        invocation.Run();
+    });
 }
 
 
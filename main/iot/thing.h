@@ -3,9 +3,11 @@
 
 #include <string>
 #include <map>
+#include <unordered_map>
 #include <functional>
 #include <vector>
 #include <stdexcept>
+#include <atomic>
 #include <cJSON.h>
 
 namespace iot {
@@ -125,8 +127,9 @@ private:
     std::string description_;
     ValueType type_;
     bool required_;
-    bool boolean_;
-    int number_;
+    // 可选参数没有传入时保持这些值，参数帧复制时也不会读到未初始化的内存
+    bool boolean_ = false;
+    int number_ = 0;
     std::string string_;
 
 public:
@@ -211,7 +214,8 @@ public:
 
     const std::string& name() const { return name_; }
     const std::string& description() const { return description_; }
-    ParameterList& parameters() { return parameters_; }
+    // 参数声明，调用时复制一份作为本次调用的参数帧，不修改这里的值
+    const ParameterList& parameters() const { return parameters_; }
 
     std::string GetDescriptorJson() {
         std::string json_str = "{";
@@ -221,30 +225,41 @@ public:
         return json_str;
     }
 
-    void Invoke() {
-        callback_(parameters_);
+    void Invoke(const ParameterList& arguments) const {
+        callback_(arguments);
     }
 };
 
 class MethodList {
 private:
     std::vector<Method> methods_;
+    std::unordered_map<std::string, size_t> index_;    // 方法名到 methods_ 下标
 
 public:
     MethodList() = default;
-    MethodList(const std::vector<Method>& methods) : methods_(methods) {}
+    MethodList(const std::vector<Method>& methods) : methods_(methods) {
+        for (size_t i = 0; i < methods_.size(); i++) {
+            index_[methods_[i].name()] = i;
+        }
+    }
 
     void AddMethod(const std::string& name, const std::string& description, const ParameterList& parameters, std::function<void(const ParameterList&)> callback) {
         methods_.push_back(Method(name, description, parameters, callback));
+        index_[name] = methods_.size() - 1;
     }
 
-    Method& operator[](const std::string& name) {
-        for (auto& method : methods_) {
-            if (method.name() == name) {
-                return method;
-            }
+    // 找不到时返回 nullptr
+    const Method* Find(const std::string& name) const {
+        auto it = index_.find(name);
+        return it == index_.end() ? nullptr : &methods_[it->second];
+    }
+
+    const Method& operator[](const std::string& name) const {
+        auto method = Find(name);
+        if (method == nullptr) {
+            throw std::runtime_error("Method not found: " + name);
         }
-        throw std::runtime_error("Method not found: " + name);
+        return *method;
     }
 
     std::string GetDescriptorJson() {
@@ -260,6 +275,14 @@ public:
     }
 };
 
+// 一次方法调用：绑定好参数的独立参数帧，交错执行的多条命令互不影响
+struct Invocation {
+    const Method* method = nullptr;
+    ParameterList arguments;
+
+    void Run() const { method->Invoke(arguments); }
+};
+
 class Thing {
 public:
     Thing(const std::string& name, const std::string& description) :
@@ -269,17 +292,31 @@ public:
     virtual std::string GetDescriptorJson();
     virtual std::string GetStateJson();
     virtual void Invoke(const cJSON* command);
+    // 查找命令对应的方法并绑定参数，失败时返回 false
+    bool Bind(const cJSON* command, Invocation& invocation) const;
+    // 属性值发生变化时调用，可以在任意任务中调用
+    void NotifyStateChanged();
 
     const std::string& name() const { return name_; }
     const std::string& description() const { return description_; }
+    bool push_state() const { return push_state_; }
 
 protected:
     PropertyList properties_;
     MethodList methods_;
 
+    // 在构造函数中调用，表示设备会在状态变化时主动调用 NotifyStateChanged，
+    // 状态更新时不再轮询它的属性 getter
+    void EnableStatePush() { push_state_ = true; }
+
 private:
+    friend class ThingManager;
+
     std::string name_;
     std::string description_;
+    bool push_state_ = false;
+    std::atomic<bool> dirty_ = true;
+    std::string last_state_;    // 上一次上报的状态
 };
 
 
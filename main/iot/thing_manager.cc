@@ -1,6 +1,7 @@
 #include "thing_manager.h"
 
 #include <esp_log.h>
+#include <esp_timer.h>
 
 #define TAG "ThingManager"
 
@@ -8,12 +9,29 @@ namespace iot {
 
 void ThingManager::AddThing(Thing* thing) {
     things_.push_back(thing);
+    things_by_name_[thing->name()] = thing;
+    descriptors_.clear();
+    descriptors_generation_++;
+    if (!thing->push_state()) {
+        polled_things_++;
+    }
+}
+
+const std::vector<std::string>& ThingManager::GetDescriptors() {
+    if (descriptors_.size() != things_.size()) {
+        descriptors_.clear();
+        descriptors_.reserve(things_.size());
+        for (auto thing : things_) {
+            descriptors_.push_back(thing->GetDescriptorJson());
+        }
+    }
+    return descriptors_;
 }
 
 std::string ThingManager::GetDescriptorsJson() {
     std::string json_str = "[";
-    for (auto& thing : things_) {
-        json_str += thing->GetDescriptorJson() + ",";
+    for (auto& descriptor : GetDescriptors()) {
+        json_str += descriptor + ",";
     }
     if (json_str.back() == ',') {
         json_str.pop_back();
@@ -22,42 +40,101 @@ std::string ThingManager::GetDescriptorsJson() {
     return json_str;
 }
 
-bool ThingManager::GetStatesJson(std::string& json, bool delta) {
-    if (!delta) {
-        last_states_.clear();
+bool ThingManager::GetStatesJson(std::string& json, bool delta, std::string* names) {
+    auto start_time = esp_timer_get_time();
+    bool pending = pending_changes_.exchange(false);
+    if (names != nullptr) {
+        names->clear();
+    }
+    // 所有设备都是推送模式且没有新的变化，不需要调用任何 getter
+    if (delta && !pending && polled_things_ == 0) {
+        json = "[]";
+        return false;
     }
+
     bool changed = false;
+    int serialized = 0;
     json = "[";
-    // 枚举thing，获取每个thing的state，如果发生变化，则更新，保存到last_states_
-    // 如果delta为true，则只返回变化的部分
-    for (auto& thing : things_) {
+    for (auto thing : things_) {
+        bool dirty = thing->dirty_.exchange(false);
+        if (delta && thing->push_state_ && !dirty) {
+            continue;
+        }
         std::string state = thing->GetStateJson();
-        if (delta) {
-            // 如果delta为true，则只返回变化的部分
-            auto it = last_states_.find(thing->name());
-            if (it != last_states_.end() && it->second == state) {
-                continue;
+        serialized++;
+        // 轮询的设备和重复的通知都靠与上次上报的状态比较来过滤
+        if (delta && state == thing->last_state_) {
+            continue;
+        }
+        changed = true;
+        json += state;
+        json += ',';
+        if (names != nullptr) {
+            if (!names->empty()) {
+                names->push_back(',');
             }
-            changed = true;
-            last_states_[thing->name()] = state;
+            names->append(thing->name());
         }
-        json += state + ",";
+        thing->last_state_ = std::move(state);
     }
     if (json.back() == ',') {
         json.pop_back();
     }
     json += "]";
+    ESP_LOGD(TAG, "States of %d/%u things serialized in %lld us", serialized, (unsigned)things_.size(),
+        esp_timer_get_time() - start_time);
     return changed;
 }
 
-void ThingManager::Invoke(const cJSON* command) {
+void ThingManager::Schedule(std::function<void()> callback) {
+    if (scheduler_) {
+        scheduler_(std::move(callback));
+    } else {
+        callback();
+    }
+}
+
+Thing* ThingManager::FindThing(const cJSON* command) {
     auto name = cJSON_GetObjectItem(command, "name");
-    for (auto& thing : things_) {
-        if (thing->name() == name->valuestring) {
-            thing->Invoke(command);
-            return;
+    if (!cJSON_IsString(name)) {
+        ESP_LOGE(TAG, "Missing thing name");
+        return nullptr;
+    }
+    auto it = things_by_name_.find(name->valuestring);
+    if (it == things_by_name_.end()) {
+        ESP_LOGE(TAG, "Thing not found: %s", name->valuestring);
+        return nullptr;
+    }
+    return it->second;
+}
+
+void ThingManager::Invoke(const cJSON* command) {
+    auto thing = FindThing(command);
+    if (thing != nullptr) {
+        thing->Invoke(command);
+    }
+}
+
+void ThingManager::InvokeCommands(const cJSON* commands) {
+    std::vector<Invocation> invocations;
+    invocations.reserve(cJSON_GetArraySize(commands));
+    const cJSON* command;
+    cJSON_ArrayForEach(command, commands) {
+        auto thing = FindThing(command);
+        Invocation invocation;
+        if (thing != nullptr && thing->Bind(command, invocation)) {
+            invocations.push_back(std::move(invocation));
         }
     }
+    if (invocations.empty()) {
+        return;
+    }
+
+    Schedule([invocations = std::move(invocations)]() {
+        for (const auto& invocation : invocations) {
+            invocation.Run();
+        }
+    });
 }
 
 } // namespace iot
@@ -7,9 +7,11 @@
 #include <cJSON.h>
 
 #include <vector>
+#include <unordered_map>
 #include <memory>
 #include <functional>
-#include <map>
+#include <atomic>
+#include <cstdint>
 
 namespace iot {
 
@@ -25,15 +27,37 @@ public:
     void AddThing(Thing* thing);
 
     std::string GetDescriptorsJson();
-    bool GetStatesJson(std::string& json, bool delta = false);
+    // 每个设备的描述 JSON，启动后不再变化，第一次调用时序列化并缓存
+    const std::vector<std::string>& GetDescriptors();
+    // AddThing 时递增，协议层据此判断缓存的描述消息是否过期
+    uint32_t descriptors_generation() const { return descriptors_generation_; }
+    // delta 为 false 时返回全部设备的状态（新会话开始时使用），为 true 时只返回上次上报后变化的设备。
+    // 启用推送的设备只有调用过 NotifyStateChanged 才会重新序列化，其余设备仍然轮询比较。
+    // 会话之外发生的多次变化会累积到下一次调用中一起上报。
+    // names 不为空时写入本次包含的设备名，以逗号分隔
+    bool GetStatesJson(std::string& json, bool delta = false, std::string* names = nullptr);
     void Invoke(const cJSON* command);
+    // 执行服务器下发的 commands 数组：一次遍历完成查找和参数绑定，所有调用放在一次 Schedule 中执行
+    void InvokeCommands(const cJSON* commands);
+    // 由 Thing::NotifyStateChanged 调用
+    void OnStateChanged() { pending_changes_ = true; }
+    // 命令在主循环中执行，由 Application 设置；没有设置时就地执行
+    void SetScheduler(std::function<void(std::function<void()> callback)> scheduler) { scheduler_ = std::move(scheduler); }
+    void Schedule(std::function<void()> callback);
 
 private:
     ThingManager() = default;
     ~ThingManager() = default;
 
+    Thing* FindThing(const cJSON* command);
+
     std::vector<Thing*> things_;
-    std::map<std::string, std::string> last_states_;
+    std::unordered_map<std::string, Thing*> things_by_name_;
+    std::vector<std::string> descriptors_;
+    uint32_t descriptors_generation_ = 0;
+    size_t polled_things_ = 0;      // 没有启用推送、需要轮询的设备数
+    std::atomic<bool> pending_changes_ = true;
+    std::function<void(std::function<void()> callback)> scheduler_;
 };
 
 
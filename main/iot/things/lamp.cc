@@ -34,6 +34,8 @@ private:
 public:
     Lamp() : Thing("Lamp", "A test lamp"), power_(false) {
         InitializeGpio();
+        // power_ 只在下面的方法中改变，改变时主动通知
+        EnableStatePush();
 
         // 定义设备的属性
         properties_.AddBooleanProperty("power", "Whether the lamp is on", [this]() -> bool {
@@ -44,11 +46,13 @@ public:
         methods_.AddMethod("turn_on", "Turn on the lamp", ParameterList(), [this](const ParameterList& parameters) {
             power_ = true;
             gpio_set_level(gpio_num_, 1);
+            NotifyStateChanged();
         });
 
         methods_.AddMethod("turn_off", "Turn off the lamp", ParameterList(), [this](const ParameterList& parameters) {
             power_ = false;
             gpio_set_level(gpio_num_, 0);
+            NotifyStateChanged();
         });
     }
 };
@@ -0,0 +1,121 @@
+/*
+ * McpServer 中依赖 Board 和 Application 的部分：设备通用工具和 initialize 的能力协商
+ * 与协议处理分开编译，主机测试用 test/fake_mcp_common_tools.cc 代替这个文件
+ */
+
+#include "mcp_server.h"
+#include <esp_log.h>
+#include <cstdio>
+
+#include "application.h"
+#include "display.h"
+#include "board.h"
+
+#define TAG "MCP"
+
+void McpServer::AddCommonTools() {
+    // To speed up the response time, we add the common tools to the beginning of
+    // the tools list to utilize the prompt cache.
+    // Backup the original tools list and restore it after adding the common tools.
+    auto original_tools = std::move(tools_);
+    auto& board = Board::GetInstance();
+
+    AddTool("self.get_device_status",
+        "Provides the real-time information of the device, including the current status of the audio speaker, screen, battery, network, etc.\n"
+        "Use this tool for: \n"
+        "1. Answering questions about current condition (e.g. what is the current volume of the audio speaker?)\n"
+        "2. As the first step to control the device (e.g. turn up / down the volume of the audio speaker, etc.)",
+        PropertyList(),
+        [&board](const PropertyList& properties) -> ReturnValue {
+            return board.GetDeviceStatusJson();
+        });
+
+    AddTool("self.network.get_link_quality",
+        "Provides the quality of the current connection to the server, measured by in-band ping probes.\n"
+        "Use this tool when the user asks whether the network is slow or unstable.\n"
+        "Return:\n"
+        "  A JSON object with `rtt_ms`, `jitter_ms`, `loss_percent` and the probe counters.",
+        PropertyList(),
+        [](const PropertyList& properties) -> ReturnValue {
+            auto stats = Application::GetInstance().GetLinkStats();
+            char json[160];
+            snprintf(json, sizeof(json),
+                "{\"valid\":%s,\"rtt_ms\":%d,\"jitter_ms\":%d,\"loss_percent\":%d,\"pings_sent\":%lu,\"pongs_received\":%lu}",
+                stats.valid ? "true" : "false", stats.rtt_ms, stats.jitter_ms, (int)(stats.loss * 100 + 0.5f),
+                stats.pings_sent, stats.pongs_received);
+            return std::string(json);
+        });
+
+    AddTool("self.audio_speaker.set_volume", 
+        "Set the volume of the audio speaker. If the current volume is unknown, you must call `self.get_device_status` tool first and then call this tool.",
+        McpArgs(McpArg<int>("volume", 0, 100)),
+        [&board](int volume) -> ReturnValue {
+            auto codec = board.GetAudioCodec();
+            codec->SetOutputVolume(volume);
+            return true;
+        });
+    
+    auto backlight = board.GetBacklight();
+    if (backlight) {
+        AddTool("self.screen.set_brightness",
+            "Set the brightness of the screen.",
+            McpArgs(McpArg<int>("brightness", 0, 100)),
+            [backlight](int brightness) -> ReturnValue {
+                backlight->SetBrightness(static_cast<uint8_t>(brightness), true);
+                return true;
+            });
+    }
+
+    auto display = board.GetDisplay();
+    if (display && !display->GetTheme().empty()) {
+        AddTool("self.screen.set_theme",
+            "Set the theme of the screen. The theme can be `light` or `dark`.",
+            McpArgs(McpArg<std::string>("theme")),
+            [display](const std::string& theme) -> ReturnValue {
+                display->SetTheme(theme.c_str());
+                return true;
+            });
+    }
+
+    auto camera = board.GetCamera();
+    if (camera) {
+        AddTool("self.camera.take_photo",
+            "Take a photo and explain it. Use this tool after the user asks you to see something.\n"
+            "Args:\n"
+            "  `question`: The question that you want to ask about the photo.\n"
+            "Return:\n"
+            "  A JSON object that provides the photo information.",
+            McpArgs(McpArg<std::string>("question")),
+            [this, camera](const std::string& question) -> ReturnValue {
+                SendProgress(0, 2, "Capturing photo");
+                if (!camera->Capture()) {
+                    return "{\"success\": false, \"message\": \"Failed to capture photo\"}";
+                }
+                SendProgress(1, 2, "Explaining photo");
+                return camera->Explain(question);
+            });
+    }
+
+    // Restore the original tools list to the end of the tools list
+    tools_.insert(tools_.end(), original_tools.begin(), original_tools.end());
+    tools_list_pages_.clear();
+}
+
+void McpServer::ParseCapabilities(const cJSON* capabilities) {
+    auto vision = cJSON_GetObjectItem(capabilities, "vision");
+    if (cJSON_IsObject(vision)) {
+        auto url = cJSON_GetObjectItem(vision, "url");
+        auto token = cJSON_GetObjectItem(vision, "token");
+        if (cJSON_IsString(url)) {
+            auto camera = Board::GetInstance().GetCamera();
+            if (camera) {
+                std::string url_str = std::string(url->valuestring);
+                std::string token_str;
+                if (cJSON_IsString(token)) {
+                    token_str = std::string(token->valuestring);
+                }
+                camera->SetExplainUrl(url_str, token_str);
+            }
+        }
+    }
+}
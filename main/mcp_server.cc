@@ -6,17 +6,30 @@
 #include "mcp_server.h"
 #include <esp_log.h>
 #include <esp_app_desc.h>
+#include <esp_timer.h>
 #include <algorithm>
 #include <cstring>
-#include <esp_pthread.h>
+#include <mutex>
 
-#include "application.h"
-#include "display.h"
-#include "board.h"
+#include "json_writer.h"
 
 #define TAG "MCP"
 
-#define DEFAULT_TOOLCALL_STACK_SIZE 6144
+#define DEFAULT_TOOLCALL_STACK_SIZE MCP_TOOL_POOL_SMALL_STACK_SIZE
+// 单页 tools/list 结果的最大字节数
+#define MAX_TOOLS_LIST_PAYLOAD_SIZE 8000
+
+// 批量请求的回复收集器，所有回复到齐后合并成一条消息发送
+struct McpBatch {
+    std::mutex mutex;
+    std::string payload;
+    size_t copied_bytes = 0;    // 合并回复时复制的字节数
+    int pending_calls = 0;  // 线程池中尚未完成的调用
+    bool parsing = true;    // 还在逐条处理批量中的请求
+};
+
+// 当前工具调用的 progressToken（序列化后的 JSON 值），只在线程池的工作线程中设置
+static thread_local const std::string* current_progress_token = nullptr;
 
 McpServer::McpServer() {
 }
@@ -28,94 +41,79 @@ McpServer::~McpServer() {
     tools_.clear();
 }
 
-void McpServer::AddCommonTools() {
-    // To speed up the response time, we add the common tools to the beginning of
-    // the tools list to utilize the prompt cache.
-    // Backup the original tools list and restore it after adding the common tools.
-    auto original_tools = std::move(tools_);
-    auto& board = Board::GetInstance();
-
-    AddTool("self.get_device_status",
-        "Provides the real-time information of the device, including the current status of the audio speaker, screen, battery, network, etc.\n"
-        "Use this tool for: \n"
-        "1. Answering questions about current condition (e.g. what is the current volume of the audio speaker?)\n"
-        "2. As the first step to control the device (e.g. turn up / down the volume of the audio speaker, etc.)",
-        PropertyList(),
-        [&board](const PropertyList& properties) -> ReturnValue {
-            return board.GetDeviceStatusJson();
-        });
-
-    AddTool("self.audio_speaker.set_volume", 
-        "Set the volume of the audio speaker. If the current volume is unknown, you must call `self.get_device_status` tool first and then call this tool.",
-        PropertyList({
-            Property("volume", kPropertyTypeInteger, 0, 100)
-        }), 
-        [&board](const PropertyList& properties) -> ReturnValue {
-            auto codec = board.GetAudioCodec();
-            codec->SetOutputVolume(properties["volume"].value<int>());
-            return true;
-        });
-    
-    auto backlight = board.GetBacklight();
-    if (backlight) {
-        AddTool("self.screen.set_brightness",
-            "Set the brightness of the screen.",
-            PropertyList({
-                Property("brightness", kPropertyTypeInteger, 0, 100)
-            }),
-            [backlight](const PropertyList& properties) -> ReturnValue {
-                uint8_t brightness = static_cast<uint8_t>(properties["brightness"].value<int>());
-                backlight->SetBrightness(brightness, true);
-                return true;
-            });
-    }
-
-    auto display = board.GetDisplay();
-    if (display && !display->GetTheme().empty()) {
-        AddTool("self.screen.set_theme",
-            "Set the theme of the screen. The theme can be `light` or `dark`.",
-            PropertyList({
-                Property("theme", kPropertyTypeString)
-            }),
-            [display](const PropertyList& properties) -> ReturnValue {
-                display->SetTheme(properties["theme"].value<std::string>().c_str());
-                return true;
-            });
-    }
-
-    auto camera = board.GetCamera();
-    if (camera) {
-        AddTool("self.camera.take_photo",
-            "Take a photo and explain it. Use this tool after the user asks you to see something.\n"
-            "Args:\n"
-            "  `question`: The question that you want to ask about the photo.\n"
-            "Return:\n"
-            "  A JSON object that provides the photo information.",
-            PropertyList({
-                Property("question", kPropertyTypeString)
-            }),
-            [camera](const PropertyList& properties) -> ReturnValue {
-                if (!camera->Capture()) {
-                    return "{\"success\": false, \"message\": \"Failed to capture photo\"}";
+McpTool::McpTool(const std::string& name, const std::string& description, std::string_view input_schema, McpBinder binder)
+    : name_(name), description_(description), binder_(std::move(binder)) {
+    descriptor_.resize(64 + JsonWriter::EscapedLength(name) + JsonWriter::EscapedLength(description) + input_schema.size());
+    JsonWriter writer(descriptor_.data(), descriptor_.size());
+    writer.BeginObject()
+        .Field("name", name)
+        .Field("description", description)
+        .RawField("inputSchema", input_schema)
+        .EndObject();
+    descriptor_.resize(writer.size());
+}
+
+McpBoundCall McpTool::Bind(const cJSON* arguments, std::string& error) const {
+    if (binder_) {
+        return binder_(arguments, error);
+    }
+    return BindProperties(arguments, error);
+}
+
+McpBoundCall McpTool::BindProperties(const cJSON* tool_arguments, std::string& error) const {
+    PropertyList arguments = properties_;
+    // 已赋值的槽位，参数个数不设上限
+    std::vector<bool> bound(arguments.size());
+    try {
+        // 只遍历一遍传入的参数，按槽位绑定，忽略未声明的参数
+        if (cJSON_IsObject(tool_arguments)) {
+            for (auto value = tool_arguments->child; value != nullptr; value = value->next) {
+                int slot = arguments.IndexOf(value->string);
+                if (slot < 0) {
+                    continue;
+                }
+                auto& argument = arguments[(size_t)slot];
+                if (argument.type() == kPropertyTypeBoolean && cJSON_IsBool(value)) {
+                    argument.set_value<bool>(cJSON_IsTrue(value));
+                } else if (argument.type() == kPropertyTypeInteger && cJSON_IsNumber(value)) {
+                    argument.set_value<int>(value->valueint);
+                } else if (argument.type() == kPropertyTypeString && cJSON_IsString(value)) {
+                    argument.set_value<std::string>(value->valuestring);
+                } else {
+                    continue;
                 }
-                auto question = properties["question"].value<std::string>();
-                return camera->Explain(question);
-            });
+                bound[slot] = true;
+            }
+        }
+    } catch (const std::exception& e) {
+        error = e.what();
+        return nullptr;
     }
 
-    // Restore the original tools list to the end of the tools list
-    tools_.insert(tools_.end(), original_tools.begin(), original_tools.end());
+    for (size_t slot = 0; slot < arguments.size(); slot++) {
+        const auto& argument = arguments[slot];
+        if (!argument.has_default_value() && !bound[slot]) {
+            error = "Missing valid argument: " + argument.name();
+            return nullptr;
+        }
+    }
+    // 工具注册后不会删除，可以直接引用回调
+    return [this, arguments = std::move(arguments)]() -> ReturnValue {
+        return callback_(arguments);
+    };
 }
 
 void McpServer::AddTool(McpTool* tool) {
     // Prevent adding duplicate tools
-    if (std::find_if(tools_.begin(), tools_.end(), [tool](const McpTool* t) { return t->name() == tool->name(); }) != tools_.end()) {
+    if (tool_index_.find(tool->name()) != tool_index_.end()) {
         ESP_LOGW(TAG, "Tool %s already added", tool->name().c_str());
         return;
     }
 
     ESP_LOGI(TAG, "Add tool: %s", tool->name().c_str());
     tools_.push_back(tool);
+    tool_index_.emplace(tool->name(), tool);
+    tools_list_pages_.clear();
 }
 
 void McpServer::AddTool(const std::string& name, const std::string& description, const PropertyList& properties, std::function<ReturnValue(const PropertyList&)> callback) {
@@ -132,26 +130,53 @@ void McpServer::ParseMessage(const std::string& message) {
     cJSON_Delete(json);
 }
 
-void McpServer::ParseCapabilities(const cJSON* capabilities) {
-    auto vision = cJSON_GetObjectItem(capabilities, "vision");
-    if (cJSON_IsObject(vision)) {
-        auto url = cJSON_GetObjectItem(vision, "url");
-        auto token = cJSON_GetObjectItem(vision, "token");
-        if (cJSON_IsString(url)) {
-            auto camera = Board::GetInstance().GetCamera();
-            if (camera) {
-                std::string url_str = std::string(url->valuestring);
-                std::string token_str;
-                if (cJSON_IsString(token)) {
-                    token_str = std::string(token->valuestring);
-                }
-                camera->SetExplainUrl(url_str, token_str);
-            }
-        }
+void McpServer::ParseMessage(const cJSON* json) {
+    if (cJSON_IsArray(json)) {
+        ParseBatch(json);
+    } else {
+        ParseRequest(json);
     }
 }
 
-void McpServer::ParseMessage(const cJSON* json) {
+void McpServer::ParseBatch(const cJSON* json) {
+    if (cJSON_GetArraySize(json) == 0) {
+        ESP_LOGE(TAG, "Empty batch");
+        auto message = std::make_shared<EnvelopeBuffer>(96);
+        JsonWriter writer(message->payload_data(), message->payload_capacity());
+        writer.BeginObject()
+            .Field("jsonrpc", "2.0")
+            .Key("id").Raw("null")
+            .Key("error").BeginObject()
+                .Field("code", MCP_ERROR_INVALID_REQUEST)
+                .Field("message", "Empty batch")
+            .EndObject()
+            .EndObject();
+        message->set_payload_size(writer.size());
+        SendMessage(std::move(message));
+        return;
+    }
+
+    // 同步的回复直接追加，线程池中的调用完成后再追加，全部完成时一次发出
+    auto batch = std::make_shared<McpBatch>();
+    batch_ = batch;
+    const cJSON* item;
+    cJSON_ArrayForEach(item, json) {
+        ParseRequest(item);
+    }
+    batch_.reset();
+
+    bool done;
+    {
+        std::lock_guard<std::mutex> lock(batch->mutex);
+        batch->parsing = false;
+        done = batch->pending_calls == 0;
+    }
+    if (done) {
+        FlushBatch(batch);
+    }
+}
+
+void McpServer::ParseRequest(const cJSON* json) {
     // Check JSONRPC version
     auto version = cJSON_GetObjectItem(json, "jsonrpc");
     if (version == nullptr || !cJSON_IsString(version) || strcmp(version->valuestring, "2.0") != 0) {
@@ -167,6 +192,10 @@ void McpServer::ParseMessage(const cJSON* json) {
     }
     
     auto method_str = std::string(method->valuestring);
+    if (method_str == "notifications/cancelled") {
+        CancelRequest(cJSON_GetObjectItem(json, "params"));
+        return;
+    }
     if (method_str.find("notifications") == 0) {
         return;
     }
@@ -209,159 +238,341 @@ void McpServer::ParseMessage(const cJSON* json) {
     } else if (method_str == "tools/call") {
         if (!cJSON_IsObject(params)) {
             ESP_LOGE(TAG, "tools/call: Missing params");
-            ReplyError(id_int, "Missing params");
+            ReplyError(id_int, "Missing params", MCP_ERROR_INVALID_PARAMS);
             return;
         }
         auto tool_name = cJSON_GetObjectItem(params, "name");
         if (!cJSON_IsString(tool_name)) {
             ESP_LOGE(TAG, "tools/call: Missing name");
-            ReplyError(id_int, "Missing name");
+            ReplyError(id_int, "Missing name", MCP_ERROR_INVALID_PARAMS);
             return;
         }
         auto tool_arguments = cJSON_GetObjectItem(params, "arguments");
         if (tool_arguments != nullptr && !cJSON_IsObject(tool_arguments)) {
             ESP_LOGE(TAG, "tools/call: Invalid arguments");
-            ReplyError(id_int, "Invalid arguments");
+            ReplyError(id_int, "Invalid arguments", MCP_ERROR_INVALID_PARAMS);
             return;
         }
         auto stack_size = cJSON_GetObjectItem(params, "stackSize");
         if (stack_size != nullptr && !cJSON_IsNumber(stack_size)) {
             ESP_LOGE(TAG, "tools/call: Invalid stackSize");
-            ReplyError(id_int, "Invalid stackSize");
+            ReplyError(id_int, "Invalid stackSize", MCP_ERROR_INVALID_PARAMS);
+            return;
+        }
+        // 线程池没有更大的档位，按最大档位执行可能栈溢出，直接拒绝
+        if (stack_size != nullptr && stack_size->valueint > MCP_TOOL_POOL_LARGE_STACK_SIZE) {
+            ESP_LOGE(TAG, "tools/call: stackSize %d exceeds %d", stack_size->valueint, MCP_TOOL_POOL_LARGE_STACK_SIZE);
+            ReplyError(id_int, "stackSize exceeds " + std::to_string(MCP_TOOL_POOL_LARGE_STACK_SIZE), MCP_ERROR_INVALID_PARAMS);
             return;
         }
-        DoToolCall(id_int, std::string(tool_name->valuestring), tool_arguments, stack_size ? stack_size->valueint : DEFAULT_TOOLCALL_STACK_SIZE);
+        // 调用方通过 _meta.progressToken 订阅进度通知
+        std::string progress_token;
+        auto meta = cJSON_GetObjectItem(params, "_meta");
+        auto token = cJSON_GetObjectItem(meta, "progressToken");
+        if (cJSON_IsString(token) || cJSON_IsNumber(token)) {
+            char* token_str = cJSON_PrintUnformatted(token);
+            progress_token = token_str;
+            cJSON_free(token_str);
+        }
+        DoToolCall(id_int, std::string(tool_name->valuestring), tool_arguments,
+            stack_size ? stack_size->valueint : DEFAULT_TOOLCALL_STACK_SIZE, progress_token);
     } else {
         ESP_LOGE(TAG, "Method not implemented: %s", method_str.c_str());
-        ReplyError(id_int, "Method not implemented: " + method_str);
+        ReplyError(id_int, "Method not implemented: " + method_str, MCP_ERROR_METHOD_NOT_FOUND);
     }
 }
 
+std::shared_ptr<EnvelopeBuffer> McpServer::MakeResult(int id, const std::string& result) {
+    auto message = std::make_shared<EnvelopeBuffer>(48 + result.size());
+    JsonWriter writer(message->payload_data(), message->payload_capacity());
+    writer.BeginObject()
+        .Field("jsonrpc", "2.0")
+        .Field("id", id)
+        .RawField("result", result)
+        .EndObject();
+    message->set_payload_size(writer.size());
+    return message;
+}
+
+std::shared_ptr<EnvelopeBuffer> McpServer::MakeError(int id, const std::string& error, int code) {
+    // 错误信息可能来自异常，需要转义
+    auto message = std::make_shared<EnvelopeBuffer>(96 + JsonWriter::EscapedLength(error));
+    JsonWriter writer(message->payload_data(), message->payload_capacity());
+    writer.BeginObject()
+        .Field("jsonrpc", "2.0")
+        .Field("id", id)
+        .Key("error").BeginObject()
+            .Field("code", code)
+            .Field("message", error)
+        .EndObject()
+        .EndObject();
+    message->set_payload_size(writer.size());
+    return message;
+}
+
+std::shared_ptr<EnvelopeBuffer> McpServer::MakeToolResult(int id, const ReturnValue& value) {
+    char number[12];
+    std::string_view text;
+    if (std::holds_alternative<std::string>(value)) {
+        text = std::get<std::string>(value);
+    } else if (std::holds_alternative<bool>(value)) {
+        text = std::get<bool>(value) ? "true" : "false";
+    } else {
+        text = std::string_view(number, snprintf(number, sizeof(number), "%d", std::get<int>(value)));
+    }
+
+    // 预先算出转义后的长度，回复直接写进带信封预留空间的缓冲区，之后不再复制
+    auto message = std::make_shared<EnvelopeBuffer>(128 + JsonWriter::EscapedLength(text));
+    JsonWriter writer(message->payload_data(), message->payload_capacity());
+    writer.BeginObject()
+        .Field("jsonrpc", "2.0")
+        .Field("id", id)
+        .Key("result").BeginObject()
+            .Key("content").BeginArray()
+                .BeginObject().Field("type", "text").Field("text", text).EndObject()
+            .EndArray()
+            .Field("isError", false)
+        .EndObject()
+        .EndObject();
+    if (writer.overflow()) {
+        ESP_LOGE(TAG, "tools/call: Result buffer overflow");
+        return MakeError(id, "Result buffer overflow", MCP_ERROR_INTERNAL);
+    }
+    message->set_payload_size(writer.size());
+    return message;
+}
+
+// 调用方需持有 batch->mutex
+static void AppendToBatch(McpBatch& batch, const EnvelopeBuffer& message) {
+    auto payload = message.payload();
+    batch.payload += batch.payload.empty() ? '[' : ',';
+    batch.payload.append(payload);
+    batch.copied_bytes += payload.size();
+}
+
+void McpServer::Reply(const std::shared_ptr<McpBatch>& batch, std::shared_ptr<EnvelopeBuffer> message) {
+    if (!batch) {
+        SendMessage(std::move(message));
+        return;
+    }
+    std::lock_guard<std::mutex> lock(batch->mutex);
+    AppendToBatch(*batch, *message);
+}
+
 void McpServer::ReplyResult(int id, const std::string& result) {
-    std::string payload = "{\"jsonrpc\":\"2.0\",\"id\":";
-    payload += std::to_string(id) + ",\"result\":";
-    payload += result;
-    payload += "}";
-    Application::GetInstance().SendMcpMessage(payload);
+    Reply(batch_, MakeResult(id, result));
 }
 
-void McpServer::ReplyError(int id, const std::string& message) {
-    std::string payload = "{\"jsonrpc\":\"2.0\",\"id\":";
-    payload += std::to_string(id);
-    payload += ",\"error\":{\"message\":\"";
-    payload += message;
-    payload += "\"}}";
-    Application::GetInstance().SendMcpMessage(payload);
+void McpServer::ReplyError(int id, const std::string& message, int code) {
+    Reply(batch_, MakeError(id, message, code));
 }
 
-void McpServer::GetToolsList(int id, const std::string& cursor) {
-    const int max_payload_size = 8000;
-    std::string json = "{\"tools\":[";
-    
-    bool found_cursor = cursor.empty();
-    auto it = tools_.begin();
-    std::string next_cursor = "";
-    
-    while (it != tools_.end()) {
-        // 如果我们还没有找到起始位置，继续搜索
-        if (!found_cursor) {
-            if ((*it)->name() == cursor) {
-                found_cursor = true;
-            } else {
-                ++it;
-                continue;
-            }
+void McpServer::CompleteCall(const std::shared_ptr<McpBatch>& batch, std::shared_ptr<EnvelopeBuffer> message) {
+    if (!batch) {
+        if (message) {
+            SendMessage(std::move(message));
         }
-        
-        // 添加tool前检查大小
-        std::string tool_json = (*it)->to_json() + ",";
-        if (json.length() + tool_json.length() + 30 > max_payload_size) {
-            // 如果添加这个tool会超出大小限制，设置next_cursor并退出循环
-            next_cursor = (*it)->name();
-            break;
+        return;
+    }
+
+    bool done;
+    {
+        std::lock_guard<std::mutex> lock(batch->mutex);
+        if (message) {
+            AppendToBatch(*batch, *message);
         }
-        
-        json += tool_json;
-        ++it;
+        done = --batch->pending_calls == 0 && !batch->parsing;
     }
-    
-    if (json.back() == ',') {
-        json.pop_back();
+    if (done) {
+        FlushBatch(batch);
     }
-    
-    if (json.back() == '[' && !tools_.empty()) {
-        // 如果没有添加任何tool，返回错误
-        ESP_LOGE(TAG, "tools/list: Failed to add tool %s because of payload size limit", next_cursor.c_str());
-        ReplyError(id, "Failed to add tool " + next_cursor + " because of payload size limit");
+}
+
+// 所有回复都已到齐，不会再有其他线程写入
+void McpServer::FlushBatch(const std::shared_ptr<McpBatch>& batch) {
+    // 全部是通知或被取消的调用时不回复
+    if (batch->payload.empty()) {
         return;
     }
+    batch->payload += ']';
+    auto message = std::make_shared<EnvelopeBuffer>(batch->payload);
+    message->CountCopy(batch->copied_bytes);
+    SendMessage(std::move(message));
+}
 
-    if (next_cursor.empty()) {
-        json += "]}";
-    } else {
-        json += "],\"nextCursor\":\"" + next_cursor + "\"}";
+void McpServer::OnOutgoingMessage(std::function<void(std::shared_ptr<EnvelopeBuffer> message)> callback) {
+    on_outgoing_message_ = std::move(callback);
+}
+
+void McpServer::LogStats() {
+    tool_pool_.LogStats();
+}
+
+void McpServer::SendMessage(std::shared_ptr<EnvelopeBuffer> message) {
+    if (on_outgoing_message_) {
+        on_outgoing_message_(std::move(message));
     }
-    
-    ReplyResult(id, json);
 }
 
-void McpServer::DoToolCall(int id, const std::string& tool_name, const cJSON* tool_arguments, int stack_size) {
-    auto tool_iter = std::find_if(tools_.begin(), tools_.end(), 
-                                 [&tool_name](const McpTool* tool) { 
-                                     return tool->name() == tool_name; 
-                                 });
-    
-    if (tool_iter == tools_.end()) {
-        ESP_LOGE(TAG, "tools/call: Unknown tool: %s", tool_name.c_str());
-        ReplyError(id, "Unknown tool: " + tool_name);
+void McpServer::SendProgress(int progress, int total, const std::string& message) {
+    if (current_progress_token == nullptr || current_progress_token->empty()) {
         return;
     }
 
-    PropertyList arguments = (*tool_iter)->properties();
-    try {
-        for (auto& argument : arguments) {
-            bool found = false;
-            if (cJSON_IsObject(tool_arguments)) {
-                auto value = cJSON_GetObjectItem(tool_arguments, argument.name().c_str());
-                if (argument.type() == kPropertyTypeBoolean && cJSON_IsBool(value)) {
-                    argument.set_value<bool>(value->valueint == 1);
-                    found = true;
-                } else if (argument.type() == kPropertyTypeInteger && cJSON_IsNumber(value)) {
-                    argument.set_value<int>(value->valueint);
-                    found = true;
-                } else if (argument.type() == kPropertyTypeString && cJSON_IsString(value)) {
-                    argument.set_value<std::string>(value->valuestring);
-                    found = true;
-                }
-            }
+    auto notification = std::make_shared<EnvelopeBuffer>(160 + current_progress_token->size() + JsonWriter::EscapedLength(message));
+    JsonWriter writer(notification->payload_data(), notification->payload_capacity());
+    writer.BeginObject()
+        .Field("jsonrpc", "2.0")
+        .Field("method", "notifications/progress")
+        .Key("params").BeginObject()
+            .RawField("progressToken", *current_progress_token)
+            .Field("progress", progress);
+    if (total > 0) {
+        writer.Field("total", total);
+    }
+    if (!message.empty()) {
+        writer.Field("message", message);
+    }
+    writer.EndObject().EndObject();
+    notification->set_payload_size(writer.size());
+    // 进度通知不参与批量合并，立即发送
+    SendMessage(std::move(notification));
+}
+
+void McpServer::CancelRequest(const cJSON* params) {
+    auto request_id = cJSON_GetObjectItem(params, "requestId");
+    if (!cJSON_IsNumber(request_id)) {
+        ESP_LOGW(TAG, "notifications/cancelled: Invalid requestId");
+        return;
+    }
+    auto reason = cJSON_GetObjectItem(params, "reason");
+    const char* reason_str = cJSON_IsString(reason) ? reason->valuestring : "none";
+    if (tool_pool_.Cancel(request_id->valueint)) {
+        ESP_LOGI(TAG, "notifications/cancelled: Request %d cancelled, reason: %s", request_id->valueint, reason_str);
+    } else {
+        ESP_LOGI(TAG, "notifications/cancelled: Request %d is not queued, reason: %s", request_id->valueint, reason_str);
+    }
+}
 
-            if (!argument.has_default_value() && !found) {
-                ESP_LOGE(TAG, "tools/call: Missing valid argument: %s", argument.name().c_str());
-                ReplyError(id, "Missing valid argument: " + argument.name());
-                return;
+void McpServer::BuildToolsListPages() {
+    auto start_time = esp_timer_get_time();
+    tools_list_pages_.clear();
+    tools_list_page_starts_.clear();
+    tools_list_oversized_tool_.clear();
+
+    size_t index = 0;
+    do {
+        size_t page_start = index;
+        std::string page = "{\"tools\":[";
+        while (index < tools_.size()) {
+            const std::string& descriptor = tools_[index]->to_json();
+            // 预留 nextCursor 和结尾的空间
+            if (page.size() + descriptor.size() + 32 > MAX_TOOLS_LIST_PAYLOAD_SIZE) {
+                break;
+            }
+            if (index > page_start) {
+                page += ',';
             }
+            page += descriptor;
+            ++index;
         }
-    } catch (const std::exception& e) {
-        ESP_LOGE(TAG, "tools/call: %s", e.what());
-        ReplyError(id, e.what());
+
+        if (index == page_start && index < tools_.size()) {
+            tools_list_oversized_tool_ = tools_[index]->name();
+            ESP_LOGE(TAG, "tools/list: Tool %s exceeds the payload size limit", tools_list_oversized_tool_.c_str());
+            // 指向该工具的 cursor 仍然有效，请求时返回错误
+            tools_list_page_starts_.push_back(page_start);
+            break;
+        }
+
+        page += ']';
+        if (index < tools_.size()) {
+            page += ",\"nextCursor\":\"" + std::to_string(index) + "\"";
+        }
+        page += '}';
+        tools_list_pages_.push_back(std::move(page));
+        tools_list_page_starts_.push_back(page_start);
+    } while (index < tools_.size());
+
+    ESP_LOGI(TAG, "tools/list: %u tools in %u pages, built in %lld us", (unsigned)tools_.size(),
+        (unsigned)tools_list_pages_.size(), esp_timer_get_time() - start_time);
+}
+
+void McpServer::GetToolsList(int id, const std::string& cursor) {
+    if (tools_list_pages_.empty()) {
+        BuildToolsListPages();
+    }
+
+    size_t page = 0;
+    if (!cursor.empty()) {
+        char* end = nullptr;
+        unsigned long start = strtoul(cursor.c_str(), &end, 10);
+        auto it = std::find(tools_list_page_starts_.begin(), tools_list_page_starts_.end(), start);
+        if (*end != '\0' || it == tools_list_page_starts_.end()) {
+            ESP_LOGE(TAG, "tools/list: Invalid cursor: %s", cursor.c_str());
+            ReplyError(id, "Invalid cursor: " + cursor, MCP_ERROR_INVALID_PARAMS);
+            return;
+        }
+        page = it - tools_list_page_starts_.begin();
+    }
+
+    // 超大工具之前的页仍然可以正常返回
+    if (page >= tools_list_pages_.size()) {
+        ReplyError(id, "Failed to add tool " + tools_list_oversized_tool_ + " because of payload size limit");
         return;
     }
+    ReplyResult(id, tools_list_pages_[page]);
+}
 
-    // Start a task to receive data with stack size
-    esp_pthread_cfg_t cfg = esp_pthread_get_default_config();
-    cfg.thread_name = "tool_call";
-    cfg.stack_size = stack_size;
-    cfg.prio = 1;
-    esp_pthread_set_cfg(&cfg);
+void McpServer::DoToolCall(int id, const std::string& tool_name, const cJSON* tool_arguments, int stack_size,
+    const std::string& progress_token) {
+    auto tool_iter = tool_index_.find(tool_name);
+    if (tool_iter == tool_index_.end()) {
+        ESP_LOGE(TAG, "tools/call: Unknown tool: %s", tool_name.c_str());
+        ReplyError(id, "Unknown tool: " + tool_name, MCP_ERROR_INVALID_PARAMS);
+        return;
+    }
+    auto tool = tool_iter->second;
 
-    // Use a thread to call the tool to avoid blocking the main thread
-    tool_call_thread_ = std::thread([this, id, tool_iter, arguments = std::move(arguments)]() {
+    // 工具在线程池中异步执行，绑定结果持有参数的独立拷贝
+    std::string error;
+    McpBoundCall call = tool->Bind(tool_arguments, error);
+    if (!call) {
+        ESP_LOGE(TAG, "tools/call: %s", error.c_str());
+        ReplyError(id, error, MCP_ERROR_INVALID_PARAMS);
+        return;
+    }
+
+    // Call the tool in the worker pool to avoid blocking the main thread
+    auto batch = batch_;
+    if (batch) {
+        std::lock_guard<std::mutex> lock(batch->mutex);
+        batch->pending_calls++;
+    }
+    bool accepted = tool_pool_.Submit(tool_name, id, stack_size,
+        [this, id, batch, progress_token, call = std::move(call)](bool cancelled) {
+        if (cancelled) {
+            // 被取消的请求不再回复
+            CompleteCall(batch, nullptr);
+            return;
+        }
+
+        std::shared_ptr<EnvelopeBuffer> message;
+        current_progress_token = &progress_token;
         try {
-            ReplyResult(id, (*tool_iter)->Call(arguments));
+            message = MakeToolResult(id, call());
         } catch (const std::exception& e) {
             ESP_LOGE(TAG, "tools/call: %s", e.what());
-            ReplyError(id, e.what());
+            message = MakeError(id, e.what(), MCP_ERROR_INTERNAL);
         }
+        current_progress_token = nullptr;
+        CompleteCall(batch, std::move(message));
     });
-    tool_call_thread_.detach();
+    if (!accepted) {
+        if (batch) {
+            std::lock_guard<std::mutex> lock(batch->mutex);
+            batch->pending_calls--;
+        }
+        ReplyError(id, "Too many tool calls in progress, try again later", MCP_ERROR_SERVER_BUSY);
+    }
 }
\ No newline at end of file
@@ -2,16 +2,32 @@
 #define MCP_SERVER_H
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
+#include <memory>
+#include <unordered_map>
 #include <functional>
 #include <variant>
 #include <optional>
 #include <stdexcept>
-#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 
 #include <cJSON.h>
 
+#include "mcp_tool_pool.h"
+#include "envelope_buffer.h"
+
+// JSON-RPC 错误码
+#define MCP_ERROR_INVALID_REQUEST -32600
+#define MCP_ERROR_METHOD_NOT_FOUND -32601
+#define MCP_ERROR_INVALID_PARAMS -32602
+#define MCP_ERROR_INTERNAL -32603
+// 工具调用线程池已满
+#define MCP_ERROR_SERVER_BUSY -32000
+
 // 添加类型别名
 using ReturnValue = std::variant<bool, int, std::string>;
 
@@ -68,7 +84,7 @@ public:
     inline int max_value() const { return max_value_.value_or(0); }
 
     template<typename T>
-    inline T value() const {
+    inline const T& value() const {
         return std::get<T>(value_);
     }
 
@@ -141,6 +157,20 @@ public:
         throw std::runtime_error("Property not found: " + name);
     }
 
+    // 按槽位访问，槽位即属性注册的顺序
+    const Property& operator[](size_t slot) const { return properties_[slot]; }
+    Property& operator[](size_t slot) { return properties_[slot]; }
+    size_t size() const { return properties_.size(); }
+
+    int IndexOf(const char* name) const {
+        for (size_t i = 0; i < properties_.size(); i++) {
+            if (properties_[i].name() == name) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
     auto begin() { return properties_.begin(); }
     auto end() { return properties_.end(); }
 
@@ -158,8 +188,8 @@ public:
         cJSON *json = cJSON_CreateObject();
         
         for (const auto& property : properties_) {
-            cJSON *prop_json = cJSON_Parse(property.to_json().c_str());
-            cJSON_AddItemToObject(json, property.name().c_str(), prop_json);
+            // 直接嵌入已序列化的属性，不再解析一遍
+            cJSON_AddRawToObject(json, property.name().c_str(), property.to_json().c_str());
         }
         
         char *json_str = cJSON_PrintUnformatted(json);
@@ -171,28 +201,335 @@ public:
     }
 };
 
+// 类型化工具的 inputSchema 在编译期生成，存放在 McpArgs 内的定长缓冲区中
+#define MCP_ARGS_SCHEMA_SIZE 512
+
+// 类型化参数：C++ 类型到 JSON Schema 类型的映射
+template <typename T>
+struct McpArgTraits {
+    static_assert(sizeof(T) == 0, "MCP tool arguments must be bool, int or std::string");
+};
+template <>
+struct McpArgTraits<bool> {
+    static constexpr const char* type = "boolean";
+    using Default = bool;
+};
+template <>
+struct McpArgTraits<int> {
+    static constexpr const char* type = "integer";
+    using Default = int;
+};
+template <>
+struct McpArgTraits<std::string> {
+    static constexpr const char* type = "string";
+    using Default = const char*;
+};
+
+/*
+ * 类型化的工具参数声明
+ * 构造函数是 consteval 的，名称必须是字面量，范围和默认值的错误在编译期报出：
+ *   McpArg<int>("volume", 50, 0, 100)
+ */
+template <typename T>
+class McpArg {
+public:
+    using Default = typename McpArgTraits<T>::Default;
+
+    consteval McpArg(const char* name) : name_(name) {
+        CheckName(name);
+    }
+    consteval McpArg(const char* name, Default default_value)
+        : name_(name), has_default_(true), default_(default_value) {
+        CheckName(name);
+        if constexpr (std::is_same_v<T, std::string>) {
+            if (default_value == nullptr) {
+                throw std::invalid_argument("String default must not be null");
+            }
+        }
+    }
+    consteval McpArg(const char* name, int min_value, int max_value)
+        : name_(name), has_range_(true), min_(min_value), max_(max_value) {
+        static_assert(std::is_same_v<T, int>, "Range limits only apply to integer arguments");
+        CheckName(name);
+        if (min_value > max_value) {
+            throw std::invalid_argument("Minimum must not exceed maximum");
+        }
+    }
+    consteval McpArg(const char* name, int default_value, int min_value, int max_value)
+        : name_(name), has_default_(true), default_(default_value), has_range_(true), min_(min_value), max_(max_value) {
+        static_assert(std::is_same_v<T, int>, "Range limits only apply to integer arguments");
+        CheckName(name);
+        if (default_value < min_value || default_value > max_value) {
+            throw std::invalid_argument("Default value must be within the specified range");
+        }
+    }
+
+    constexpr const char* name() const { return name_; }
+    constexpr bool has_default() const { return has_default_; }
+    T default_value() const { return T(default_); }
+
+    // 参数名直接写进 schema 和错误信息，只允许不需要转义的字符
+    static consteval void CheckName(const char* name) {
+        if (name == nullptr || name[0] == '\0') {
+            throw std::invalid_argument("Argument name must not be empty");
+        }
+        for (const char* p = name; *p != '\0'; ++p) {
+            char c = *p;
+            if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-' || c == '.')) {
+                throw std::invalid_argument("Argument name may only contain letters, digits, '_', '-' and '.'");
+            }
+        }
+    }
+
+    // 取出 tools/call 中的参数值；类型不符时返回 false，视为没有传入，超出范围时写入 error
+    bool Accept(const cJSON* value, T& out, std::string& error) const {
+        if constexpr (std::is_same_v<T, bool>) {
+            if (!cJSON_IsBool(value)) {
+                return false;
+            }
+            out = cJSON_IsTrue(value);
+        } else if constexpr (std::is_same_v<T, int>) {
+            if (!cJSON_IsNumber(value)) {
+                return false;
+            }
+            if (has_range_ && value->valueint < min_) {
+                error = "Value is below minimum allowed: " + std::to_string(min_);
+                return false;
+            }
+            if (has_range_ && value->valueint > max_) {
+                error = "Value exceeds maximum allowed: " + std::to_string(max_);
+                return false;
+            }
+            out = value->valueint;
+        } else {
+            if (!cJSON_IsString(value)) {
+                return false;
+            }
+            out = value->valuestring;
+        }
+        return true;
+    }
+
+    // 属性的 schema，与 Property::to_json 的字段顺序一致
+    template <typename Writer>
+    constexpr void WriteSchema(Writer& writer) const {
+        writer.Append("{\"type\":\"");
+        writer.Append(McpArgTraits<T>::type);
+        writer.Append("\"");
+        if (has_default_) {
+            writer.Append(",\"default\":");
+            if constexpr (std::is_same_v<T, bool>) {
+                writer.Append(default_ ? "true" : "false");
+            } else if constexpr (std::is_same_v<T, int>) {
+                writer.AppendInt(default_);
+            } else {
+                writer.AppendString(default_);
+            }
+        }
+        if (has_range_) {
+            writer.Append(",\"minimum\":");
+            writer.AppendInt(min_);
+            writer.Append(",\"maximum\":");
+            writer.AppendInt(max_);
+        }
+        writer.Append("}");
+    }
+
+private:
+    const char* name_;
+    bool has_default_ = false;
+    Default default_ = Default();
+    bool has_range_ = false;
+    int min_ = 0;
+    int max_ = 0;
+};
+
+// 编译期拼接 schema 的写入器，超出缓冲区时抛出异常，即编译失败
+class McpSchemaWriter {
+public:
+    constexpr McpSchemaWriter(char* data, size_t capacity) : data_(data), capacity_(capacity) {}
+
+    constexpr void Append(char c) {
+        if (size_ >= capacity_) {
+            throw std::length_error("Tool schema exceeds MCP_ARGS_SCHEMA_SIZE");
+        }
+        data_[size_++] = c;
+    }
+    constexpr void Append(const char* s) {
+        for (; *s != '\0'; ++s) {
+            Append(*s);
+        }
+    }
+    constexpr void AppendInt(int value) {
+        char digits[12] = {};
+        int count = 0;
+        // 用 long long 取绝对值，避免 INT_MIN 溢出
+        long long v = value;
+        if (v < 0) {
+            Append('-');
+            v = -v;
+        }
+        do {
+            digits[count++] = char('0' + v % 10);
+            v /= 10;
+        } while (v != 0);
+        while (count > 0) {
+            Append(digits[--count]);
+        }
+    }
+    constexpr void AppendString(const char* s) {
+        Append('"');
+        for (; *s != '\0'; ++s) {
+            char c = *s;
+            if (c == '"' || c == '\\') {
+                Append('\\');
+                Append(c);
+            } else if (c == '\n') {
+                Append("\\n");
+            } else if (c >= 0 && c < 0x20) {
+                throw std::invalid_argument("String default must not contain control characters");
+            } else {
+                Append(c);
+            }
+        }
+        Append('"');
+    }
+    constexpr size_t size() const { return size_; }
+
+private:
+    char* data_;
+    size_t capacity_;
+    size_t size_ = 0;
+};
+
+// tools/call 的参数绑定成一次可在线程池中执行的调用
+using McpBoundCall = std::function<ReturnValue()>;
+// 绑定失败时返回空，error 为回复给调用方的错误信息
+using McpBinder = std::function<McpBoundCall(const cJSON* arguments, std::string& error)>;
+
+/*
+ * 工具的参数签名，例如 McpArgs(McpArg<int>("volume", 0, 100), McpArg<bool>("mute", false))
+ * 构造时在编译期生成 inputSchema 并检查参数名不重复；tools/call 时按声明顺序绑定到 std::tuple<T...>，
+ * 不经过 Property 和 std::variant。
+ */
+template <typename... T>
+struct McpArgs {
+    std::tuple<McpArg<T>...> args;
+
+    consteval McpArgs(McpArg<T>... args) : args(args...) {
+        const char* names[sizeof...(T) + 1] = {args.name()..., nullptr};
+        for (size_t i = 0; i < sizeof...(T); i++) {
+            for (size_t j = 0; j < i; j++) {
+                if (std::string_view(names[i]) == std::string_view(names[j])) {
+                    throw std::invalid_argument("Duplicate argument name");
+                }
+            }
+        }
+
+        McpSchemaWriter writer(schema_, MCP_ARGS_SCHEMA_SIZE);
+        writer.Append("{\"type\":\"object\",\"properties\":{");
+        // 没有参数的工具只有空的 properties
+        if constexpr (sizeof...(T) > 0) {
+            bool first = true;
+            auto write_property = [&writer, &first](const auto& arg) {
+                if (!first) {
+                    writer.Append(',');
+                }
+                first = false;
+                writer.Append('"');
+                writer.Append(arg.name());
+                writer.Append("\":");
+                arg.WriteSchema(writer);
+            };
+            (write_property(args), ...);
+            writer.Append('}');
+            // 与 McpTool::BuildDescriptor 一致，没有必填参数时省略 required
+            if ((!args.has_default() || ...)) {
+                writer.Append(",\"required\":[");
+                first = true;
+                auto write_required = [&writer, &first](const auto& arg) {
+                    if (arg.has_default()) {
+                        return;
+                    }
+                    if (!first) {
+                        writer.Append(',');
+                    }
+                    first = false;
+                    writer.Append('"');
+                    writer.Append(arg.name());
+                    writer.Append('"');
+                };
+                (write_required(args), ...);
+                writer.Append(']');
+            }
+        } else {
+            writer.Append('}');
+        }
+        writer.Append('}');
+        schema_size_ = writer.size();
+    }
+
+    constexpr std::string_view schema() const { return std::string_view(schema_, schema_size_); }
+
+    // 一次遍历传入的参数，按名称绑定到对应槽位，忽略未声明的参数；缺少的参数用默认值补齐
+    static bool Bind(const std::tuple<McpArg<T>...>& args, const cJSON* arguments, std::tuple<T...>& values, std::string& error) {
+        return BindSlots(args, arguments, values, error, std::index_sequence_for<T...>{});
+    }
+
+private:
+    char schema_[MCP_ARGS_SCHEMA_SIZE] = {};
+    size_t schema_size_ = 0;
+
+    template <size_t... I>
+    static bool BindSlots(const std::tuple<McpArg<T>...>& args, const cJSON* arguments, std::tuple<T...>& values,
+        std::string& error, std::index_sequence<I...>) {
+        if constexpr (sizeof...(T) == 0) {
+            return true;
+        } else {
+            bool bound[sizeof...(T)] = {};
+            if (cJSON_IsObject(arguments)) {
+                for (auto value = arguments->child; value != nullptr; value = value->next) {
+                    std::string_view key(value->string);
+                    ((key == std::get<I>(args).name() &&
+                        (bound[I] = std::get<I>(args).Accept(value, std::get<I>(values), error), true)) || ...);
+                    if (!error.empty()) {
+                        return false;
+                    }
+                }
+            }
+
+            bool complete = true;
+            auto fill = [&](const auto& arg, auto& value, bool is_bound) {
+                if (!complete || is_bound) {
+                    return;
+                }
+                if (!arg.has_default()) {
+                    error = std::string("Missing valid argument: ") + arg.name();
+                    complete = false;
+                    return;
+                }
+                value = arg.default_value();
+            };
+            (fill(std::get<I>(args), std::get<I>(values), bound[I]), ...);
+            return complete;
+        }
+    }
+};
+
 class McpTool {
 private:
     std::string name_;
     std::string description_;
     PropertyList properties_;
     std::function<ReturnValue(const PropertyList&)> callback_;
+    // 类型化工具的参数绑定，为空时按 properties_ 绑定
+    McpBinder binder_;
+    // 工具描述在注册时序列化一次，tools/list 直接拼接
+    std::string descriptor_;
 
-public:
-    McpTool(const std::string& name, 
-            const std::string& description, 
-            const PropertyList& properties, 
-            std::function<ReturnValue(const PropertyList&)> callback)
-        : name_(name), 
-        description_(description), 
-        properties_(properties), 
-        callback_(callback) {}
-
-    inline const std::string& name() const { return name_; }
-    inline const std::string& description() const { return description_; }
-    inline const PropertyList& properties() const { return properties_; }
+    McpBoundCall BindProperties(const cJSON* arguments, std::string& error) const;
 
-    std::string to_json() const {
+    std::string BuildDescriptor() const {
         std::vector<std::string> required = properties_.GetRequired();
         
         cJSON *json = cJSON_CreateObject();
@@ -202,8 +539,7 @@ public:
         cJSON *input_schema = cJSON_CreateObject();
         cJSON_AddStringToObject(input_schema, "type", "object");
         
-        cJSON *properties = cJSON_Parse(properties_.to_json().c_str());
-        cJSON_AddItemToObject(input_schema, "properties", properties);
+        cJSON_AddRawToObject(input_schema, "properties", properties_.to_json().c_str());
         
         if (!required.empty()) {
             cJSON *required_array = cJSON_CreateArray();
@@ -223,32 +559,37 @@ public:
         return result;
     }
 
-    std::string Call(const PropertyList& properties) {
-        ReturnValue return_value = callback_(properties);
-        // 返回结果
-        cJSON* result = cJSON_CreateObject();
-        cJSON* content = cJSON_CreateArray();
-        cJSON* text = cJSON_CreateObject();
-        cJSON_AddStringToObject(text, "type", "text");
-        if (std::holds_alternative<std::string>(return_value)) {
-            cJSON_AddStringToObject(text, "text", std::get<std::string>(return_value).c_str());
-        } else if (std::holds_alternative<bool>(return_value)) {
-            cJSON_AddStringToObject(text, "text", std::get<bool>(return_value) ? "true" : "false");
-        } else if (std::holds_alternative<int>(return_value)) {
-            cJSON_AddStringToObject(text, "text", std::to_string(std::get<int>(return_value)).c_str());
-        }
-        cJSON_AddItemToArray(content, text);
-        cJSON_AddItemToObject(result, "content", content);
-        cJSON_AddBoolToObject(result, "isError", false);
+public:
+    McpTool(const std::string& name, 
+            const std::string& description, 
+            const PropertyList& properties, 
+            std::function<ReturnValue(const PropertyList&)> callback)
+        : name_(name), 
+        description_(description), 
+        properties_(properties), 
+        callback_(callback) {
+        descriptor_ = BuildDescriptor();
+    }
 
-        auto json_str = cJSON_PrintUnformatted(result);
-        std::string result_str(json_str);
-        cJSON_free(json_str);
-        cJSON_Delete(result);
-        return result_str;
+    // 类型化工具：inputSchema 已在编译期生成，参数由 binder 直接绑定
+    McpTool(const std::string& name, const std::string& description, std::string_view input_schema, McpBinder binder);
+
+    inline const std::string& name() const { return name_; }
+    inline const std::string& description() const { return description_; }
+    inline const PropertyList& properties() const { return properties_; }
+
+    inline const std::string& to_json() const { return descriptor_; }
+
+    ReturnValue Call(const PropertyList& properties) {
+        return callback_(properties);
     }
+
+    // 校验并绑定 tools/call 的参数，失败时返回空并写入 error
+    McpBoundCall Bind(const cJSON* arguments, std::string& error) const;
 };
 
+struct McpBatch;
+
 class McpServer {
 public:
     static McpServer& GetInstance() {
@@ -259,8 +600,32 @@ public:
     void AddCommonTools();
     void AddTool(McpTool* tool);
     void AddTool(const std::string& name, const std::string& description, const PropertyList& properties, std::function<ReturnValue(const PropertyList&)> callback);
+
+    // 类型化注册：回调直接接收声明顺序的参数，签名不匹配时编译失败
+    template <typename... T, typename F>
+    void AddTool(const std::string& name, const std::string& description, const McpArgs<T...>& args, F callback) {
+        static_assert(std::is_invocable_r_v<ReturnValue, F, const T&...>,
+            "Tool callback parameters must match the declared McpArgs");
+        AddTool(new McpTool(name, description, args.schema(),
+            [spec = args.args, callback](const cJSON* arguments, std::string& error) -> McpBoundCall {
+                std::tuple<T...> values;
+                if (!McpArgs<T...>::Bind(spec, arguments, values, error)) {
+                    return nullptr;
+                }
+                return [callback, values = std::move(values)]() -> ReturnValue {
+                    return std::apply(callback, values);
+                };
+            }));
+    }
+    // 支持单个请求和 JSON-RPC 批量请求（数组），批量请求的回复合并为一条消息
     void ParseMessage(const cJSON* json);
     void ParseMessage(const std::string& message);
+    // 在工具回调中调用，向服务器发送 notifications/progress；请求没有携带 progressToken 时忽略
+    void SendProgress(int progress, int total, const std::string& message = "");
+    // 回复和通知的出口，由 Application 设置为经协议层发送；可能在线程池的工作线程中调用
+    void OnOutgoingMessage(std::function<void(std::shared_ptr<EnvelopeBuffer> message)> callback);
+    // 输出每个工具的调用次数和耗时，音频通道关闭时调用
+    void LogStats();
 
 private:
     McpServer();
@@ -268,14 +633,40 @@ private:
 
     void ParseCapabilities(const cJSON* capabilities);
 
+    void ParseBatch(const cJSON* json);
+    void ParseRequest(const cJSON* json);
+    void CancelRequest(const cJSON* params);
+
+    // 回复直接写进 EnvelopeBuffer，发送时由协议层就地补上信封
+    static std::shared_ptr<EnvelopeBuffer> MakeResult(int id, const std::string& result);
+    static std::shared_ptr<EnvelopeBuffer> MakeError(int id, const std::string& error, int code);
+    static std::shared_ptr<EnvelopeBuffer> MakeToolResult(int id, const ReturnValue& value);
+    // 不在批量请求中时立即发送，否则追加到批量回复
+    void Reply(const std::shared_ptr<McpBatch>& batch, std::shared_ptr<EnvelopeBuffer> message);
     void ReplyResult(int id, const std::string& result);
-    void ReplyError(int id, const std::string& message);
+    void ReplyError(int id, const std::string& message, int code = MCP_ERROR_INTERNAL);
+    // 线程池中的调用结束，message 为空表示调用被取消、不需要回复
+    void CompleteCall(const std::shared_ptr<McpBatch>& batch, std::shared_ptr<EnvelopeBuffer> message);
+    void FlushBatch(const std::shared_ptr<McpBatch>& batch);
+    void SendMessage(std::shared_ptr<EnvelopeBuffer> message);
 
     void GetToolsList(int id, const std::string& cursor);
-    void DoToolCall(int id, const std::string& tool_name, const cJSON* tool_arguments, int stack_size);
+    void BuildToolsListPages();
+    void DoToolCall(int id, const std::string& tool_name, const cJSON* tool_arguments, int stack_size,
+        const std::string& progress_token);
 
     std::vector<McpTool*> tools_;
-    std::thread tool_call_thread_;
+    // 工具名到工具的索引，tools/call 不再线性查找
+    std::unordered_map<std::string, McpTool*> tool_index_;
+    McpToolPool tool_pool_;
+    std::function<void(std::shared_ptr<EnvelopeBuffer> message)> on_outgoing_message_;
+    // 正在处理的批量请求，只在主线程解析批量请求期间有效
+    std::shared_ptr<McpBatch> batch_;
+
+    // tools/list 的分页缓存，工具列表变化时清空，下次请求时重建
+    std::vector<std::string> tools_list_pages_;     // 每页完整的 result JSON
+    std::vector<size_t> tools_list_page_starts_;    // 每页第一个工具的下标，即该页的 cursor
+    std::string tools_list_oversized_tool_;         // 单个描述就超出负载上限的工具
 };
 
 #endif // MCP_SERVER_H
@@ -0,0 +1,149 @@
+#include "mcp_tool_pool.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_pthread.h>
+
+#define TAG "McpToolPool"
+
+McpToolPool::McpToolPool()
+    : classes_{{MCP_TOOL_POOL_SMALL_STACK_SIZE, MCP_TOOL_POOL_SMALL_WORKERS},
+               {MCP_TOOL_POOL_LARGE_STACK_SIZE, MCP_TOOL_POOL_LARGE_WORKERS}} {
+}
+
+McpToolPool::~McpToolPool() {
+    // 线程都是 detach 的，这里只通知退出；McpServer 是进程级单例，实际不会析构
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+    for (auto& stack_class : classes_) {
+        stack_class.jobs.clear();
+        stack_class.cv.notify_all();
+    }
+}
+
+bool McpToolPool::Submit(const std::string& name, int id, int stack_size, std::function<void(bool cancelled)> job) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    StackClass* stack_class = nullptr;
+    for (auto& candidate : classes_) {
+        if (stack_size <= candidate.stack_size) {
+            stack_class = &candidate;
+            break;
+        }
+    }
+    if (stack_class == nullptr) {
+        ESP_LOGE(TAG, "Requested stack size %d for %s exceeds the largest class %d", stack_size, name.c_str(), MCP_TOOL_POOL_LARGE_STACK_SIZE);
+        return false;
+    }
+
+    // 所有线程都在忙且队列已满时拒绝，防止服务器用并发调用耗尽内存
+    if (stack_class->jobs.size() >= MCP_TOOL_POOL_QUEUE_DEPTH) {
+        stats_[name].rejected++;
+        ESP_LOGW(TAG, "Tool call queue is full, reject %s", name.c_str());
+        return false;
+    }
+
+    stack_class->jobs.push_back(Job{name, id, esp_timer_get_time(), std::move(job)});
+    // 被唤醒的空闲线程要等拿到锁才会取走任务，排队的任务比空闲线程多时就需要新线程
+    if ((int)stack_class->jobs.size() > stack_class->idle && stack_class->workers < stack_class->max_workers) {
+        StartWorker(stack_class);
+    }
+    stack_class->cv.notify_one();
+    return true;
+}
+
+bool McpToolPool::Cancel(int id) {
+    Job job;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        bool found = false;
+        for (auto& stack_class : classes_) {
+            for (auto it = stack_class.jobs.begin(); it != stack_class.jobs.end(); ++it) {
+                if (it->id == id) {
+                    job = std::move(*it);
+                    stack_class.jobs.erase(it);
+                    found = true;
+                    break;
+                }
+            }
+            if (found) {
+                break;
+            }
+        }
+        if (!found) {
+            return false;
+        }
+        stats_[job.name].cancelled++;
+    }
+
+    ESP_LOGI(TAG, "Cancelled queued call %d: %s", id, job.name.c_str());
+    job.run(true);
+    return true;
+}
+
+// 调用方需持有 mutex_
+void McpToolPool::StartWorker(StackClass* stack_class) {
+    esp_pthread_cfg_t cfg = esp_pthread_get_default_config();
+    cfg.thread_name = "tool_call";
+    cfg.stack_size = stack_class->stack_size;
+    cfg.prio = 1;
+    esp_pthread_set_cfg(&cfg);
+
+    std::thread([this, stack_class]() {
+        WorkerLoop(stack_class);
+    }).detach();
+    stack_class->workers++;
+
+    // 恢复默认配置，避免影响调用线程之后创建的其他 std::thread
+    cfg = esp_pthread_get_default_config();
+    esp_pthread_set_cfg(&cfg);
+    ESP_LOGI(TAG, "Started tool call worker %d/%d with stack size %d",
+        stack_class->workers, stack_class->max_workers, stack_class->stack_size);
+}
+
+void McpToolPool::WorkerLoop(StackClass* stack_class) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        stack_class->idle++;
+        stack_class->cv.wait(lock, [this, stack_class]() {
+            return stopping_ || !stack_class->jobs.empty();
+        });
+        stack_class->idle--;
+        if (stopping_) {
+            break;
+        }
+
+        Job job = std::move(stack_class->jobs.front());
+        stack_class->jobs.pop_front();
+        lock.unlock();
+
+        int64_t start_time = esp_timer_get_time();
+        job.run(false);
+        int64_t end_time = esp_timer_get_time();
+
+        lock.lock();
+        auto& stats = stats_[job.name];
+        int64_t elapsed = end_time - start_time;
+        stats.calls++;
+        stats.total_us += elapsed;
+        stats.total_wait_us += start_time - job.enqueue_time;
+        if (elapsed > stats.max_us) {
+            stats.max_us = elapsed;
+        }
+        ESP_LOGD(TAG, "%s: %lld ms (queued %lld ms), avg %lld ms over %lu calls", job.name.c_str(),
+            elapsed / 1000, (start_time - job.enqueue_time) / 1000, stats.total_us / stats.calls / 1000, stats.calls);
+    }
+    stack_class->workers--;
+}
+
+void McpToolPool::LogStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& [name, stats] : stats_) {
+        if (stats.calls == 0) {
+            ESP_LOGI(TAG, "%s: rejected %lu, cancelled %lu", name.c_str(), stats.rejected, stats.cancelled);
+            continue;
+        }
+        ESP_LOGI(TAG, "%s: calls %lu, avg %lld ms, max %lld ms, avg queued %lld ms, rejected %lu, cancelled %lu", name.c_str(),
+            stats.calls, stats.total_us / stats.calls / 1000, stats.max_us / 1000,
+            stats.total_wait_us / stats.calls / 1000, stats.rejected, stats.cancelled);
+    }
+}
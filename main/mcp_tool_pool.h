@@ -0,0 +1,75 @@
+#ifndef MCP_TOOL_POOL_H
+#define MCP_TOOL_POOL_H
+
+#include <string>
+#include <deque>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstdint>
+
+// 每个栈大小档位的常驻线程数和排队上限
+#define MCP_TOOL_POOL_SMALL_STACK_SIZE 6144
+#define MCP_TOOL_POOL_SMALL_WORKERS 2
+#define MCP_TOOL_POOL_LARGE_STACK_SIZE 16384
+#define MCP_TOOL_POOL_LARGE_WORKERS 1
+#define MCP_TOOL_POOL_QUEUE_DEPTH 4
+
+/*
+ * tools/call 的常驻线程池
+ * 按请求的栈大小分为两个档位，每个档位的线程在首次使用时创建，之后一直复用，
+ * 避免每次调用都重新配置 pthread 并分配新的栈。线程数和排队长度都有上限，
+ * 排满时 Submit 返回 false，由调用方回复 JSON-RPC 错误。
+ * 还在排队的调用可以按请求 id 取消，已经开始执行的调用无法中断。
+ * 按工具名统计排队时间和执行时间。
+ */
+class McpToolPool {
+public:
+    McpToolPool();
+    ~McpToolPool();
+
+    // stack_size 向上取到所属档位，超过最大档位时返回 false，调用方应在提交前校验
+    // job 正常执行时参数为 false，排队中被取消时在取消方的线程以 true 调用一次
+    bool Submit(const std::string& name, int id, int stack_size, std::function<void(bool cancelled)> job);
+    // 取消排队中的调用，返回 false 表示没有找到（已经开始执行或已完成）
+    bool Cancel(int id);
+    void LogStats();
+
+private:
+    struct Job {
+        std::string name;
+        int id;
+        int64_t enqueue_time;
+        std::function<void(bool cancelled)> run;
+    };
+
+    struct StackClass {
+        int stack_size;
+        int max_workers;
+        int workers = 0;
+        int idle = 0;
+        std::deque<Job> jobs;
+        std::condition_variable cv;
+    };
+
+    struct ToolStats {
+        uint32_t calls = 0;
+        uint32_t rejected = 0;
+        uint32_t cancelled = 0;
+        int64_t total_us = 0;
+        int64_t max_us = 0;
+        int64_t total_wait_us = 0;
+    };
+
+    std::mutex mutex_;
+    StackClass classes_[2];
+    std::map<std::string, ToolStats> stats_;
+    bool stopping_ = false;
+
+    void StartWorker(StackClass* stack_class);
+    void WorkerLoop(StackClass* stack_class);
+};
+
+#endif // MCP_TOOL_POOL_H
@@ -0,0 +1,123 @@
+#include "audio_aggregator.h"
+#include "protocol.h"
+
+#include <esp_log.h>
+
+#define TAG "AudioAggregator"
+
+// 发送耗时超过该值视为链路拥塞
+#define AGGREGATION_SLOW_SEND_MS 30
+// 连续多少次顺畅发送后降低一级聚合
+#define AGGREGATION_RECOVER_SENDS 50
+
+bool AudioAggregator::Append(const AudioStreamPacket& packet) {
+    size_t size = packet.payload.size();
+    if (size >= 0x8000) {
+        ESP_LOGE(TAG, "Opus frame too large: %u", (unsigned)size);
+        return !empty();
+    }
+
+    if (frame_count_ == 0) {
+        timestamp_ = packet.timestamp;
+        frames_.reserve(level_ * (size + 2));
+    }
+    if (size < 0x80) {
+        frames_.push_back(static_cast<char>(size));
+    } else {
+        frames_.push_back(static_cast<char>(0x80 | (size >> 8)));
+        frames_.push_back(static_cast<char>(size & 0xFF));
+    }
+    frames_.append(reinterpret_cast<const char*>(packet.payload.data()), size);
+    frame_count_++;
+    total_frames_++;
+    return frame_count_ >= level_;
+}
+
+void AudioAggregator::Clear() {
+    frames_.clear();
+    frame_count_ = 0;
+    timestamp_ = 0;
+}
+
+void AudioAggregator::SetLevel(int level) {
+    if (level < min_level_) {
+        level = min_level_;
+    } else if (level > AUDIO_AGGREGATION_MAX_FRAMES) {
+        level = AUDIO_AGGREGATION_MAX_FRAMES;
+    }
+    level_ = level;
+    good_sends_ = 0;
+}
+
+void AudioAggregator::SetMinLevel(int level) {
+    if (level < 1) {
+        level = 1;
+    } else if (level > AUDIO_AGGREGATION_MAX_FRAMES) {
+        level = AUDIO_AGGREGATION_MAX_FRAMES;
+    }
+    min_level_ = level;
+    if (level_ < min_level_) {
+        SetLevel(min_level_);
+    }
+}
+
+void AudioAggregator::OnSent(bool success, int elapsed_ms) {
+    if (success) {
+        total_packets_++;
+    }
+
+    if (!success || elapsed_ms > AGGREGATION_SLOW_SEND_MS) {
+        if (level_ < AUDIO_AGGREGATION_MAX_FRAMES) {
+            SetLevel(level_ * 2);
+            ESP_LOGI(TAG, "Link congested (%d ms), aggregation level -> %d", elapsed_ms, level_);
+        }
+        good_sends_ = 0;
+        return;
+    }
+
+    if (level_ > min_level_ && ++good_sends_ >= AGGREGATION_RECOVER_SENDS) {
+        SetLevel(level_ - 1);
+        ESP_LOGI(TAG, "Link recovered, aggregation level -> %d", level_);
+    }
+}
+
+// 解析下一帧的长度，返回 false 表示数据截断
+static bool NextFrame(const uint8_t*& p, const uint8_t* end, size_t& length) {
+    length = *p++;
+    if (length & 0x80) {
+        if (p >= end) {
+            return false;
+        }
+        length = ((length & 0x7F) << 8) | *p++;
+    }
+    return length <= (size_t)(end - p);
+}
+
+bool AudioAggregator::Decode(const uint8_t* data, size_t size, int frame_count, uint32_t timestamp, int frame_duration,
+    const std::function<void(AudioStreamPacket&& packet)>& callback) {
+    const uint8_t* end = data + size;
+    // 先校验整个负载，截断或损坏的包整体丢弃，不交出其中一部分帧
+    int count = 0;
+    size_t length;
+    for (const uint8_t* p = data; p < end; p += length) {
+        if (!NextFrame(p, end, length)) {
+            return false;
+        }
+        count++;
+    }
+    if (count != frame_count) {
+        return false;
+    }
+
+    int index = 0;
+    for (const uint8_t* p = data; p < end; p += length) {
+        NextFrame(p, end, length);
+        AudioStreamPacket packet;
+        packet.frame_duration = frame_duration;
+        packet.timestamp = timestamp + index * frame_duration;
+        packet.payload.assign(p, p + length);
+        callback(std::move(packet));
+        index++;
+    }
+    return true;
+}
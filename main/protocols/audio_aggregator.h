@@ -0,0 +1,60 @@
+#ifndef AUDIO_AGGREGATOR_H
+#define AUDIO_AGGREGATOR_H
+
+#include <string>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+struct AudioStreamPacket;
+
+// 单个传输帧最多聚合的 Opus 帧数，6 帧 x 60ms = 360ms 额外延迟
+#define AUDIO_AGGREGATION_MAX_FRAMES 6
+
+/*
+ * 多帧聚合（WebSocket 协议 v4 / UDP 包类型 0x02）
+ * 将连续 N 个 Opus 帧打包进一个传输帧，共享一个基准时间戳：
+ * |len 1~2u|opus|len 1~2u|opus|...
+ * 长度小于 128 时用 1 字节，否则用 2 字节（大端，最高位置 1）。
+ * 第 i 帧的时间戳 = 基准时间戳 + i * frame_duration。
+ *
+ * 聚合级别根据发送结果自适应：发送失败或耗时过长时加倍，链路持续良好时逐级回落。
+ */
+class AudioAggregator {
+public:
+    // 追加一帧，返回 true 表示已达到当前聚合级别，应当立即发送
+    bool Append(const AudioStreamPacket& packet);
+    void Clear();
+
+    bool empty() const { return frame_count_ == 0; }
+    int frame_count() const { return frame_count_; }
+    uint32_t timestamp() const { return timestamp_; }
+    const std::string& frames() const { return frames_; }
+
+    int level() const { return level_; }
+    void SetLevel(int level);
+    // 拥塞控制要求的最小聚合级别，自适应回落不会低于该值
+    void SetMinLevel(int level);
+    // 根据一次发送的结果和耗时调整聚合级别
+    void OnSent(bool success, int elapsed_ms);
+
+    // 统计：原始 Opus 帧数和实际发出的传输帧数
+    uint32_t total_frames() const { return total_frames_; }
+    uint32_t total_packets() const { return total_packets_; }
+
+    // frame_count 是包头声明的帧数，负载截断、格式错误或帧数不符时返回 false，且不回调任何帧
+    static bool Decode(const uint8_t* data, size_t size, int frame_count, uint32_t timestamp, int frame_duration,
+        const std::function<void(AudioStreamPacket&& packet)>& callback);
+
+private:
+    std::string frames_;
+    int frame_count_ = 0;
+    uint32_t timestamp_ = 0;
+    int level_ = 1;
+    int min_level_ = 1;
+    int good_sends_ = 0;
+    uint32_t total_frames_ = 0;
+    uint32_t total_packets_ = 0;
+};
+
+#endif // AUDIO_AGGREGATOR_H
@@ -0,0 +1,144 @@
+#include "congestion_controller.h"
+
+#include <esp_log.h>
+
+#define TAG "Congestion"
+
+// 拥塞解除前需要连续平稳的批次数，避免在临界点来回切换
+#define CONGESTION_CALM_BATCHES 20
+
+static const char* const kDropReasonNames[kAudioDropReasonCount] = {
+    "input_overflow",
+    "queue_full",
+    "send_failure",
+    "congestion",
+};
+
+CongestionController::CongestionController(int frame_duration_ms, size_t max_backlog)
+    : frame_duration_ms_(frame_duration_ms), max_backlog_(max_backlog) {
+}
+
+void CongestionController::OnBatchSent(size_t backlog, size_t sent, bool success, int elapsed_ms) {
+    if (backlog > max_seen_backlog_) {
+        max_seen_backlog_ = backlog;
+    }
+    packets_sent_ += sent;
+    if (!success && backlog > sent) {
+        OnDropped(kAudioDropSendFailure, backlog - sent);
+    }
+
+    // 只有主循环写入，其他任务只读
+    float send_latency_ms = send_latency_ms_;
+    if (sent > 0) {
+        float latency = (float)elapsed_ms / sent;
+        send_latency_ms += (latency - send_latency_ms) / 8;
+        send_latency_ms_ = send_latency_ms;
+    }
+
+    CongestionState state = kCongestionNone;
+    if (!success || backlog >= max_backlog_ / 2 || send_latency_ms > frame_duration_ms_) {
+        state = kCongestionSevere;
+    } else if (backlog >= 3 || send_latency_ms > frame_duration_ms_ / 2) {
+        state = kCongestionMild;
+    }
+
+    if (state < link_floor_) {
+        state = link_floor_;
+    }
+    // 轻度拥塞只靠加大聚合缓解，协议不支持时按未拥塞处理
+    if (state == kCongestionMild && !aggregation_available_) {
+        state = kCongestionNone;
+    }
+
+    if (state >= state_) {
+        calm_batches_ = 0;
+        if (state > state_) {
+            ESP_LOGW(TAG, "Uplink congestion %d -> %d, backlog: %u, send latency: %.1f ms",
+                state_, state, (unsigned)backlog, send_latency_ms);
+        }
+        state_ = state;
+    } else if (++calm_batches_ >= CONGESTION_CALM_BATCHES) {
+        // 每次只降一级
+        calm_batches_ = 0;
+        state_ = (CongestionState)(state_ - 1);
+        if (state_ == kCongestionMild && !aggregation_available_) {
+            state_ = kCongestionNone;
+        }
+        ESP_LOGI(TAG, "Uplink congestion eased to %d", state_);
+    }
+}
+
+void CongestionController::OnDropped(AudioDropReason reason, size_t count) {
+    drops_[reason] += count;
+}
+
+void CongestionController::OnLinkStats(const LinkStats& stats) {
+    if (!stats.valid) {
+        link_floor_ = kCongestionNone;
+    } else if (stats.loss > 0.2f || stats.rtt_ms > 1500) {
+        link_floor_ = kCongestionSevere;
+    } else if (stats.loss > 0.05f || stats.rtt_ms > 600 || stats.jitter_ms > 200) {
+        link_floor_ = kCongestionMild;
+    } else {
+        link_floor_ = kCongestionNone;
+    }
+}
+
+size_t CongestionController::ExcessBacklog(size_t backlog) const {
+    // 严重拥塞时把积压压到上限的四分之一，超出部分已经没有实时意义
+    size_t target = max_backlog_ / 4;
+    if (state_ != kCongestionSevere || backlog <= target) {
+        return 0;
+    }
+    return backlog - target;
+}
+
+int CongestionController::aggregation_level() const {
+    if (!aggregation_available_) {
+        return 1;
+    }
+    switch (state_) {
+        case kCongestionSevere:
+            return 4;
+        case kCongestionMild:
+            return 2;
+        default:
+            return 1;
+    }
+}
+
+void CongestionController::Reset() {
+    state_ = kCongestionNone;
+    link_floor_ = kCongestionNone;
+    send_latency_ms_ = 0;
+    max_seen_backlog_ = 0;
+    calm_batches_ = 0;
+    packets_sent_ = 0;
+    for (auto& drops : drops_) {
+        drops = 0;
+    }
+}
+
+void CongestionController::SetAggregationAvailable(bool available) {
+    aggregation_available_ = available;
+    if (!available && state_ == kCongestionMild) {
+        state_ = kCongestionNone;
+    }
+}
+
+void CongestionController::LogStats() const {
+    // 可能在网络任务中调用，先取一份快照
+    uint32_t drops[kAudioDropReasonCount];
+    uint32_t total_drops = 0;
+    for (int i = 0; i < kAudioDropReasonCount; i++) {
+        drops[i] = drops_[i];
+        total_drops += drops[i];
+    }
+    ESP_LOGI(TAG, "Uplink sent: %lu, max backlog: %lu, send latency: %.1f ms, dropped: %lu",
+        (uint32_t)packets_sent_, (uint32_t)max_seen_backlog_, (float)send_latency_ms_, total_drops);
+    for (int i = 0; i < kAudioDropReasonCount; i++) {
+        if (drops[i] > 0) {
+            ESP_LOGI(TAG, "  %s: %lu", kDropReasonNames[i], drops[i]);
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef CONGESTION_CONTROLLER_H
+#define CONGESTION_CONTROLLER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "link_probe.h"
+
+enum CongestionState {
+    kCongestionNone,
+    kCongestionMild,    // 发送开始落后，加大聚合
+    kCongestionSevere   // 积压接近上限，主动丢弃最旧的帧
+};
+
+enum AudioDropReason {
+    kAudioDropInputOverflow,    // 编码前发送队列已满，丢弃最新的 PCM
+    kAudioDropQueueFull,        // 编码后发送队列已满，丢弃最旧的包
+    kAudioDropSendFailure,      // 发送失败，本批剩余的包被丢弃
+    kAudioDropCongestion,       // 严重拥塞时主动丢弃
+    kAudioDropReasonCount
+};
+
+/*
+ * 上行拥塞控制
+ * 主循环每发送一批音频调用一次 OnBatchSent，根据积压长度和单包发送耗时（EWMA）判断拥塞程度。
+ * 拥塞时通过 aggregation_level() 要求协议层聚合更多帧，严重拥塞时由 ExcessBacklog() 给出需要丢弃的包数，
+ * 在队列溢出之前把延迟控制住。所有丢包按原因计数。
+ * 协议未启用多帧聚合（WebSocket v1~v3、服务器未确认 multi_frame 的 MQTT）时轻度拥塞没有可用的手段，
+ * 不进入该状态，只在严重拥塞时丢包。
+ * 除统计外的方法只在主循环中调用；统计字段是原子的，LogStats 可以在其他任务中调用。
+ */
+class CongestionController {
+public:
+    CongestionController(int frame_duration_ms, size_t max_backlog);
+
+    // backlog: 本批取出的包数，sent: 成功发送的包数，elapsed_ms: 本批发送总耗时
+    void OnBatchSent(size_t backlog, size_t sent, bool success, int elapsed_ms);
+    void OnDropped(AudioDropReason reason, size_t count = 1);
+    // 链路探测结果给出拥塞状态的下限，RTT 或丢包恶化时提前加大聚合
+    void OnLinkStats(const LinkStats& stats);
+    // 严重拥塞时返回需要从队首丢弃的包数
+    size_t ExcessBacklog(size_t backlog) const;
+
+    CongestionState state() const { return state_; }
+    // 建议协议层使用的最小聚合帧数
+    int aggregation_level() const;
+    void Reset();
+    // 协议当前是否支持多帧聚合，音频通道打开后设置
+    void SetAggregationAvailable(bool available);
+    void LogStats() const;
+
+private:
+    int frame_duration_ms_;
+    size_t max_backlog_;
+    CongestionState state_ = kCongestionNone;
+    CongestionState link_floor_ = kCongestionNone;
+    bool aggregation_available_ = false;
+    int calm_batches_ = 0;
+    std::atomic<float> send_latency_ms_ = 0;    // 单包发送耗时 EWMA
+    std::atomic<uint32_t> max_seen_backlog_ = 0;
+    std::atomic<uint32_t> packets_sent_ = 0;
+    std::atomic<uint32_t> drops_[kAudioDropReasonCount] = {};
+};
+
+#endif // CONGESTION_CONTROLLER_H
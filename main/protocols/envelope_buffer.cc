@@ -0,0 +1,54 @@
+#include "envelope_buffer.h"
+
+#include <cstring>
+
+EnvelopeBuffer::EnvelopeBuffer(size_t capacity)
+    : storage_(ENVELOPE_HEADROOM + capacity + ENVELOPE_TAILROOM, '\0'), capacity_(capacity) {
+}
+
+EnvelopeBuffer::EnvelopeBuffer(std::string_view payload) : EnvelopeBuffer(payload.size()) {
+    memcpy(payload_data(), payload.data(), payload.size());
+    set_payload_size(payload.size());
+    copied_bytes_ += payload.size();
+}
+
+void EnvelopeBuffer::set_payload_size(size_t size) {
+    if (size > capacity_) {
+        size = capacity_;
+    }
+    end_ = ENVELOPE_HEADROOM + size;
+}
+
+std::string_view EnvelopeBuffer::payload() const {
+    if (end_ < ENVELOPE_HEADROOM) {
+        // 消息已经被 TakeMessage 移走
+        return std::string_view();
+    }
+    return std::string_view(storage_.data() + ENVELOPE_HEADROOM, end_ - ENVELOPE_HEADROOM);
+}
+
+bool EnvelopeBuffer::Wrap(std::string_view prefix, std::string_view suffix) {
+    if (wrapped_ || prefix.size() > ENVELOPE_HEADROOM || suffix.size() > ENVELOPE_TAILROOM + capacity_ - (end_ - ENVELOPE_HEADROOM)) {
+        return false;
+    }
+    begin_ = ENVELOPE_HEADROOM - prefix.size();
+    memcpy(&storage_[begin_], prefix.data(), prefix.size());
+    memcpy(&storage_[end_], suffix.data(), suffix.size());
+    end_ += suffix.size();
+    wrapped_ = true;
+    return true;
+}
+
+std::string EnvelopeBuffer::TakeMessage() {
+    // 前缀通常填不满预留空间，需要把消息挪到开头，原地移动，不重新分配
+    if (begin_ > 0) {
+        copied_bytes_ += end_ - begin_;
+        storage_.erase(0, begin_);
+    }
+    storage_.resize(end_ - begin_);
+    std::string message = std::move(storage_);
+    storage_.clear();
+    capacity_ = 0;
+    begin_ = end_ = 0;
+    return message;
+}
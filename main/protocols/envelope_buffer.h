@@ -0,0 +1,51 @@
+#ifndef ENVELOPE_BUFFER_H
+#define ENVELOPE_BUFFER_H
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+// 负载前预留给信封前缀的空间，足够放下 {"session_id":"<uuid>","type":"mcp","payload":
+#define ENVELOPE_HEADROOM 96
+// 负载后预留给信封后缀的空间
+#define ENVELOPE_TAILROOM 8
+
+/*
+ * 预留了信封空间的消息缓冲区
+ * 生产方（例如 MCP 工具线程）把负载直接写在预留的头部空间之后，协议层发送前把信封前缀
+ * 写进头部空间、把后缀追加在负载之后，整条消息从生成到交给传输层只有这一份内存。
+ * 通过 shared_ptr 在线程间传递，不需要复制。确实发生的复制（合并批量回复、前缀超出预留空间等）
+ * 计入 copied_bytes()，便于统计。
+ */
+class EnvelopeBuffer {
+public:
+    // capacity: 负载的最大字节数
+    explicit EnvelopeBuffer(size_t capacity);
+    // 复制一份已有的负载，复制的字节数计入统计
+    explicit EnvelopeBuffer(std::string_view payload);
+
+    char* payload_data() { return &storage_[ENVELOPE_HEADROOM]; }
+    size_t payload_capacity() const { return capacity_; }
+    void set_payload_size(size_t size);
+    std::string_view payload() const;
+
+    // 就地写入前缀和后缀，预留空间不足或已经包装过时返回 false
+    bool Wrap(std::string_view prefix, std::string_view suffix);
+    // 完整的消息，未包装时等于负载
+    std::string_view message() const { return std::string_view(storage_.data() + begin_, end_ - begin_); }
+    // 把消息移出为独立的 std::string，供需要持有字符串的传输层使用；之后缓冲区不可再用
+    std::string TakeMessage();
+
+    size_t copied_bytes() const { return copied_bytes_; }
+    void CountCopy(size_t bytes) { copied_bytes_ += bytes; }
+
+private:
+    std::string storage_;
+    size_t capacity_;
+    size_t begin_ = ENVELOPE_HEADROOM;
+    size_t end_ = ENVELOPE_HEADROOM;
+    bool wrapped_ = false;
+    size_t copied_bytes_ = 0;
+};
+
+#endif // ENVELOPE_BUFFER_H
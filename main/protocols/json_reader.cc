@@ -0,0 +1,280 @@
+#include "json_reader.h"
+
+#include <cstdint>
+
+namespace {
+
+struct FieldEntry {
+    std::string_view key;
+    JsonString ControlMessage::*field;
+};
+
+const FieldEntry kFields[] = {
+    {"type", &ControlMessage::type},
+    {"state", &ControlMessage::state},
+    {"text", &ControlMessage::text},
+    {"emotion", &ControlMessage::emotion},
+    {"session_id", &ControlMessage::session_id},
+    {"command", &ControlMessage::command},
+    {"status", &ControlMessage::status},
+    {"message", &ControlMessage::message},
+    {"id", &ControlMessage::id},
+};
+
+class Scanner {
+public:
+    Scanner(const char* data, size_t length) : p_(data), end_(data + length) {}
+
+    bool AtEnd() const { return p_ >= end_; }
+    const char* position() const { return p_; }
+    char Peek() const { return p_ < end_ ? *p_ : '\0'; }
+    void Advance() { ++p_; }
+
+    void SkipWhitespace() {
+        while (p_ < end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\n' || *p_ == '\r')) {
+            ++p_;
+        }
+    }
+
+    bool Consume(char c) {
+        SkipWhitespace();
+        if (Peek() != c) {
+            return false;
+        }
+        ++p_;
+        return true;
+    }
+
+    // 读取字符串，p_ 指向开头的引号
+    bool ReadString(JsonString& out) {
+        if (Peek() != '"') {
+            return false;
+        }
+        ++p_;
+        const char* start = p_;
+        bool escaped = false;
+        while (p_ < end_) {
+            char c = *p_;
+            if (c == '"') {
+                out.raw = std::string_view(start, p_ - start);
+                out.escaped = escaped;
+                out.present = true;
+                ++p_;
+                return true;
+            }
+            if (c == '\\') {
+                escaped = true;
+                p_ += 2;
+                continue;
+            }
+            ++p_;
+        }
+        return false;
+    }
+
+    // 跳过任意值，嵌套的对象和数组只做括号计数
+    bool SkipValue() {
+        SkipWhitespace();
+        char c = Peek();
+        if (c == '"') {
+            JsonString ignored;
+            return ReadString(ignored);
+        }
+        if (c == '{' || c == '[') {
+            int depth = 0;
+            while (p_ < end_) {
+                c = *p_;
+                if (c == '"') {
+                    JsonString ignored;
+                    if (!ReadString(ignored)) {
+                        return false;
+                    }
+                    continue;
+                }
+                if (c == '{' || c == '[') {
+                    depth++;
+                } else if (c == '}' || c == ']') {
+                    if (--depth == 0) {
+                        ++p_;
+                        return true;
+                    }
+                }
+                ++p_;
+            }
+            return false;
+        }
+        // 数字、true、false、null
+        const char* start = p_;
+        while (p_ < end_ && *p_ != ',' && *p_ != '}' && *p_ != ']' &&
+               *p_ != ' ' && *p_ != '\t' && *p_ != '\n' && *p_ != '\r') {
+            ++p_;
+        }
+        return p_ > start;
+    }
+
+private:
+    const char* p_;
+    const char* end_;
+};
+
+int HexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool ReadHex4(const char* p, const char* end, uint32_t& value) {
+    if (end - p < 4) {
+        return false;
+    }
+    value = 0;
+    for (int i = 0; i < 4; i++) {
+        int v = HexValue(p[i]);
+        if (v < 0) {
+            return false;
+        }
+        value = (value << 4) | v;
+    }
+    return true;
+}
+
+void AppendUtf8(std::string& out, uint32_t cp) {
+    if (cp < 0x80) {
+        out.push_back(static_cast<char>(cp));
+    } else if (cp < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+}
+
+} // namespace
+
+std::string JsonString::str() const {
+    if (!escaped) {
+        return std::string(raw);
+    }
+
+    std::string out;
+    out.reserve(raw.size());
+    const char* p = raw.data();
+    const char* end = p + raw.size();
+    while (p < end) {
+        char c = *p++;
+        if (c != '\\' || p >= end) {
+            out.push_back(c);
+            continue;
+        }
+        c = *p++;
+        switch (c) {
+            case 'b': out.push_back('\b'); break;
+            case 'f': out.push_back('\f'); break;
+            case 'n': out.push_back('\n'); break;
+            case 'r': out.push_back('\r'); break;
+            case 't': out.push_back('\t'); break;
+            case 'u': {
+                uint32_t cp;
+                if (!ReadHex4(p, end, cp)) {
+                    return out;
+                }
+                p += 4;
+                // UTF-16 代理对
+                if (cp >= 0xD800 && cp <= 0xDBFF && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+                    uint32_t low;
+                    if (ReadHex4(p + 2, end, low) && low >= 0xDC00 && low <= 0xDFFF) {
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                        p += 6;
+                    }
+                }
+                // 落单的代理项不是合法的 Unicode 字符，替换为 U+FFFD
+                if (cp >= 0xD800 && cp <= 0xDFFF) {
+                    cp = 0xFFFD;
+                }
+                AppendUtf8(out, cp);
+                break;
+            }
+            default:
+                // \" \\ \/
+                out.push_back(c);
+                break;
+        }
+    }
+    return out;
+}
+
+bool ParseControlMessage(const char* json, size_t length, ControlMessage& message) {
+    message = ControlMessage();
+    message.json = json;
+    message.length = length;
+
+    Scanner scanner(json, length);
+    if (!scanner.Consume('{')) {
+        return false;
+    }
+    if (scanner.Consume('}')) {
+        return true;
+    }
+
+    while (true) {
+        scanner.SkipWhitespace();
+        JsonString key;
+        if (!scanner.ReadString(key) || !scanner.Consume(':')) {
+            return false;
+        }
+        scanner.SkipWhitespace();
+
+        JsonString* field = nullptr;
+        for (const auto& entry : kFields) {
+            if (entry.key == key.raw) {
+                field = &(message.*entry.field);
+                break;
+            }
+        }
+
+        if (field != nullptr && scanner.Peek() == '"') {
+            if (!scanner.ReadString(*field)) {
+                return false;
+            }
+        } else if (!scanner.SkipValue()) {
+            return false;
+        }
+
+        if (scanner.Consume(',')) {
+            continue;
+        }
+        return scanner.Consume('}');
+    }
+}
+
+bool ForEachArrayElement(const char* json, size_t length, const std::function<void(std::string_view element)>& callback) {
+    Scanner scanner(json, length);
+    if (!scanner.Consume('[')) {
+        return false;
+    }
+    if (scanner.Consume(']')) {
+        return true;
+    }
+
+    while (true) {
+        scanner.SkipWhitespace();
+        const char* start = scanner.position();
+        if (!scanner.SkipValue()) {
+            return false;
+        }
+        callback(std::string_view(start, scanner.position() - start));
+
+        if (scanner.Consume(',')) {
+            continue;
+        }
+        return scanner.Consume(']');
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef JSON_READER_H
+#define JSON_READER_H
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+#include <functional>
+
+/*
+ * 控制消息的流式读取器
+ * 只扫描一遍顶层 JSON 对象，提取常用的字符串字段，不构建 cJSON DOM，也不分配内存。
+ * 字段内容指向原始报文，只有在需要时才通过 str() 反转义。
+ */
+struct JsonString {
+    std::string_view raw;   // 引号内的原始内容（未反转义）
+    bool present = false;
+    bool escaped = false;   // raw 中包含转义字符，比较前需要先 str()
+
+    bool operator==(std::string_view value) const {
+        return present && !escaped && raw == value;
+    }
+    bool operator!=(std::string_view value) const {
+        return !(*this == value);
+    }
+
+    // 返回反转义后的 UTF-8 字符串
+    std::string str() const;
+};
+
+struct ControlMessage {
+    // 原始报文，mcp / iot / hello 等需要完整结构的消息由调用方再交给 cJSON 解析
+    const char* json = nullptr;
+    size_t length = 0;
+
+    JsonString type;
+    JsonString state;
+    JsonString text;
+    JsonString emotion;
+    JsonString session_id;
+    JsonString command;
+    JsonString status;
+    JsonString message;
+    JsonString id;
+};
+
+// 解析失败（不是 JSON 对象或格式错误）时返回 false
+bool ParseControlMessage(const char* json, size_t length, ControlMessage& message);
+
+// 遍历顶层 JSON 数组，回调参数为每个元素的原始文本
+bool ForEachArrayElement(const char* json, size_t length, const std::function<void(std::string_view element)>& callback);
+
+#endif // JSON_READER_H
@@ -0,0 +1,156 @@
+#include "json_writer.h"
+
+#include <cstring>
+#include <cstdio>
+
+void JsonWriter::Put(char c) {
+    if (size_ < capacity_) {
+        buffer_[size_++] = c;
+    } else {
+        overflow_ = true;
+    }
+}
+
+void JsonWriter::Put(std::string_view s) {
+    if (s.size() > capacity_ - size_) {
+        overflow_ = true;
+        s = s.substr(0, capacity_ - size_);
+    }
+    // 空的 string_view 可能带空指针，不能交给 memcpy
+    if (s.empty()) {
+        return;
+    }
+    memcpy(buffer_ + size_, s.data(), s.size());
+    size_ += s.size();
+}
+
+void JsonWriter::BeforeValue() {
+    if (after_key_) {
+        after_key_ = false;
+        return;
+    }
+    // 超过 32 层时 Push 已标记溢出，不再记录逗号
+    if (depth_ > 0 && depth_ <= 32) {
+        uint32_t bit = 1u << (depth_ - 1);
+        if (has_items_ & bit) {
+            Put(',');
+        }
+        has_items_ |= bit;
+    }
+}
+
+void JsonWriter::Push() {
+    depth_++;
+    if (depth_ <= 32) {
+        has_items_ &= ~(1u << (depth_ - 1));
+    } else {
+        overflow_ = true;
+    }
+}
+
+void JsonWriter::Pop() {
+    if (depth_ > 0) {
+        depth_--;
+    }
+}
+
+JsonWriter& JsonWriter::BeginObject() {
+    BeforeValue();
+    Put('{');
+    Push();
+    return *this;
+}
+
+JsonWriter& JsonWriter::EndObject() {
+    Pop();
+    Put('}');
+    return *this;
+}
+
+JsonWriter& JsonWriter::BeginArray() {
+    BeforeValue();
+    Put('[');
+    Push();
+    return *this;
+}
+
+JsonWriter& JsonWriter::EndArray() {
+    Pop();
+    Put(']');
+    return *this;
+}
+
+JsonWriter& JsonWriter::Key(std::string_view key) {
+    String(key);
+    Put(':');
+    after_key_ = true;
+    return *this;
+}
+
+size_t JsonWriter::EscapedLength(std::string_view value) {
+    size_t length = 0;
+    for (unsigned char c : value) {
+        if (c == '"' || c == '\\' || c == '\n' || c == '\r' || c == '\t' || c == '\b' || c == '\f') {
+            length += 2;
+        } else if (c < 0x20) {
+            length += 6;
+        } else {
+            length += 1;
+        }
+    }
+    return length;
+}
+
+JsonWriter& JsonWriter::String(std::string_view value) {
+    BeforeValue();
+    Put('"');
+    const char* run = value.data();
+    const char* end = value.data() + value.size();
+    for (const char* p = run; p < end; ++p) {
+        unsigned char c = *p;
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        // 先写入不需要转义的连续片段
+        Put(std::string_view(run, p - run));
+        run = p + 1;
+        switch (c) {
+            case '"': Put("\\\""); break;
+            case '\\': Put("\\\\"); break;
+            case '\n': Put("\\n"); break;
+            case '\r': Put("\\r"); break;
+            case '\t': Put("\\t"); break;
+            case '\b': Put("\\b"); break;
+            case '\f': Put("\\f"); break;
+            default: {
+                char escaped[7];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                Put(std::string_view(escaped, 6));
+                break;
+            }
+        }
+    }
+    Put(std::string_view(run, end - run));
+    Put('"');
+    return *this;
+}
+
+JsonWriter& JsonWriter::Number(int value) {
+    BeforeValue();
+    char digits[12];
+    int length = snprintf(digits, sizeof(digits), "%d", value);
+    Put(std::string_view(digits, length));
+    return *this;
+}
+
+JsonWriter& JsonWriter::Bool(bool value) {
+    BeforeValue();
+    Put(value ? std::string_view("true") : std::string_view("false"));
+    return *this;
+}
+
+JsonWriter& JsonWriter::Raw(std::string_view json) {
+    BeforeValue();
+    Put(json);
+    return *this;
+}
@@ -0,0 +1,70 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * 固定缓冲区的 JSON 序列化器
+ * 直接写入调用方提供的内存，自动处理逗号和字符串转义，不做任何堆分配。
+ * 缓冲区不足时 overflow() 返回 true，输出内容会被截断，调用方应丢弃。
+ */
+class JsonWriter {
+public:
+    JsonWriter(char* buffer, size_t capacity) : buffer_(buffer), capacity_(capacity) {}
+
+    JsonWriter& BeginObject();
+    JsonWriter& EndObject();
+    JsonWriter& BeginArray();
+    JsonWriter& EndArray();
+
+    JsonWriter& Key(std::string_view key);
+    JsonWriter& String(std::string_view value);
+    JsonWriter& Number(int value);
+    JsonWriter& Bool(bool value);
+    // 写入已经序列化好的 JSON 值（对象、数组等），内容不做检查
+    JsonWriter& Raw(std::string_view json);
+
+    // 常用的键值对简写
+    JsonWriter& Field(std::string_view key, std::string_view value) { return Key(key).String(value); }
+    JsonWriter& Field(std::string_view key, const char* value) { return Key(key).String(value); }
+    JsonWriter& Field(std::string_view key, int value) { return Key(key).Number(value); }
+    JsonWriter& Field(std::string_view key, bool value) { return Key(key).Bool(value); }
+    JsonWriter& RawField(std::string_view key, std::string_view json) { return Key(key).Raw(json); }
+
+    bool overflow() const { return overflow_; }
+    size_t size() const { return size_; }
+    std::string_view view() const { return std::string_view(buffer_, size_); }
+
+    // 计算字符串转义后的长度（不含引号），用于预估缓冲区大小
+    static size_t EscapedLength(std::string_view value);
+
+private:
+    char* buffer_;
+    size_t capacity_;
+    size_t size_ = 0;
+    bool overflow_ = false;
+    // 每层容器一位，记录是否已经写过元素，最多支持 32 层嵌套
+    uint32_t has_items_ = 0;
+    int depth_ = 0;
+    bool after_key_ = false;
+
+    void Put(char c);
+    void Put(std::string_view s);
+    void BeforeValue();
+    void Push();
+    void Pop();
+};
+
+// 带内置缓冲区的版本，适合放在栈上构造短小的控制消息
+template <size_t N>
+class StaticJsonWriter : public JsonWriter {
+public:
+    StaticJsonWriter() : JsonWriter(storage_, N) {}
+
+private:
+    char storage_[N];
+};
+
+#endif // JSON_WRITER_H
@@ -0,0 +1,95 @@
+#include "link_probe.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <cmath>
+
+#define TAG "LinkProbe"
+
+void LinkProbe::Reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& item : outstanding_) {
+        item = Outstanding();
+    }
+    rtt_ms_ = 0;
+    jitter_ms_ = 0;
+    last_rtt_ms_ = 0;
+    loss_ = 0;
+    stats_ = LinkStats();
+}
+
+uint32_t LinkProbe::OnPingSent() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto now_us = esp_timer_get_time();
+    ExpireLocked(now_us);
+
+    uint32_t id = ++next_id_;
+    // 覆盖最早的一项，被覆盖的探测在 ExpireLocked 中已经计为丢失或仍在等待
+    Outstanding* slot = &outstanding_[0];
+    for (auto& item : outstanding_) {
+        if (item.id == 0) {
+            slot = &item;
+            break;
+        }
+        if (item.sent_us < slot->sent_us) {
+            slot = &item;
+        }
+    }
+    if (slot->id != 0) {
+        RecordLossLocked(true);
+    }
+    slot->id = id;
+    slot->sent_us = now_us;
+    stats_.pings_sent++;
+    return id;
+}
+
+void LinkProbe::OnPong(uint32_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto now_us = esp_timer_get_time();
+    for (auto& item : outstanding_) {
+        if (item.id != id || id == 0) {
+            continue;
+        }
+        float rtt = (now_us - item.sent_us) / 1000.0f;
+        item = Outstanding();
+
+        if (!stats_.valid) {
+            rtt_ms_ = rtt;
+        } else {
+            rtt_ms_ += (rtt - rtt_ms_) / 8;
+            jitter_ms_ += (std::fabs(rtt - last_rtt_ms_) - jitter_ms_) / 16;
+        }
+        last_rtt_ms_ = rtt;
+        RecordLossLocked(false);
+
+        stats_.valid = true;
+        stats_.pongs_received++;
+        stats_.rtt_ms = (int)rtt_ms_;
+        stats_.jitter_ms = (int)jitter_ms_;
+        ESP_LOGD(TAG, "Pong %lu: rtt %.0f ms, avg %d ms, jitter %d ms, loss %.2f",
+            id, rtt, stats_.rtt_ms, stats_.jitter_ms, stats_.loss);
+        return;
+    }
+    ESP_LOGW(TAG, "Unexpected pong id: %lu", id);
+}
+
+LinkStats LinkProbe::stats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ExpireLocked(esp_timer_get_time());
+    return stats_;
+}
+
+void LinkProbe::ExpireLocked(int64_t now_us) {
+    for (auto& item : outstanding_) {
+        if (item.id != 0 && now_us - item.sent_us > LINK_PROBE_TIMEOUT_MS * 1000LL) {
+            item = Outstanding();
+            RecordLossLocked(true);
+        }
+    }
+}
+
+void LinkProbe::RecordLossLocked(bool lost) {
+    loss_ += ((lost ? 1.0f : 0.0f) - loss_) / 16;
+    stats_.loss = loss_;
+}
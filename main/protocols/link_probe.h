@@ -0,0 +1,57 @@
+#ifndef LINK_PROBE_H
+#define LINK_PROBE_H
+
+#include <mutex>
+#include <cstdint>
+#include <string>
+
+// 会话期间的探测间隔
+#define LINK_PROBE_INTERVAL_SECONDS 10
+// 超过该时间未收到 pong 视为丢失
+#define LINK_PROBE_TIMEOUT_MS 5000
+
+struct LinkStats {
+    bool valid = false;         // 至少收到过一次 pong
+    int rtt_ms = 0;             // 往返时延 EWMA
+    int jitter_ms = 0;          // 相邻两次 RTT 差值的 EWMA
+    float loss = 0;             // 丢失率 EWMA，0~1
+    uint32_t pings_sent = 0;
+    uint32_t pongs_received = 0;
+};
+
+/*
+ * 带内链路探测
+ * 通过控制通道（WebSocket 文本帧或 MQTT）发送 {"type":"ping","id":"N"}，服务器原样回复
+ * {"type":"pong","id":"N"}。只有服务器在 hello 的 features 中声明支持 ping 时才启用。
+ * RTT 和抖动的平滑方式参照 RFC 3550，丢失率按每次探测的结果做 EWMA。
+ */
+class LinkProbe {
+public:
+    void Reset();
+    // 返回本次探测的 id，并记录发送时间
+    uint32_t OnPingSent();
+    void OnPong(uint32_t id);
+    LinkStats stats();
+
+private:
+    static const int kMaxOutstanding = 4;
+
+    struct Outstanding {
+        uint32_t id = 0;
+        int64_t sent_us = 0;
+    };
+
+    std::mutex mutex_;
+    Outstanding outstanding_[kMaxOutstanding];
+    uint32_t next_id_ = 0;
+    float rtt_ms_ = 0;
+    float jitter_ms_ = 0;
+    float last_rtt_ms_ = 0;
+    float loss_ = 0;
+    LinkStats stats_;
+
+    void ExpireLocked(int64_t now_us);
+    void RecordLossLocked(bool lost);
+};
+
+#endif // LINK_PROBE_H
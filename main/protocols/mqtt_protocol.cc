@@ -4,6 +4,7 @@
 #include "settings.h"
 
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <ml307_mqtt.h>
 #include <ml307_udp.h>
 #include <cstring>
@@ -14,10 +15,20 @@
 
 MqttProtocol::MqttProtocol() {
     event_group_handle_ = xEventGroupCreate();
+    publish_queue_ = std::make_unique<PublishQueue>([this](const std::string& payload) {
+        return Publish(payload);
+    });
+    publish_queue_->OnPublishFailed([this]() {
+        Application::GetInstance().Schedule([this]() {
+            SetError(Lang::Strings::SERVER_ERROR);
+        });
+    });
 }
 
 MqttProtocol::~MqttProtocol() {
     ESP_LOGI(TAG, "MqttProtocol deinit");
+    // 先停止发布任务，再释放连接
+    publish_queue_.reset();
     if (udp_ != nullptr) {
         delete udp_;
     }
@@ -32,9 +43,16 @@ bool MqttProtocol::Start() {
 }
 
 bool MqttProtocol::StartMqttClient(bool report_error) {
-    if (mqtt_ != nullptr) {
+    // 连接可能耗时数秒，mqtt_mutex_ 只在替换 mqtt_ 和 publish_topic_ 时持有，发送路径不会被连接阻塞
+    Mqtt* old_mqtt;
+    {
+        std::lock_guard<std::mutex> lock(mqtt_mutex_);
+        old_mqtt = mqtt_;
+        mqtt_ = nullptr;
+    }
+    if (old_mqtt != nullptr) {
         ESP_LOGW(TAG, "Mqtt client already started");
-        delete mqtt_;
+        delete old_mqtt;
     }
 
     Settings settings("mqtt", false);
@@ -43,7 +61,10 @@ bool MqttProtocol::StartMqttClient(bool report_error) {
     auto username = settings.GetString("username");
     auto password = settings.GetString("password");
     int keepalive_interval = settings.GetInt("keepalive", 120);
-    publish_topic_ = settings.GetString("publish_topic");
+    {
+        std::lock_guard<std::mutex> lock(mqtt_mutex_);
+        publish_topic_ = settings.GetString("publish_topic");
+    }
 
     if (endpoint.empty()) {
         ESP_LOGW(TAG, "MQTT endpoint is not specified");
@@ -53,40 +74,41 @@ bool MqttProtocol::StartMqttClient(bool report_error) {
         return false;
     }
 
-    mqtt_ = Board::GetInstance().CreateMqtt();
-    mqtt_->SetKeepAlive(keepalive_interval);
+    auto mqtt = Board::GetInstance().CreateMqtt();
+    mqtt->SetKeepAlive(keepalive_interval);
 
-    mqtt_->OnDisconnected([this]() {
+    mqtt->OnDisconnected([this]() {
         ESP_LOGI(TAG, "Disconnected from endpoint");
     });
 
-    mqtt_->OnMessage([this](const std::string& topic, const std::string& payload) {
-        cJSON* root = cJSON_Parse(payload.c_str());
-        if (root == nullptr) {
+    mqtt->OnMessage([this](const std::string& topic, const std::string& payload) {
+        ControlMessage message;
+        if (!ParseControlMessage(payload.data(), payload.size(), message)) {
             ESP_LOGE(TAG, "Failed to parse json message %s", payload.c_str());
             return;
         }
-        cJSON* type = cJSON_GetObjectItem(root, "type");
-        if (!cJSON_IsString(type)) {
+        if (!message.type.present || message.type.escaped) {
             ESP_LOGE(TAG, "Message type is invalid");
-            cJSON_Delete(root);
             return;
         }
 
-        if (strcmp(type->valuestring, "hello") == 0) {
+        if (message.type == "hello") {
+            cJSON* root = cJSON_ParseWithLength(payload.data(), payload.size());
             ParseServerHello(root);
-        } else if (strcmp(type->valuestring, "goodbye") == 0) {
-            auto session_id = cJSON_GetObjectItem(root, "session_id");
-            ESP_LOGI(TAG, "Received goodbye message, session_id: %s", session_id ? session_id->valuestring : "null");
-            if (session_id == nullptr || session_id_ == session_id->valuestring) {
+            cJSON_Delete(root);
+        } else if (message.type == "goodbye") {
+            auto session_id = message.session_id.str();
+            ESP_LOGI(TAG, "Received goodbye message, session_id: %s", message.session_id.present ? session_id.c_str() : "null");
+            if (!message.session_id.present || session_id_ == session_id) {
                 Application::GetInstance().Schedule([this]() {
                     CloseAudioChannel();
                 });
             }
-        } else if (on_incoming_json_ != nullptr) {
-            on_incoming_json_(root);
+        } else if (message.type == "pong") {
+            HandlePong(message);
+        } else if (on_incoming_message_ != nullptr) {
+            on_incoming_message_(message);
         }
-        cJSON_Delete(root);
         last_incoming_time_ = std::chrono::steady_clock::now();
     });
 
@@ -100,7 +122,12 @@ bool MqttProtocol::StartMqttClient(bool report_error) {
     } else {
         broker_address = endpoint;
     }
-    if (!mqtt_->Connect(broker_address, broker_port, client_id, username, password)) {
+    bool connected = mqtt->Connect(broker_address, broker_port, client_id, username, password);
+    {
+        std::lock_guard<std::mutex> lock(mqtt_mutex_);
+        mqtt_ = mqtt;
+    }
+    if (!connected) {
         ESP_LOGE(TAG, "Failed to connect to endpoint");
         SetError(Lang::Strings::SERVER_NOT_CONNECTED);
         return false;
@@ -110,16 +137,40 @@ bool MqttProtocol::StartMqttClient(bool report_error) {
     return true;
 }
 
-bool MqttProtocol::SendText(const std::string& text) {
-    if (publish_topic_.empty()) {
+bool MqttProtocol::HasPublishTopic() {
+    std::lock_guard<std::mutex> lock(mqtt_mutex_);
+    return !publish_topic_.empty();
+}
+
+bool MqttProtocol::SendText(std::string_view text) {
+    if (!HasPublishTopic()) {
         return false;
     }
-    if (!mqtt_->Publish(publish_topic_, text)) {
-        ESP_LOGE(TAG, "Failed to publish message: %s", text.c_str());
-        SetError(Lang::Strings::SERVER_ERROR);
+    return publish_queue_->Enqueue(text);
+}
+
+bool MqttProtocol::SendBuffer(EnvelopeBuffer& buffer) {
+    if (!HasPublishTopic()) {
         return false;
     }
-    return true;
+    // 发布队列需要持有消息，直接接管缓冲区，不再复制一份
+    return publish_queue_->Enqueue(buffer.TakeMessage());
+}
+
+bool MqttProtocol::SendCoalescedText(std::string_view text, std::string_view key) {
+    if (!HasPublishTopic()) {
+        return false;
+    }
+    return publish_queue_->Enqueue(text, key);
+}
+
+// 在发布任务中调用
+bool MqttProtocol::Publish(const std::string& payload) {
+    std::lock_guard<std::mutex> lock(mqtt_mutex_);
+    if (mqtt_ == nullptr || publish_topic_.empty()) {
+        return false;
+    }
+    return mqtt_->Publish(publish_topic_, payload);
 }
 
 bool MqttProtocol::SendAudio(const AudioStreamPacket& packet) {
@@ -128,19 +179,59 @@ bool MqttProtocol::SendAudio(const AudioStreamPacket& packet) {
         return false;
     }
 
+    if (!multi_frame_) {
+        return SendUdpPacket(0x01, 0, packet.timestamp, packet.payload.data(), packet.payload.size());
+    }
+    if (!aggregator_.Append(packet)) {
+        return true;
+    }
+    return SendAggregatedAudio();
+}
+
+void MqttProtocol::FlushAudio() {
+    std::lock_guard<std::mutex> lock(channel_mutex_);
+    if (udp_ != nullptr && !aggregator_.empty()) {
+        SendAggregatedAudio();
+    }
+}
+
+bool MqttProtocol::IsAggregationEnabled() {
+    std::lock_guard<std::mutex> lock(channel_mutex_);
+    return multi_frame_;
+}
+
+void MqttProtocol::SetMinAggregationLevel(int level) {
+    std::lock_guard<std::mutex> lock(channel_mutex_);
+    aggregator_.SetMinLevel(level);
+}
+
+// 调用方需持有 channel_mutex_
+bool MqttProtocol::SendAggregatedAudio() {
+    const auto& frames = aggregator_.frames();
+    auto start_time = esp_timer_get_time();
+    bool success = SendUdpPacket(0x02, aggregator_.frame_count(), aggregator_.timestamp(),
+        (const uint8_t*)frames.data(), frames.size());
+    aggregator_.OnSent(success, (esp_timer_get_time() - start_time) / 1000);
+    aggregator_.Clear();
+    return success;
+}
+
+bool MqttProtocol::SendUdpPacket(uint8_t type, uint8_t flags, uint32_t timestamp, const uint8_t* payload, size_t size) {
     std::string nonce(aes_nonce_);
-    *(uint16_t*)&nonce[2] = htons(packet.payload.size());
-    *(uint32_t*)&nonce[8] = htonl(packet.timestamp);
+    nonce[0] = type;
+    nonce[1] = flags;
+    *(uint16_t*)&nonce[2] = htons(size);
+    *(uint32_t*)&nonce[8] = htonl(timestamp);
     *(uint32_t*)&nonce[12] = htonl(++local_sequence_);
 
     std::string encrypted;
-    encrypted.resize(aes_nonce_.size() + packet.payload.size());
+    encrypted.resize(aes_nonce_.size() + size);
     memcpy(encrypted.data(), nonce.data(), nonce.size());
 
     size_t nc_off = 0;
     uint8_t stream_block[16] = {0};
-    if (mbedtls_aes_crypt_ctr(&aes_ctx_, packet.payload.size(), &nc_off, (uint8_t*)nonce.c_str(), stream_block,
-        (uint8_t*)packet.payload.data(), (uint8_t*)&encrypted[nonce.size()]) != 0) {
+    if (mbedtls_aes_crypt_ctr(&aes_ctx_, size, &nc_off, (uint8_t*)nonce.c_str(), stream_block,
+        payload, (uint8_t*)&encrypted[nonce.size()]) != 0) {
         ESP_LOGE(TAG, "Failed to encrypt audio data");
         return false;
     }
@@ -155,19 +246,46 @@ void MqttProtocol::CloseAudioChannel() {
             delete udp_;
             udp_ = nullptr;
         }
+        if (aggregator_.total_packets() > 0) {
+            ESP_LOGI(TAG, "Audio aggregation: %lu frames in %lu packets", aggregator_.total_frames(), aggregator_.total_packets());
+        }
+        aggregator_.Clear();
     }
 
-    std::string message = "{";
-    message += "\"session_id\":\"" + session_id_ + "\",";
-    message += "\"type\":\"goodbye\"";
-    message += "}";
-    SendText(message);
+    StaticJsonWriter<CONTROL_MESSAGE_BUFFER_SIZE> writer;
+    writer.BeginObject()
+        .Field("session_id", session_id_)
+        .Field("type", "goodbye")
+        .EndObject();
+    SendJson(writer);
+    publish_queue_->LogStats();
 
     if (on_audio_channel_closed_ != nullptr) {
         on_audio_channel_closed_();
     }
 }
 
+bool MqttProtocol::MigrateTransport() {
+    bool was_opened;
+    {
+        std::lock_guard<std::mutex> lock(channel_mutex_);
+        was_opened = udp_ != nullptr;
+        if (udp_ != nullptr) {
+            delete udp_;
+            udp_ = nullptr;
+        }
+        aggregator_.Clear();
+    }
+
+    if (!StartMqttClient(false)) {
+        return false;
+    }
+    if (!was_opened) {
+        return true;
+    }
+    return OpenAudioChannel();
+}
+
 bool MqttProtocol::OpenAudioChannel() {
     if (mqtt_ == nullptr || !mqtt_->IsConnected()) {
         ESP_LOGI(TAG, "MQTT is not connected, try to connect now");
@@ -177,10 +295,15 @@ bool MqttProtocol::OpenAudioChannel() {
     }
 
     error_occurred_ = false;
+    resume_session_id_ = GetResumeSessionId();
     session_id_ = "";
     xEventGroupClearBits(event_group_handle_, MQTT_PROTOCOL_SERVER_HELLO_EVENT);
 
     auto message = GetHelloMessage();
+    if (message.empty()) {
+        SetError(Lang::Strings::SERVER_ERROR);
+        return false;
+    }
     if (!SendText(message)) {
         return false;
     }
@@ -193,7 +316,8 @@ bool MqttProtocol::OpenAudioChannel() {
         return false;
     }
 
-    std::lock_guard<std::mutex> lock(channel_mutex_);
+    // 只在替换 udp_ 期间持有 channel_mutex_：回调会查询聚合状态，再次获取这个锁
+    std::unique_lock<std::mutex> lock(channel_mutex_);
     if (udp_ != nullptr) {
         delete udp_;
     }
@@ -203,12 +327,14 @@ bool MqttProtocol::OpenAudioChannel() {
          * UDP Encrypted OPUS Packet Format:
          * |type 1u|flags 1u|payload_len 2u|ssrc 4u|timestamp 4u|sequence 4u|
          * |payload payload_len|
+         * type 0x01: 单个 Opus 帧
+         * type 0x02: 多帧聚合，flags 为帧数，payload 格式见 AudioAggregator
          */
-        if (data.size() < sizeof(aes_nonce_)) {
+        if (data.size() < aes_nonce_.size()) {
             ESP_LOGE(TAG, "Invalid audio packet size: %u", data.size());
             return;
         }
-        if (data[0] != 0x01) {
+        if (data[0] != 0x01 && data[0] != 0x02) {
             ESP_LOGE(TAG, "Invalid audio packet type: %x", data[0]);
             return;
         }
@@ -238,13 +364,24 @@ bool MqttProtocol::OpenAudioChannel() {
             return;
         }
         if (on_incoming_audio_ != nullptr) {
-            on_incoming_audio_(std::move(packet));
+            if (data[0] == 0x02) {
+                if (!AudioAggregator::Decode(packet.payload.data(), packet.payload.size(), (uint8_t)data[1], timestamp,
+                    server_frame_duration_, [this](AudioStreamPacket&& frame) {
+                        frame.sample_rate = server_sample_rate_;
+                        on_incoming_audio_(std::move(frame));
+                    })) {
+                    ESP_LOGE(TAG, "Invalid aggregated audio packet, %u frames in %u bytes", (uint8_t)data[1], decrypted_size);
+                }
+            } else {
+                on_incoming_audio_(std::move(packet));
+            }
         }
         remote_sequence_ = sequence;
         last_incoming_time_ = std::chrono::steady_clock::now();
     });
 
-    udp_->Connect(udp_server_, udp_port_);
+    udp_->Connect(Board::GetInstance().ResolveHost(udp_server_), udp_port_);
+    lock.unlock();
 
     if (on_audio_channel_opened_ != nullptr) {
         on_audio_channel_opened_();
@@ -254,32 +391,42 @@ bool MqttProtocol::OpenAudioChannel() {
 
 std::string MqttProtocol::GetHelloMessage() {
     // 发送 hello 消息申请 UDP 通道
-    cJSON* root = cJSON_CreateObject();
-    cJSON_AddStringToObject(root, "type", "hello");
-    cJSON_AddNumberToObject(root, "version", 3);
-    cJSON_AddStringToObject(root, "transport", "udp");
-    cJSON* features = cJSON_CreateObject();
+    StaticJsonWriter<CONTROL_MESSAGE_BUFFER_SIZE> writer;
+    writer.BeginObject()
+        .Field("type", "hello")
+        .Field("version", 3)
+        .Field("transport", "udp")
+        .Key("features").BeginObject();
 #if CONFIG_USE_SERVER_AEC
-    cJSON_AddBoolToObject(features, "aec", true);
+    writer.Field("aec", true);
 #endif
 #if CONFIG_IOT_PROTOCOL_MCP
-    cJSON_AddBoolToObject(features, "mcp", true);
+    writer.Field("mcp", true);
 #endif
-    cJSON_AddItemToObject(root, "features", features);
-    cJSON* audio_params = cJSON_CreateObject();
-    cJSON_AddStringToObject(audio_params, "format", "opus");
-    cJSON_AddNumberToObject(audio_params, "sample_rate", 16000);
-    cJSON_AddNumberToObject(audio_params, "channels", 1);
-    cJSON_AddNumberToObject(audio_params, "frame_duration", OPUS_FRAME_DURATION_MS);
-    cJSON_AddItemToObject(root, "audio_params", audio_params);
-    auto json_str = cJSON_PrintUnformatted(root);
-    std::string message(json_str);
-    cJSON_free(json_str);
-    cJSON_Delete(root);
-    return message;
+    writer.Field("ping", true);
+    writer.Field("multi_frame", true);
+    writer.EndObject()
+        .Key("audio_params").BeginObject()
+            .Field("format", "opus")
+            .Field("sample_rate", 16000)
+            .Field("channels", 1)
+            .Field("frame_duration", OPUS_FRAME_DURATION_MS)
+        .EndObject();
+    // 请求服务器沿用最近的会话，跳过重新初始化
+    if (!resume_session_id_.empty()) {
+        writer.Field("resume_session_id", resume_session_id_);
+    }
+    writer.EndObject();
+    // resume_session_id 来自服务器，截断的 hello 不能发出去
+    if (writer.overflow()) {
+        ESP_LOGE(TAG, "Hello message exceeds buffer size %d", CONTROL_MESSAGE_BUFFER_SIZE);
+        return std::string();
+    }
+    return std::string(writer.view());
 }
 
 void MqttProtocol::ParseServerHello(const cJSON* root) {
+    ParseHelloFeatures(root);
     auto transport = cJSON_GetObjectItem(root, "transport");
     if (transport == nullptr || strcmp(transport->valuestring, "udp") != 0) {
         ESP_LOGE(TAG, "Unsupported transport: %s", transport->valuestring);
@@ -288,8 +435,9 @@ void MqttProtocol::ParseServerHello(const cJSON* root) {
 
     auto session_id = cJSON_GetObjectItem(root, "session_id");
     if (cJSON_IsString(session_id)) {
+        bool resumed = !resume_session_id_.empty() && resume_session_id_ == session_id->valuestring;
         session_id_ = session_id->valuestring;
-        ESP_LOGI(TAG, "Session ID: %s", session_id_.c_str());
+        ESP_LOGI(TAG, "Session ID: %s%s", session_id_.c_str(), resumed ? " (resumed)" : "");
     }
 
     // Get sample rate from hello message
@@ -317,11 +465,19 @@ void MqttProtocol::ParseServerHello(const cJSON* root) {
 
     //auto encryption = cJSON_GetObjectItem(udp, "encryption")->valuestring;
     ESP_LOGI(TAG, "UDP server: %s, port: %d", udp_server_.c_str(), udp_port_);
+    // 在 MQTT 任务中执行，音频发送路径同时在使用密钥和聚合状态
+    std::lock_guard<std::mutex> lock(channel_mutex_);
     aes_nonce_ = DecodeHexString(nonce);
     mbedtls_aes_init(&aes_ctx_);
     mbedtls_aes_setkey_enc(&aes_ctx_, (const unsigned char*)DecodeHexString(key).c_str(), 128);
     local_sequence_ = 0;
     remote_sequence_ = 0;
+
+    // 服务器在 udp 参数中确认后才启用多帧聚合
+    multi_frame_ = cJSON_IsTrue(cJSON_GetObjectItem(udp, "multi_frame"));
+    aggregator_.Clear();
+    // 4G 链路按流量计费，从 2 帧聚合起步
+    aggregator_.SetLevel(Board::GetInstance().GetBoardType() == "ml307" ? 2 : 1);
     xEventGroupSetBits(event_group_handle_, MQTT_PROTOCOL_SERVER_HELLO_EVENT);
 }
 
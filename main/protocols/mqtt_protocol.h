@@ -3,6 +3,8 @@
 
 
 #include "protocol.h"
+#include "audio_aggregator.h"
+#include "publish_queue.h"
 #include <mqtt.h>
 #include <udp.h>
 #include <cJSON.h>
@@ -14,6 +16,7 @@
 #include <string>
 #include <map>
 #include <mutex>
+#include <memory>
 
 #define MQTT_PING_INTERVAL_SECONDS 90
 #define MQTT_RECONNECT_INTERVAL_MS 10000
@@ -27,9 +30,13 @@ public:
 
     bool Start() override;
     bool SendAudio(const AudioStreamPacket& packet) override;
+    void FlushAudio() override;
+    bool IsAggregationEnabled() override;
+    void SetMinAggregationLevel(int level) override;
     bool OpenAudioChannel() override;
     void CloseAudioChannel() override;
     bool IsAudioChannelOpened() const override;
+    bool MigrateTransport() override;
 
 private:
     EventGroupHandle_t event_group_handle_;
@@ -37,7 +44,10 @@ private:
     std::string publish_topic_;
 
     std::mutex channel_mutex_;
+    // 保护 mqtt_ 和 publish_topic_，发布任务和重连之间互斥
+    std::mutex mqtt_mutex_;
     Mqtt* mqtt_ = nullptr;
+    std::unique_ptr<PublishQueue> publish_queue_;
     Udp* udp_ = nullptr;
     mbedtls_aes_context aes_ctx_;
     std::string aes_nonce_;
@@ -45,12 +55,20 @@ private:
     int udp_port_;
     uint32_t local_sequence_;
     uint32_t remote_sequence_;
+    bool multi_frame_ = false;
+    AudioAggregator aggregator_;
 
     bool StartMqttClient(bool report_error=false);
     void ParseServerHello(const cJSON* root);
     std::string DecodeHexString(const std::string& hex_string);
+    bool SendUdpPacket(uint8_t type, uint8_t flags, uint32_t timestamp, const uint8_t* payload, size_t size);
+    bool SendAggregatedAudio();
 
-    bool SendText(const std::string& text) override;
+    bool SendText(std::string_view text) override;
+    bool SendBuffer(EnvelopeBuffer& buffer) override;
+    bool SendCoalescedText(std::string_view text, std::string_view key) override;
+    bool HasPublishTopic();
+    bool Publish(const std::string& payload);
     std::string GetHelloMessage();
 };
 
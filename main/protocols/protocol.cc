@@ -1,11 +1,13 @@
 #include "protocol.h"
 
 #include <esp_log.h>
+#include <esp_timer.h>
+#include <cstdio>
 
 #define TAG "Protocol"
 
-void Protocol::OnIncomingJson(std::function<void(const cJSON* root)> callback) {
-    on_incoming_json_ = callback;
+void Protocol::OnIncomingMessage(std::function<void(const ControlMessage& message)> callback) {
+    on_incoming_message_ = callback;
 }
 
 void Protocol::OnIncomingAudio(std::function<void(AudioStreamPacket&& packet)> callback) {
@@ -31,93 +33,221 @@ void Protocol::SetError(const std::string& message) {
     }
 }
 
+bool Protocol::SendJson(const JsonWriter& writer, std::string_view coalesce_key) {
+    if (writer.overflow()) {
+        ESP_LOGE(TAG, "Control message exceeds buffer size %u", (unsigned)writer.size());
+        return false;
+    }
+    if (!coalesce_key.empty()) {
+        return SendCoalescedText(writer.view(), coalesce_key);
+    }
+    return SendText(writer.view());
+}
+
 void Protocol::SendAbortSpeaking(AbortReason reason) {
-    std::string message = "{\"session_id\":\"" + session_id_ + "\",\"type\":\"abort\"";
+    StaticJsonWriter<CONTROL_MESSAGE_BUFFER_SIZE> writer;
+    writer.BeginObject()
+        .Field("session_id", session_id_)
+        .Field("type", "abort");
     if (reason == kAbortReasonWakeWordDetected) {
-        message += ",\"reason\":\"wake_word_detected\"";
+        writer.Field("reason", "wake_word_detected");
     }
-    message += "}";
-    SendText(message);
+    writer.EndObject();
+    SendJson(writer);
 }
 
 void Protocol::SendWakeWordDetected(const std::string& wake_word) {
-    std::string json = "{\"session_id\":\"" + session_id_ + 
-                      "\",\"type\":\"listen\",\"state\":\"detect\",\"text\":\"" + wake_word + "\"}";
-    SendText(json);
+    FlushAudio();
+    StaticJsonWriter<CONTROL_MESSAGE_BUFFER_SIZE> writer;
+    writer.BeginObject()
+        .Field("session_id", session_id_)
+        .Field("type", "listen")
+        .Field("state", "detect")
+        .Field("text", wake_word)
+        .EndObject();
+    SendJson(writer);
 }
 
 void Protocol::SendStartListening(ListeningMode mode) {
-    std::string message = "{\"session_id\":\"" + session_id_ + "\"";
-    message += ",\"type\":\"listen\",\"state\":\"start\"";
+    const char* mode_name = "manual";
     if (mode == kListeningModeRealtime) {
-        message += ",\"mode\":\"realtime\"";
+        mode_name = "realtime";
     } else if (mode == kListeningModeAutoStop) {
-        message += ",\"mode\":\"auto\"";
-    } else {
-        message += ",\"mode\":\"manual\"";
+        mode_name = "auto";
     }
-    message += "}";
-    SendText(message);
+
+    StaticJsonWriter<CONTROL_MESSAGE_BUFFER_SIZE> writer;
+    writer.BeginObject()
+        .Field("session_id", session_id_)
+        .Field("type", "listen")
+        .Field("state", "start")
+        .Field("mode", mode_name)
+        .EndObject();
+    SendJson(writer);
 }
 
 void Protocol::SendStopListening() {
-    std::string message = "{\"session_id\":\"" + session_id_ + "\",\"type\":\"listen\",\"state\":\"stop\"}";
-    SendText(message);
+    FlushAudio();
+    StaticJsonWriter<CONTROL_MESSAGE_BUFFER_SIZE> writer;
+    writer.BeginObject()
+        .Field("session_id", session_id_)
+        .Field("type", "listen")
+        .Field("state", "stop")
+        .EndObject();
+    SendJson(writer);
 }
 
-void Protocol::SendIotDescriptors(const std::string& descriptors) {
-    cJSON* root = cJSON_Parse(descriptors.c_str());
-    if (root == nullptr) {
-        ESP_LOGE(TAG, "Failed to parse IoT descriptors: %s", descriptors.c_str());
-        return;
+size_t Protocol::EnvelopeSize(std::string_view payload) const {
+    // {"session_id":"...","type":"...","update":true,"descriptors":[...]} 的固定部分不超过 64 字节
+    return payload.size() + JsonWriter::EscapedLength(session_id_) + 64;
+}
+
+void Protocol::SendIotDescriptors(const std::vector<std::string>& descriptors, uint32_t generation) {
+    auto start_time = esp_timer_get_time();
+    // 描述只在添加设备时变化，信封中除会话 ID 以外的部分只序列化一次
+    if (generation != iot_descriptor_generation_ || iot_descriptor_messages_.empty()) {
+        iot_descriptor_messages_.clear();
+        iot_descriptor_messages_.reserve(descriptors.size());
+        std::string buffer;
+        for (const auto& descriptor : descriptors) {
+            buffer.resize(EnvelopeSize(descriptor));
+            JsonWriter writer(buffer.data(), buffer.size());
+            writer.BeginObject()
+                .Field("type", "iot")
+                .Field("update", true)
+                .Key("descriptors").BeginArray().Raw(descriptor).EndArray()
+                .EndObject();
+            if (writer.overflow()) {
+                ESP_LOGE(TAG, "IoT descriptor exceeds buffer size: %u bytes", (unsigned)descriptor.size());
+                continue;
+            }
+            // 去掉开头的 {，换成逗号接在会话 ID 后面
+            std::string message(",");
+            message.append(writer.view().substr(1));
+            iot_descriptor_messages_.push_back(std::move(message));
+        }
+        iot_descriptor_generation_ = generation;
+    }
+
+    StaticJsonWriter<CONTROL_MESSAGE_BUFFER_SIZE> prefix;
+    prefix.BeginObject().Field("session_id", session_id_);
+    std::string buffer;
+    for (const auto& message : iot_descriptor_messages_) {
+        buffer.assign(prefix.view().data(), prefix.size());
+        buffer.append(message);
+        SendText(buffer);
     }
+    ESP_LOGI(TAG, "Sent %u IoT descriptors in %lld us", (unsigned)iot_descriptor_messages_.size(),
+        esp_timer_get_time() - start_time);
+}
 
-    if (!cJSON_IsArray(root)) {
-        ESP_LOGE(TAG, "IoT descriptors should be an array");
-        cJSON_Delete(root);
+void Protocol::SendIotStates(const std::string& states, std::string_view things) {
+    std::string buffer(EnvelopeSize(states), '\0');
+    JsonWriter writer(buffer.data(), buffer.size());
+    writer.BeginObject()
+        .Field("session_id", session_id_)
+        .Field("type", "iot")
+        .Field("update", true)
+        .RawField("states", states)
+        .EndObject();
+    if (things.empty()) {
+        SendJson(writer);
         return;
     }
+    // 每个设备的状态都是完整的，包含同一组设备的新消息可以取代旧消息；
+    // 设备不同的增量或完整状态不会被替换
+    std::string key("iot_states:");
+    key.append(things);
+    SendJson(writer, key);
+}
 
-    int arraySize = cJSON_GetArraySize(root);
-    for (int i = 0; i < arraySize; ++i) {
-        cJSON* descriptor = cJSON_GetArrayItem(root, i);
-        if (descriptor == nullptr) {
-            ESP_LOGE(TAG, "Failed to get IoT descriptor at index %d", i);
-            continue;
-        }
+void Protocol::SendMcpMessage(const std::shared_ptr<EnvelopeBuffer>& message) {
+    // 只写出信封的前缀 {"session_id":"...","type":"mcp","payload":
+    StaticJsonWriter<CONTROL_MESSAGE_BUFFER_SIZE> prefix;
+    prefix.BeginObject()
+        .Field("session_id", session_id_)
+        .Field("type", "mcp")
+        .Key("payload");
+    if (prefix.overflow()) {
+        ESP_LOGE(TAG, "MCP envelope exceeds buffer size");
+        return;
+    }
 
-        cJSON* messageRoot = cJSON_CreateObject();
-        cJSON_AddStringToObject(messageRoot, "session_id", session_id_.c_str());
-        cJSON_AddStringToObject(messageRoot, "type", "iot");
-        cJSON_AddBoolToObject(messageRoot, "update", true);
+    // SendBuffer 可能把消息移走，先记下负载大小
+    size_t payload_size = message->payload().size();
+    if (message->Wrap(prefix.view(), "}")) {
+        SendBuffer(*message);
+    } else {
+        // 会话 ID 过长，预留空间放不下前缀，退回到复制
+        auto payload = message->payload();
+        std::string buffer;
+        buffer.reserve(prefix.size() + payload.size() + 1);
+        buffer.append(prefix.view()).append(payload).push_back('}');
+        message->CountCopy(payload.size());
+        SendText(buffer);
+    }
 
-        cJSON* descriptorArray = cJSON_CreateArray();
-        cJSON_AddItemToArray(descriptorArray, cJSON_Duplicate(descriptor, 1));
-        cJSON_AddItemToObject(messageRoot, "descriptors", descriptorArray);
+    mcp_messages_++;
+    mcp_bytes_ += payload_size;
+    mcp_copied_bytes_ += message->copied_bytes();
+    ESP_LOGD(TAG, "MCP message: %u bytes, %u bytes copied", (unsigned)payload_size, (unsigned)message->copied_bytes());
+}
 
-        char* message = cJSON_PrintUnformatted(messageRoot);
-        if (message == nullptr) {
-            ESP_LOGE(TAG, "Failed to print JSON message for IoT descriptor at index %d", i);
-            cJSON_Delete(messageRoot);
-            continue;
-        }
+void Protocol::LogMcpStats() const {
+    if (mcp_messages_ == 0) {
+        return;
+    }
+    ESP_LOGI(TAG, "MCP messages: %lu, payload: %u bytes, copied: %u bytes (%u per message)", mcp_messages_,
+        (unsigned)mcp_bytes_, (unsigned)mcp_copied_bytes_, (unsigned)(mcp_copied_bytes_ / mcp_messages_));
+}
 
-        SendText(std::string(message));
-        cJSON_free(message);
-        cJSON_Delete(messageRoot);
+void Protocol::SendPing() {
+    if (!ping_supported_) {
+        return;
     }
+    char id[12];
+    snprintf(id, sizeof(id), "%lu", link_probe_.OnPingSent());
 
-    cJSON_Delete(root);
+    StaticJsonWriter<CONTROL_MESSAGE_BUFFER_SIZE> writer;
+    writer.BeginObject()
+        .Field("session_id", session_id_)
+        .Field("type", "ping")
+        .Field("id", id)
+        .EndObject();
+    SendJson(writer);
 }
 
-void Protocol::SendIotStates(const std::string& states) {
-    std::string message = "{\"session_id\":\"" + session_id_ + "\",\"type\":\"iot\",\"update\":true,\"states\":" + states + "}";
-    SendText(message);
+void Protocol::HandlePong(const ControlMessage& message) {
+    if (!message.id.present || message.id.escaped) {
+        ESP_LOGW(TAG, "Pong without id");
+        return;
+    }
+    uint32_t id = 0;
+    for (char c : message.id.raw) {
+        if (c < '0' || c > '9') {
+            ESP_LOGW(TAG, "Invalid pong id");
+            return;
+        }
+        id = id * 10 + (c - '0');
+    }
+    link_probe_.OnPong(id);
 }
 
-void Protocol::SendMcpMessage(const std::string& payload) {
-    std::string message = "{\"session_id\":\"" + session_id_ + "\",\"type\":\"mcp\",\"payload\":" + payload + "}";
-    SendText(message);
+void Protocol::ParseHelloFeatures(const cJSON* root) {
+    auto features = cJSON_GetObjectItem(root, "features");
+    ping_supported_ = cJSON_IsTrue(cJSON_GetObjectItem(features, "ping"));
+    link_probe_.Reset();
+}
+
+std::string Protocol::GetResumeSessionId() const {
+    if (session_id_.empty()) {
+        return "";
+    }
+    auto elapsed = std::chrono::steady_clock::now() - last_incoming_time_;
+    if (elapsed > std::chrono::seconds(SESSION_RESUME_WINDOW_SECONDS)) {
+        return "";
+    }
+    return session_id_;
 }
 
 bool Protocol::IsTimeout() const {
@@ -3,9 +3,21 @@
 
 #include <cJSON.h>
 #include <string>
+#include <string_view>
 #include <functional>
 #include <chrono>
 #include <vector>
+#include <memory>
+
+#include "json_reader.h"
+#include "json_writer.h"
+#include "envelope_buffer.h"
+#include "link_probe.h"
+
+// 短控制消息（listen、abort、goodbye、hello）的栈上缓冲区大小
+#define CONTROL_MESSAGE_BUFFER_SIZE 512
+// 上一个会话结束后多久之内可以请求服务器恢复
+#define SESSION_RESUME_WINDOW_SECONDS 120
 
 struct AudioStreamPacket {
     int sample_rate = 0;
@@ -30,6 +42,15 @@ struct BinaryProtocol3 {
     uint8_t payload[];
 } __attribute__((packed));
 
+// 多帧聚合，payload 为带长度前缀的 Opus 帧序列，格式见 AudioAggregator
+struct BinaryProtocol4 {
+    uint8_t type;           // Message type (0: OPUS)
+    uint8_t frame_count;    // Number of Opus frames in payload
+    uint16_t payload_size;  // Payload size in bytes
+    uint32_t timestamp;     // Timestamp of the first frame, following frames add frame_duration
+    uint8_t payload[];
+} __attribute__((packed));
+
 enum AbortReason {
     kAbortReasonNone,
     kAbortReasonWakeWordDetected
@@ -56,7 +77,7 @@ public:
     }
 
     void OnIncomingAudio(std::function<void(AudioStreamPacket&& packet)> callback);
-    void OnIncomingJson(std::function<void(const cJSON* root)> callback);
+    void OnIncomingMessage(std::function<void(const ControlMessage& message)> callback);
     void OnAudioChannelOpened(std::function<void()> callback);
     void OnAudioChannelClosed(std::function<void()> callback);
     void OnNetworkError(std::function<void(const std::string& message)> callback);
@@ -65,17 +86,33 @@ public:
     virtual bool OpenAudioChannel() = 0;
     virtual void CloseAudioChannel() = 0;
     virtual bool IsAudioChannelOpened() const = 0;
+    // 网络切换后在新的网卡上重建连接，音频通道原本打开时重新握手并请求恢复会话
+    virtual bool MigrateTransport() = 0;
     virtual bool SendAudio(const AudioStreamPacket& packet) = 0;
+    // 立即发出聚合中尚未发送的音频帧
+    virtual void FlushAudio() {}
+    // 当前音频通道是否启用了多帧聚合（WebSocket v4 或 MQTT multi_frame）
+    virtual bool IsAggregationEnabled() { return false; }
+    // 拥塞控制要求的最小聚合帧数，不支持多帧聚合的协议版本忽略
+    virtual void SetMinAggregationLevel(int level) {}
     virtual void SendWakeWordDetected(const std::string& wake_word);
     virtual void SendStartListening(ListeningMode mode);
     virtual void SendStopListening();
     virtual void SendAbortSpeaking(AbortReason reason);
-    virtual void SendIotDescriptors(const std::string& descriptors);
-    virtual void SendIotStates(const std::string& states);
-    virtual void SendMcpMessage(const std::string& message);
+    // 每个元素是一个设备的描述 JSON，逐个发送；generation 变化时重建缓存的消息
+    virtual void SendIotDescriptors(const std::vector<std::string>& descriptors, uint32_t generation);
+    // things 为增量更新中包含的设备名（逗号分隔），尚未发出的同一组设备的旧状态会被替换；
+    // 为空表示完整状态，不与其他消息合并
+    virtual void SendIotStates(const std::string& states, std::string_view things = std::string_view());
+    // 负载已经写在 EnvelopeBuffer 中，在预留空间里就地补上信封后发送
+    void SendMcpMessage(const std::shared_ptr<EnvelopeBuffer>& message);
+    void LogMcpStats() const;
+    // 发送一次链路探测，服务器未声明支持时忽略
+    virtual void SendPing();
+    LinkStats GetLinkStats() { return link_probe_.stats(); }
 
 protected:
-    std::function<void(const cJSON* root)> on_incoming_json_;
+    std::function<void(const ControlMessage& message)> on_incoming_message_;
     std::function<void(AudioStreamPacket&& packet)> on_incoming_audio_;
     std::function<void()> on_audio_channel_opened_;
     std::function<void()> on_audio_channel_closed_;
@@ -85,11 +122,32 @@ protected:
     int server_frame_duration_ = 60;
     bool error_occurred_ = false;
     std::string session_id_;
+    std::string resume_session_id_;     // 本次 hello 请求恢复的会话
     std::chrono::time_point<std::chrono::steady_clock> last_incoming_time_;
+    LinkProbe link_probe_;
+    bool ping_supported_ = false;
+
+    // 预先序列化的 IoT 描述消息，不含开头的 {"session_id":"..."，发送时拼上会话 ID 即可
+    std::vector<std::string> iot_descriptor_messages_;
+    uint32_t iot_descriptor_generation_ = 0;
+
+    // MCP 消息统计
+    uint32_t mcp_messages_ = 0;
+    size_t mcp_bytes_ = 0;
+    size_t mcp_copied_bytes_ = 0;
 
-    virtual bool SendText(const std::string& text) = 0;
+    virtual bool SendText(std::string_view text) = 0;
+    // 同 key 的消息可以被后发送的替换，默认直接发送
+    virtual bool SendCoalescedText(std::string_view text, std::string_view key) { return SendText(text); }
+    bool SendJson(const JsonWriter& writer, std::string_view coalesce_key = std::string_view());
+    // 发送已经包装好信封的缓冲区，需要持有消息的传输层可以重写以避免复制
+    virtual bool SendBuffer(EnvelopeBuffer& buffer) { return SendText(buffer.message()); }
+    size_t EnvelopeSize(std::string_view payload) const;
     virtual void SetError(const std::string& message);
     virtual bool IsTimeout() const;
+    std::string GetResumeSessionId() const;
+    void ParseHelloFeatures(const cJSON* root);
+    void HandlePong(const ControlMessage& message);
 };
 
 #endif // PROTOCOL_H
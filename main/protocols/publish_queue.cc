@@ -0,0 +1,137 @@
+#include "publish_queue.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#define TAG "PublishQueue"
+
+PublishQueue::PublishQueue(std::function<bool(const std::string& payload)> publisher)
+    : publisher_(publisher) {
+    xTaskCreate([](void* arg) {
+        PublishQueue* queue = (PublishQueue*)arg;
+        queue->PublishLoop();
+        vTaskDelete(NULL);
+    }, "mqtt_publish", 4096, this, 3, &task_handle_);
+}
+
+PublishQueue::~PublishQueue() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (task_handle_ == nullptr) {
+        return;
+    }
+    stopping_ = true;
+    condition_variable_.notify_all();
+    // 等待正在进行的发送结束，发布任务退出后才能释放底层连接
+    condition_variable_.wait(lock, [this]() { return stopped_; });
+}
+
+bool PublishQueue::Enqueue(std::string_view payload, std::string_view key) {
+    return Enqueue(std::string(payload), key);
+}
+
+bool PublishQueue::Enqueue(std::string&& payload, std::string_view key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // 同一 key 的消息还在排队时就地替换，消息数不变，只需容纳新旧消息的差值
+    auto target = messages_.end();
+    if (!key.empty()) {
+        for (auto message = messages_.begin(); message != messages_.end(); ++message) {
+            if (message->key == key) {
+                target = message;
+                break;
+            }
+        }
+    }
+    bool coalesce = target != messages_.end();
+    size_t replaced_bytes = coalesce ? target->payload.size() : 0;
+
+    // 只丢弃可以被后续更新取代的带 key 消息，从最旧的开始
+    auto it = messages_.begin();
+    while ((!coalesce && messages_.size() >= PUBLISH_QUEUE_MAX_MESSAGES) ||
+           queued_bytes_ - replaced_bytes + payload.size() > PUBLISH_QUEUE_MAX_BYTES) {
+        while (it != messages_.end() && (it->key.empty() || it == target)) {
+            ++it;
+        }
+        if (it == messages_.end()) {
+            rejected_++;
+            ESP_LOGE(TAG, "Publish queue full (%u messages, %u bytes), reject message of %u bytes",
+                (unsigned)messages_.size(), (unsigned)queued_bytes_, (unsigned)payload.size());
+            return false;
+        }
+        ESP_LOGW(TAG, "Publish queue full, drop the oldest %s message", it->key.c_str());
+        queued_bytes_ -= it->payload.size();
+        it = messages_.erase(it);
+        dropped_++;
+    }
+
+    queued_bytes_ += payload.size();
+    if (coalesce) {
+        queued_bytes_ -= replaced_bytes;
+        target->payload = std::move(payload);
+        coalesced_++;
+        return true;
+    }
+    messages_.emplace_back(Message{std::move(payload), std::string(key), esp_timer_get_time()});
+    condition_variable_.notify_all();
+    return true;
+}
+
+void PublishQueue::Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    dropped_ += messages_.size();
+    messages_.clear();
+    queued_bytes_ = 0;
+}
+
+void PublishQueue::OnPublishFailed(std::function<void()> callback) {
+    on_publish_failed_ = callback;
+}
+
+void PublishQueue::LogStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ESP_LOGI(TAG, "Published: %lu, failed: %lu, coalesced: %lu, dropped: %lu, rejected: %lu, latency avg: %.0f ms, max: %d ms, max queue delay: %d ms",
+        published_, failed_, coalesced_, dropped_, rejected_, publish_latency_ms_, max_publish_latency_ms_, max_queue_delay_ms_);
+}
+
+void PublishQueue::PublishLoop() {
+    while (true) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        condition_variable_.wait(lock, [this]() { return stopping_ || !messages_.empty(); });
+        if (stopping_) {
+            stopped_ = true;
+            condition_variable_.notify_all();
+            return;
+        }
+
+        Message message = std::move(messages_.front());
+        messages_.pop_front();
+        queued_bytes_ -= message.payload.size();
+        lock.unlock();
+
+        auto start_time = esp_timer_get_time();
+        bool success = publisher_(message.payload);
+        int latency_ms = (esp_timer_get_time() - start_time) / 1000;
+        int queue_delay_ms = (start_time - message.enqueue_us) / 1000;
+
+        lock.lock();
+        if (success) {
+            published_++;
+            publish_latency_ms_ += (latency_ms - publish_latency_ms_) / 8;
+            if (latency_ms > max_publish_latency_ms_) {
+                max_publish_latency_ms_ = latency_ms;
+            }
+            if (queue_delay_ms > max_queue_delay_ms_) {
+                max_queue_delay_ms_ = queue_delay_ms;
+            }
+        } else {
+            failed_++;
+        }
+        lock.unlock();
+
+        if (!success) {
+            ESP_LOGE(TAG, "Failed to publish message: %s", message.payload.c_str());
+            if (on_publish_failed_) {
+                on_publish_failed_();
+            }
+        }
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef PUBLISH_QUEUE_H
+#define PUBLISH_QUEUE_H
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <string>
+#include <string_view>
+#include <list>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstdint>
+
+// 待发送消息的总字节数上限
+#define PUBLISH_QUEUE_MAX_BYTES (16 * 1024)
+#define PUBLISH_QUEUE_MAX_MESSAGES 32
+
+/*
+ * 异步发布队列
+ * 控制消息在独立任务中发送，调用方（通常是主循环）只做入队，不会被 ML307 的 AT 往返阻塞。
+ * 带 key 的消息会替换队列中尚未发送的同 key 消息，调用方保证同 key 的新消息完整地取代旧消息
+ * （例如同一组 IoT 设备的状态）。
+ * 超出上限时只丢弃最旧的带 key 消息；hello、goodbye、MCP 回复等不带 key 的消息不会被丢弃，
+ * 队列中没有可丢弃的消息时拒绝入队，由调用方处理发送失败。
+ */
+class PublishQueue {
+public:
+    // publisher 在队列任务中调用，返回 false 表示发送失败
+    PublishQueue(std::function<bool(const std::string& payload)> publisher);
+    ~PublishQueue();
+
+    // key 为空表示不合并，返回 false 表示队列已满被拒绝
+    bool Enqueue(std::string_view payload, std::string_view key = std::string_view());
+    // 接管调用方的字符串，避免再复制一次
+    bool Enqueue(std::string&& payload, std::string_view key = std::string_view());
+    // 丢弃所有尚未发送的消息
+    void Clear();
+    void OnPublishFailed(std::function<void()> callback);
+    void LogStats();
+
+private:
+    struct Message {
+        std::string payload;
+        std::string key;
+        int64_t enqueue_us;
+    };
+
+    std::function<bool(const std::string& payload)> publisher_;
+    std::function<void()> on_publish_failed_;
+    std::mutex mutex_;
+    std::condition_variable condition_variable_;
+    std::list<Message> messages_;
+    size_t queued_bytes_ = 0;
+    bool stopping_ = false;
+    bool stopped_ = false;
+    TaskHandle_t task_handle_ = nullptr;
+
+    // 统计
+    uint32_t published_ = 0;
+    uint32_t failed_ = 0;
+    uint32_t coalesced_ = 0;
+    uint32_t dropped_ = 0;
+    uint32_t rejected_ = 0;
+    float publish_latency_ms_ = 0;  // Publish 调用耗时 EWMA
+    int max_publish_latency_ms_ = 0;
+    int max_queue_delay_ms_ = 0;    // 入队到开始发送的最长等待
+
+    void PublishLoop();
+};
+
+#endif // PUBLISH_QUEUE_H
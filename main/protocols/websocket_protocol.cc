@@ -7,6 +7,7 @@
 #include <cstring>
 #include <cJSON.h>
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <arpa/inet.h>
 #include "assets/lang_config.h"
 
@@ -55,18 +56,47 @@ bool WebsocketProtocol::SendAudio(const AudioStreamPacket& packet) {
         memcpy(bp3->payload, packet.payload.data(), packet.payload.size());
 
         return websocket_->Send(serialized.data(), serialized.size(), true);
+    } else if (version_ == 4) {
+        if (!aggregator_.Append(packet)) {
+            return true;
+        }
+        return SendAggregatedAudio();
     } else {
         return websocket_->Send(packet.payload.data(), packet.payload.size(), true);
     }
 }
 
-bool WebsocketProtocol::SendText(const std::string& text) {
+bool WebsocketProtocol::SendAggregatedAudio() {
+    const auto& frames = aggregator_.frames();
+    std::string serialized;
+    serialized.resize(sizeof(BinaryProtocol4) + frames.size());
+    auto bp4 = (BinaryProtocol4*)serialized.data();
+    bp4->type = 0;
+    bp4->frame_count = aggregator_.frame_count();
+    bp4->payload_size = htons(frames.size());
+    bp4->timestamp = htonl(aggregator_.timestamp());
+    memcpy(bp4->payload, frames.data(), frames.size());
+    aggregator_.Clear();
+
+    auto start_time = esp_timer_get_time();
+    bool success = websocket_->Send(serialized.data(), serialized.size(), true);
+    aggregator_.OnSent(success, (esp_timer_get_time() - start_time) / 1000);
+    return success;
+}
+
+void WebsocketProtocol::FlushAudio() {
+    if (websocket_ != nullptr && version_ == 4 && !aggregator_.empty()) {
+        SendAggregatedAudio();
+    }
+}
+
+bool WebsocketProtocol::SendText(std::string_view text) {
     if (websocket_ == nullptr) {
         return false;
     }
 
-    if (!websocket_->Send(text)) {
-        ESP_LOGE(TAG, "Failed to send text: %s", text.c_str());
+    if (!websocket_->Send(text.data(), text.size(), false)) {
+        ESP_LOGE(TAG, "Failed to send text: %.*s", (int)text.size(), text.data());
         SetError(Lang::Strings::SERVER_ERROR);
         return false;
     }
@@ -74,17 +104,41 @@ bool WebsocketProtocol::SendText(const std::string& text) {
     return true;
 }
 
+bool WebsocketProtocol::IsAggregationEnabled() {
+    return version_ == 4;
+}
+
+void WebsocketProtocol::SetMinAggregationLevel(int level) {
+    aggregator_.SetMinLevel(level);
+}
+
 bool WebsocketProtocol::IsAudioChannelOpened() const {
     return websocket_ != nullptr && websocket_->IsConnected() && !error_occurred_ && !IsTimeout();
 }
 
 void WebsocketProtocol::CloseAudioChannel() {
+    if (aggregator_.total_packets() > 0) {
+        ESP_LOGI(TAG, "Audio aggregation: %lu frames in %lu packets", aggregator_.total_frames(), aggregator_.total_packets());
+    }
+    aggregator_.Clear();
     if (websocket_ != nullptr) {
         delete websocket_;
         websocket_ = nullptr;
     }
 }
 
+bool WebsocketProtocol::MigrateTransport() {
+    if (websocket_ == nullptr) {
+        return true;
+    }
+    // 旧连接所在的网卡已经关闭，静默丢弃，不触发通道关闭回调
+    websocket_->OnDisconnected(nullptr);
+    delete websocket_;
+    websocket_ = nullptr;
+    aggregator_.Clear();
+    return OpenAudioChannel();
+}
+
 bool WebsocketProtocol::OpenAudioChannel() {
     if (websocket_ != nullptr) {
         delete websocket_;
@@ -93,12 +147,15 @@ bool WebsocketProtocol::OpenAudioChannel() {
     Settings settings("websocket", false);
     std::string url = settings.GetString("url");
     std::string token = settings.GetString("token");
+    // 上次协商出的 v4 不沿用，每次从配置的版本重新协商
     int version = settings.GetInt("version");
-    if (version != 0) {
-        version_ = version;
-    }
+    version_ = version != 0 ? version : 1;
 
     error_occurred_ = false;
+    resume_session_id_ = GetResumeSessionId();
+    aggregator_.Clear();
+    // 4G 链路按流量计费，从 2 帧聚合起步
+    aggregator_.SetLevel(Board::GetInstance().GetBoardType() == "ml307" ? 2 : 1);
 
     websocket_ = Board::GetInstance().CreateWebSocket();
     
@@ -140,6 +197,18 @@ bool WebsocketProtocol::OpenAudioChannel() {
                         .timestamp = 0,
                         .payload = std::vector<uint8_t>(payload, payload + bp3->payload_size)
                     });
+                } else if (version_ == 4) {
+                    BinaryProtocol4* bp4 = (BinaryProtocol4*)data;
+                    // 先检查长度再读取头部
+                    if (len < sizeof(BinaryProtocol4) || ntohs(bp4->payload_size) > len - sizeof(BinaryProtocol4) ||
+                        !AudioAggregator::Decode(bp4->payload, ntohs(bp4->payload_size), bp4->frame_count, ntohl(bp4->timestamp),
+                            server_frame_duration_,
+                            [this](AudioStreamPacket&& packet) {
+                                packet.sample_rate = server_sample_rate_;
+                                on_incoming_audio_(std::move(packet));
+                            })) {
+                        ESP_LOGE(TAG, "Invalid aggregated audio packet, size: %u", (unsigned)len);
+                    }
                 } else {
                     on_incoming_audio_(AudioStreamPacket{
                         .sample_rate = server_sample_rate_,
@@ -150,21 +219,19 @@ bool WebsocketProtocol::OpenAudioChannel() {
                 }
             }
         } else {
-            // Parse JSON data
-            auto root = cJSON_Parse(data);
-            auto type = cJSON_GetObjectItem(root, "type");
-            if (cJSON_IsString(type)) {
-                if (strcmp(type->valuestring, "hello") == 0) {
-                    ParseServerHello(root);
-                } else {
-                    if (on_incoming_json_ != nullptr) {
-                        on_incoming_json_(root);
-                    }
-                }
-            } else {
-                ESP_LOGE(TAG, "Missing message type, data: %s", data);
+            // Extract the common fields in one pass, only hello needs the full DOM
+            ControlMessage message;
+            if (!ParseControlMessage(data, len, message) || !message.type.present) {
+                ESP_LOGE(TAG, "Missing message type, data: %.*s", (int)len, data);
+            } else if (message.type == "hello") {
+                auto root = cJSON_ParseWithLength(data, len);
+                ParseServerHello(root);
+                cJSON_Delete(root);
+            } else if (message.type == "pong") {
+                HandlePong(message);
+            } else if (on_incoming_message_ != nullptr) {
+                on_incoming_message_(message);
             }
-            cJSON_Delete(root);
         }
         last_incoming_time_ = std::chrono::steady_clock::now();
     });
@@ -185,6 +252,10 @@ bool WebsocketProtocol::OpenAudioChannel() {
 
     // Send hello message to describe the client
     auto message = GetHelloMessage();
+    if (message.empty()) {
+        SetError(Lang::Strings::SERVER_ERROR);
+        return false;
+    }
     if (!SendText(message)) {
         return false;
     }
@@ -206,32 +277,43 @@ bool WebsocketProtocol::OpenAudioChannel() {
 
 std::string WebsocketProtocol::GetHelloMessage() {
     // keys: message type, version, audio_params (format, sample_rate, channels)
-    cJSON* root = cJSON_CreateObject();
-    cJSON_AddStringToObject(root, "type", "hello");
-    cJSON_AddNumberToObject(root, "version", version_);
-    cJSON* features = cJSON_CreateObject();
+    StaticJsonWriter<CONTROL_MESSAGE_BUFFER_SIZE> writer;
+    writer.BeginObject()
+        .Field("type", "hello")
+        .Field("version", version_)
+        .Key("features").BeginObject();
 #if CONFIG_USE_SERVER_AEC
-    cJSON_AddBoolToObject(features, "aec", true);
+    writer.Field("aec", true);
 #endif
 #if CONFIG_IOT_PROTOCOL_MCP
-    cJSON_AddBoolToObject(features, "mcp", true);
+    writer.Field("mcp", true);
 #endif
-    cJSON_AddItemToObject(root, "features", features);
-    cJSON_AddStringToObject(root, "transport", "websocket");
-    cJSON* audio_params = cJSON_CreateObject();
-    cJSON_AddStringToObject(audio_params, "format", "opus");
-    cJSON_AddNumberToObject(audio_params, "sample_rate", 16000);
-    cJSON_AddNumberToObject(audio_params, "channels", 1);
-    cJSON_AddNumberToObject(audio_params, "frame_duration", OPUS_FRAME_DURATION_MS);
-    cJSON_AddItemToObject(root, "audio_params", audio_params);
-    auto json_str = cJSON_PrintUnformatted(root);
-    std::string message(json_str);
-    cJSON_free(json_str);
-    cJSON_Delete(root);
-    return message;
+    writer.Field("ping", true);
+    // 提议多帧聚合，服务器确认后改用 v4 帧格式
+    writer.Field("multi_frame", true);
+    writer.EndObject()
+        .Field("transport", "websocket")
+        .Key("audio_params").BeginObject()
+            .Field("format", "opus")
+            .Field("sample_rate", 16000)
+            .Field("channels", 1)
+            .Field("frame_duration", OPUS_FRAME_DURATION_MS)
+        .EndObject();
+    // 请求服务器沿用最近的会话，跳过重新初始化
+    if (!resume_session_id_.empty()) {
+        writer.Field("resume_session_id", resume_session_id_);
+    }
+    writer.EndObject();
+    // resume_session_id 来自服务器，截断的 hello 不能发出去
+    if (writer.overflow()) {
+        ESP_LOGE(TAG, "Hello message exceeds buffer size %d", CONTROL_MESSAGE_BUFFER_SIZE);
+        return std::string();
+    }
+    return std::string(writer.view());
 }
 
 void WebsocketProtocol::ParseServerHello(const cJSON* root) {
+    ParseHelloFeatures(root);
     auto transport = cJSON_GetObjectItem(root, "transport");
     if (transport == nullptr || strcmp(transport->valuestring, "websocket") != 0) {
         ESP_LOGE(TAG, "Unsupported transport: %s", transport->valuestring);
@@ -240,8 +322,24 @@ void WebsocketProtocol::ParseServerHello(const cJSON* root) {
 
     auto session_id = cJSON_GetObjectItem(root, "session_id");
     if (cJSON_IsString(session_id)) {
+        bool resumed = !resume_session_id_.empty() && resume_session_id_ == session_id->valuestring;
         session_id_ = session_id->valuestring;
-        ESP_LOGI(TAG, "Session ID: %s", session_id_.c_str());
+        ESP_LOGI(TAG, "Session ID: %s%s", session_id_.c_str(), resumed ? " (resumed)" : "");
+    }
+
+    // 服务器在 features 中确认 multi_frame（或直接回复 version 4）时改用 v4 帧格式，
+    // 否则保持 hello 中的版本；配置为 v4 而服务器不支持时退回服务器声明的版本
+    auto version = cJSON_GetObjectItem(root, "version");
+    int server_version = cJSON_IsNumber(version) ? version->valueint : 0;
+    auto features = cJSON_GetObjectItem(root, "features");
+    if (cJSON_IsTrue(cJSON_GetObjectItem(features, "multi_frame")) || server_version == 4) {
+        if (version_ != 4) {
+            ESP_LOGI(TAG, "Server accepted multi-frame aggregation, switch from v%d to v4", version_);
+            version_ = 4;
+        }
+    } else if (version_ == 4) {
+        version_ = (server_version >= 1 && server_version <= 3) ? server_version : 1;
+        ESP_LOGW(TAG, "Server does not support protocol v4, fallback to v%d", version_);
     }
 
     auto audio_params = cJSON_GetObjectItem(root, "audio_params");
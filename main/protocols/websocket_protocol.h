@@ -3,6 +3,7 @@
 
 
 #include "protocol.h"
+#include "audio_aggregator.h"
 
 #include <web_socket.h>
 #include <freertos/FreeRTOS.h>
@@ -17,17 +18,23 @@ public:
 
     bool Start() override;
     bool SendAudio(const AudioStreamPacket& packet) override;
+    void FlushAudio() override;
+    bool IsAggregationEnabled() override;
+    void SetMinAggregationLevel(int level) override;
     bool OpenAudioChannel() override;
     void CloseAudioChannel() override;
     bool IsAudioChannelOpened() const override;
+    bool MigrateTransport() override;
 
 private:
     EventGroupHandle_t event_group_handle_;
     WebSocket* websocket_ = nullptr;
     int version_ = 1;
+    AudioAggregator aggregator_;
 
     void ParseServerHello(const cJSON* root);
-    bool SendText(const std::string& text) override;
+    bool SendAggregatedAudio();
+    bool SendText(std::string_view text) override;
     std::string GetHelloMessage();
 };
 
@@ -0,0 +1,109 @@
+#include "audio_framing.h"
+#include "bench_util.h"
+#include "protocol.h"
+#include "audio_aggregator.h"
+
+#include <arpa/inet.h>
+#include <cstring>
+
+std::string PackFrames(const std::string* frames, size_t count) {
+    AudioAggregator aggregator;
+    aggregator.SetLevel(AUDIO_AGGREGATION_MAX_FRAMES);
+    AudioStreamPacket packet;
+    for (size_t i = 0; i < count; i++) {
+        packet.payload.assign(frames[i].begin(), frames[i].end());
+        aggregator.Append(packet);
+    }
+    return aggregator.frames();
+}
+
+bool UnpackFrames(std::string_view payload, size_t frame_count, uint32_t timestamp, const FrameCallback& callback) {
+    return AudioAggregator::Decode(reinterpret_cast<const uint8_t*>(payload.data()), payload.size(), frame_count,
+        timestamp, BENCH_FRAME_DURATION_MS, [&callback](AudioStreamPacket&& packet) {
+            callback(packet.timestamp, std::string_view(reinterpret_cast<const char*>(packet.payload.data()), packet.payload.size()));
+        });
+}
+
+std::vector<std::string> PackWebsocketAudio(int version, const std::string* frames, size_t count, uint32_t timestamp) {
+    std::vector<std::string> packets;
+    if (version == 4) {
+        auto payload = PackFrames(frames, count);
+        std::string serialized(sizeof(BinaryProtocol4) + payload.size(), '\0');
+        auto bp4 = (BinaryProtocol4*)serialized.data();
+        bp4->type = 0;
+        bp4->frame_count = count;
+        bp4->payload_size = htons(payload.size());
+        bp4->timestamp = htonl(timestamp);
+        memcpy(bp4->payload, payload.data(), payload.size());
+        packets.push_back(std::move(serialized));
+        return packets;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        const auto& frame = frames[i];
+        uint32_t frame_timestamp = timestamp + i * BENCH_FRAME_DURATION_MS;
+        if (version == 2) {
+            std::string serialized(sizeof(BinaryProtocol2) + frame.size(), '\0');
+            auto bp2 = (BinaryProtocol2*)serialized.data();
+            bp2->version = htons(version);
+            bp2->type = 0;
+            bp2->reserved = 0;
+            bp2->timestamp = htonl(frame_timestamp);
+            bp2->payload_size = htonl(frame.size());
+            memcpy(bp2->payload, frame.data(), frame.size());
+            packets.push_back(std::move(serialized));
+        } else if (version == 3) {
+            std::string serialized(sizeof(BinaryProtocol3) + frame.size(), '\0');
+            auto bp3 = (BinaryProtocol3*)serialized.data();
+            bp3->type = 0;
+            bp3->reserved = 0;
+            bp3->payload_size = htons(frame.size());
+            memcpy(bp3->payload, frame.data(), frame.size());
+            packets.push_back(std::move(serialized));
+        } else {
+            packets.push_back(frame);
+        }
+    }
+    return packets;
+}
+
+bool UnpackWebsocketAudio(int version, std::string_view data, const FrameCallback& callback) {
+    // 收到的数据不保证对齐，先拷贝包头
+    if (version == 2) {
+        BinaryProtocol2 bp2;
+        if (data.size() < sizeof(bp2)) {
+            return false;
+        }
+        memcpy(&bp2, data.data(), sizeof(bp2));
+        size_t size = ntohl(bp2.payload_size);
+        if (size > data.size() - sizeof(bp2)) {
+            return false;
+        }
+        callback(ntohl(bp2.timestamp), data.substr(sizeof(bp2), size));
+    } else if (version == 3) {
+        BinaryProtocol3 bp3;
+        if (data.size() < sizeof(bp3)) {
+            return false;
+        }
+        memcpy(&bp3, data.data(), sizeof(bp3));
+        size_t size = ntohs(bp3.payload_size);
+        if (size > data.size() - sizeof(bp3)) {
+            return false;
+        }
+        callback(0, data.substr(sizeof(bp3), size));
+    } else if (version == 4) {
+        BinaryProtocol4 bp4;
+        if (data.size() < sizeof(bp4)) {
+            return false;
+        }
+        memcpy(&bp4, data.data(), sizeof(bp4));
+        size_t size = ntohs(bp4.payload_size);
+        if (size > data.size() - sizeof(bp4)) {
+            return false;
+        }
+        return UnpackFrames(data.substr(sizeof(bp4), size), bp4.frame_count, ntohl(bp4.timestamp), callback);
+    } else {
+        callback(0, data);
+    }
+    return true;
+}
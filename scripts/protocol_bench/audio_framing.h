@@ -0,0 +1,27 @@
+#ifndef AUDIO_FRAMING_H
+#define AUDIO_FRAMING_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+ * 按固件的二进制协议打包和解析音频：
+ * 包头直接使用 protocols/protocol.h 中的 BinaryProtocol2/3/4，多帧负载使用固件的 AudioAggregator，
+ * 固件协议格式变化时这里随之重新编译，不需要同步维护第二份实现。
+ */
+using FrameCallback = std::function<void(uint32_t timestamp, std::string_view opus)>;
+
+// 打包 frames[0, count) 为 WebSocket 二进制帧，v4 合成一个帧，其他版本每个 Opus 帧一个
+std::vector<std::string> PackWebsocketAudio(int version, const std::string* frames, size_t count, uint32_t timestamp);
+// 解析 WebSocket 二进制帧，格式错误时返回 false
+bool UnpackWebsocketAudio(int version, std::string_view data, const FrameCallback& callback);
+
+// 多帧聚合负载 |len 1~2u|opus|len 1~2u|opus|...，用于 WebSocket v4 和 UDP 包类型 0x02
+std::string PackFrames(const std::string* frames, size_t count);
+// frame_count 是包头声明的帧数，不符时整包丢弃
+bool UnpackFrames(std::string_view payload, size_t frame_count, uint32_t timestamp, const FrameCallback& callback);
+
+#endif // AUDIO_FRAMING_H
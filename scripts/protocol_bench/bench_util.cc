@@ -0,0 +1,230 @@
+#include "bench_util.h"
+
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+void Options::Add(const char* name, const char* default_value, const char* help, char short_name) {
+    Option option;
+    option.name = name;
+    option.value = default_value;
+    option.help = help;
+    option.short_name = short_name;
+    options_.push_back(std::move(option));
+}
+
+void Options::AddFlag(const char* name, const char* help) {
+    Option option;
+    option.name = name;
+    option.help = help;
+    option.flag = true;
+    options_.push_back(std::move(option));
+}
+
+void Options::AddGroup(const char* title) {
+    Option option;
+    option.help = title;
+    option.group = true;
+    options_.push_back(std::move(option));
+}
+
+Options::Option* Options::Find(std::string_view name) {
+    for (auto& option : options_) {
+        if (!option.group && option.name == name) {
+            return &option;
+        }
+    }
+    return nullptr;
+}
+
+const Options::Option* Options::Find(std::string_view name) const {
+    return const_cast<Options*>(this)->Find(name);
+}
+
+void Options::PrintUsage(const char* program) const {
+    fprintf(stderr, "%s\n\n用法: %s [选项]\n", description_, program);
+    for (auto& option : options_) {
+        if (option.group) {
+            fprintf(stderr, "\n%s:\n", option.help.c_str());
+            continue;
+        }
+        std::string left = "  ";
+        if (option.short_name) {
+            left += std::string("-") + option.short_name + ", ";
+        }
+        left += "--" + option.name;
+        if (!option.flag) {
+            left += " <值>";
+        }
+        fprintf(stderr, "%-32s %s", left.c_str(), option.help.c_str());
+        if (!option.flag && !option.value.empty()) {
+            fprintf(stderr, " (默认: %s)", option.value.c_str());
+        }
+        fprintf(stderr, "\n");
+    }
+}
+
+bool Options::Parse(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        Option* option = nullptr;
+        if (arg == "-h" || arg == "--help") {
+            PrintUsage(argv[0]);
+            return false;
+        }
+        if (arg.size() > 2 && arg.substr(0, 2) == "--") {
+            option = Find(arg.substr(2));
+        } else if (arg.size() == 2 && arg[0] == '-') {
+            for (auto& candidate : options_) {
+                if (!candidate.group && candidate.short_name == arg[1]) {
+                    option = &candidate;
+                }
+            }
+        }
+        if (option == nullptr) {
+            fprintf(stderr, "未知参数: %s\n\n", argv[i]);
+            PrintUsage(argv[0]);
+            return false;
+        }
+        if (option->flag) {
+            option->value = "1";
+            continue;
+        }
+        if (i + 1 >= argc) {
+            fprintf(stderr, "参数 %s 缺少取值\n", argv[i]);
+            return false;
+        }
+        option->value = argv[++i];
+    }
+    return true;
+}
+
+const std::string& Options::Get(const char* name) const {
+    auto option = Find(name);
+    if (option == nullptr) {
+        fprintf(stderr, "BUG: option --%s is not defined\n", name);
+        abort();
+    }
+    return option->value;
+}
+
+int Options::GetInt(const char* name) const {
+    return atoi(Get(name).c_str());
+}
+
+double Options::GetDouble(const char* name) const {
+    return atof(Get(name).c_str());
+}
+
+bool Options::GetFlag(const char* name) const {
+    return !Get(name).empty();
+}
+
+std::vector<std::string> ReadP3(const std::string& path) {
+    std::vector<std::string> frames;
+    std::ifstream file(path, std::ios::binary);
+    uint8_t header[4];
+    while (file.read(reinterpret_cast<char*>(header), sizeof(header))) {
+        size_t length = (header[2] << 8) | header[3];
+        std::string frame(length, '\0');
+        if (!file.read(frame.data(), length)) {
+            break;
+        }
+        frames.push_back(std::move(frame));
+    }
+    return frames;
+}
+
+double Percentile(std::vector<double>& values, double p) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    double k = (values.size() - 1) * p / 100;
+    size_t lo = (size_t)k;
+    size_t hi = std::min(lo + 1, values.size() - 1);
+    return values[lo] + (values[hi] - values[lo]) * (k - lo);
+}
+
+std::string HexEncode(std::string_view data) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(data.size() * 2);
+    for (unsigned char c : data) {
+        hex.push_back(digits[c >> 4]);
+        hex.push_back(digits[c & 0x0F]);
+    }
+    return hex;
+}
+
+static int HexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+std::string HexDecode(std::string_view hex) {
+    if (hex.size() % 2 != 0) {
+        return std::string();
+    }
+    std::string data;
+    data.reserve(hex.size() / 2);
+    for (size_t i = 0; i < hex.size(); i += 2) {
+        int hi = HexValue(hex[i]);
+        int lo = HexValue(hex[i + 1]);
+        if (hi < 0 || lo < 0) {
+            return std::string();
+        }
+        data.push_back(static_cast<char>((hi << 4) | lo));
+    }
+    return data;
+}
+
+std::string Base64Encode(std::string_view data) {
+    std::string out(4 * ((data.size() + 2) / 3) + 1, '\0');
+    int length = EVP_EncodeBlock(reinterpret_cast<unsigned char*>(out.data()),
+        reinterpret_cast<const unsigned char*>(data.data()), (int)data.size());
+    out.resize(length);
+    return out;
+}
+
+std::string RandomBytes(size_t size) {
+    std::string bytes(size, '\0');
+    RAND_bytes(reinterpret_cast<unsigned char*>(bytes.data()), (int)size);
+    return bytes;
+}
+
+std::string RandomUuid() {
+    auto bytes = RandomBytes(16);
+    bytes[6] = static_cast<char>((bytes[6] & 0x0F) | 0x40);
+    bytes[8] = static_cast<char>((bytes[8] & 0x3F) | 0x80);
+    auto hex = HexEncode(bytes);
+    return hex.substr(0, 8) + "-" + hex.substr(8, 4) + "-" + hex.substr(12, 4) + "-" +
+        hex.substr(16, 4) + "-" + hex.substr(20);
+}
+
+int RaiseFdLimit() {
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0) {
+        return 0;
+    }
+    if (limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+        getrlimit(RLIMIT_NOFILE, &limit);
+    }
+    return (int)limit.rlim_cur;
+}
+
+double WallClockMs() {
+    timeval tv;
+    gettimeofday(&tv, nullptr);
+    return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
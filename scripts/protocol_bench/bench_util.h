@@ -0,0 +1,71 @@
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 与固件的 OPUS_FRAME_DURATION_MS 一致
+#define BENCH_FRAME_DURATION_MS 60
+#define BENCH_SAMPLE_RATE 16000
+
+// 没有指定音频文件时使用的 Opus 静音帧，仅用于测试传输层负载
+#define BENCH_SILENCE_FRAME "\xf8\xff\xfe"
+
+/*
+ * 极简命令行解析，只支持 --name value、--flag 和单字母别名 -n value
+ * 未知参数或 --help 时打印用法并返回 false。
+ */
+class Options {
+public:
+    explicit Options(const char* description) : description_(description) {}
+
+    void Add(const char* name, const char* default_value, const char* help, char short_name = 0);
+    void AddFlag(const char* name, const char* help);
+    void AddGroup(const char* title);
+    bool Parse(int argc, char** argv);
+
+    const std::string& Get(const char* name) const;
+    int GetInt(const char* name) const;
+    double GetDouble(const char* name) const;
+    bool GetFlag(const char* name) const;
+
+private:
+    struct Option {
+        std::string name;
+        std::string value;
+        std::string help;
+        char short_name = 0;
+        bool flag = false;
+        bool group = false;
+    };
+    const char* description_;
+    std::vector<Option> options_;
+
+    Option* Find(std::string_view name);
+    const Option* Find(std::string_view name) const;
+    void PrintUsage(const char* program) const;
+};
+
+// 读取 p3 文件，返回 Opus 帧列表。p3 格式: [1字节类型, 1字节保留, 2字节长度, Opus数据]...
+std::vector<std::string> ReadP3(const std::string& path);
+
+// 线性插值分位数，values 会被排序
+double Percentile(std::vector<double>& values, double p);
+
+std::string HexEncode(std::string_view data);
+// 非法字符或长度为奇数时返回空字符串
+std::string HexDecode(std::string_view hex);
+std::string Base64Encode(std::string_view data);
+std::string RandomBytes(size_t size);
+std::string RandomUuid();
+
+// 把文件描述符软上限提到硬上限，返回新的软上限
+int RaiseFdLimit();
+
+// 墙钟毫秒数，用于日志中的时间戳
+double WallClockMs();
+
+#endif // BENCH_UTIL_H
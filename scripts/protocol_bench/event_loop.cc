@@ -0,0 +1,126 @@
+#include "event_loop.h"
+
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <ctime>
+#include <vector>
+
+#define EVENT_LOOP_MAX_EVENTS 256
+
+EventLoop::EventLoop() {
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd_ < 0) {
+        perror("epoll_create1");
+    }
+}
+
+EventLoop::~EventLoop() {
+    if (epoll_fd_ >= 0) {
+        close(epoll_fd_);
+    }
+}
+
+int64_t EventLoop::NowUs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+bool EventLoop::Add(int fd, uint32_t events, IoCallback callback) {
+    uint64_t id = next_watcher_id_++;
+    epoll_event event = {};
+    event.events = events;
+    event.data.u64 = id;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) != 0) {
+        perror("epoll_ctl add");
+        return false;
+    }
+    watchers_[id] = std::make_shared<Watcher>(Watcher{fd, std::move(callback)});
+    fd_to_watcher_[fd] = id;
+    return true;
+}
+
+void EventLoop::Modify(int fd, uint32_t events) {
+    auto it = fd_to_watcher_.find(fd);
+    if (it == fd_to_watcher_.end()) {
+        return;
+    }
+    epoll_event event = {};
+    event.events = events;
+    event.data.u64 = it->second;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &event);
+}
+
+void EventLoop::Remove(int fd) {
+    auto it = fd_to_watcher_.find(fd);
+    if (it == fd_to_watcher_.end()) {
+        return;
+    }
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    watchers_.erase(it->second);
+    fd_to_watcher_.erase(it);
+}
+
+uint64_t EventLoop::CallLater(int64_t delay_us, Callback callback) {
+    uint64_t id = next_timer_id_++;
+    int64_t deadline = NowUs() + (delay_us > 0 ? delay_us : 0);
+    timers_.emplace(std::make_pair(deadline, id), std::move(callback));
+    timer_deadlines_[id] = deadline;
+    return id;
+}
+
+void EventLoop::Cancel(uint64_t timer_id) {
+    auto it = timer_deadlines_.find(timer_id);
+    if (it == timer_deadlines_.end()) {
+        return;
+    }
+    timers_.erase(std::make_pair(it->second, timer_id));
+    timer_deadlines_.erase(it);
+}
+
+// 执行到期的定时器，返回距下一个定时器的毫秒数，没有定时器时返回 -1
+int EventLoop::RunTimers() {
+    int64_t now = NowUs();
+    while (!timers_.empty() && running_) {
+        auto it = timers_.begin();
+        if (it->first.first > now) {
+            // 向上取整，避免提前醒来空转
+            return (int)((it->first.first - now + 999) / 1000);
+        }
+        auto callback = std::move(it->second);
+        timer_deadlines_.erase(it->first.second);
+        timers_.erase(it);
+        callback();
+    }
+    return timers_.empty() ? -1 : 0;
+}
+
+void EventLoop::Run() {
+    running_ = true;
+    std::vector<epoll_event> events(EVENT_LOOP_MAX_EVENTS);
+    while (running_) {
+        int timeout = RunTimers();
+        if (!running_) {
+            break;
+        }
+        int count = epoll_wait(epoll_fd_, events.data(), (int)events.size(), timeout);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("epoll_wait");
+            break;
+        }
+        for (int i = 0; i < count && running_; i++) {
+            auto it = watchers_.find(events[i].data.u64);
+            if (it == watchers_.end()) {
+                continue;
+            }
+            // 回调中可能移除自己，先持有一份引用
+            auto watcher = it->second;
+            watcher->callback(events[i].events);
+        }
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+
+/*
+ * 单线程 epoll 事件循环，压测工具和替身服务器的所有连接共用一个实例
+ * - 文件描述符按水平触发注册，回调参数为 epoll 事件位
+ * - 定时器按单调时钟排序，CallLater 返回的 id 可用于取消
+ * 回调中可以安全地注册、移除其他描述符或定时器。
+ */
+class EventLoop {
+public:
+    using Callback = std::function<void()>;
+    using IoCallback = std::function<void(uint32_t events)>;
+
+    EventLoop();
+    ~EventLoop();
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    bool Add(int fd, uint32_t events, IoCallback callback);
+    void Modify(int fd, uint32_t events);
+    void Remove(int fd);
+
+    uint64_t CallLater(int64_t delay_us, Callback callback);
+    void Cancel(uint64_t timer_id);
+
+    void Run();
+    void Stop() { running_ = false; }
+
+    // 单调时钟微秒数
+    static int64_t NowUs();
+
+private:
+    struct Watcher {
+        int fd;
+        IoCallback callback;
+    };
+
+    int epoll_fd_ = -1;
+    bool running_ = false;
+    uint64_t next_watcher_id_ = 1;
+    uint64_t next_timer_id_ = 1;
+    // epoll_event.data 中存放 watcher id，描述符关闭后被复用时旧事件不会派发给新的 watcher
+    std::unordered_map<uint64_t, std::shared_ptr<Watcher>> watchers_;
+    std::unordered_map<int, uint64_t> fd_to_watcher_;
+    std::map<std::pair<int64_t, uint64_t>, Callback> timers_;
+    std::unordered_map<uint64_t, int64_t> timer_deadlines_;
+
+    int RunTimers();
+};
+
+#endif // EVENT_LOOP_H
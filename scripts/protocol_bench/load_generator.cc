@@ -0,0 +1,910 @@
+// 多设备协议压测工具
+// 在一台 Linux 主机上模拟成百上千台设备，按固件的协议格式与服务器通信：
+// hello -> listen start -> 按实时节奏上传 Opus -> listen stop -> 等待 TTS，循环若干轮，
+// 统计每台设备的 hello 往返、ping RTT、首包延迟、TLS 握手和上下行吞吐，输出分位数。
+// 所有设备共享一个 epoll 事件循环；控制消息用固件的 JsonWriter 构造、ParseControlMessage 解析，
+// 音频帧格式直接使用固件的 BinaryProtocol 结构体和 AudioAggregator。
+#include "audio_framing.h"
+#include "bench_util.h"
+#include "event_loop.h"
+#include "mqtt_codec.h"
+#include "stream.h"
+#include "udp_cipher.h"
+#include "websocket.h"
+
+#include "json_reader.h"
+#include "json_writer.h"
+#include "protocol.h"
+
+#include <cJSON.h>
+#include <csignal>
+#include <cstdio>
+#include <ctime>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#define MQTT_KEEPALIVE_SECONDS 120
+
+namespace {
+
+struct Config {
+    std::string transport;
+    int devices;
+    double ramp;
+    int sessions;
+    double think_time;
+    int aggregate;
+    std::string mode;
+    double ping_interval;
+    double timeout;
+    double tts_timeout;
+    int id_offset;
+    bool tls_resume;
+    std::string url;
+    std::string token;
+    int version;
+    std::string mqtt_endpoint;
+    std::string mqtt_client_id;
+    std::string mqtt_username;
+    std::string mqtt_password;
+    std::string mqtt_publish_topic;
+    std::string mqtt_subscribe_topic;
+    bool multi_frame;
+    bool mqtt_tls;
+};
+
+// 按终端显示宽度补齐，中文字符占两列
+std::string PadRight(const std::string& text, int width) {
+    int columns = 0;
+    for (unsigned char c : text) {
+        if (c < 0x80) {
+            columns++;
+        } else if (c >= 0xC0) {
+            columns += 2;
+        }
+    }
+    return text + std::string(columns < width ? width - columns : 0, ' ');
+}
+
+struct DeviceSamples {
+    std::string device_id;
+    std::vector<double> hello_rtt_ms;
+    std::vector<double> ping_rtt_ms;
+    std::vector<double> first_audio_ms;
+    std::vector<double> pacing_lag_ms;
+    std::vector<double> uplink_kbps;
+    std::vector<double> downlink_kbps;
+    std::vector<double> tls_full_ms;
+    std::vector<double> tls_resumed_ms;
+};
+
+// 汇总所有设备的样本
+struct Metrics {
+    std::vector<std::unique_ptr<DeviceSamples>> devices;
+    std::map<std::string, int> errors;
+    int sessions_ok = 0;
+    int sessions_failed = 0;
+    int active = 0;
+    int finished = 0;
+
+    void Error(const std::string& reason) {
+        errors[reason]++;
+        sessions_failed++;
+    }
+
+    std::vector<double> Collect(std::vector<double> DeviceSamples::*field) const {
+        std::vector<double> values;
+        for (auto& device : devices) {
+            auto& samples = (*device).*field;
+            values.insert(values.end(), samples.begin(), samples.end());
+        }
+        return values;
+    }
+
+    void Report() const {
+        struct Row {
+            std::vector<double> DeviceSamples::*field;
+            const char* name;
+        };
+        static const Row rows[] = {
+            {&DeviceSamples::hello_rtt_ms, "hello 往返 (ms)"},
+            {&DeviceSamples::ping_rtt_ms, "ping RTT (ms)"},
+            {&DeviceSamples::first_audio_ms, "首个 TTS 包 (ms)"},
+            {&DeviceSamples::pacing_lag_ms, "上行节奏滞后 (ms)"},
+            {&DeviceSamples::tls_full_ms, "TLS 完整握手 (ms)"},
+            {&DeviceSamples::tls_resumed_ms, "TLS 会话恢复 (ms)"},
+            {&DeviceSamples::uplink_kbps, "上行吞吐 (kbps)"},
+            {&DeviceSamples::downlink_kbps, "下行吞吐 (kbps)"},
+        };
+        printf("\n设备数: %zu, 成功会话: %d, 失败会话: %d\n", devices.size(), sessions_ok, sessions_failed);
+        for (auto& [reason, count] : errors) {
+            printf("  %s: %d\n", reason.c_str(), count);
+        }
+        printf("%s    样本%10s%10s%10s%10s\n", PadRight("指标", 24).c_str(), "p50", "p90", "p99", "max");
+        for (auto& row : rows) {
+            auto values = Collect(row.field);
+            if (values.empty()) {
+                continue;
+            }
+            double p50 = Percentile(values, 50);
+            double p90 = Percentile(values, 90);
+            double p99 = Percentile(values, 99);
+            printf("%s%8zu%10.1f%10.1f%10.1f%10.1f\n", PadRight(row.name, 24).c_str(), values.size(), p50, p90, p99, values.back());
+        }
+    }
+
+    bool WriteJson(const std::string& path) const {
+        FILE* file = fopen(path.c_str(), "w");
+        if (file == nullptr) {
+            return false;
+        }
+        auto write_array = [file](const char* key, const std::vector<double>& values) {
+            fprintf(file, ", \"%s\": [", key);
+            for (size_t i = 0; i < values.size(); i++) {
+                fprintf(file, i == 0 ? "%.3f" : ", %.3f", values[i]);
+            }
+            fprintf(file, "]");
+        };
+        fprintf(file, "{\"errors\": {");
+        bool first = true;
+        for (auto& [reason, count] : errors) {
+            fprintf(file, "%s\"%s\": %d", first ? "" : ", ", reason.c_str(), count);
+            first = false;
+        }
+        fprintf(file, "},\n\"devices\": [\n");
+        for (size_t i = 0; i < devices.size(); i++) {
+            auto& device = *devices[i];
+            fprintf(file, " {\"device_id\": \"%s\"", device.device_id.c_str());
+            write_array("hello_rtt_ms", device.hello_rtt_ms);
+            write_array("ping_rtt_ms", device.ping_rtt_ms);
+            write_array("first_audio_ms", device.first_audio_ms);
+            write_array("pacing_lag_ms", device.pacing_lag_ms);
+            write_array("tls_full_ms", device.tls_full_ms);
+            write_array("tls_resumed_ms", device.tls_resumed_ms);
+            write_array("uplink_kbps", device.uplink_kbps);
+            write_array("downlink_kbps", device.downlink_kbps);
+            fprintf(file, "}%s\n", i + 1 < devices.size() ? "," : "");
+        }
+        fprintf(file, "]}\n");
+        fclose(file);
+        return true;
+    }
+};
+
+std::string ListenMessage(const std::string& session_id, const char* state, const char* mode = nullptr) {
+    StaticJsonWriter<CONTROL_MESSAGE_BUFFER_SIZE> writer;
+    writer.BeginObject()
+        .Field("session_id", session_id)
+        .Field("type", "listen")
+        .Field("state", state);
+    if (mode != nullptr) {
+        writer.Field("mode", mode);
+    }
+    writer.EndObject();
+    return std::string(writer.view());
+}
+
+std::string PingMessage(int id) {
+    StaticJsonWriter<64> writer;
+    writer.BeginObject()
+        .Field("type", "ping")
+        .Field("id", std::to_string(id))
+        .EndObject();
+    return std::string(writer.view());
+}
+
+std::string GoodbyeMessage(const std::string& session_id) {
+    StaticJsonWriter<CONTROL_MESSAGE_BUFFER_SIZE> writer;
+    writer.BeginObject()
+        .Field("session_id", session_id)
+        .Field("type", "goodbye")
+        .EndObject();
+    return std::string(writer.view());
+}
+
+// 与固件的 GetHelloMessage 相同的字段
+std::string HelloMessage(const char* transport, int version, bool multi_frame) {
+    StaticJsonWriter<CONTROL_MESSAGE_BUFFER_SIZE> writer;
+    writer.BeginObject()
+        .Field("type", "hello")
+        .Field("version", version)
+        .Field("transport", transport)
+        .Key("features").BeginObject()
+            .Field("ping", true);
+    if (multi_frame) {
+        writer.Field("multi_frame", true);
+    }
+    writer.EndObject()
+        .Key("audio_params").BeginObject()
+            .Field("format", "opus")
+            .Field("sample_rate", BENCH_SAMPLE_RATE)
+            .Field("channels", 1)
+            .Field("frame_duration", BENCH_FRAME_DURATION_MS)
+        .EndObject()
+        .EndObject();
+    return std::string(writer.view());
+}
+
+bool JsonBool(const cJSON* object, const char* key) {
+    return cJSON_IsTrue(cJSON_GetObjectItem(object, key));
+}
+
+std::string JsonString(const cJSON* object, const char* key) {
+    auto item = cJSON_GetObjectItem(object, key);
+    return cJSON_IsString(item) ? item->valuestring : "";
+}
+
+/*
+ * 一次会话的传输通道。回调只在事件循环中触发；Close 之后不再回调
+ */
+class Channel {
+public:
+    virtual ~Channel() = default;
+    virtual void Open(SSL_SESSION* tls_session) = 0;
+    virtual void SendJson(std::string_view text) = 0;
+    virtual void SendAudio(const std::string* frames, size_t count, uint32_t timestamp) = 0;
+    virtual void Close(const std::string& session_id) = 0;
+    virtual uint64_t bytes_up() const = 0;
+    virtual uint64_t bytes_down() const = 0;
+    // 会话结束时取出 TLS 会话，供同一设备的下一次连接恢复
+    virtual SSL_SESSION* GetTlsSession() const = 0;
+    virtual const Stream* stream() const = 0;
+
+    std::function<void(const cJSON* hello)> on_hello;
+    std::function<void(const ControlMessage& message)> on_json;
+    std::function<void()> on_audio;
+    std::function<void(const std::string& reason)> on_error;
+};
+
+class WebsocketChannel : public Channel {
+public:
+    WebsocketChannel(EventLoop& loop, const Config& config, SSL_CTX* tls, const std::string& device_id, const std::string& client_id)
+        : config_(config), tls_(tls), version_(config.version), websocket_(loop) {
+        websocket_.SetHeader("Protocol-Version", std::to_string(version_));
+        websocket_.SetHeader("Device-Id", device_id);
+        websocket_.SetHeader("Client-Id", client_id);
+        if (!config.token.empty()) {
+            websocket_.SetHeader("Authorization", config.token.find(' ') == std::string::npos ? "Bearer " + config.token : config.token);
+        }
+    }
+
+    void Open(SSL_SESSION* tls_session) override {
+        websocket_.OnConnected([this]() {
+            websocket_.SendText(HelloMessage("websocket", version_, version_ == 4));
+        });
+        websocket_.OnText([this](std::string_view text) {
+            ControlMessage message;
+            if (!ParseControlMessage(text.data(), text.size(), message)) {
+                return;
+            }
+            if (message.type == "hello" && !hello_received_) {
+                hello_received_ = true;
+                auto root = cJSON_ParseWithLength(text.data(), text.size());
+                NegotiateVersion(root);
+                if (on_hello) {
+                    on_hello(root);
+                }
+                cJSON_Delete(root);
+            } else if (on_json) {
+                on_json(message);
+            }
+        });
+        websocket_.OnBinary([this](std::string_view data) {
+            if (on_audio && UnpackWebsocketAudio(version_, data, [](uint32_t, std::string_view) {})) {
+                on_audio();
+            }
+        });
+        websocket_.OnClosed([this](const std::string& reason) {
+            if (on_error) {
+                on_error(reason);
+            }
+        });
+        if (!websocket_.Connect(config_.url, tls_, tls_session)) {
+            if (on_error) {
+                on_error("invalid url");
+            }
+        }
+    }
+
+    void SendJson(std::string_view text) override {
+        websocket_.SendText(text);
+    }
+
+    void SendAudio(const std::string* frames, size_t count, uint32_t timestamp) override {
+        for (auto& packet : PackWebsocketAudio(version_, frames, count, timestamp)) {
+            websocket_.SendBinary(packet);
+        }
+    }
+
+    void Close(const std::string&) override {
+        websocket_.Close();
+    }
+
+    uint64_t bytes_up() const override { return websocket_.bytes_sent(); }
+    uint64_t bytes_down() const override { return websocket_.bytes_received(); }
+    SSL_SESSION* GetTlsSession() const override {
+        return websocket_.stream() ? websocket_.stream()->GetTlsSession() : nullptr;
+    }
+    const Stream* stream() const override { return websocket_.stream(); }
+
+private:
+    const Config& config_;
+    SSL_CTX* tls_;
+    int version_;
+    bool hello_received_ = false;
+    WebSocketClient websocket_;
+
+    // 与固件一致：服务器确认 multi_frame 或版本 4 才使用 v4，否则退回服务器声明的版本
+    void NegotiateVersion(const cJSON* root) {
+        if (version_ != 4) {
+            return;
+        }
+        auto features = cJSON_GetObjectItem(root, "features");
+        auto version = cJSON_GetObjectItem(root, "version");
+        int server_version = cJSON_IsNumber(version) ? version->valueint : 1;
+        if (JsonBool(features, "multi_frame") || server_version == 4) {
+            return;
+        }
+        version_ = (server_version >= 1 && server_version <= 3) ? server_version : 1;
+    }
+};
+
+class MqttChannel : public Channel {
+public:
+    MqttChannel(EventLoop& loop, const Config& config, SSL_CTX* tls, const std::string& device_id, int index)
+        : loop_(loop), config_(config), tls_(tls), device_id_(device_id), index_(index) {}
+
+    ~MqttChannel() {
+        if (ping_timer_ != 0) {
+            loop_.Cancel(ping_timer_);
+        }
+    }
+
+    void Open(SSL_SESSION* tls_session) override {
+        auto colon = config_.mqtt_endpoint.find(':');
+        std::string host = config_.mqtt_endpoint.substr(0, colon);
+        int port = colon == std::string::npos ? 8883 : atoi(config_.mqtt_endpoint.c_str() + colon + 1);
+        // 与固件一致，8883 端口使用 TLS
+        bool secure = port == 8883 || config_.mqtt_tls;
+        stream_ = Stream::Connect(loop_, host, port, secure ? tls_ : nullptr, tls_session);
+        stream_->OnConnected([this]() {
+            Write(MqttCodec::Connect(Format(config_.mqtt_client_id), Format(config_.mqtt_username),
+                Format(config_.mqtt_password), MQTT_KEEPALIVE_SECONDS));
+        });
+        stream_->OnData([this](const uint8_t* data, size_t size) {
+            bytes_down_ += size;
+            if (!codec_.Feed(data, size, [this](MqttCodec::PacketType type, uint8_t flags, std::string_view body) {
+                OnPacket(type, flags, body);
+            })) {
+                Fail("invalid mqtt packet");
+            }
+        });
+        stream_->OnClosed([this](const std::string& reason) {
+            Fail(reason);
+        });
+    }
+
+    void SendJson(std::string_view text) override {
+        Write(MqttCodec::Publish(Format(config_.mqtt_publish_topic), text));
+    }
+
+    void SendAudio(const std::string* frames, size_t count, uint32_t timestamp) override {
+        if (udp_ == nullptr) {
+            return;
+        }
+        if (multi_frame_ && count > 1) {
+            SendUdp(cipher_->Seal(UDP_PACKET_TYPE_AGGREGATED, count, timestamp, ++sequence_, PackFrames(frames, count)));
+            return;
+        }
+        for (size_t i = 0; i < count; i++) {
+            SendUdp(cipher_->Seal(UDP_PACKET_TYPE_OPUS, 0, timestamp + i * BENCH_FRAME_DURATION_MS, ++sequence_, frames[i]));
+        }
+    }
+
+    void Close(const std::string& session_id) override {
+        if (stream_ && stream_->connected()) {
+            if (!session_id.empty()) {
+                SendJson(GoodbyeMessage(session_id));
+            }
+            Write(MqttCodec::Packet(MqttCodec::kDisconnect));
+        }
+        if (stream_) {
+            stream_->Close();
+        }
+    }
+
+    uint64_t bytes_up() const override { return bytes_up_; }
+    uint64_t bytes_down() const override { return bytes_down_; }
+    SSL_SESSION* GetTlsSession() const override { return stream_ ? stream_->GetTlsSession() : nullptr; }
+    const Stream* stream() const override { return stream_.get(); }
+
+private:
+    EventLoop& loop_;
+    const Config& config_;
+    SSL_CTX* tls_;
+    std::string device_id_;
+    int index_;
+    std::shared_ptr<Stream> stream_;
+    MqttCodec codec_;
+    std::unique_ptr<Datagram> udp_;
+    std::unique_ptr<UdpCipher> cipher_;
+    bool multi_frame_ = false;
+    bool hello_received_ = false;
+    uint32_t sequence_ = 0;
+    uint64_t ping_timer_ = 0;
+    uint64_t bytes_up_ = 0;
+    uint64_t bytes_down_ = 0;
+
+    // 主题、用户名等支持 {index} {device_id} {mac} 占位符
+    std::string Format(const std::string& pattern) const {
+        std::string mac = device_id_;
+        for (auto& c : mac) {
+            if (c == ':') {
+                c = '_';
+            }
+        }
+        std::string out = pattern;
+        auto replace = [&out](const std::string& key, const std::string& value) {
+            for (size_t pos = out.find(key); pos != std::string::npos; pos = out.find(key, pos + value.size())) {
+                out.replace(pos, key.size(), value);
+            }
+        };
+        replace("{index}", std::to_string(index_));
+        replace("{device_id}", device_id_);
+        replace("{mac}", mac);
+        return out;
+    }
+
+    void Write(const std::string& packet) {
+        bytes_up_ += packet.size();
+        stream_->Write(packet);
+    }
+
+    void SendUdp(const std::string& packet) {
+        bytes_up_ += packet.size();
+        udp_->Send(packet);
+    }
+
+    void SchedulePing() {
+        ping_timer_ = loop_.CallLater(MQTT_KEEPALIVE_SECONDS / 2 * 1000000LL, [this]() {
+            ping_timer_ = 0;
+            Write(MqttCodec::Packet(MqttCodec::kPingReq));
+            SchedulePing();
+        });
+    }
+
+    void OnPacket(MqttCodec::PacketType type, uint8_t flags, std::string_view body) {
+        if (type == MqttCodec::kConnAck) {
+            if (body.size() < 2 || body[1] != 0) {
+                Fail("mqtt connect refused");
+                return;
+            }
+            SchedulePing();
+            if (!config_.mqtt_subscribe_topic.empty()) {
+                Write(MqttCodec::Subscribe(Format(config_.mqtt_subscribe_topic), 1));
+            }
+            SendJson(HelloMessage("udp", 3, config_.multi_frame));
+        } else if (type == MqttCodec::kPublish) {
+            std::string_view topic, payload;
+            if (MqttCodec::ParsePublish(flags, body, topic, payload)) {
+                OnMessage(payload);
+            }
+        }
+    }
+
+    void OnMessage(std::string_view payload) {
+        ControlMessage message;
+        if (!ParseControlMessage(payload.data(), payload.size(), message)) {
+            return;
+        }
+        if (message.type != "hello" || hello_received_) {
+            if (on_json) {
+                on_json(message);
+            }
+            return;
+        }
+
+        hello_received_ = true;
+        auto root = cJSON_ParseWithLength(payload.data(), payload.size());
+        auto udp = cJSON_GetObjectItem(root, "udp");
+        auto port = cJSON_GetObjectItem(udp, "port");
+        cipher_ = std::make_unique<UdpCipher>(HexDecode(JsonString(udp, "key")), HexDecode(JsonString(udp, "nonce")));
+        if (!cJSON_IsNumber(port) || !cipher_->valid()) {
+            cJSON_Delete(root);
+            Fail("invalid udp params in hello");
+            return;
+        }
+        multi_frame_ = JsonBool(udp, "multi_frame");
+        udp_ = Datagram::Connect(loop_, JsonString(udp, "server"), port->valueint);
+        if (udp_ == nullptr) {
+            cJSON_Delete(root);
+            Fail("udp connect failed");
+            return;
+        }
+        udp_->OnMessage([this](const uint8_t* data, size_t size, const sockaddr_in&) {
+            bytes_down_ += size;
+            UdpPacket packet;
+            if (cipher_->Open(data, size, packet) && on_audio) {
+                on_audio();
+            }
+        });
+        if (on_hello) {
+            on_hello(root);
+        }
+        cJSON_Delete(root);
+    }
+
+    void Fail(const std::string& reason) {
+        if (stream_) {
+            stream_->Close();
+        }
+        if (on_error) {
+            on_error(reason);
+        }
+    }
+};
+
+/*
+ * 一台模拟设备，按 Config 循环执行若干轮对话
+ * 每轮对话的回调都带着轮次编号，会话结束后迟到的回调直接忽略。
+ */
+class Device {
+public:
+    Device(EventLoop& loop, const Config& config, SSL_CTX* tls, const std::vector<std::string>& frames,
+        Metrics& metrics, std::mt19937& random, int index)
+        : loop_(loop), config_(config), tls_(tls), frames_(frames), metrics_(metrics), random_(random),
+          index_(index + config.id_offset) {
+        char device_id[32];
+        int n = index_;
+        snprintf(device_id, sizeof(device_id), "02:00:%02x:%02x:%02x:%02x",
+            (n >> 24) & 0xFF, (n >> 16) & 0xFF, (n >> 8) & 0xFF, n & 0xFF);
+        client_id_ = RandomUuid();
+        auto samples = std::make_unique<DeviceSamples>();
+        samples->device_id = device_id;
+        samples_ = samples.get();
+        metrics.devices.push_back(std::move(samples));
+    }
+
+    ~Device() {
+        if (tls_session_ != nullptr) {
+            SSL_SESSION_free(tls_session_);
+        }
+    }
+
+    void Start() {
+        metrics_.active++;
+        StartSession();
+    }
+
+private:
+    EventLoop& loop_;
+    const Config& config_;
+    SSL_CTX* tls_;
+    const std::vector<std::string>& frames_;
+    Metrics& metrics_;
+    std::mt19937& random_;
+    int index_;
+    std::string client_id_;
+    DeviceSamples* samples_;
+    SSL_SESSION* tls_session_ = nullptr;
+
+    std::unique_ptr<Channel> channel_;
+    int generation_ = 0;
+    int sessions_done_ = 0;
+    std::string session_id_;
+    uint64_t timer_ = 0;
+    int64_t start_us_ = 0;
+    int64_t stream_start_us_ = 0;
+    int64_t stop_us_ = 0;
+    int64_t next_ping_us_ = 0;
+    int64_t max_lag_us_ = 0;
+    double upload_seconds_ = 0;
+    size_t next_frame_ = 0;
+    bool ping_supported_ = false;
+    int ping_count_ = 0;
+    std::map<std::string, int64_t> pings_;
+    bool first_audio_ = false;
+
+    void SetTimer(double seconds, std::function<void()> callback) {
+        CancelTimer();
+        int generation = generation_;
+        timer_ = loop_.CallLater((int64_t)(seconds * 1000000), [this, generation, callback = std::move(callback)]() {
+            timer_ = 0;
+            if (generation == generation_) {
+                callback();
+            }
+        });
+    }
+
+    void CancelTimer() {
+        if (timer_ != 0) {
+            loop_.Cancel(timer_);
+            timer_ = 0;
+        }
+    }
+
+    void StartSession() {
+        generation_++;
+        int generation = generation_;
+        if (config_.transport == "websocket") {
+            channel_ = std::make_unique<WebsocketChannel>(loop_, config_, tls_, samples_->device_id, client_id_);
+        } else {
+            channel_ = std::make_unique<MqttChannel>(loop_, config_, tls_, samples_->device_id, index_);
+        }
+        pings_.clear();
+        session_id_.clear();
+        first_audio_ = false;
+        ping_count_ = 0;
+
+        channel_->on_hello = [this, generation](const cJSON* hello) {
+            if (generation == generation_) {
+                OnHello(hello);
+            }
+        };
+        channel_->on_json = [this, generation](const ControlMessage& message) {
+            if (generation == generation_) {
+                OnJson(message);
+            }
+        };
+        channel_->on_audio = [this, generation]() {
+            if (generation == generation_) {
+                OnAudio();
+            }
+        };
+        channel_->on_error = [this, generation](const std::string& reason) {
+            if (generation == generation_) {
+                EndSession(reason);
+            }
+        };
+
+        start_us_ = EventLoop::NowUs();
+        SetTimer(config_.timeout, [this]() { EndSession("timeout"); });
+        channel_->Open(config_.tls_resume ? tls_session_ : nullptr);
+    }
+
+    void OnHello(const cJSON* hello) {
+        samples_->hello_rtt_ms.push_back((EventLoop::NowUs() - start_us_) / 1000.0);
+        auto stream = channel_->stream();
+        if (stream != nullptr && stream->tls()) {
+            double handshake_ms = stream->handshake_us() / 1000.0;
+            (stream->tls_resumed() ? samples_->tls_resumed_ms : samples_->tls_full_ms).push_back(handshake_ms);
+        }
+        session_id_ = JsonString(hello, "session_id");
+        ping_supported_ = JsonBool(cJSON_GetObjectItem(hello, "features"), "ping");
+
+        channel_->SendJson(ListenMessage(session_id_, "start", config_.mode.c_str()));
+        stream_start_us_ = EventLoop::NowUs();
+        next_ping_us_ = stream_start_us_;
+        max_lag_us_ = 0;
+        next_frame_ = 0;
+        CancelTimer();
+        SendChunk();
+    }
+
+    // 按实时节奏上传，每次发送 aggregate 帧；聚合发送时等最后一帧“录完”再发
+    void SendChunk() {
+        size_t count = std::min<size_t>(config_.aggregate, frames_.size() - next_frame_);
+        int64_t now = EventLoop::NowUs();
+        int64_t due = stream_start_us_ + (int64_t)(next_frame_ + count - 1) * BENCH_FRAME_DURATION_MS * 1000;
+        max_lag_us_ = std::max(max_lag_us_, now - due);
+        channel_->SendAudio(&frames_[next_frame_], count, next_frame_ * BENCH_FRAME_DURATION_MS);
+        if (ping_supported_ && now >= next_ping_us_) {
+            auto id = std::to_string(++ping_count_);
+            pings_[id] = now;
+            channel_->SendJson(PingMessage(ping_count_));
+            next_ping_us_ += (int64_t)(config_.ping_interval * 1000000);
+        }
+
+        next_frame_ += count;
+        if (next_frame_ < frames_.size()) {
+            size_t next_count = std::min<size_t>(config_.aggregate, frames_.size() - next_frame_);
+            int64_t next_due = stream_start_us_ + (int64_t)(next_frame_ + next_count - 1) * BENCH_FRAME_DURATION_MS * 1000;
+            SetTimer((next_due - EventLoop::NowUs()) / 1e6, [this]() { SendChunk(); });
+            return;
+        }
+
+        samples_->pacing_lag_ms.push_back(max_lag_us_ / 1000.0);
+        stop_us_ = EventLoop::NowUs();
+        upload_seconds_ = (stop_us_ - stream_start_us_) / 1e6;
+        channel_->SendJson(ListenMessage(session_id_, "stop"));
+        SetTimer(config_.timeout, [this]() { EndSession("timeout"); });
+    }
+
+    void OnJson(const ControlMessage& message) {
+        if (message.type == "pong") {
+            auto it = pings_.find(message.id.str());
+            if (it != pings_.end()) {
+                samples_->ping_rtt_ms.push_back((EventLoop::NowUs() - it->second) / 1000.0);
+                pings_.erase(it);
+            }
+        } else if (message.type == "tts" && message.state == "stop" && first_audio_) {
+            EndSession(std::string());
+        }
+    }
+
+    void OnAudio() {
+        // 只统计 listen stop 之后的下行音频
+        if (first_audio_ || stop_us_ == 0) {
+            return;
+        }
+        first_audio_ = true;
+        samples_->first_audio_ms.push_back((EventLoop::NowUs() - stop_us_) / 1000.0);
+        // 收到首包后等待 tts stop 超时不算失败
+        SetTimer(config_.tts_timeout, [this]() { EndSession(std::string()); });
+    }
+
+    void EndSession(const std::string& error) {
+        CancelTimer();
+        generation_++;
+        if (error.empty()) {
+            double elapsed = (EventLoop::NowUs() - start_us_) / 1e6;
+            samples_->uplink_kbps.push_back(channel_->bytes_up() * 8 / 1000.0 / std::max(upload_seconds_, 0.001));
+            samples_->downlink_kbps.push_back(channel_->bytes_down() * 8 / 1000.0 / std::max(elapsed, 0.001));
+            metrics_.sessions_ok++;
+        } else {
+            metrics_.Error(error);
+        }
+
+        if (config_.tls_resume) {
+            auto session = channel_->GetTlsSession();
+            if (session != nullptr) {
+                if (tls_session_ != nullptr) {
+                    SSL_SESSION_free(tls_session_);
+                }
+                tls_session_ = session;
+            }
+        }
+        channel_->Close(session_id_);
+        // 可能正处于通道自己的回调中，推迟到下一轮事件循环再释放
+        loop_.CallLater(0, [channel = std::shared_ptr<Channel>(std::move(channel_))]() {});
+        stop_us_ = 0;
+
+        if (++sessions_done_ >= config_.sessions) {
+            metrics_.active--;
+            metrics_.finished++;
+            if (metrics_.finished == config_.devices) {
+                loop_.Stop();
+            }
+            return;
+        }
+        std::uniform_real_distribution<double> think(0.5, 1.5);
+        SetTimer(config_.think_time * think(random_), [this]() { StartSession(); });
+    }
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options("多设备协议压测工具");
+    options.Add("transport", "websocket", "websocket 或 mqtt");
+    options.Add("devices", "100", "模拟设备数", 'n');
+    options.Add("ramp", "50", "每秒新增设备数，0 表示一次全部启动");
+    options.Add("sessions", "3", "每台设备的对话轮数");
+    options.Add("think-time", "2", "两轮对话之间的平均间隔秒数");
+    options.Add("audio", "", "上行音频，p3 格式；不指定时发送静音帧");
+    options.Add("utterance", "3", "未指定音频时每轮上行时长秒数");
+    options.Add("aggregate", "1", "每次发送的帧数，v4 和 UDP multi_frame 时打包为一个包");
+    options.Add("mode", "manual", "auto、manual 或 realtime");
+    options.Add("ping-interval", "1", "上行期间 ping 的间隔秒数");
+    options.Add("timeout", "10", "hello 和首个 TTS 包的超时秒数");
+    options.Add("tts-timeout", "30", "等待 tts stop 的超时秒数");
+    options.Add("id-offset", "0", "设备编号起点，多台压测机并行时错开");
+    options.AddFlag("insecure", "不校验服务器证书");
+    options.AddFlag("no-tls-resume", "每轮对话都做完整 TLS 握手，默认像固件一样恢复上一次的会话");
+    options.Add("json-out", "", "把每台设备的原始样本写入 JSON 文件");
+    options.Add("progress-interval", "5", "进度输出间隔秒数");
+    options.Add("seed", "", "思考时间的随机数种子，便于复现");
+    options.AddGroup("WebSocket");
+    options.Add("url", "ws://127.0.0.1:8000/xiaozhi/v1/", "ws:// 或 wss:// 地址");
+    options.Add("token", "test-token", "Authorization 头，不含空格时自动加 Bearer 前缀");
+    options.Add("version", "1", "二进制协议版本 1~4");
+    options.AddGroup("MQTT + UDP，主题、用户名等支持 {index} {device_id} {mac} 占位符");
+    options.Add("mqtt-endpoint", "127.0.0.1:1883", "host:port，8883 端口使用 TLS");
+    options.AddFlag("mqtt-tls", "其他端口也使用 TLS");
+    options.Add("mqtt-client-id", "GID_test@@@{mac}@@@{index}", "客户端 ID");
+    options.Add("mqtt-username", "", "用户名");
+    options.Add("mqtt-password", "", "密码");
+    options.Add("mqtt-publish-topic", "device-server", "发布主题");
+    options.Add("mqtt-subscribe-topic", "", "需要显式订阅时指定，例如 devices/p2p/{mac}");
+    options.AddFlag("no-multi-frame", "hello 中不声明 multi_frame");
+    if (!options.Parse(argc, argv)) {
+        return 2;
+    }
+
+    Config config;
+    config.transport = options.Get("transport");
+    config.devices = options.GetInt("devices");
+    config.ramp = options.GetDouble("ramp");
+    config.sessions = options.GetInt("sessions");
+    config.think_time = options.GetDouble("think-time");
+    config.aggregate = std::max(1, options.GetInt("aggregate"));
+    config.mode = options.Get("mode");
+    config.ping_interval = options.GetDouble("ping-interval");
+    config.timeout = options.GetDouble("timeout");
+    config.tts_timeout = options.GetDouble("tts-timeout");
+    config.id_offset = options.GetInt("id-offset");
+    config.tls_resume = !options.GetFlag("no-tls-resume");
+    config.url = options.Get("url");
+    config.token = options.Get("token");
+    config.version = options.GetInt("version");
+    config.mqtt_endpoint = options.Get("mqtt-endpoint");
+    config.mqtt_client_id = options.Get("mqtt-client-id");
+    config.mqtt_username = options.Get("mqtt-username");
+    config.mqtt_password = options.Get("mqtt-password");
+    config.mqtt_publish_topic = options.Get("mqtt-publish-topic");
+    config.mqtt_subscribe_topic = options.Get("mqtt-subscribe-topic");
+    config.multi_frame = !options.GetFlag("no-multi-frame");
+    config.mqtt_tls = options.GetFlag("mqtt-tls");
+    if (config.transport != "websocket" && config.transport != "mqtt") {
+        fprintf(stderr, "--transport 只能是 websocket 或 mqtt\n");
+        return 2;
+    }
+    if (config.version < 1 || config.version > 4) {
+        fprintf(stderr, "--version 只能是 1~4\n");
+        return 2;
+    }
+    if (config.devices <= 0 || config.sessions <= 0) {
+        fprintf(stderr, "--devices 和 --sessions 必须大于 0\n");
+        return 2;
+    }
+
+    std::vector<std::string> frames;
+    if (!options.Get("audio").empty()) {
+        frames = ReadP3(options.Get("audio"));
+        if (frames.empty()) {
+            fprintf(stderr, "音频文件中没有 Opus 帧\n");
+            return 1;
+        }
+    } else {
+        int count = std::max(1, (int)(options.GetDouble("utterance") * 1000 / BENCH_FRAME_DURATION_MS));
+        frames.assign(count, std::string(BENCH_SILENCE_FRAME));
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    int limit = RaiseFdLimit();
+    if (config.devices * 2 > limit) {
+        fprintf(stderr, "警告: 文件描述符上限 %d 可能不足以支撑 %d 台设备\n", limit, config.devices);
+    }
+
+    std::mt19937 random(options.Get("seed").empty() ? std::random_device()() : options.GetInt("seed"));
+    SSL_CTX* tls = CreateTlsClientContext(!options.GetFlag("insecure"));
+    EventLoop loop;
+    Metrics metrics;
+    std::vector<std::unique_ptr<Device>> devices;
+    for (int i = 0; i < config.devices; i++) {
+        devices.push_back(std::make_unique<Device>(loop, config, tls, frames, metrics, random, i));
+        auto device = devices.back().get();
+        double delay = config.ramp > 0 ? i / config.ramp : 0;
+        loop.CallLater((int64_t)(delay * 1000000), [device]() { device->Start(); });
+    }
+
+    double progress_interval = options.GetDouble("progress-interval");
+    std::function<void()> progress = [&]() {
+        char now[16];
+        time_t t = time(nullptr);
+        strftime(now, sizeof(now), "%H:%M:%S", localtime(&t));
+        printf("[%s] 活跃设备: %d, 成功会话: %d, 失败会话: %d\n", now, metrics.active, metrics.sessions_ok, metrics.sessions_failed);
+        fflush(stdout);
+        loop.CallLater((int64_t)(progress_interval * 1000000), progress);
+    };
+    if (progress_interval > 0) {
+        loop.CallLater((int64_t)(progress_interval * 1000000), progress);
+    }
+
+    loop.Run();
+    metrics.Report();
+    if (!options.Get("json-out").empty()) {
+        if (metrics.WriteJson(options.Get("json-out"))) {
+            printf("\n每台设备的样本已写入 %s\n", options.Get("json-out").c_str());
+        } else {
+            fprintf(stderr, "无法写入 %s\n", options.Get("json-out").c_str());
+        }
+    }
+    devices.clear();
+    SSL_CTX_free(tls);
+    // 有会话失败时返回非零，便于脚本判断
+    return metrics.sessions_failed == 0 ? 0 : 1;
+}
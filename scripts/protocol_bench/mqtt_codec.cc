@@ -0,0 +1,138 @@
+#include "mqtt_codec.h"
+
+// 报文长度上限，远大于协议中的任何控制消息
+#define MQTT_MAX_PACKET_SIZE (1024 * 1024)
+
+std::string MqttCodec::Packet(PacketType type, std::string_view body, uint8_t flags) {
+    std::string packet;
+    packet.reserve(body.size() + 5);
+    packet.push_back(static_cast<char>((type << 4) | flags));
+    size_t length = body.size();
+    do {
+        uint8_t byte = length & 0x7F;
+        length >>= 7;
+        packet.push_back(static_cast<char>(length ? (byte | 0x80) : byte));
+    } while (length);
+    packet.append(body);
+    return packet;
+}
+
+std::string MqttCodec::String(std::string_view value) {
+    std::string out;
+    out.reserve(value.size() + 2);
+    out.push_back(static_cast<char>(value.size() >> 8));
+    out.push_back(static_cast<char>(value.size() & 0xFF));
+    out.append(value);
+    return out;
+}
+
+std::string MqttCodec::Connect(std::string_view client_id, std::string_view username,
+    std::string_view password, int keepalive_seconds) {
+    uint8_t flags = 0x02;  // clean session
+    std::string payload = String(client_id);
+    if (!username.empty()) {
+        flags |= 0x80;
+        payload += String(username);
+    }
+    if (!password.empty()) {
+        flags |= 0x40;
+        payload += String(password);
+    }
+    std::string body = String("MQTT");
+    body.push_back(4);  // protocol level 3.1.1
+    body.push_back(static_cast<char>(flags));
+    body.push_back(static_cast<char>(keepalive_seconds >> 8));
+    body.push_back(static_cast<char>(keepalive_seconds & 0xFF));
+    body += payload;
+    return Packet(kConnect, body);
+}
+
+std::string MqttCodec::Publish(std::string_view topic, std::string_view payload) {
+    std::string body = String(topic);
+    body.append(payload);
+    return Packet(kPublish, body);
+}
+
+std::string MqttCodec::Subscribe(std::string_view topic, uint16_t packet_id) {
+    std::string body;
+    body.push_back(static_cast<char>(packet_id >> 8));
+    body.push_back(static_cast<char>(packet_id & 0xFF));
+    body += String(topic);
+    body.push_back(0);  // QoS 0
+    return Packet(kSubscribe, body, 0x02);
+}
+
+bool MqttCodec::ParseConnect(std::string_view body, std::string& client_id) {
+    // |protocol name|level 1u|flags 1u|keepalive 2u|client id|...
+    if (body.size() < 2) {
+        return false;
+    }
+    size_t pos = 2 + ((static_cast<uint8_t>(body[0]) << 8) | static_cast<uint8_t>(body[1])) + 4;
+    if (pos + 2 > body.size()) {
+        return false;
+    }
+    size_t length = (static_cast<uint8_t>(body[pos]) << 8) | static_cast<uint8_t>(body[pos + 1]);
+    if (pos + 2 + length > body.size()) {
+        return false;
+    }
+    client_id.assign(body.substr(pos + 2, length));
+    return true;
+}
+
+bool MqttCodec::ParsePublish(uint8_t flags, std::string_view body, std::string_view& topic, std::string_view& payload) {
+    if (body.size() < 2) {
+        return false;
+    }
+    size_t topic_length = (static_cast<uint8_t>(body[0]) << 8) | static_cast<uint8_t>(body[1]);
+    size_t pos = 2 + topic_length;
+    if ((flags >> 1) & 0x03) {
+        pos += 2;  // packet id
+    }
+    if (pos > body.size()) {
+        return false;
+    }
+    topic = body.substr(2, topic_length);
+    payload = body.substr(pos);
+    return true;
+}
+
+bool MqttCodec::Feed(const uint8_t* data, size_t size, const PacketCallback& callback) {
+    buffer_.append(reinterpret_cast<const char*>(data), size);
+    size_t pos = 0;
+    while (buffer_.size() - pos >= 2) {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(buffer_.data()) + pos;
+        size_t available = buffer_.size() - pos;
+        size_t length = 0;
+        size_t header = 1;
+        bool complete = false;
+        for (int shift = 0; shift <= 21; shift += 7) {
+            if (header >= available) {
+                break;
+            }
+            uint8_t byte = p[header++];
+            length |= (size_t)(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                complete = true;
+                break;
+            }
+            if (shift == 21) {
+                return false;
+            }
+        }
+        if (!complete) {
+            break;
+        }
+        if (length > MQTT_MAX_PACKET_SIZE) {
+            return false;
+        }
+        if (available < header + length) {
+            break;
+        }
+        auto type = static_cast<PacketType>(p[0] >> 4);
+        uint8_t flags = p[0] & 0x0F;
+        pos += header + length;
+        callback(type, flags, std::string_view(reinterpret_cast<const char*>(p + header), length));
+    }
+    buffer_.erase(0, pos);
+    return true;
+}
@@ -0,0 +1,46 @@
+#ifndef MQTT_CODEC_H
+#define MQTT_CODEC_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+/*
+ * MQTT 3.1.1 最小编解码，只支持 QoS 0
+ * 压测时每个连接只是事件循环中的一个描述符，不再需要 esp-mqtt 那样的独立任务
+ */
+class MqttCodec {
+public:
+    enum PacketType : uint8_t {
+        kConnect = 1,
+        kConnAck = 2,
+        kPublish = 3,
+        kSubscribe = 8,
+        kSubAck = 9,
+        kPingReq = 12,
+        kPingResp = 13,
+        kDisconnect = 14
+    };
+    using PacketCallback = std::function<void(PacketType type, uint8_t flags, std::string_view body)>;
+
+    static std::string Packet(PacketType type, std::string_view body = {}, uint8_t flags = 0);
+    static std::string String(std::string_view value);
+    static std::string Connect(std::string_view client_id, std::string_view username,
+        std::string_view password, int keepalive_seconds);
+    static std::string Publish(std::string_view topic, std::string_view payload);
+    static std::string Subscribe(std::string_view topic, uint16_t packet_id);
+
+    // 解析 CONNECT 中的客户端 ID，用于替身服务器的内置 broker
+    static bool ParseConnect(std::string_view body, std::string& client_id);
+    // 解析 PUBLISH 的主题和负载，只处理 QoS 0/1 的报文格式
+    static bool ParsePublish(uint8_t flags, std::string_view body, std::string_view& topic, std::string_view& payload);
+
+    // 喂入收到的字节，每收齐一个报文回调一次；剩余长度字段格式错误时返回 false
+    bool Feed(const uint8_t* data, size_t size, const PacketCallback& callback);
+
+private:
+    std::string buffer_;
+};
+
+#endif // MQTT_CODEC_H
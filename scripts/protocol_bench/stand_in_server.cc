@@ -0,0 +1,1356 @@
+// 本地协议替身服务器
+// 不依赖云端，用确定的时序回应设备（或 load_generator），用于对比固件改动前后的端到端延迟：
+//   - WebSocket：ws 和 wss，v1~v4 二进制帧，hello / listen / abort / goodbye / ping / mcp
+//   - MQTT + UDP：内置最小 MQTT broker（明文和 TLS），hello 中下发 udp.key/nonce，音频使用 AES-CTR 加密
+//   - OTA：返回 websocket 或 mqtt 配置，设备可以直接指向本机
+// TLS 端口开启会话缓存和票据，每次握手是否恢复了之前的会话都写入事件日志，用于验证设备端的 TLS 会话恢复。
+// 一轮对话结束后把设备上传的音频原样作为 TTS 回放，stt/tts 的时延由命令行参数控制。
+// 下行（以及上行接收）可以注入丢包、抖动和乱序，运行中通过控制端口调整。
+// 所有关键事件写入 JSONL 时间戳日志，便于离线计算设备端到端延迟。
+#include "audio_framing.h"
+#include "bench_util.h"
+#include "event_loop.h"
+#include "mqtt_codec.h"
+#include "stream.h"
+#include "udp_cipher.h"
+#include "websocket.h"
+
+#include "json_reader.h"
+#include "json_writer.h"
+#include "protocol.h"
+
+#include <cJSON.h>
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <unistd.h>
+#include <algorithm>
+#include <csignal>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+// 事件日志单行的上限
+#define EVENT_LOG_LINE_SIZE 1024
+// OTA 请求的上限，设备上报的系统信息通常只有几 KB
+#define OTA_MAX_REQUEST_SIZE (64 * 1024)
+
+namespace {
+
+struct Config {
+    std::string host;
+    std::string public_host;
+    int ws_port;
+    int wss_port;
+    int mqtt_port;
+    int mqtts_port;
+    int udp_port;
+    std::string ota_transport;
+    int ota_version;
+    bool ota_tls;
+    int timezone_offset;
+    double stt_delay;
+    double tts_delay;
+    double tts_speed;
+    double tts_duration;
+    double auto_utterance;
+    int aggregate;
+    int sample_rate;
+    bool mcp;
+    bool resume;
+    bool no_v4;
+    bool no_multi_frame;
+};
+
+bool verbose = false;
+
+void Log(const char* level, const char* format, va_list args) {
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    char now[16];
+    strftime(now, sizeof(now), "%H:%M:%S", localtime(&ts.tv_sec));
+    fprintf(stderr, "%s.%03ld %s ", now, ts.tv_nsec / 1000000, level);
+    vfprintf(stderr, format, args);
+    fputc('\n', stderr);
+}
+
+void LogInfo(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    Log("INFO", format, args);
+    va_end(args);
+}
+
+void LogDebug(const char* format, ...) {
+    if (!verbose) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    Log("DEBUG", format, args);
+    va_end(args);
+}
+
+std::string FormatDouble(double value) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.3f", value);
+    return buffer;
+}
+
+bool JsonBool(const cJSON* object, const char* key) {
+    return cJSON_IsTrue(cJSON_GetObjectItem(object, key));
+}
+
+std::string JsonString(const cJSON* object, const char* key) {
+    auto item = cJSON_GetObjectItem(object, key);
+    return cJSON_IsString(item) ? item->valuestring : "";
+}
+
+/*
+ * 每行一个事件：{"t": 墙钟毫秒, "mono": 单调时钟毫秒, "session": ..., "event": ..., ...}
+ * 附加字段由调用方通过 JsonWriter 写入
+ */
+class EventLog {
+public:
+    explicit EventLog(const std::string& path) {
+        if (!path.empty()) {
+            file_ = fopen(path.c_str(), "a");
+            if (file_ != nullptr) {
+                setvbuf(file_, nullptr, _IOLBF, 0);
+            }
+        }
+    }
+
+    ~EventLog() {
+        if (file_ != nullptr) {
+            fclose(file_);
+        }
+    }
+
+    bool ok() const { return file_ != nullptr; }
+
+    template <typename Fields>
+    void Write(std::string_view session, std::string_view event, Fields&& fields) {
+        if (file_ == nullptr) {
+            return;
+        }
+        StaticJsonWriter<EVENT_LOG_LINE_SIZE> writer;
+        writer.BeginObject()
+            .RawField("t", FormatDouble(WallClockMs()))
+            .RawField("mono", FormatDouble(EventLoop::NowUs() / 1000.0));
+        if (session.empty()) {
+            writer.RawField("session", "null");
+        } else {
+            writer.Field("session", session);
+        }
+        writer.Field("event", event);
+        fields(writer);
+        writer.EndObject();
+        if (!writer.overflow()) {
+            fprintf(file_, "%.*s\n", (int)writer.size(), writer.view().data());
+        }
+    }
+
+    void Write(std::string_view session, std::string_view event) {
+        Write(session, event, [](JsonWriter&) {});
+    }
+
+private:
+    FILE* file_ = nullptr;
+};
+
+/*
+ * 丢包、抖动、乱序，对每个音频包独立生效
+ */
+struct Impairment {
+    double loss = 0;
+    double jitter_ms = 0;
+    double reorder = 0;
+    int dropped = 0;
+    int reordered = 0;
+    std::mt19937 random;
+
+    // 返回负数表示丢弃，否则为需要延迟的微秒数
+    int64_t DelayUs() {
+        std::uniform_real_distribution<double> uniform(0, 1);
+        if (loss > 0 && uniform(random) < loss) {
+            dropped++;
+            return -1;
+        }
+        double delay_ms = jitter_ms > 0 ? uniform(random) * jitter_ms : 0;
+        if (reorder > 0 && uniform(random) < reorder) {
+            // 推迟两帧，让后面的包先到
+            reordered++;
+            delay_ms += 2 * BENCH_FRAME_DURATION_MS;
+        }
+        return (int64_t)(delay_ms * 1000);
+    }
+
+    std::string Describe() const {
+        char buffer[160];
+        snprintf(buffer, sizeof(buffer), "loss=%g jitter=%gms reorder=%g dropped=%d reordered=%d",
+            loss, jitter_ms, reorder, dropped, reordered);
+        return buffer;
+    }
+};
+
+class Server;
+
+/*
+ * 一次音频通道会话的公共逻辑，传输相关的部分由子类实现
+ * 回应的各个步骤通过定时器串联，打断或关闭时递增 generation_，迟到的定时器直接忽略。
+ */
+class Session : public std::enable_shared_from_this<Session> {
+public:
+    Session(Server& server, const char* transport);
+    virtual ~Session();
+
+    const std::string& id() const { return session_id_; }
+    bool closed() const { return closed_; }
+
+    void OnHello(const cJSON* hello);
+    void OnJson(std::string_view text);
+    // 一个上行音频包中的所有帧
+    void OnAudio(const std::vector<std::pair<uint32_t, std::string_view>>& frames);
+    virtual void Close();
+
+    template <typename Fields>
+    void Log(std::string_view event, Fields&& fields);
+    void Log(std::string_view event) { Log(event, [](JsonWriter&) {}); }
+
+protected:
+    Server& server_;
+    const Config& config_;
+    bool device_multi_frame_ = false;
+
+    virtual void SendJson(std::string_view json) = 0;
+    virtual void SendAudio(const std::string* frames, size_t count, uint32_t timestamp) = 0;
+    // 协商传输相关的参数，并向 hello 回复中追加字段
+    virtual void Negotiate(const cJSON* hello, JsonWriter& reply) = 0;
+
+private:
+    std::string session_id_;
+    const char* transport_;
+    bool closed_ = false;
+    bool listening_ = false;
+    std::string mode_ = "manual";
+    std::vector<std::string> uplink_frames_;
+    int uplink_packets_ = 0;
+    int mcp_id_ = 0;
+    bool device_mcp_ = false;
+
+    // TTS 回放
+    bool responding_ = false;
+    int generation_ = 0;
+    uint64_t timer_ = 0;
+    std::vector<std::string> reply_frames_;
+    size_t next_frame_ = 0;
+    int64_t tts_start_us_ = 0;
+
+    void Send(std::string_view json, std::string_view type, std::string_view state = {});
+    void SendMcp(const char* method, const char* params);
+    void Later(double seconds, void (Session::*step)());
+    void StartListening(const std::string& mode);
+    void StopListening();
+    void AbortSpeaking(bool send_stop);
+    void SendRecognition();
+    void StartTts();
+    void SendTtsChunk();
+};
+
+class MqttSession;
+
+class Server {
+public:
+    Server(EventLoop& loop, const Config& config, EventLog& events, Impairment& impairment)
+        : loop_(loop), config_(config), events_(events), impairment_(impairment) {}
+    ~Server();
+
+    bool Start(const Options& options);
+    void PrintSummary() const;
+
+    EventLoop& loop() { return loop_; }
+    const Config& config() const { return config_; }
+    EventLog& events() { return events_; }
+    Impairment& impairment() { return impairment_; }
+    Datagram* udp() { return udp_.get(); }
+
+    // 按当前的网络损伤设置发送一个音频包，丢弃或延迟发送
+    void Impair(std::function<void()> send);
+    void AddUdpSession(uint32_t ssrc, std::weak_ptr<MqttSession> session) { udp_sessions_[ssrc] = std::move(session); }
+    void RemoveUdpSession(uint32_t ssrc) { udp_sessions_.erase(ssrc); }
+    // 连接对象可能正处于自己的回调中，推迟到下一轮事件循环再释放
+    void Release(uint64_t id);
+    void OnTlsHandshake(const Stream& stream, const char* transport);
+
+private:
+    // 所有连接对象的公共基类，只用于统一持有
+    struct Connection {
+        virtual ~Connection() = default;
+    };
+    class WebsocketConnection;
+    class MqttConnection;
+    class OtaConnection;
+    class ControlConnection;
+
+    EventLoop& loop_;
+    const Config& config_;
+    EventLog& events_;
+    Impairment& impairment_;
+    SSL_CTX* tls_ = nullptr;
+    std::vector<std::unique_ptr<Listener>> listeners_;
+    std::unique_ptr<Datagram> udp_;
+    std::map<uint32_t, std::weak_ptr<MqttSession>> udp_sessions_;
+    std::map<uint64_t, std::shared_ptr<Connection>> connections_;
+    uint64_t next_connection_id_ = 1;
+    int tls_full_ = 0;
+    int tls_resumed_ = 0;
+
+    bool Listen(const std::string& host, int port, bool secure, const char* name, std::function<std::shared_ptr<Connection>(uint64_t id, std::shared_ptr<Stream>)> create);
+    void OnDatagram(const uint8_t* data, size_t size, const sockaddr_in& from);
+};
+
+Session::Session(Server& server, const char* transport)
+    : server_(server), config_(server.config()), session_id_(RandomUuid()), transport_(transport) {}
+
+Session::~Session() {
+    if (timer_ != 0) {
+        server_.loop().Cancel(timer_);
+    }
+}
+
+template <typename Fields>
+void Session::Log(std::string_view event, Fields&& fields) {
+    server_.events().Write(session_id_, event, std::forward<Fields>(fields));
+}
+
+void Session::Send(std::string_view json, std::string_view type, std::string_view state) {
+    std::string event = "tx_" + std::string(type);
+    Log(event, [state](JsonWriter& writer) {
+        if (!state.empty()) {
+            writer.Field("state", state);
+        }
+    });
+    SendJson(json);
+}
+
+void Session::OnHello(const cJSON* hello) {
+    auto version = cJSON_GetObjectItem(hello, "version");
+    Log("rx_hello", [this, version](JsonWriter& writer) {
+        writer.Field("transport", transport_);
+        if (cJSON_IsNumber(version)) {
+            writer.Field("version", version->valueint);
+        }
+    });
+    auto resume = JsonString(hello, "resume_session_id");
+    if (!resume.empty() && config_.resume) {
+        session_id_ = resume;
+    }
+    auto features = cJSON_GetObjectItem(hello, "features");
+    device_mcp_ = JsonBool(features, "mcp");
+    device_multi_frame_ = JsonBool(features, "multi_frame");
+
+    StaticJsonWriter<CONTROL_MESSAGE_BUFFER_SIZE> writer;
+    writer.BeginObject()
+        .Field("type", "hello")
+        .Field("transport", transport_)
+        .Field("session_id", session_id_)
+        .Key("features").BeginObject()
+            .Field("ping", true)
+        .EndObject()
+        .Key("audio_params").BeginObject()
+            .Field("format", "opus")
+            .Field("sample_rate", config_.sample_rate)
+            .Field("channels", 1)
+            .Field("frame_duration", BENCH_FRAME_DURATION_MS)
+        .EndObject();
+    Negotiate(hello, writer);
+    writer.EndObject();
+    Send(writer.view(), "hello");
+
+    if (config_.mcp && device_mcp_) {
+        SendMcp("initialize", "{\"protocolVersion\":\"2024-11-05\",\"capabilities\":{},"
+            "\"clientInfo\":{\"name\":\"stand-in\",\"version\":\"1.0\"}}");
+        SendMcp("tools/list", "{}");
+    }
+}
+
+void Session::SendMcp(const char* method, const char* params) {
+    int id = ++mcp_id_;
+    Log("tx_mcp", [method, id](JsonWriter& writer) {
+        writer.Field("method", method).Field("id", id);
+    });
+    StaticJsonWriter<CONTROL_MESSAGE_BUFFER_SIZE> writer;
+    writer.BeginObject()
+        .Field("session_id", session_id_)
+        .Field("type", "mcp")
+        .Key("payload").BeginObject()
+            .Field("jsonrpc", "2.0")
+            .Field("id", id)
+            .Field("method", method)
+            .RawField("params", params)
+        .EndObject()
+        .EndObject();
+    SendJson(writer.view());
+}
+
+void Session::OnJson(std::string_view text) {
+    ControlMessage message;
+    if (!ParseControlMessage(text.data(), text.size(), message)) {
+        return;
+    }
+    std::string type = message.type.str();
+    std::string state = message.state.str();
+    Log("rx_" + type, [&state](JsonWriter& writer) {
+        if (!state.empty()) {
+            writer.Field("state", state);
+        }
+    });
+
+    if (type == "listen") {
+        if (state == "start") {
+            auto root = cJSON_ParseWithLength(text.data(), text.size());
+            auto mode = JsonString(root, "mode");
+            cJSON_Delete(root);
+            StartListening(mode.empty() ? "manual" : mode);
+        } else if (state == "stop") {
+            StopListening();
+        } else if (state == "detect") {
+            auto wake_word = message.text.str();
+            Log("wake_word", [&wake_word](JsonWriter& writer) {
+                writer.Field("text", wake_word);
+            });
+        }
+    } else if (type == "abort") {
+        AbortSpeaking(true);
+    } else if (type == "ping") {
+        StaticJsonWriter<CONTROL_MESSAGE_BUFFER_SIZE> writer;
+        writer.BeginObject().Field("type", "pong");
+        if (message.id.present) {
+            writer.Field("id", message.id.str());
+        }
+        writer.EndObject();
+        Send(writer.view(), "pong");
+    } else if (type == "mcp") {
+        auto root = cJSON_ParseWithLength(text.data(), text.size());
+        auto result = cJSON_GetObjectItem(cJSON_GetObjectItem(root, "payload"), "result");
+        auto tools = cJSON_GetObjectItem(result, "tools");
+        if (cJSON_IsArray(tools)) {
+            LogInfo("[%.8s] device exposes %d MCP tools", session_id_.c_str(), cJSON_GetArraySize(tools));
+        }
+        cJSON_Delete(root);
+    } else if (type == "goodbye") {
+        Close();
+    }
+}
+
+void Session::OnAudio(const std::vector<std::pair<uint32_t, std::string_view>>& frames) {
+    uplink_packets_++;
+    for (auto& [timestamp, frame] : frames) {
+        Log("rx_audio", [timestamp = timestamp, size = (int)frame.size()](JsonWriter& writer) {
+            writer.RawField("ts", std::to_string(timestamp)).Field("size", size);
+        });
+        if (listening_) {
+            uplink_frames_.emplace_back(frame);
+        }
+    }
+    // 自动模式下按固定时长模拟服务器端的断句
+    if (listening_ && mode_ == "auto" &&
+        uplink_frames_.size() * BENCH_FRAME_DURATION_MS >= config_.auto_utterance * 1000) {
+        StopListening();
+    }
+}
+
+void Session::StartListening(const std::string& mode) {
+    AbortSpeaking(false);
+    listening_ = true;
+    mode_ = mode;
+    uplink_frames_.clear();
+}
+
+void Session::StopListening() {
+    if (!listening_) {
+        return;
+    }
+    listening_ = false;
+    reply_frames_ = std::move(uplink_frames_);
+    uplink_frames_.clear();
+    responding_ = true;
+    Later(config_.stt_delay, &Session::SendRecognition);
+}
+
+void Session::AbortSpeaking(bool send_stop) {
+    if (!responding_) {
+        return;
+    }
+    responding_ = false;
+    generation_++;
+    if (timer_ != 0) {
+        server_.loop().Cancel(timer_);
+        timer_ = 0;
+    }
+    if (send_stop) {
+        StaticJsonWriter<CONTROL_MESSAGE_BUFFER_SIZE> writer;
+        writer.BeginObject().Field("type", "tts").Field("state", "stop").EndObject();
+        Send(writer.view(), "tts", "stop");
+    }
+}
+
+void Session::Later(double seconds, void (Session::*step)()) {
+    std::weak_ptr<Session> weak = shared_from_this();
+    int generation = generation_;
+    timer_ = server_.loop().CallLater((int64_t)(std::max(seconds, 0.0) * 1000000), [weak, generation, step]() {
+        auto self = weak.lock();
+        if (self == nullptr || generation != self->generation_) {
+            return;
+        }
+        self->timer_ = 0;
+        ((*self).*step)();
+    });
+}
+
+// 按脚本时序回应：stt -> llm -> tts start -> 回放上行音频 -> tts stop
+void Session::SendRecognition() {
+    char text[64];
+    snprintf(text, sizeof(text), "收到 %zu 帧音频", reply_frames_.size());
+    StaticJsonWriter<CONTROL_MESSAGE_BUFFER_SIZE> stt;
+    stt.BeginObject().Field("session_id", session_id_).Field("type", "stt").Field("text", text).EndObject();
+    Send(stt.view(), "stt");
+    StaticJsonWriter<CONTROL_MESSAGE_BUFFER_SIZE> llm;
+    llm.BeginObject().Field("session_id", session_id_).Field("type", "llm")
+        .Field("emotion", "happy").Field("text", "😀").EndObject();
+    Send(llm.view(), "llm");
+    Later(config_.tts_delay, &Session::StartTts);
+}
+
+void Session::StartTts() {
+    if (reply_frames_.empty()) {
+        int count = (int)(config_.tts_duration * 1000 / BENCH_FRAME_DURATION_MS);
+        reply_frames_.assign(count, std::string(BENCH_SILENCE_FRAME));
+    }
+    StaticJsonWriter<CONTROL_MESSAGE_BUFFER_SIZE> start;
+    start.BeginObject().Field("session_id", session_id_).Field("type", "tts").Field("state", "start").EndObject();
+    Send(start.view(), "tts", "start");
+    StaticJsonWriter<CONTROL_MESSAGE_BUFFER_SIZE> sentence;
+    sentence.BeginObject().Field("session_id", session_id_).Field("type", "tts")
+        .Field("state", "sentence_start").Field("text", "回放").EndObject();
+    Send(sentence.view(), "tts", "sentence_start");
+    tts_start_us_ = EventLoop::NowUs();
+    next_frame_ = 0;
+    SendTtsChunk();
+}
+
+void Session::SendTtsChunk() {
+    size_t step = std::max(1, config_.aggregate);
+    size_t count = std::min(step, reply_frames_.size() - next_frame_);
+    if (count > 0) {
+        int index = (int)next_frame_;
+        Log("tx_audio", [index, count](JsonWriter& writer) {
+            writer.Field("index", index).Field("frames", (int)count);
+        });
+        SendAudio(&reply_frames_[next_frame_], count, next_frame_ * BENCH_FRAME_DURATION_MS);
+        next_frame_ += count;
+    }
+    if (next_frame_ < reply_frames_.size()) {
+        // 服务器比实时稍快地下发，与真实 TTS 的预缓冲行为一致
+        int64_t due = tts_start_us_ + (int64_t)(next_frame_ * BENCH_FRAME_DURATION_MS * 1000 / config_.tts_speed);
+        Later((due - EventLoop::NowUs()) / 1e6, &Session::SendTtsChunk);
+        return;
+    }
+    responding_ = false;
+    reply_frames_.clear();
+    StaticJsonWriter<CONTROL_MESSAGE_BUFFER_SIZE> stop;
+    stop.BeginObject().Field("session_id", session_id_).Field("type", "tts").Field("state", "stop").EndObject();
+    Send(stop.view(), "tts", "stop");
+}
+
+void Session::Close() {
+    if (closed_) {
+        return;
+    }
+    closed_ = true;
+    AbortSpeaking(false);
+    listening_ = false;
+    int packets = uplink_packets_;
+    Log("closed", [packets](JsonWriter& writer) {
+        writer.Field("uplink_packets", packets);
+    });
+}
+
+class WebsocketSession : public Session {
+public:
+    WebsocketSession(Server& server, WebSocketServerConnection* websocket, int version)
+        : Session(server, "websocket"), websocket_(websocket), version_(version) {}
+
+    int version() const { return version_; }
+
+    void Close() override {
+        Session::Close();
+        websocket_ = nullptr;
+    }
+
+protected:
+    void SendJson(std::string_view json) override {
+        if (websocket_ != nullptr) {
+            websocket_->SendText(json);
+        }
+    }
+
+    void SendAudio(const std::string* frames, size_t count, uint32_t timestamp) override {
+        std::weak_ptr<Session> weak = shared_from_this();
+        for (auto& packet : PackWebsocketAudio(version_, frames, count, timestamp)) {
+            server_.Impair([weak, packet = std::move(packet)]() {
+                auto self = std::static_pointer_cast<WebsocketSession>(weak.lock());
+                if (self != nullptr && self->websocket_ != nullptr) {
+                    self->websocket_->SendBinary(packet);
+                }
+            });
+        }
+    }
+
+    // 设备请求 v4 时确认，--no-v4 时回退到 v3，其他版本沿用连接头部中的版本
+    void Negotiate(const cJSON* hello, JsonWriter& reply) override {
+        auto version = cJSON_GetObjectItem(hello, "version");
+        int device_version = cJSON_IsNumber(version) ? version->valueint : version_;
+        if (device_version == 4) {
+            version_ = config_.no_v4 ? 3 : 4;
+        }
+        reply.Field("version", version_);
+    }
+
+private:
+    WebSocketServerConnection* websocket_;
+    int version_;
+};
+
+class MqttSession : public Session {
+public:
+    using PublishCallback = std::function<void(std::string_view text)>;
+
+    MqttSession(Server& server, PublishCallback publish)
+        : Session(server, "udp"), publish_(std::move(publish)), ssrc_bytes_(RandomBytes(4)),
+          cipher_(RandomBytes(16), std::string("\x01\x00\x00\x00", 4) + ssrc_bytes_ + std::string(8, '\0')) {
+        uint32_t ssrc;
+        memcpy(&ssrc, ssrc_bytes_.data(), sizeof(ssrc));
+        ssrc_ = ntohl(ssrc);
+    }
+
+    uint32_t ssrc() const { return ssrc_; }
+
+    void OnDatagram(const uint8_t* data, size_t size, const sockaddr_in& from) {
+        udp_address_ = from;
+        has_udp_address_ = true;
+        UdpPacket packet;
+        if (!cipher_.Open(data, size, packet)) {
+            return;
+        }
+        uint32_t sequence = packet.sequence;
+        uint32_t expected = remote_sequence_ + 1;
+        if (sequence <= remote_sequence_) {
+            Log("rx_audio_old", [sequence](JsonWriter& writer) {
+                writer.RawField("seq", std::to_string(sequence));
+            });
+            return;
+        }
+        if (sequence != expected) {
+            Log("rx_audio_gap", [sequence, expected](JsonWriter& writer) {
+                writer.RawField("seq", std::to_string(sequence)).RawField("expected", std::to_string(expected));
+            });
+        }
+        remote_sequence_ = sequence;
+        std::vector<std::pair<uint32_t, std::string_view>> frames;
+        if (packet.type == UDP_PACKET_TYPE_AGGREGATED) {
+            UnpackFrames(packet.payload, packet.flags, packet.timestamp, [&frames](uint32_t timestamp, std::string_view opus) {
+                frames.emplace_back(timestamp, opus);
+            });
+        } else {
+            frames.emplace_back(packet.timestamp, packet.payload);
+        }
+        OnAudio(frames);
+    }
+
+    void Close() override {
+        if (closed()) {
+            return;
+        }
+        Session::Close();
+        publish_ = nullptr;
+        server_.RemoveUdpSession(ssrc_);
+    }
+
+protected:
+    void SendJson(std::string_view json) override {
+        if (publish_) {
+            publish_(json);
+        }
+    }
+
+    void SendAudio(const std::string* frames, size_t count, uint32_t timestamp) override {
+        if (!has_udp_address_) {
+            return;
+        }
+        std::vector<std::string> packets;
+        if (multi_frame_ && count > 1) {
+            packets.push_back(cipher_.Seal(UDP_PACKET_TYPE_AGGREGATED, count, timestamp, ++local_sequence_,
+                PackFrames(frames, count)));
+        } else {
+            for (size_t i = 0; i < count; i++) {
+                packets.push_back(cipher_.Seal(UDP_PACKET_TYPE_OPUS, 0, timestamp + i * BENCH_FRAME_DURATION_MS,
+                    ++local_sequence_, frames[i]));
+            }
+        }
+        Server& server = server_;
+        sockaddr_in address = udp_address_;
+        for (auto& packet : packets) {
+            server_.Impair([&server, address, packet = std::move(packet)]() {
+                server.udp()->SendTo(packet, address);
+            });
+        }
+    }
+
+    void Negotiate(const cJSON*, JsonWriter& reply) override {
+        multi_frame_ = device_multi_frame_ && !config_.no_multi_frame;
+        reply.Key("udp").BeginObject()
+            .Field("server", config_.public_host)
+            .Field("port", config_.udp_port)
+            .Field("key", HexEncode(cipher_.key()))
+            .Field("nonce", HexEncode(cipher_.nonce()))
+            .Field("encryption", "aes-128-ctr");
+        if (multi_frame_) {
+            reply.Field("multi_frame", true);
+        }
+        reply.EndObject();
+    }
+
+private:
+    PublishCallback publish_;
+    std::string ssrc_bytes_;
+    uint32_t ssrc_ = 0;
+    UdpCipher cipher_;
+    bool multi_frame_ = false;
+    bool has_udp_address_ = false;
+    sockaddr_in udp_address_ = {};
+    uint32_t local_sequence_ = 0;
+    uint32_t remote_sequence_ = 0;
+};
+
+class Server::WebsocketConnection : public Server::Connection {
+public:
+    WebsocketConnection(Server& server, uint64_t id, std::shared_ptr<Stream> stream)
+        : server_(server), id_(id), websocket_(stream) {
+        stream->OnConnected([this, stream = stream.get()]() {
+            if (stream->tls()) {
+                server_.OnTlsHandshake(*stream, "websocket");
+            }
+        });
+        websocket_.OnUpgrade([this](std::string_view headers) {
+            auto version = FindHttpHeader(headers, "Protocol-Version");
+            version_ = version.empty() ? 1 : atoi(std::string(version).c_str());
+            auto device_id = std::string(FindHttpHeader(headers, "Device-Id"));
+            LogInfo("WebSocket connected: device=%s version=%d%s", device_id.c_str(), version_,
+                websocket_.stream()->tls() ? " (tls)" : "");
+            return true;
+        });
+        websocket_.OnText([this](std::string_view text) {
+            OnText(text);
+        });
+        websocket_.OnBinary([this](std::string_view data) {
+            OnBinary(data);
+        });
+        websocket_.OnClosed([this](const std::string& reason) {
+            LogDebug("WebSocket closed: %s", reason.c_str());
+            if (session_ != nullptr) {
+                session_->Close();
+            }
+            server_.Release(id_);
+        });
+    }
+
+    ~WebsocketConnection() {
+        if (session_ != nullptr) {
+            session_->Close();
+        }
+    }
+
+private:
+    Server& server_;
+    uint64_t id_;
+    WebSocketServerConnection websocket_;
+    int version_ = 1;
+    std::shared_ptr<WebsocketSession> session_;
+
+    void OnText(std::string_view text) {
+        ControlMessage message;
+        if (!ParseControlMessage(text.data(), text.size(), message)) {
+            return;
+        }
+        if (message.type != "hello") {
+            if (session_ != nullptr) {
+                session_->OnJson(text);
+            }
+            return;
+        }
+        if (session_ != nullptr) {
+            session_->Close();
+        }
+        session_ = std::make_shared<WebsocketSession>(server_, &websocket_, version_);
+        auto root = cJSON_ParseWithLength(text.data(), text.size());
+        session_->OnHello(root);
+        cJSON_Delete(root);
+    }
+
+    void OnBinary(std::string_view data) {
+        if (session_ == nullptr) {
+            return;
+        }
+        // 上行丢包只模拟丢弃，抖动和乱序作用在下行
+        if (server_.impairment().DelayUs() < 0) {
+            session_->Log("rx_audio_dropped");
+            return;
+        }
+        std::vector<std::pair<uint32_t, std::string_view>> frames;
+        if (UnpackWebsocketAudio(session_->version(), data, [&frames](uint32_t timestamp, std::string_view opus) {
+            frames.emplace_back(timestamp, opus);
+        })) {
+            session_->OnAudio(frames);
+        }
+    }
+};
+
+/*
+ * 内置 broker 的一条设备连接，设备发布的消息都视为控制消息，
+ * 下行消息发布到 devices/p2p/<client_id>，不需要设备显式订阅
+ */
+class Server::MqttConnection : public Server::Connection {
+public:
+    MqttConnection(Server& server, uint64_t id, std::shared_ptr<Stream> stream)
+        : server_(server), id_(id), stream_(std::move(stream)) {
+        stream_->OnConnected([this]() {
+            if (stream_->tls()) {
+                server_.OnTlsHandshake(*stream_, "mqtt");
+            }
+        });
+        stream_->OnData([this](const uint8_t* data, size_t size) {
+            if (!codec_.Feed(data, size, [this](MqttCodec::PacketType type, uint8_t flags, std::string_view body) {
+                OnPacket(type, flags, body);
+            })) {
+                Close("invalid mqtt packet");
+            }
+        });
+        stream_->OnClosed([this](const std::string& reason) {
+            Close(reason);
+        });
+    }
+
+    ~MqttConnection() {
+        if (session_ != nullptr) {
+            session_->Close();
+        }
+    }
+
+private:
+    Server& server_;
+    uint64_t id_;
+    std::shared_ptr<Stream> stream_;
+    MqttCodec codec_;
+    std::string client_id_;
+    bool connected_ = false;
+    bool closed_ = false;
+    std::shared_ptr<MqttSession> session_;
+
+    void OnPacket(MqttCodec::PacketType type, uint8_t flags, std::string_view body) {
+        if (closed_) {
+            return;
+        }
+        if (!connected_) {
+            if (type != MqttCodec::kConnect || !MqttCodec::ParseConnect(body, client_id_)) {
+                Close("expected CONNECT");
+                return;
+            }
+            connected_ = true;
+            stream_->Write(MqttCodec::Packet(MqttCodec::kConnAck, std::string_view("\x00\x00", 2)));
+            LogInfo("MQTT client connected: %s from %s%s", client_id_.c_str(), stream_->peer().c_str(),
+                stream_->tls() ? " (tls)" : "");
+            return;
+        }
+        switch (type) {
+        case MqttCodec::kPublish: {
+            std::string_view topic, payload;
+            if (MqttCodec::ParsePublish(flags, body, topic, payload)) {
+                OnMessage(payload);
+            }
+            break;
+        }
+        case MqttCodec::kSubscribe:
+            if (body.size() >= 2) {
+                stream_->Write(MqttCodec::Packet(MqttCodec::kSubAck, std::string(body.substr(0, 2)) + '\0'));
+            }
+            break;
+        case MqttCodec::kPingReq:
+            stream_->Write(MqttCodec::Packet(MqttCodec::kPingResp));
+            break;
+        case MqttCodec::kDisconnect:
+            Close("disconnect");
+            break;
+        default:
+            break;
+        }
+    }
+
+    void OnMessage(std::string_view payload) {
+        ControlMessage message;
+        if (!ParseControlMessage(payload.data(), payload.size(), message)) {
+            return;
+        }
+        if (message.type != "hello") {
+            if (session_ != nullptr) {
+                session_->OnJson(payload);
+            }
+            return;
+        }
+        if (session_ != nullptr) {
+            session_->Close();
+        }
+        std::string topic = "devices/p2p/" + client_id_;
+        auto stream = stream_;
+        session_ = std::make_shared<MqttSession>(server_, [stream, topic](std::string_view text) {
+            stream->Write(MqttCodec::Publish(topic, text));
+        });
+        server_.AddUdpSession(session_->ssrc(), session_);
+        auto root = cJSON_ParseWithLength(payload.data(), payload.size());
+        session_->OnHello(root);
+        cJSON_Delete(root);
+    }
+
+    void Close(const std::string& reason) {
+        if (closed_) {
+            return;
+        }
+        closed_ = true;
+        if (session_ != nullptr) {
+            session_->Close();
+        }
+        stream_->Close();
+        LogInfo("MQTT client disconnected: %s (%s)", client_id_.c_str(), reason.c_str());
+        server_.Release(id_);
+    }
+};
+
+/*
+ * 极简 HTTP：不区分路径和方法，一律返回协议配置
+ */
+class Server::OtaConnection : public Server::Connection {
+public:
+    OtaConnection(Server& server, uint64_t id, std::shared_ptr<Stream> stream)
+        : server_(server), id_(id), stream_(std::move(stream)) {
+        stream_->OnData([this](const uint8_t* data, size_t size) {
+            OnData(data, size);
+        });
+        stream_->OnClosed([this](const std::string&) {
+            server_.Release(id_);
+        });
+    }
+
+private:
+    Server& server_;
+    uint64_t id_;
+    std::shared_ptr<Stream> stream_;
+    std::string request_;
+    bool replied_ = false;
+
+    void OnData(const uint8_t* data, size_t size) {
+        if (replied_) {
+            return;
+        }
+        request_.append(reinterpret_cast<const char*>(data), size);
+        size_t end = request_.find("\r\n\r\n");
+        if (end == std::string::npos || request_.size() > OTA_MAX_REQUEST_SIZE) {
+            if (request_.size() > OTA_MAX_REQUEST_SIZE) {
+                stream_->Close();
+                server_.Release(id_);
+            }
+            return;
+        }
+        std::string_view headers(request_.data(), end + 2);
+        auto length = FindHttpHeader(headers, "Content-Length");
+        if (request_.size() < end + 4 + atoi(std::string(length).c_str())) {
+            return;
+        }
+        auto device_id = std::string(FindHttpHeader(headers, "Device-Id"));
+        if (device_id.empty()) {
+            device_id = "unknown";
+        }
+        Reply(device_id);
+    }
+
+    void Reply(const std::string& device_id) {
+        auto& config = server_.config();
+        std::string host = config.public_host;
+        std::string client_id = "GID_test@@@" + device_id;
+        for (auto& c : client_id) {
+            if (c == ':') {
+                c = '_';
+            }
+        }
+        char timestamp[32];
+        snprintf(timestamp, sizeof(timestamp), "%.0f", WallClockMs());
+
+        StaticJsonWriter<1024> writer;
+        writer.BeginObject()
+            .Key("server_time").BeginObject()
+                .RawField("timestamp", timestamp)
+                .Field("timezone_offset", config.timezone_offset)
+            .EndObject()
+            .Key("firmware").BeginObject()
+                .Field("version", "0.0.0")
+                .Field("url", "")
+            .EndObject();
+        if (config.ota_transport == "mqtt") {
+            int port = config.ota_tls ? config.mqtts_port : config.mqtt_port;
+            writer.Key("mqtt").BeginObject()
+                .Field("endpoint", host + ":" + std::to_string(port))
+                .Field("client_id", client_id)
+                .Field("username", "test")
+                .Field("password", "test")
+                .Field("publish_topic", "device-server")
+            .EndObject();
+        } else {
+            std::string url = config.ota_tls
+                ? "wss://" + host + ":" + std::to_string(config.wss_port) + "/xiaozhi/v1/"
+                : "ws://" + host + ":" + std::to_string(config.ws_port) + "/xiaozhi/v1/";
+            writer.Key("websocket").BeginObject()
+                .Field("url", url)
+                .Field("token", "test-token")
+                .Field("version", config.ota_version)
+            .EndObject();
+        }
+        writer.EndObject();
+
+        std::string body(writer.view());
+        stream_->Write("HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: "
+            + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body);
+        replied_ = true;
+        LogInfo("OTA request from %s -> %s", device_id.c_str(), config.ota_transport.c_str());
+        // 响应很短，通常一次就能发完；没发完时等设备读完后关闭
+        if (stream_->pending_bytes() == 0) {
+            stream_->Close();
+            server_.Release(id_);
+        }
+    }
+};
+
+/*
+ * 控制端口，每行一条命令：loss 0.1 / jitter 80 / reorder 0.05 / show
+ */
+class Server::ControlConnection : public Server::Connection {
+public:
+    ControlConnection(Server& server, uint64_t id, std::shared_ptr<Stream> stream)
+        : server_(server), id_(id), stream_(std::move(stream)) {
+        stream_->OnData([this](const uint8_t* data, size_t size) {
+            buffer_.append(reinterpret_cast<const char*>(data), size);
+            size_t end;
+            while ((end = buffer_.find('\n')) != std::string::npos) {
+                std::string line = buffer_.substr(0, end);
+                buffer_.erase(0, end + 1);
+                OnLine(line);
+            }
+        });
+        stream_->OnClosed([this](const std::string&) {
+            server_.Release(id_);
+        });
+    }
+
+private:
+    Server& server_;
+    uint64_t id_;
+    std::shared_ptr<Stream> stream_;
+    std::string buffer_;
+
+    void OnLine(const std::string& line) {
+        char command[16] = {};
+        double value = 0;
+        int fields = sscanf(line.c_str(), "%15s %lf", command, &value);
+        auto& impairment = server_.impairment();
+        std::string name = fields >= 1 ? command : "";
+        if (fields == 2 && (name == "loss" || name == "jitter" || name == "reorder")) {
+            if (name == "loss") {
+                impairment.loss = value;
+            } else if (name == "jitter") {
+                impairment.jitter_ms = value;
+            } else {
+                impairment.reorder = value;
+            }
+            server_.events().Write("", "impairment", [&impairment](JsonWriter& writer) {
+                writer.RawField("loss", FormatDouble(impairment.loss))
+                    .RawField("jitter_ms", FormatDouble(impairment.jitter_ms))
+                    .RawField("reorder", FormatDouble(impairment.reorder));
+            });
+            LogInfo("Impairment changed: %s", impairment.Describe().c_str());
+        } else if (!name.empty() && name != "show") {
+            stream_->Write("usage: loss <0~1> | jitter <ms> | reorder <0~1> | show\n");
+            return;
+        }
+        stream_->Write(impairment.Describe() + "\n");
+    }
+};
+
+Server::~Server() {
+    // 连接析构时会关闭会话，会话又会访问 udp_sessions_，先释放连接
+    connections_.clear();
+    listeners_.clear();
+    if (tls_ != nullptr) {
+        SSL_CTX_free(tls_);
+    }
+}
+
+void Server::Release(uint64_t id) {
+    auto it = connections_.find(id);
+    if (it == connections_.end()) {
+        return;
+    }
+    loop_.CallLater(0, [connection = std::move(it->second)]() {});
+    connections_.erase(it);
+}
+
+void Server::Impair(std::function<void()> send) {
+    int64_t delay = impairment_.DelayUs();
+    if (delay < 0) {
+        return;
+    }
+    if (delay == 0) {
+        send();
+    } else {
+        loop_.CallLater(delay, std::move(send));
+    }
+}
+
+void Server::OnTlsHandshake(const Stream& stream, const char* transport) {
+    bool resumed = stream.tls_resumed();
+    double handshake_ms = stream.handshake_us() / 1000.0;
+    (resumed ? tls_resumed_ : tls_full_)++;
+    events_.Write("", "tls_handshake", [&](JsonWriter& writer) {
+        writer.Field("transport", transport)
+            .Field("peer", stream.peer())
+            .Field("resumed", resumed)
+            .RawField("handshake_ms", FormatDouble(handshake_ms));
+    });
+    LogDebug("TLS handshake from %s: %s, %.1f ms", stream.peer().c_str(), resumed ? "resumed" : "full", handshake_ms);
+}
+
+bool Server::Listen(const std::string& host, int port, bool secure, const char* name,
+    std::function<std::shared_ptr<Connection>(uint64_t id, std::shared_ptr<Stream>)> create) {
+    if (port <= 0) {
+        return true;
+    }
+    auto listener = Listener::Listen(loop_, host, port, secure ? tls_ : nullptr,
+        [this, create = std::move(create)](std::shared_ptr<Stream> stream) {
+            uint64_t id = next_connection_id_++;
+            connections_[id] = create(id, std::move(stream));
+        });
+    if (listener == nullptr) {
+        fprintf(stderr, "无法监听 %s:%d (%s): %s\n", host.c_str(), port, name, strerror(errno));
+        return false;
+    }
+    listeners_.push_back(std::move(listener));
+    LogInfo("%s listening on %s:%d%s", name, host.c_str(), port, secure ? " (tls)" : "");
+    return true;
+}
+
+bool Server::Start(const Options& options) {
+    if (config_.wss_port > 0 || config_.mqtts_port > 0) {
+        tls_ = CreateTlsServerContext(options.Get("tls-cert"), options.Get("tls-key"));
+        if (tls_ == nullptr) {
+            return false;
+        }
+    }
+    auto websocket = [this](uint64_t id, std::shared_ptr<Stream> stream) -> std::shared_ptr<Connection> {
+        return std::make_shared<WebsocketConnection>(*this, id, std::move(stream));
+    };
+    auto mqtt = [this](uint64_t id, std::shared_ptr<Stream> stream) -> std::shared_ptr<Connection> {
+        return std::make_shared<MqttConnection>(*this, id, std::move(stream));
+    };
+    auto ota = [this](uint64_t id, std::shared_ptr<Stream> stream) -> std::shared_ptr<Connection> {
+        return std::make_shared<OtaConnection>(*this, id, std::move(stream));
+    };
+    auto control = [this](uint64_t id, std::shared_ptr<Stream> stream) -> std::shared_ptr<Connection> {
+        return std::make_shared<ControlConnection>(*this, id, std::move(stream));
+    };
+    // 控制端口只监听本机
+    if (!Listen(config_.host, config_.ws_port, false, "WebSocket", websocket)
+        || !Listen(config_.host, config_.wss_port, true, "WebSocket", websocket)
+        || !Listen(config_.host, config_.mqtt_port, false, "MQTT", mqtt)
+        || !Listen(config_.host, config_.mqtts_port, true, "MQTT", mqtt)
+        || !Listen(config_.host, options.GetInt("ota-port"), false, "OTA", ota)
+        || !Listen("127.0.0.1", options.GetInt("control-port"), false, "Control", control)) {
+        return false;
+    }
+
+    udp_ = Datagram::Bind(loop_, config_.host, config_.udp_port);
+    if (udp_ == nullptr) {
+        fprintf(stderr, "无法绑定 UDP %s:%d: %s\n", config_.host.c_str(), config_.udp_port, strerror(errno));
+        return false;
+    }
+    udp_->OnMessage([this](const uint8_t* data, size_t size, const sockaddr_in& from) {
+        OnDatagram(data, size, from);
+    });
+    LogInfo("UDP listening on %s:%d", config_.host.c_str(), config_.udp_port);
+    LogInfo("Impairment: %s", impairment_.Describe().c_str());
+    return true;
+}
+
+void Server::OnDatagram(const uint8_t* data, size_t size, const sockaddr_in& from) {
+    if (size < UDP_PACKET_HEADER_SIZE) {
+        return;
+    }
+    uint32_t ssrc;
+    memcpy(&ssrc, data + 4, sizeof(ssrc));
+    auto it = udp_sessions_.find(ntohl(ssrc));
+    if (it == udp_sessions_.end()) {
+        return;
+    }
+    auto session = it->second.lock();
+    if (session == nullptr) {
+        udp_sessions_.erase(it);
+        return;
+    }
+    if (impairment_.DelayUs() < 0) {
+        // 上行丢包只模拟丢弃，抖动和乱序作用在下行
+        session->Log("rx_audio_dropped");
+        return;
+    }
+    session->OnDatagram(data, size, from);
+}
+
+void Server::PrintSummary() const {
+    LogInfo("TLS handshakes: full=%d resumed=%d", tls_full_, tls_resumed_);
+    LogInfo("Impairment: %s", impairment_.Describe().c_str());
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options("本地协议替身服务器");
+    options.Add("host", "0.0.0.0", "监听地址");
+    options.Add("public-host", "127.0.0.1", "下发给设备的服务器地址");
+    options.Add("ws-port", "8000", "WebSocket 端口，0 表示不启动");
+    options.Add("wss-port", "8443", "WebSocket over TLS 端口，0 表示不启动");
+    options.Add("mqtt-port", "1883", "MQTT 端口，0 表示不启动");
+    options.Add("mqtts-port", "8883", "MQTT over TLS 端口，0 表示不启动");
+    options.Add("udp-port", "8884", "UDP 音频端口");
+    options.Add("tls-cert", "", "TLS 证书链 (PEM)，不指定时生成临时自签名证书");
+    options.Add("tls-key", "", "TLS 私钥 (PEM)，不指定时从证书文件读取");
+    options.Add("ota-port", "8002", "0 表示不启动 OTA 服务");
+    options.Add("ota-transport", "websocket", "OTA 下发 websocket 或 mqtt 配置");
+    options.Add("ota-version", "3", "OTA 下发的 WebSocket 协议版本");
+    options.AddFlag("ota-tls", "OTA 下发 wss:// 地址或 MQTT TLS 端口");
+    options.Add("timezone-offset", "480", "OTA 下发的时区偏移分钟数");
+    options.Add("control-port", "8003", "0 表示不启动控制端口");
+    options.AddGroup("回应时序");
+    options.Add("stt-delay", "0.3", "listen stop 到 stt 的秒数");
+    options.Add("tts-delay", "0.2", "stt 到 tts start 的秒数");
+    options.Add("tts-speed", "1.0", "下发速度相对实时的倍数");
+    options.Add("tts-duration", "2.0", "没有上行音频时回放的静音秒数");
+    options.Add("auto-utterance", "3.0", "自动模式下多少秒音频后视为一句话结束");
+    options.Add("aggregate", "1", "下行每包帧数，v4 和 UDP multi_frame 时生效");
+    options.Add("sample-rate", "16000", "hello 中声明的下行采样率");
+    options.AddFlag("mcp", "hello 后向声明 mcp 的设备请求 tools/list");
+    options.AddFlag("no-resume", "不接受 resume_session_id");
+    options.AddFlag("no-v4", "不确认 WebSocket v4，设备应回退到 v3");
+    options.AddFlag("no-multi-frame", "不确认 UDP 多帧聚合");
+    options.AddGroup("网络损伤");
+    options.Add("loss", "0", "音频包丢失率 0~1");
+    options.Add("jitter", "0", "下行音频随机延迟上限毫秒");
+    options.Add("reorder", "0", "下行音频乱序比例 0~1");
+    options.Add("seed", "", "随机数种子，便于复现");
+    options.AddGroup("输出");
+    options.Add("log", "", "事件时间戳日志 (JSONL)");
+    options.AddFlag("verbose", "输出调试日志");
+    if (!options.Parse(argc, argv)) {
+        return 2;
+    }
+
+    Config config;
+    config.host = options.Get("host");
+    config.public_host = options.Get("public-host");
+    config.ws_port = options.GetInt("ws-port");
+    config.wss_port = options.GetInt("wss-port");
+    config.mqtt_port = options.GetInt("mqtt-port");
+    config.mqtts_port = options.GetInt("mqtts-port");
+    config.udp_port = options.GetInt("udp-port");
+    config.ota_transport = options.Get("ota-transport");
+    config.ota_version = options.GetInt("ota-version");
+    config.ota_tls = options.GetFlag("ota-tls");
+    config.timezone_offset = options.GetInt("timezone-offset");
+    config.stt_delay = options.GetDouble("stt-delay");
+    config.tts_delay = options.GetDouble("tts-delay");
+    config.tts_speed = options.GetDouble("tts-speed");
+    config.tts_duration = options.GetDouble("tts-duration");
+    config.auto_utterance = options.GetDouble("auto-utterance");
+    config.aggregate = options.GetInt("aggregate");
+    config.sample_rate = options.GetInt("sample-rate");
+    config.mcp = options.GetFlag("mcp");
+    config.resume = !options.GetFlag("no-resume");
+    config.no_v4 = options.GetFlag("no-v4");
+    config.no_multi_frame = options.GetFlag("no-multi-frame");
+    verbose = options.GetFlag("verbose");
+    if (config.ota_transport != "websocket" && config.ota_transport != "mqtt") {
+        fprintf(stderr, "--ota-transport 只能是 websocket 或 mqtt\n");
+        return 2;
+    }
+    if (config.ota_version < 1 || config.ota_version > 4) {
+        fprintf(stderr, "--ota-version 只能是 1~4\n");
+        return 2;
+    }
+    if (config.tts_speed <= 0) {
+        fprintf(stderr, "--tts-speed 必须大于 0\n");
+        return 2;
+    }
+
+    EventLog events(options.Get("log"));
+    if (!options.Get("log").empty() && !events.ok()) {
+        fprintf(stderr, "无法写入 %s\n", options.Get("log").c_str());
+        return 1;
+    }
+    Impairment impairment;
+    impairment.loss = options.GetDouble("loss");
+    impairment.jitter_ms = options.GetDouble("jitter");
+    impairment.reorder = options.GetDouble("reorder");
+    impairment.random.seed(options.Get("seed").empty() ? std::random_device()() : options.GetInt("seed"));
+
+    signal(SIGPIPE, SIG_IGN);
+    RaiseFdLimit();
+    EventLoop loop;
+    // SIGINT / SIGTERM 时退出事件循环，输出 TLS 握手统计
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigprocmask(SIG_BLOCK, &signals, nullptr);
+    int signal_fd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    loop.Add(signal_fd, EPOLLIN, [&loop, signal_fd](uint32_t) {
+        signalfd_siginfo info;
+        while (read(signal_fd, &info, sizeof(info)) == sizeof(info)) {
+        }
+        loop.Stop();
+    });
+
+    int result = 0;
+    {
+        Server server(loop, config, events, impairment);
+        if (server.Start(options)) {
+            loop.Run();
+            server.PrintSummary();
+        } else {
+            result = 1;
+        }
+    }
+    loop.Remove(signal_fd);
+    close(signal_fd);
+    return result;
+}
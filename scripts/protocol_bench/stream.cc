@@ -0,0 +1,527 @@
+#include "stream.h"
+
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#define STREAM_READ_BUFFER_SIZE 16384
+// 单次 SSL_write 的最大长度，与 TLS 记录大小一致
+#define STREAM_TLS_WRITE_CHUNK 16384
+// 服务器端会话缓存的条目数和会话有效期
+#define STREAM_TLS_SESSION_CACHE_SIZE 20000
+#define STREAM_TLS_SESSION_TIMEOUT_SECONDS 7200
+
+static void SetNonBlocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+static std::string TlsError(const char* what) {
+    std::string reason = what;
+    unsigned long error = ERR_get_error();
+    if (error != 0) {
+        char buffer[256];
+        ERR_error_string_n(error, buffer, sizeof(buffer));
+        reason += ": ";
+        reason += buffer;
+    }
+    ERR_clear_error();
+    return reason;
+}
+
+bool ResolveIpv4(const std::string& host, int port, sockaddr_in& address) {
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    if (inet_pton(AF_INET, host.c_str(), &address.sin_addr) == 1) {
+        return true;
+    }
+    addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), nullptr, &hints, &result) != 0 || result == nullptr) {
+        return false;
+    }
+    address.sin_addr = reinterpret_cast<sockaddr_in*>(result->ai_addr)->sin_addr;
+    freeaddrinfo(result);
+    return true;
+}
+
+SSL_CTX* CreateTlsClientContext(bool verify) {
+    SSL_CTX* ctx = SSL_CTX_new(TLS_client_method());
+    SSL_CTX_set_mode(ctx, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+    if (verify) {
+        SSL_CTX_set_default_verify_paths(ctx);
+        SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER, nullptr);
+    } else {
+        SSL_CTX_set_verify(ctx, SSL_VERIFY_NONE, nullptr);
+    }
+    return ctx;
+}
+
+std::string FormatAddress(const sockaddr_in& address) {
+    char ip[INET_ADDRSTRLEN] = {};
+    inet_ntop(AF_INET, &address.sin_addr, ip, sizeof(ip));
+    return std::string(ip) + ":" + std::to_string(ntohs(address.sin_port));
+}
+
+// 临时自签名证书，只用于本地测试，客户端需要关闭证书校验
+static bool UseSelfSignedCertificate(SSL_CTX* ctx) {
+    EVP_PKEY* key = EVP_EC_gen("P-256");
+    X509* cert = X509_new();
+    bool ok = key != nullptr && cert != nullptr;
+    if (ok) {
+        X509_set_version(cert, 2);
+        ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+        X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+        X509_gmtime_adj(X509_getm_notAfter(cert), 30L * 24 * 3600);
+        X509_set_pubkey(cert, key);
+        X509_NAME* name = X509_get_subject_name(cert);
+        X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+            reinterpret_cast<const unsigned char*>("xiaozhi-stand-in"), -1, -1, 0);
+        X509_set_issuer_name(cert, name);
+        ok = X509_sign(cert, key, EVP_sha256()) > 0
+            && SSL_CTX_use_certificate(ctx, cert) == 1
+            && SSL_CTX_use_PrivateKey(ctx, key) == 1;
+    }
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    return ok;
+}
+
+SSL_CTX* CreateTlsServerContext(const std::string& cert_file, const std::string& key_file) {
+    SSL_CTX* ctx = SSL_CTX_new(TLS_server_method());
+    SSL_CTX_set_mode(ctx, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+    bool ok;
+    if (cert_file.empty()) {
+        ok = UseSelfSignedCertificate(ctx);
+    } else {
+        ok = SSL_CTX_use_certificate_chain_file(ctx, cert_file.c_str()) == 1
+            && SSL_CTX_use_PrivateKey_file(ctx, (key_file.empty() ? cert_file : key_file).c_str(), SSL_FILETYPE_PEM) == 1
+            && SSL_CTX_check_private_key(ctx) == 1;
+    }
+    if (!ok) {
+        fprintf(stderr, "%s\n", TlsError("tls certificate").c_str());
+        SSL_CTX_free(ctx);
+        return nullptr;
+    }
+    // TLS 1.2 的会话 ID 和 TLS 1.3 的票据都可以恢复，票据密钥在进程内保持不变
+    static const unsigned char kSessionContext[] = "xiaozhi";
+    SSL_CTX_set_session_id_context(ctx, kSessionContext, sizeof(kSessionContext) - 1);
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+    SSL_CTX_sess_set_cache_size(ctx, STREAM_TLS_SESSION_CACHE_SIZE);
+    SSL_CTX_set_timeout(ctx, STREAM_TLS_SESSION_TIMEOUT_SECONDS);
+    return ctx;
+}
+
+std::shared_ptr<Stream> Stream::Connect(EventLoop& loop, const std::string& host, int port,
+    SSL_CTX* tls, SSL_SESSION* session) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    std::shared_ptr<Stream> stream(new Stream(loop, fd));
+    if (fd < 0) {
+        loop.CallLater(0, [stream]() { stream->Fail(std::string("socket: ") + strerror(errno)); });
+        return stream;
+    }
+    SetNonBlocking(fd);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    sockaddr_in address;
+    if (!ResolveIpv4(host, port, address)) {
+        loop.CallLater(0, [stream, host]() { stream->Fail("cannot resolve " + host); });
+        return stream;
+    }
+    stream->peer_ = FormatAddress(address);
+    if (tls != nullptr) {
+        stream->StartTls(tls, host, session);
+    }
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 && errno != EINPROGRESS) {
+        int error = errno;
+        loop.CallLater(0, [stream, error]() { stream->Fail(std::string("connect: ") + strerror(error)); });
+        return stream;
+    }
+    if (!stream->Watch()) {
+        loop.CallLater(0, [stream]() { stream->Fail("epoll"); });
+    }
+    return stream;
+}
+
+std::shared_ptr<Stream> Stream::Accept(EventLoop& loop, int fd, SSL_CTX* tls) {
+    std::shared_ptr<Stream> stream(new Stream(loop, fd));
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    sockaddr_in address;
+    socklen_t length = sizeof(address);
+    if (getpeername(fd, reinterpret_cast<sockaddr*>(&address), &length) == 0) {
+        stream->peer_ = FormatAddress(address);
+    }
+    if (tls != nullptr) {
+        stream->ssl_ = SSL_new(tls);
+        SSL_set_fd(stream->ssl_, fd);
+        SSL_set_accept_state(stream->ssl_);
+    }
+    // 已连接的套接字立即可写，和客户端一样从 OnTcpConnected 开始，调用方在此之前设置好回调
+    if (!stream->Watch()) {
+        loop.CallLater(0, [stream]() { stream->Fail("epoll"); });
+    }
+    return stream;
+}
+
+Stream::~Stream() {
+    Close();
+}
+
+bool Stream::Watch() {
+    auto self = shared_from_this();
+    // 连接建立前等待可写
+    return loop_.Add(fd_, EPOLLOUT, [self](uint32_t events) {
+        self->HandleEvents(events);
+    });
+}
+
+void Stream::StartTls(SSL_CTX* tls, const std::string& host, SSL_SESSION* session) {
+    ssl_ = SSL_new(tls);
+    SSL_set_fd(ssl_, fd_);
+    SSL_set_tlsext_host_name(ssl_, host.c_str());
+    if (SSL_CTX_get_verify_mode(tls) & SSL_VERIFY_PEER) {
+        SSL_set1_host(ssl_, host.c_str());
+    }
+    if (session != nullptr) {
+        SSL_set_session(ssl_, session);
+    }
+    SSL_set_connect_state(ssl_);
+}
+
+void Stream::HandleEvents(uint32_t events) {
+    switch (state_) {
+    case State::kConnecting:
+        OnTcpConnected();
+        break;
+    case State::kHandshaking:
+        DoHandshake();
+        break;
+    case State::kOpen:
+        if (events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+            ReadAll();
+        }
+        if (state_ == State::kOpen && (events & EPOLLOUT)) {
+            Flush();
+        }
+        break;
+    case State::kClosed:
+        break;
+    }
+}
+
+void Stream::OnTcpConnected() {
+    int error = 0;
+    socklen_t length = sizeof(error);
+    getsockopt(fd_, SOL_SOCKET, SO_ERROR, &error, &length);
+    if (error != 0) {
+        Fail(std::string("connect: ") + strerror(error));
+        return;
+    }
+    if (ssl_ == nullptr) {
+        SetOpen();
+        return;
+    }
+    state_ = State::kHandshaking;
+    handshake_start_us_ = EventLoop::NowUs();
+    DoHandshake();
+}
+
+void Stream::DoHandshake() {
+    int ret = SSL_do_handshake(ssl_);
+    if (ret == 1) {
+        handshake_us_ = EventLoop::NowUs() - handshake_start_us_;
+        tls_resumed_ = SSL_session_reused(ssl_);
+        SetOpen();
+        return;
+    }
+    int error = SSL_get_error(ssl_, ret);
+    if (error == SSL_ERROR_WANT_READ) {
+        loop_.Modify(fd_, EPOLLIN);
+    } else if (error == SSL_ERROR_WANT_WRITE) {
+        loop_.Modify(fd_, EPOLLOUT);
+    } else {
+        Fail(TlsError("tls handshake"));
+    }
+}
+
+void Stream::SetOpen() {
+    state_ = State::kOpen;
+    UpdateInterest();
+    auto self = shared_from_this();
+    if (on_connected_) {
+        on_connected_();
+    }
+    if (state_ == State::kOpen && pending_bytes() > 0) {
+        Flush();
+    }
+}
+
+void Stream::ReadAll() {
+    // 回调中可能释放最后一个外部引用
+    auto self = shared_from_this();
+    uint8_t buffer[STREAM_READ_BUFFER_SIZE];
+    while (state_ == State::kOpen) {
+        ssize_t n;
+        if (ssl_ != nullptr) {
+            n = SSL_read(ssl_, buffer, sizeof(buffer));
+            if (n <= 0) {
+                int error = SSL_get_error(ssl_, (int)n);
+                if (error == SSL_ERROR_WANT_READ) {
+                    return;
+                }
+                if (error == SSL_ERROR_WANT_WRITE) {
+                    want_write_ = true;
+                    UpdateInterest();
+                    return;
+                }
+                Fail(error == SSL_ERROR_ZERO_RETURN ? "closed by peer" : TlsError("tls read"));
+                return;
+            }
+        } else {
+            n = recv(fd_, buffer, sizeof(buffer), 0);
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    return;
+                }
+                if (errno == EINTR) {
+                    continue;
+                }
+                Fail(std::string("recv: ") + strerror(errno));
+                return;
+            }
+            if (n == 0) {
+                Fail("closed by peer");
+                return;
+            }
+        }
+        if (on_data_) {
+            on_data_(buffer, n);
+        }
+    }
+}
+
+void Stream::Write(std::string_view data) {
+    if (state_ == State::kClosed) {
+        return;
+    }
+    if (out_offset_ == out_.size()) {
+        out_.clear();
+        out_offset_ = 0;
+    }
+    out_.append(data.data(), data.size());
+    if (state_ == State::kOpen) {
+        Flush();
+    }
+}
+
+void Stream::Flush() {
+    want_write_ = false;
+    while (out_offset_ < out_.size()) {
+        size_t size = out_.size() - out_offset_;
+        ssize_t n;
+        if (ssl_ != nullptr) {
+            n = SSL_write(ssl_, out_.data() + out_offset_, (int)std::min<size_t>(size, STREAM_TLS_WRITE_CHUNK));
+            if (n <= 0) {
+                int error = SSL_get_error(ssl_, (int)n);
+                if (error == SSL_ERROR_WANT_WRITE || error == SSL_ERROR_WANT_READ) {
+                    want_write_ = true;
+                    break;
+                }
+                Fail(TlsError("tls write"));
+                return;
+            }
+        } else {
+            n = send(fd_, out_.data() + out_offset_, size, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    want_write_ = true;
+                    break;
+                }
+                if (errno == EINTR) {
+                    continue;
+                }
+                Fail(std::string("send: ") + strerror(errno));
+                return;
+            }
+        }
+        out_offset_ += n;
+    }
+    if (out_offset_ == out_.size()) {
+        out_.clear();
+        out_offset_ = 0;
+    }
+    UpdateInterest();
+}
+
+void Stream::UpdateInterest() {
+    if (state_ == State::kOpen) {
+        loop_.Modify(fd_, EPOLLIN | (want_write_ ? EPOLLOUT : 0));
+    }
+}
+
+SSL_SESSION* Stream::GetTlsSession() const {
+    if (ssl_ == nullptr) {
+        return nullptr;
+    }
+    SSL_SESSION* session = SSL_get1_session(ssl_);
+    if (session != nullptr && !SSL_SESSION_is_resumable(session)) {
+        SSL_SESSION_free(session);
+        return nullptr;
+    }
+    return session;
+}
+
+void Stream::Fail(const std::string& reason) {
+    if (state_ == State::kClosed && fd_ < 0) {
+        return;
+    }
+    auto callback = std::move(on_closed_);
+    Close();
+    if (callback) {
+        callback(reason);
+    }
+}
+
+void Stream::Close() {
+    if (fd_ < 0) {
+        state_ = State::kClosed;
+        return;
+    }
+    if (ssl_ != nullptr) {
+        if (state_ == State::kOpen) {
+            SSL_shutdown(ssl_);
+        }
+        SSL_free(ssl_);
+        ssl_ = nullptr;
+    }
+    state_ = State::kClosed;
+    loop_.Remove(fd_);
+    close(fd_);
+    fd_ = -1;
+}
+
+std::unique_ptr<Listener> Listener::Listen(EventLoop& loop, const std::string& host, int port,
+    SSL_CTX* tls, AcceptCallback callback) {
+    sockaddr_in address;
+    if (!ResolveIpv4(host, port, address)) {
+        return nullptr;
+    }
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (fd < 0) {
+        return nullptr;
+    }
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        close(fd);
+        return nullptr;
+    }
+    std::unique_ptr<Listener> listener(new Listener(loop, fd, tls, std::move(callback)));
+    auto raw = listener.get();
+    loop.Add(fd, EPOLLIN, [raw](uint32_t) {
+        raw->AcceptAll();
+    });
+    return listener;
+}
+
+Listener::~Listener() {
+    loop_.Remove(fd_);
+    close(fd_);
+}
+
+void Listener::AcceptAll() {
+    while (true) {
+        int fd = accept4(fd_, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            return;
+        }
+        callback_(Stream::Accept(loop_, fd, tls_));
+    }
+}
+
+std::unique_ptr<Datagram> Datagram::Connect(EventLoop& loop, const std::string& host, int port) {
+    sockaddr_in address;
+    if (!ResolveIpv4(host, port, address)) {
+        return nullptr;
+    }
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (fd < 0) {
+        return nullptr;
+    }
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        close(fd);
+        return nullptr;
+    }
+    std::unique_ptr<Datagram> datagram(new Datagram(loop, fd));
+    auto raw = datagram.get();
+    loop.Add(fd, EPOLLIN, [raw](uint32_t) {
+        raw->ReadAll();
+    });
+    return datagram;
+}
+
+std::unique_ptr<Datagram> Datagram::Bind(EventLoop& loop, const std::string& host, int port) {
+    sockaddr_in address;
+    if (!ResolveIpv4(host, port, address)) {
+        return nullptr;
+    }
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (fd < 0) {
+        return nullptr;
+    }
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        close(fd);
+        return nullptr;
+    }
+    std::unique_ptr<Datagram> datagram(new Datagram(loop, fd));
+    auto raw = datagram.get();
+    loop.Add(fd, EPOLLIN, [raw](uint32_t) {
+        raw->ReadAll();
+    });
+    return datagram;
+}
+
+Datagram::~Datagram() {
+    loop_.Remove(fd_);
+    close(fd_);
+}
+
+bool Datagram::Send(std::string_view data) {
+    return send(fd_, data.data(), data.size(), 0) == (ssize_t)data.size();
+}
+
+bool Datagram::SendTo(std::string_view data, const sockaddr_in& to) {
+    return sendto(fd_, data.data(), data.size(), 0, reinterpret_cast<const sockaddr*>(&to), sizeof(to)) == (ssize_t)data.size();
+}
+
+void Datagram::ReadAll() {
+    uint8_t buffer[2048];
+    while (true) {
+        sockaddr_in from;
+        socklen_t length = sizeof(from);
+        ssize_t n = recvfrom(fd_, buffer, sizeof(buffer), 0, reinterpret_cast<sockaddr*>(&from), &length);
+        if (n < 0) {
+            return;
+        }
+        if (on_message_) {
+            on_message_(buffer, n, from);
+        }
+    }
+}
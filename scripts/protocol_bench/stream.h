@@ -0,0 +1,149 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "event_loop.h"
+
+#include <openssl/ssl.h>
+#include <netinet/in.h>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
+/*
+ * 非阻塞 TCP 连接，可选 TLS
+ * 连接和 TLS 握手完成后回调 OnConnected，之前 Write 的数据先缓存，连上后再发出。
+ * 服务器端由 Listener 接受的连接同样在 TLS 握手完成后回调 OnConnected。
+ * 对端关闭或出错时回调 OnClosed；主动调用 Close 不会触发回调。
+ * 回调中可以调用 Close，之后不会再有任何回调；回调对象随 Stream 一起释放。
+ */
+class Stream : public std::enable_shared_from_this<Stream> {
+public:
+    using DataCallback = std::function<void(const uint8_t* data, size_t size)>;
+
+    // tls 为空时使用明文；session 不为空时在握手中请求恢复该会话
+    static std::shared_ptr<Stream> Connect(EventLoop& loop, const std::string& host, int port,
+        SSL_CTX* tls = nullptr, SSL_SESSION* session = nullptr);
+    // 接管已经 accept 的非阻塞套接字，tls 不为空时作为服务器端握手
+    static std::shared_ptr<Stream> Accept(EventLoop& loop, int fd, SSL_CTX* tls = nullptr);
+    ~Stream();
+
+    void OnConnected(std::function<void()> callback) { on_connected_ = std::move(callback); }
+    void OnData(DataCallback callback) { on_data_ = std::move(callback); }
+    void OnClosed(std::function<void(const std::string& reason)> callback) { on_closed_ = std::move(callback); }
+
+    void Write(std::string_view data);
+    void Close();
+
+    bool connected() const { return state_ == State::kOpen; }
+    bool closed() const { return state_ == State::kClosed; }
+    size_t pending_bytes() const { return out_.size() - out_offset_; }
+
+    const std::string& peer() const { return peer_; }
+
+    // TLS 握手信息，明文连接时 handshake_us 为 0
+    bool tls() const { return ssl_ != nullptr; }
+    bool tls_resumed() const { return tls_resumed_; }
+    int64_t handshake_us() const { return handshake_us_; }
+    // 返回当前 TLS 会话（含服务器下发的票据）的引用，调用方负责 SSL_SESSION_free；不可恢复时返回 nullptr
+    SSL_SESSION* GetTlsSession() const;
+
+private:
+    enum class State {
+        kConnecting,
+        kHandshaking,
+        kOpen,
+        kClosed
+    };
+
+    EventLoop& loop_;
+    int fd_ = -1;
+    State state_ = State::kConnecting;
+    SSL* ssl_ = nullptr;
+    bool want_write_ = false;
+    bool tls_resumed_ = false;
+    int64_t handshake_start_us_ = 0;
+    int64_t handshake_us_ = 0;
+    std::string peer_;
+    std::string out_;
+    size_t out_offset_ = 0;
+
+    std::function<void()> on_connected_;
+    DataCallback on_data_;
+    std::function<void(const std::string& reason)> on_closed_;
+
+    Stream(EventLoop& loop, int fd) : loop_(loop), fd_(fd) {}
+    bool Watch();
+    void HandleEvents(uint32_t events);
+    void OnTcpConnected();
+    void StartTls(SSL_CTX* tls, const std::string& host, SSL_SESSION* session);
+    void DoHandshake();
+    void SetOpen();
+    void ReadAll();
+    void Flush();
+    void UpdateInterest();
+    void Fail(const std::string& reason);
+};
+
+/*
+ * TCP 监听端口，每接受一个连接回调一次，连接的回调由调用方在回调中设置
+ */
+class Listener {
+public:
+    using AcceptCallback = std::function<void(std::shared_ptr<Stream> stream)>;
+
+    // tls 不为空时接受的连接都做 TLS 握手；绑定失败时返回 nullptr
+    static std::unique_ptr<Listener> Listen(EventLoop& loop, const std::string& host, int port,
+        SSL_CTX* tls, AcceptCallback callback);
+    ~Listener();
+
+private:
+    EventLoop& loop_;
+    int fd_;
+    SSL_CTX* tls_;
+    AcceptCallback callback_;
+
+    Listener(EventLoop& loop, int fd, SSL_CTX* tls, AcceptCallback callback)
+        : loop_(loop), fd_(fd), tls_(tls), callback_(std::move(callback)) {}
+    void AcceptAll();
+};
+
+/*
+ * 非阻塞 UDP 套接字，Connect 后只与一个对端通信，Bind 后可以收发任意对端
+ */
+class Datagram {
+public:
+    using MessageCallback = std::function<void(const uint8_t* data, size_t size, const sockaddr_in& from)>;
+
+    static std::unique_ptr<Datagram> Connect(EventLoop& loop, const std::string& host, int port);
+    static std::unique_ptr<Datagram> Bind(EventLoop& loop, const std::string& host, int port);
+    ~Datagram();
+
+    void OnMessage(MessageCallback callback) { on_message_ = std::move(callback); }
+    bool Send(std::string_view data);
+    bool SendTo(std::string_view data, const sockaddr_in& to);
+
+private:
+    EventLoop& loop_;
+    int fd_;
+    MessageCallback on_message_;
+
+    Datagram(EventLoop& loop, int fd) : loop_(loop), fd_(fd) {}
+    void ReadAll();
+};
+
+// 解析主机名，只返回第一个 IPv4 地址
+bool ResolveIpv4(const std::string& host, int port, sockaddr_in& address);
+
+// TLS 客户端上下文，verify 为 false 时不校验服务器证书
+SSL_CTX* CreateTlsClientContext(bool verify);
+
+// TLS 服务器上下文，开启会话缓存和会话票据，客户端可以恢复之前的会话
+// cert_file 为空时生成临时的自签名证书；证书或私钥无法加载时返回 nullptr
+SSL_CTX* CreateTlsServerContext(const std::string& cert_file, const std::string& key_file);
+
+// ip:port 形式的地址
+std::string FormatAddress(const sockaddr_in& address);
+
+#endif // STREAM_H
@@ -0,0 +1,58 @@
+#include "udp_cipher.h"
+
+#include <openssl/evp.h>
+#include <arpa/inet.h>
+#include <cstring>
+
+// 收到的数据不保证对齐，用 memcpy 读写大端字段
+static void PutBe16(uint8_t* p, uint16_t value) {
+    value = htons(value);
+    memcpy(p, &value, sizeof(value));
+}
+
+static void PutBe32(uint8_t* p, uint32_t value) {
+    value = htonl(value);
+    memcpy(p, &value, sizeof(value));
+}
+
+static uint32_t GetBe32(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return ntohl(value);
+}
+
+void UdpCipher::Crypt(const uint8_t* header, const uint8_t* in, size_t size, uint8_t* out) const {
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    EVP_EncryptInit_ex(ctx, EVP_aes_128_ctr(), nullptr, reinterpret_cast<const uint8_t*>(key_.data()), header);
+    int length = 0;
+    EVP_EncryptUpdate(ctx, out, &length, in, (int)size);
+    EVP_EncryptFinal_ex(ctx, out + length, &length);
+    EVP_CIPHER_CTX_free(ctx);
+}
+
+std::string UdpCipher::Seal(uint8_t type, uint8_t flags, uint32_t timestamp, uint32_t sequence, std::string_view payload) const {
+    std::string packet(UDP_PACKET_HEADER_SIZE + payload.size(), '\0');
+    auto header = reinterpret_cast<uint8_t*>(packet.data());
+    memcpy(header, nonce_.data(), UDP_PACKET_HEADER_SIZE);
+    header[0] = type;
+    header[1] = flags;
+    PutBe16(&header[2], payload.size());
+    PutBe32(&header[8], timestamp);
+    PutBe32(&header[12], sequence);
+    Crypt(header, reinterpret_cast<const uint8_t*>(payload.data()), payload.size(), header + UDP_PACKET_HEADER_SIZE);
+    return packet;
+}
+
+bool UdpCipher::Open(const uint8_t* data, size_t size, UdpPacket& packet) const {
+    if (size < UDP_PACKET_HEADER_SIZE) {
+        return false;
+    }
+    packet.type = data[0];
+    packet.flags = data[1];
+    packet.ssrc = GetBe32(&data[4]);
+    packet.timestamp = GetBe32(&data[8]);
+    packet.sequence = GetBe32(&data[12]);
+    packet.payload.resize(size - UDP_PACKET_HEADER_SIZE);
+    Crypt(data, data + UDP_PACKET_HEADER_SIZE, packet.payload.size(), reinterpret_cast<uint8_t*>(packet.payload.data()));
+    return true;
+}
@@ -0,0 +1,46 @@
+#ifndef UDP_CIPHER_H
+#define UDP_CIPHER_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// UDP 包类型，与 MqttProtocol 一致
+#define UDP_PACKET_TYPE_OPUS 0x01
+#define UDP_PACKET_TYPE_AGGREGATED 0x02
+#define UDP_PACKET_HEADER_SIZE 16
+
+struct UdpPacket {
+    uint8_t type = 0;
+    uint8_t flags = 0;
+    uint32_t ssrc = 0;
+    uint32_t timestamp = 0;
+    uint32_t sequence = 0;
+    std::string payload;
+};
+
+/*
+ * MQTT + UDP 通道的音频包加解密，格式与 MqttProtocol 相同：
+ * |type 1u|flags 1u|payload_len 2u|ssrc 4u|timestamp 4u|sequence 4u|payload payload_len|
+ * 16 字节包头以服务器下发的 nonce 为模板，同时作为 AES-128-CTR 的初始计数器。
+ */
+class UdpCipher {
+public:
+    // key 和 nonce 为 16 字节原始数据
+    UdpCipher(std::string key, std::string nonce) : key_(std::move(key)), nonce_(std::move(nonce)) {}
+
+    bool valid() const { return key_.size() == 16 && nonce_.size() == 16; }
+    const std::string& key() const { return key_; }
+    const std::string& nonce() const { return nonce_; }
+
+    std::string Seal(uint8_t type, uint8_t flags, uint32_t timestamp, uint32_t sequence, std::string_view payload) const;
+    bool Open(const uint8_t* data, size_t size, UdpPacket& packet) const;
+
+private:
+    std::string key_;
+    std::string nonce_;
+
+    void Crypt(const uint8_t* header, const uint8_t* in, size_t size, uint8_t* out) const;
+};
+
+#endif // UDP_CIPHER_H
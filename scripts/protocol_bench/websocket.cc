@@ -0,0 +1,438 @@
+#include "websocket.h"
+#include "bench_util.h"
+
+#include <openssl/sha.h>
+#include <strings.h>
+#include <cstring>
+
+// 单条消息的上限，超过视为协议错误
+#define WEBSOCKET_MAX_MESSAGE_SIZE (16 * 1024 * 1024)
+// 握手请求和响应头部的上限
+#define WEBSOCKET_MAX_RESPONSE_SIZE 8192
+
+std::string WebSocketCodec::EncodeFrame(Opcode opcode, std::string_view payload, bool mask) {
+    std::string frame;
+    frame.reserve(payload.size() + 14);
+    frame.push_back(static_cast<char>(0x80 | opcode));
+    uint8_t mask_bit = mask ? 0x80 : 0;
+    size_t size = payload.size();
+    if (size < 126) {
+        frame.push_back(static_cast<char>(mask_bit | size));
+    } else if (size <= 0xFFFF) {
+        frame.push_back(static_cast<char>(mask_bit | 126));
+        frame.push_back(static_cast<char>(size >> 8));
+        frame.push_back(static_cast<char>(size & 0xFF));
+    } else {
+        frame.push_back(static_cast<char>(mask_bit | 127));
+        for (int i = 7; i >= 0; i--) {
+            frame.push_back(static_cast<char>((uint64_t)size >> (i * 8)));
+        }
+    }
+    if (!mask) {
+        frame.append(payload);
+        return frame;
+    }
+    auto key = RandomBytes(4);
+    frame.append(key);
+    size_t offset = frame.size();
+    frame.append(payload);
+    for (size_t i = 0; i < size; i++) {
+        frame[offset + i] ^= key[i & 3];
+    }
+    return frame;
+}
+
+std::string WebSocketCodec::AcceptKey(std::string_view client_key) {
+    std::string input(client_key);
+    input += "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+    unsigned char digest[SHA_DIGEST_LENGTH];
+    SHA1(reinterpret_cast<const unsigned char*>(input.data()), input.size(), digest);
+    return Base64Encode(std::string_view(reinterpret_cast<const char*>(digest), sizeof(digest)));
+}
+
+bool WebSocketCodec::Feed(const uint8_t* data, size_t size, const MessageCallback& callback) {
+    buffer_.append(reinterpret_cast<const char*>(data), size);
+    size_t pos = 0;
+    while (true) {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(buffer_.data()) + pos;
+        size_t available = buffer_.size() - pos;
+        if (available < 2) {
+            break;
+        }
+        bool fin = p[0] & 0x80;
+        auto opcode = static_cast<Opcode>(p[0] & 0x0F);
+        bool masked = p[1] & 0x80;
+        uint64_t length = p[1] & 0x7F;
+        size_t header = 2;
+        if (length == 126) {
+            if (available < 4) {
+                break;
+            }
+            length = (p[2] << 8) | p[3];
+            header = 4;
+        } else if (length == 127) {
+            if (available < 10) {
+                break;
+            }
+            length = 0;
+            for (int i = 0; i < 8; i++) {
+                length = (length << 8) | p[2 + i];
+            }
+            header = 10;
+        }
+        if (length > WEBSOCKET_MAX_MESSAGE_SIZE) {
+            return false;
+        }
+        size_t mask_offset = header;
+        if (masked) {
+            header += 4;
+        }
+        if (available < header + length) {
+            break;
+        }
+
+        std::string_view payload(reinterpret_cast<const char*>(p + header), length);
+        std::string unmasked;
+        if (masked) {
+            unmasked.assign(payload);
+            for (size_t i = 0; i < length; i++) {
+                unmasked[i] ^= p[mask_offset + (i & 3)];
+            }
+            payload = unmasked;
+        }
+        pos += header + length;
+
+        if (opcode >= kClose) {
+            // 控制帧可以插在分片之间，不影响正在拼接的消息
+            callback(opcode, payload);
+        } else if (opcode == kContinuation) {
+            if (message_opcode_ == kContinuation) {
+                return false;
+            }
+            message_.append(payload);
+            if (message_.size() > WEBSOCKET_MAX_MESSAGE_SIZE) {
+                return false;
+            }
+            if (fin) {
+                auto message_opcode = message_opcode_;
+                std::string message = std::move(message_);
+                message_.clear();
+                message_opcode_ = kContinuation;
+                callback(message_opcode, message);
+            }
+        } else if (fin) {
+            callback(opcode, payload);
+        } else {
+            message_opcode_ = opcode;
+            message_.assign(payload);
+        }
+    }
+    buffer_.erase(0, pos);
+    return true;
+}
+
+std::string_view FindHttpHeader(std::string_view headers, std::string_view name) {
+    size_t pos = 0;
+    while (pos < headers.size()) {
+        size_t end = headers.find("\r\n", pos);
+        if (end == std::string_view::npos) {
+            end = headers.size();
+        }
+        auto line = headers.substr(pos, end - pos);
+        size_t colon = line.find(':');
+        if (colon == name.size() && strncasecmp(line.data(), name.data(), name.size()) == 0) {
+            auto value = line.substr(colon + 1);
+            while (!value.empty() && value.front() == ' ') {
+                value.remove_prefix(1);
+            }
+            while (!value.empty() && value.back() == ' ') {
+                value.remove_suffix(1);
+            }
+            return value;
+        }
+        pos = end + 2;
+    }
+    return std::string_view();
+}
+
+bool WebSocketClient::ParseUrl(const std::string& url, bool& secure, std::string& host, int& port, std::string& path) {
+    std::string_view rest = url;
+    if (rest.substr(0, 5) == "ws://") {
+        secure = false;
+        rest.remove_prefix(5);
+    } else if (rest.substr(0, 6) == "wss://") {
+        secure = true;
+        rest.remove_prefix(6);
+    } else {
+        return false;
+    }
+    size_t slash = rest.find('/');
+    auto authority = rest.substr(0, slash);
+    path = slash == std::string_view::npos ? "/" : std::string(rest.substr(slash));
+    size_t colon = authority.find(':');
+    if (colon == std::string_view::npos) {
+        host = authority;
+        port = secure ? 443 : 80;
+    } else {
+        host = authority.substr(0, colon);
+        port = atoi(std::string(authority.substr(colon + 1)).c_str());
+    }
+    return !host.empty() && port > 0;
+}
+
+WebSocketClient::~WebSocketClient() {
+    Close();
+}
+
+bool WebSocketClient::Connect(const std::string& url, SSL_CTX* tls, SSL_SESSION* session) {
+    bool secure;
+    std::string host;
+    int port;
+    std::string path;
+    if (!ParseUrl(url, secure, host, port, path) || (secure && tls == nullptr)) {
+        return false;
+    }
+
+    key_ = Base64Encode(RandomBytes(16));
+    std::string request = "GET " + path + " HTTP/1.1\r\n";
+    request += "Host: " + host + ":" + std::to_string(port) + "\r\n";
+    request += "Upgrade: websocket\r\nConnection: Upgrade\r\n";
+    request += "Sec-WebSocket-Key: " + key_ + "\r\nSec-WebSocket-Version: 13\r\n";
+    for (auto& [name, value] : headers_) {
+        request += name + ": " + value + "\r\n";
+    }
+    request += "\r\n";
+
+    stream_ = Stream::Connect(loop_, host, port, secure ? tls : nullptr, session);
+    stream_->OnData([this](const uint8_t* data, size_t size) {
+        OnData(data, size);
+    });
+    stream_->OnClosed([this](const std::string& reason) {
+        upgraded_ = false;
+        if (on_closed_) {
+            on_closed_(reason);
+        }
+    });
+    // 请求先进入 Stream 的发送缓冲区，TCP 和 TLS 握手完成后发出
+    stream_->Write(request);
+    return true;
+}
+
+void WebSocketClient::OnData(const uint8_t* data, size_t size) {
+    bytes_received_ += size;
+    if (upgraded_) {
+        if (!codec_.Feed(data, size, [this](WebSocketCodec::Opcode opcode, std::string_view payload) {
+            OnMessage(opcode, payload);
+        })) {
+            Fail("invalid websocket frame");
+        }
+        return;
+    }
+
+    response_.append(reinterpret_cast<const char*>(data), size);
+    size_t end = response_.find("\r\n\r\n");
+    if (end == std::string::npos) {
+        if (response_.size() > WEBSOCKET_MAX_RESPONSE_SIZE) {
+            Fail("handshake response too large");
+        }
+        return;
+    }
+    std::string_view headers(response_.data(), end + 2);
+    if (headers.substr(0, 12) != "HTTP/1.1 101") {
+        size_t line_end = headers.find("\r\n");
+        Fail("handshake rejected: " + std::string(headers.substr(0, line_end)));
+        return;
+    }
+    if (FindHttpHeader(headers, "Sec-WebSocket-Accept") != WebSocketCodec::AcceptKey(key_)) {
+        Fail("invalid Sec-WebSocket-Accept");
+        return;
+    }
+    upgraded_ = true;
+    std::string rest = response_.substr(end + 4);
+    response_.clear();
+    response_.shrink_to_fit();
+    if (on_connected_) {
+        on_connected_();
+    }
+    if (!rest.empty() && upgraded_) {
+        bytes_received_ -= rest.size();
+        OnData(reinterpret_cast<const uint8_t*>(rest.data()), rest.size());
+    }
+}
+
+void WebSocketClient::OnMessage(WebSocketCodec::Opcode opcode, std::string_view payload) {
+    if (!upgraded_) {
+        return;
+    }
+    switch (opcode) {
+    case WebSocketCodec::kText:
+        if (on_text_) {
+            on_text_(payload);
+        }
+        break;
+    case WebSocketCodec::kBinary:
+        if (on_binary_) {
+            on_binary_(payload);
+        }
+        break;
+    case WebSocketCodec::kPing:
+        stream_->Write(WebSocketCodec::EncodeFrame(WebSocketCodec::kPong, payload, true));
+        break;
+    case WebSocketCodec::kClose:
+        Fail("closed by server");
+        break;
+    default:
+        break;
+    }
+}
+
+void WebSocketClient::SendText(std::string_view text) {
+    if (!upgraded_) {
+        return;
+    }
+    auto frame = WebSocketCodec::EncodeFrame(WebSocketCodec::kText, text, true);
+    bytes_sent_ += frame.size();
+    stream_->Write(frame);
+}
+
+void WebSocketClient::SendBinary(std::string_view data) {
+    if (!upgraded_) {
+        return;
+    }
+    auto frame = WebSocketCodec::EncodeFrame(WebSocketCodec::kBinary, data, true);
+    bytes_sent_ += frame.size();
+    stream_->Write(frame);
+}
+
+void WebSocketClient::Fail(const std::string& reason) {
+    upgraded_ = false;
+    if (stream_) {
+        stream_->Close();
+    }
+    if (on_closed_) {
+        on_closed_(reason);
+    }
+}
+
+void WebSocketClient::Close() {
+    if (stream_ && !stream_->closed()) {
+        if (upgraded_) {
+            stream_->Write(WebSocketCodec::EncodeFrame(WebSocketCodec::kClose, std::string_view("\x03\xe8", 2), true));
+        }
+        stream_->Close();
+    }
+    upgraded_ = false;
+}
+
+WebSocketServerConnection::WebSocketServerConnection(std::shared_ptr<Stream> stream) : stream_(std::move(stream)) {
+    stream_->OnData([this](const uint8_t* data, size_t size) {
+        OnData(data, size);
+    });
+    stream_->OnClosed([this](const std::string& reason) {
+        upgraded_ = false;
+        if (on_closed_) {
+            on_closed_(reason);
+        }
+    });
+}
+
+WebSocketServerConnection::~WebSocketServerConnection() {
+    Close();
+}
+
+void WebSocketServerConnection::OnData(const uint8_t* data, size_t size) {
+    if (upgraded_) {
+        if (!codec_.Feed(data, size, [this](WebSocketCodec::Opcode opcode, std::string_view payload) {
+            OnMessage(opcode, payload);
+        })) {
+            Fail("invalid websocket frame");
+        }
+        return;
+    }
+
+    request_.append(reinterpret_cast<const char*>(data), size);
+    size_t end = request_.find("\r\n\r\n");
+    if (end == std::string::npos) {
+        if (request_.size() > WEBSOCKET_MAX_RESPONSE_SIZE) {
+            Fail("handshake request too large");
+        }
+        return;
+    }
+    std::string_view headers(request_.data(), end + 2);
+    auto key = FindHttpHeader(headers, "Sec-WebSocket-Key");
+    if (headers.substr(0, 4) != "GET " || key.empty()) {
+        stream_->Write("HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+        Fail("invalid upgrade request");
+        return;
+    }
+    if (on_upgrade_ && !on_upgrade_(headers)) {
+        stream_->Write("HTTP/1.1 401 Unauthorized\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+        Fail("upgrade rejected");
+        return;
+    }
+    stream_->Write("HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+        "Sec-WebSocket-Accept: " + WebSocketCodec::AcceptKey(key) + "\r\n\r\n");
+    upgraded_ = true;
+    std::string rest = request_.substr(end + 4);
+    request_.clear();
+    request_.shrink_to_fit();
+    if (!rest.empty()) {
+        OnData(reinterpret_cast<const uint8_t*>(rest.data()), rest.size());
+    }
+}
+
+void WebSocketServerConnection::OnMessage(WebSocketCodec::Opcode opcode, std::string_view payload) {
+    if (!upgraded_) {
+        return;
+    }
+    switch (opcode) {
+    case WebSocketCodec::kText:
+        if (on_text_) {
+            on_text_(payload);
+        }
+        break;
+    case WebSocketCodec::kBinary:
+        if (on_binary_) {
+            on_binary_(payload);
+        }
+        break;
+    case WebSocketCodec::kPing:
+        stream_->Write(WebSocketCodec::EncodeFrame(WebSocketCodec::kPong, payload, false));
+        break;
+    case WebSocketCodec::kClose:
+        Fail("closed by client");
+        break;
+    default:
+        break;
+    }
+}
+
+void WebSocketServerConnection::SendText(std::string_view text) {
+    if (upgraded_) {
+        stream_->Write(WebSocketCodec::EncodeFrame(WebSocketCodec::kText, text, false));
+    }
+}
+
+void WebSocketServerConnection::SendBinary(std::string_view data) {
+    if (upgraded_) {
+        stream_->Write(WebSocketCodec::EncodeFrame(WebSocketCodec::kBinary, data, false));
+    }
+}
+
+void WebSocketServerConnection::Fail(const std::string& reason) {
+    upgraded_ = false;
+    stream_->Close();
+    if (on_closed_) {
+        on_closed_(reason);
+    }
+}
+
+void WebSocketServerConnection::Close() {
+    if (!stream_->closed()) {
+        if (upgraded_) {
+            stream_->Write(WebSocketCodec::EncodeFrame(WebSocketCodec::kClose, std::string_view("\x03\xe8", 2), false));
+        }
+        stream_->Close();
+    }
+    upgraded_ = false;
+}
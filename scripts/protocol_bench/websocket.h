@@ -0,0 +1,133 @@
+#ifndef WEBSOCKET_H
+#define WEBSOCKET_H
+
+#include "stream.h"
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+
+/*
+ * RFC 6455 帧格式，客户端发出的帧必须加掩码，服务器发出的帧不加
+ */
+class WebSocketCodec {
+public:
+    enum Opcode : uint8_t {
+        kContinuation = 0x0,
+        kText = 0x1,
+        kBinary = 0x2,
+        kClose = 0x8,
+        kPing = 0x9,
+        kPong = 0xA
+    };
+    using MessageCallback = std::function<void(Opcode opcode, std::string_view payload)>;
+
+    static std::string EncodeFrame(Opcode opcode, std::string_view payload, bool mask);
+    // 握手响应中的 Sec-WebSocket-Accept
+    static std::string AcceptKey(std::string_view client_key);
+
+    // 喂入收到的字节，每收齐一条完整消息（已合并分片、已去掉掩码）回调一次
+    // 帧格式错误或消息过大时返回 false
+    bool Feed(const uint8_t* data, size_t size, const MessageCallback& callback);
+
+private:
+    std::string buffer_;
+    std::string message_;
+    Opcode message_opcode_ = kContinuation;
+};
+
+/*
+ * 基于 Stream 的 WebSocket 客户端，接口与固件中的 WebSocket 类保持相近
+ */
+class WebSocketClient {
+public:
+    explicit WebSocketClient(EventLoop& loop) : loop_(loop) {}
+    ~WebSocketClient();
+
+    void SetHeader(const std::string& name, const std::string& value) { headers_[name] = value; }
+    // url 为 ws:// 或 wss://，wss 时 tls 不能为空；URL 格式错误时返回 false
+    bool Connect(const std::string& url, SSL_CTX* tls = nullptr, SSL_SESSION* session = nullptr);
+    void Close();
+
+    void OnConnected(std::function<void()> callback) { on_connected_ = std::move(callback); }
+    void OnText(std::function<void(std::string_view text)> callback) { on_text_ = std::move(callback); }
+    void OnBinary(std::function<void(std::string_view data)> callback) { on_binary_ = std::move(callback); }
+    void OnClosed(std::function<void(const std::string& reason)> callback) { on_closed_ = std::move(callback); }
+
+    void SendText(std::string_view text);
+    void SendBinary(std::string_view data);
+
+    bool connected() const { return upgraded_; }
+    Stream* stream() const { return stream_.get(); }
+    uint64_t bytes_sent() const { return bytes_sent_; }
+    uint64_t bytes_received() const { return bytes_received_; }
+
+    // 拆分 ws://host:port/path，没有端口时按协议取 80 或 443
+    static bool ParseUrl(const std::string& url, bool& secure, std::string& host, int& port, std::string& path);
+
+private:
+    EventLoop& loop_;
+    std::map<std::string, std::string> headers_;
+    std::shared_ptr<Stream> stream_;
+    std::string key_;
+    std::string response_;
+    bool upgraded_ = false;
+    WebSocketCodec codec_;
+    uint64_t bytes_sent_ = 0;
+    uint64_t bytes_received_ = 0;
+
+    std::function<void()> on_connected_;
+    std::function<void(std::string_view text)> on_text_;
+    std::function<void(std::string_view data)> on_binary_;
+    std::function<void(const std::string& reason)> on_closed_;
+
+    void OnData(const uint8_t* data, size_t size);
+    void OnMessage(WebSocketCodec::Opcode opcode, std::string_view payload);
+    void Fail(const std::string& reason);
+};
+
+/*
+ * 服务器端 WebSocket 连接，接管 Listener 接受的 Stream
+ * 收到升级请求后回调 OnUpgrade，参数为请求行和头部；返回 false 时以 401 拒绝并关闭连接。
+ * 服务器发出的帧不加掩码，收到 ping 时自动回复 pong。
+ */
+class WebSocketServerConnection {
+public:
+    explicit WebSocketServerConnection(std::shared_ptr<Stream> stream);
+    ~WebSocketServerConnection();
+
+    void OnUpgrade(std::function<bool(std::string_view request)> callback) { on_upgrade_ = std::move(callback); }
+    void OnText(std::function<void(std::string_view text)> callback) { on_text_ = std::move(callback); }
+    void OnBinary(std::function<void(std::string_view data)> callback) { on_binary_ = std::move(callback); }
+    void OnClosed(std::function<void(const std::string& reason)> callback) { on_closed_ = std::move(callback); }
+
+    void SendText(std::string_view text);
+    void SendBinary(std::string_view data);
+    void Close();
+
+    bool upgraded() const { return upgraded_; }
+    Stream* stream() const { return stream_.get(); }
+
+private:
+    std::shared_ptr<Stream> stream_;
+    std::string request_;
+    bool upgraded_ = false;
+    WebSocketCodec codec_;
+
+    std::function<bool(std::string_view request)> on_upgrade_;
+    std::function<void(std::string_view text)> on_text_;
+    std::function<void(std::string_view data)> on_binary_;
+    std::function<void(const std::string& reason)> on_closed_;
+
+    void OnData(const uint8_t* data, size_t size);
+    void OnMessage(WebSocketCodec::Opcode opcode, std::string_view payload);
+    void Fail(const std::string& reason);
+};
+
+// 在 HTTP 头部中按名称查找（不区分大小写），找不到时返回空
+std::string_view FindHttpHeader(std::string_view headers, std::string_view name);
+
+#endif // WEBSOCKET_H
@@ -0,0 +1,175 @@
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "audio_aggregator.h"
+#include "protocol.h"
+
+namespace {
+
+AudioStreamPacket MakePacket(uint32_t timestamp, size_t size, uint8_t seed) {
+    AudioStreamPacket packet;
+    packet.frame_duration = 60;
+    packet.timestamp = timestamp;
+    packet.payload.resize(size);
+    for (size_t i = 0; i < size; i++) {
+        packet.payload[i] = static_cast<uint8_t>(seed + i);
+    }
+    return packet;
+}
+
+// 与 WebsocketProtocol::SendAggregatedAudio 相同的 v4 帧封装
+std::string Serialize(AudioAggregator& aggregator) {
+    const auto& frames = aggregator.frames();
+    std::string serialized(sizeof(BinaryProtocol4) + frames.size(), '\0');
+    auto bp4 = (BinaryProtocol4*)serialized.data();
+    bp4->type = 0;
+    bp4->frame_count = aggregator.frame_count();
+    bp4->payload_size = htons(frames.size());
+    bp4->timestamp = htonl(aggregator.timestamp());
+    memcpy(bp4->payload, frames.data(), frames.size());
+    aggregator.Clear();
+    return serialized;
+}
+
+std::vector<AudioStreamPacket> Deserialize(const std::string& data, bool* ok) {
+    std::vector<AudioStreamPacket> packets;
+    auto bp4 = (const BinaryProtocol4*)data.data();
+    *ok = data.size() >= sizeof(BinaryProtocol4) &&
+        ntohs(bp4->payload_size) <= data.size() - sizeof(BinaryProtocol4) &&
+        AudioAggregator::Decode(bp4->payload, ntohs(bp4->payload_size), bp4->frame_count, ntohl(bp4->timestamp), 60,
+            [&](AudioStreamPacket&& packet) { packets.push_back(std::move(packet)); });
+    return packets;
+}
+
+} // namespace
+
+TEST(AudioAggregatorTest, RoundTripKeepsPayloadsAndTimestamps) {
+    AudioAggregator aggregator;
+    aggregator.SetLevel(4);
+    // 覆盖 1 字节长度、2 字节长度的边界和空帧
+    std::vector<AudioStreamPacket> sent = {
+        MakePacket(1000, 0, 1), MakePacket(1060, 127, 2), MakePacket(1120, 128, 3), MakePacket(1180, 0x7FFF, 4),
+    };
+    for (size_t i = 0; i < sent.size(); i++) {
+        EXPECT_EQ(aggregator.Append(sent[i]), i == sent.size() - 1);
+    }
+    EXPECT_EQ(aggregator.frame_count(), 4);
+    EXPECT_EQ(aggregator.frames().size(), 1u + 0 + 1 + 127 + 2 + 128 + 2 + 0x7FFF);
+
+    // payload_size 字段是 16 位，超过的部分只验证聚合本身
+    bool ok = false;
+    std::string frames = aggregator.frames();
+    std::vector<AudioStreamPacket> received;
+    ok = AudioAggregator::Decode((const uint8_t*)frames.data(), frames.size(), aggregator.frame_count(), aggregator.timestamp(), 60,
+        [&](AudioStreamPacket&& packet) { received.push_back(std::move(packet)); });
+    ASSERT_TRUE(ok);
+    ASSERT_EQ(received.size(), sent.size());
+    for (size_t i = 0; i < sent.size(); i++) {
+        EXPECT_EQ(received[i].payload, sent[i].payload) << i;
+        EXPECT_EQ(received[i].timestamp, sent[i].timestamp) << i;
+        EXPECT_EQ(received[i].frame_duration, 60);
+    }
+}
+
+TEST(AudioAggregatorTest, RoundTripThroughBinaryProtocol4) {
+    AudioAggregator aggregator;
+    aggregator.SetLevel(3);
+    std::vector<AudioStreamPacket> sent;
+    std::vector<AudioStreamPacket> received;
+    for (int i = 0; i < 7; i++) {
+        sent.push_back(MakePacket(i * 60, 20 + i * 30, i));
+        if (aggregator.Append(sent.back())) {
+            bool ok = false;
+            auto packets = Deserialize(Serialize(aggregator), &ok);
+            ASSERT_TRUE(ok);
+            received.insert(received.end(), packets.begin(), packets.end());
+        }
+    }
+    // 最后一帧由 FlushAudio 发出
+    ASSERT_FALSE(aggregator.empty());
+    bool ok = false;
+    auto packets = Deserialize(Serialize(aggregator), &ok);
+    ASSERT_TRUE(ok);
+    received.insert(received.end(), packets.begin(), packets.end());
+
+    ASSERT_EQ(received.size(), sent.size());
+    for (size_t i = 0; i < sent.size(); i++) {
+        EXPECT_EQ(received[i].payload, sent[i].payload) << i;
+        EXPECT_EQ(received[i].timestamp, sent[i].timestamp) << i;
+    }
+}
+
+TEST(AudioAggregatorTest, RejectsTruncatedInput) {
+    auto decode = [](const std::vector<uint8_t>& data, int frame_count) {
+        int count = 0;
+        bool ok = AudioAggregator::Decode(data.data(), data.size(), frame_count, 0, 60, [&](AudioStreamPacket&&) { count++; });
+        EXPECT_EQ(count, ok ? frame_count : 0);
+        return ok;
+    };
+    EXPECT_TRUE(decode({}, 0));
+    EXPECT_TRUE(decode({2, 0xAA, 0xBB}, 1));
+    EXPECT_FALSE(decode({2, 0xAA, 0xBB, 3, 0xCC}, 2));
+    EXPECT_FALSE(decode({0x80}, 1));
+    EXPECT_FALSE(decode({0x80, 0x02, 0xAA}, 1));
+
+    bool ok = false;
+    std::string header(sizeof(BinaryProtocol4) - 1, '\0');
+    Deserialize(header, &ok);
+    EXPECT_FALSE(ok);
+}
+
+TEST(AudioAggregatorTest, RejectsFrameCountMismatch) {
+    AudioAggregator aggregator;
+    aggregator.SetLevel(3);
+    for (int i = 0; i < 3; i++) {
+        aggregator.Append(MakePacket(i * 60, 10, i));
+    }
+    auto serialized = Serialize(aggregator);
+    auto bp4 = (BinaryProtocol4*)serialized.data();
+
+    // 包头声明的帧数多于或少于负载中的帧数，整包丢弃，不交出任何帧
+    for (uint8_t frame_count : {2, 4, 0}) {
+        bp4->frame_count = frame_count;
+        bool ok = true;
+        auto packets = Deserialize(serialized, &ok);
+        EXPECT_FALSE(ok) << (int)frame_count;
+        EXPECT_TRUE(packets.empty()) << (int)frame_count;
+    }
+
+    // 负载在帧边界处被截断时长度校验发现不了，只能靠帧数
+    bp4->frame_count = 3;
+    bp4->payload_size = htons(ntohs(bp4->payload_size) - 11);
+    bool ok = true;
+    auto packets = Deserialize(serialized, &ok);
+    EXPECT_FALSE(ok);
+    EXPECT_TRUE(packets.empty());
+}
+
+TEST(AudioAggregatorTest, LevelAdaptsToSendResults) {
+    AudioAggregator aggregator;
+    EXPECT_EQ(aggregator.level(), 1);
+    aggregator.OnSent(true, 100);
+    EXPECT_EQ(aggregator.level(), 2);
+    aggregator.OnSent(false, 0);
+    EXPECT_EQ(aggregator.level(), 4);
+    aggregator.OnSent(false, 0);
+    EXPECT_EQ(aggregator.level(), AUDIO_AGGREGATION_MAX_FRAMES);
+
+    for (int i = 0; i < 50; i++) {
+        aggregator.OnSent(true, 1);
+    }
+    EXPECT_EQ(aggregator.level(), AUDIO_AGGREGATION_MAX_FRAMES - 1);
+
+    aggregator.SetMinLevel(5);
+    for (int i = 0; i < 200; i++) {
+        aggregator.OnSent(true, 1);
+    }
+    EXPECT_EQ(aggregator.level(), 5);
+    aggregator.SetMinLevel(1);
+    aggregator.SetLevel(0);
+    EXPECT_EQ(aggregator.level(), 1);
+}
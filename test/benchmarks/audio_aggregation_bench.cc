@@ -0,0 +1,118 @@
+// 多帧聚合节省的上行字节数：v3（每帧一个 BinaryProtocol3 头）对比 v4（每 N 帧一个 BinaryProtocol4 头）
+// 只计算协议头和长度前缀；WebSocket/TLS/TCP 的逐帧开销按下面的常量估算，实际值取决于服务器和链路
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "audio_aggregator.h"
+#include "bench.h"
+#include "protocol.h"
+
+namespace {
+
+// 客户端发送的 WebSocket 帧头（负载 < 126 字节时 2 字节 + 4 字节掩码）
+constexpr size_t kWebsocketHeader = 6;
+// TLS 1.2 AES-GCM 记录：5 字节头 + 8 字节显式 nonce + 16 字节 tag
+constexpr size_t kTlsRecord = 29;
+// IPv4 + TCP（含时间戳选项），不计 ACK
+constexpr size_t kTcpIp = 52;
+
+struct WireBytes {
+    size_t payload = 0;
+    size_t protocol = 0;
+    size_t transport = 0;
+    size_t packets = 0;
+};
+
+// 一分钟说话的 60ms Opus 帧，大小按语音和静音段随机分布
+std::vector<AudioStreamPacket> MakeMinuteOfSpeech() {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> speech(60, 140);
+    std::uniform_int_distribution<int> silence(3, 12);
+    std::vector<AudioStreamPacket> packets;
+    for (int i = 0; i < 1000; i++) {
+        AudioStreamPacket packet;
+        packet.frame_duration = 60;
+        packet.timestamp = i * 60;
+        packet.payload.resize((i / 20) % 3 == 2 ? silence(rng) : speech(rng));
+        packets.push_back(std::move(packet));
+    }
+    return packets;
+}
+
+WireBytes MeasureV3(const std::vector<AudioStreamPacket>& packets) {
+    WireBytes bytes;
+    for (auto& packet : packets) {
+        bytes.payload += packet.payload.size();
+        bytes.protocol += sizeof(BinaryProtocol3);
+        bytes.transport += kWebsocketHeader + kTlsRecord + kTcpIp;
+        bytes.packets++;
+    }
+    return bytes;
+}
+
+WireBytes MeasureV4(const std::vector<AudioStreamPacket>& packets, int level) {
+    WireBytes bytes;
+    AudioAggregator aggregator;
+    aggregator.SetLevel(level);
+    auto flush = [&] {
+        bytes.protocol += sizeof(BinaryProtocol4) + aggregator.frames().size();
+        bytes.transport += kWebsocketHeader + kTlsRecord + kTcpIp;
+        bytes.packets++;
+        aggregator.Clear();
+    };
+    for (auto& packet : packets) {
+        bytes.payload += packet.payload.size();
+        if (aggregator.Append(packet)) {
+            flush();
+        }
+    }
+    if (!aggregator.empty()) {
+        flush();
+    }
+    // frames() 包含 Opus 数据，协议开销只算长度前缀
+    bytes.protocol -= bytes.payload;
+    return bytes;
+}
+
+void Print(const char* name, const WireBytes& bytes, size_t baseline) {
+    size_t total = bytes.payload + bytes.protocol + bytes.transport;
+    printf("%-10s packets %5zu  opus %7zu B  protocol %6zu B  transport %7zu B  total %7zu B  saved %5.1f%%\n",
+        name, bytes.packets, bytes.payload, bytes.protocol, bytes.transport, total,
+        baseline == 0 ? 0.0 : 100.0 * ((double)baseline - (double)total) / baseline);
+}
+
+} // namespace
+
+int main() {
+    auto packets = MakeMinuteOfSpeech();
+    auto v3 = MeasureV3(packets);
+    size_t baseline = v3.payload + v3.protocol + v3.transport;
+    Print("v3", v3, 0);
+
+    char name[16];
+    size_t previous = baseline;
+    int result = 0;
+    for (int level = 1; level <= AUDIO_AGGREGATION_MAX_FRAMES; level++) {
+        auto v4 = MeasureV4(packets, level);
+        snprintf(name, sizeof(name), "v4 x%d", level);
+        Print(name, v4, baseline);
+        size_t total = v4.payload + v4.protocol + v4.transport;
+        // 聚合级别越高，线上字节数应当越少
+        if (level > 1 && total >= previous) {
+            result = 1;
+        }
+        previous = total;
+    }
+
+    AudioAggregator aggregator;
+    aggregator.SetLevel(AUDIO_AGGREGATION_MAX_FRAMES);
+    size_t index = 0;
+    RunBench("AudioAggregator Append x6 + Clear", 200000, [&] {
+        if (aggregator.Append(packets[index++ % packets.size()])) {
+            DoNotOptimize(aggregator.frames().size());
+            aggregator.Clear();
+        }
+    });
+    return result;
+}
@@ -0,0 +1,50 @@
+#include "bench.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+thread_local AllocStats alloc_stats;
+}
+
+AllocStats GetAllocStats() {
+    return alloc_stats;
+}
+
+void* CountedMalloc(size_t size) {
+    alloc_stats.count++;
+    alloc_stats.bytes += size;
+    return malloc(size);
+}
+
+void CountedFree(void* ptr) {
+    free(ptr);
+}
+
+void* operator new(size_t size) {
+    void* ptr = CountedMalloc(size == 0 ? 1 : size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    free(ptr);
+}
@@ -0,0 +1,50 @@
+#pragma once
+// 主机基准测试公用工具：计时，并统计每次操作的堆分配次数和字节数
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+
+struct AllocStats {
+    size_t count = 0;
+    size_t bytes = 0;
+};
+
+// 当前线程累计的分配，包括 operator new 和 CountedMalloc
+AllocStats GetAllocStats();
+// 交给 cJSON_InitHooks，让 cJSON 的分配也计入统计
+void* CountedMalloc(size_t size);
+void CountedFree(void* ptr);
+
+struct BenchResult {
+    double ns_per_op;
+    double allocs_per_op;
+    double bytes_per_op;
+};
+
+template <typename F>
+BenchResult RunBench(const char* name, int iterations, F&& body) {
+    for (int i = 0; i < iterations / 10 + 1; i++) {
+        body();
+    }
+    AllocStats before = GetAllocStats();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        body();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    AllocStats after = GetAllocStats();
+
+    BenchResult result;
+    result.ns_per_op = std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+    result.allocs_per_op = double(after.count - before.count) / iterations;
+    result.bytes_per_op = double(after.bytes - before.bytes) / iterations;
+    printf("%-48s %10.1f ns/op %8.2f allocs/op %10.1f bytes/op\n", name,
+        result.ns_per_op, result.allocs_per_op, result.bytes_per_op);
+    return result;
+}
+
+// 防止被测结果被编译器优化掉
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
@@ -0,0 +1,74 @@
+// 出站控制消息：固定缓冲区 JsonWriter 对比原先的 std::string 拼接，统计每条消息的堆分配
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "fake_protocol.h"
+
+namespace {
+
+// 原先 Protocol::SendStartListening 的拼接方式，作为对照
+std::string ConcatStartListening(const std::string& session_id) {
+    std::string message = "{\"session_id\":\"" + session_id + "\"";
+    message += ",\"type\":\"listen\",\"state\":\"start\"";
+    message += ",\"mode\":\"auto\"";
+    message += "}";
+    return message;
+}
+
+// 原先 Protocol::SendWakeWordDetected 的拼接方式（没有转义）
+std::string ConcatWakeWord(const std::string& session_id, const std::string& wake_word) {
+    return "{\"session_id\":\"" + session_id +
+        "\",\"type\":\"listen\",\"state\":\"detect\",\"text\":\"" + wake_word + "\"}";
+}
+
+} // namespace
+
+int main() {
+    const int iterations = 200000;
+    // 服务器下发的会话 ID 是 UUID，超出 std::string 的短字符串优化
+    const std::string session_id = "0f8e4c1a-7d2b-4f53-9a61-2c3d4e5f6a7b";
+    const std::string wake_word = "你好小智";
+    const std::string states = R"([{"name":"Speaker","state":{"volume":70}},{"name":"Screen","state":{"brightness":80,"theme":"dark"}}])";
+
+    FakeProtocol protocol;
+    protocol.record_messages = false;
+    protocol.set_session_id(session_id);
+
+    auto listen = RunBench("SendStartListening (JsonWriter)", iterations, [&] {
+        protocol.SendStartListening(kListeningModeAutoStop);
+    });
+    auto wake = RunBench("SendWakeWordDetected (JsonWriter)", iterations, [&] {
+        protocol.SendWakeWordDetected(wake_word);
+    });
+    RunBench("SendAbortSpeaking (JsonWriter)", iterations, [&] {
+        protocol.SendAbortSpeaking(kAbortReasonWakeWordDetected);
+    });
+    RunBench("SendIotStates (JsonWriter)", iterations, [&] {
+        protocol.SendIotStates(states);
+    });
+    // 通道打开时发送的 IoT 描述：缓存的信封对比每次都重新序列化（代数每次都变）
+    std::vector<std::string> descriptors;
+    for (int i = 0; i < 8; i++) {
+        descriptors.push_back(R"({"name":"Thing)" + std::to_string(i) +
+            R"(","description":"A typical thing","properties":{"volume":{"description":"Current volume","type":"number"}},)"
+            R"("methods":{"SetVolume":{"description":"Set the volume","parameters":{"volume":{"description":"0 to 100","type":"number"}}}}})");
+    }
+    RunBench("SendIotDescriptors x8 (cached)", iterations / 10, [&] {
+        protocol.SendIotDescriptors(descriptors, 1);
+    });
+    uint32_t generation = 1;
+    RunBench("SendIotDescriptors x8 (rebuilt)", iterations / 10, [&] {
+        protocol.SendIotDescriptors(descriptors, ++generation);
+    });
+    RunBench("start listening (std::string concat)", iterations, [&] {
+        DoNotOptimize(ConcatStartListening(session_id));
+    });
+    RunBench("wake word (std::string concat)", iterations, [&] {
+        DoNotOptimize(ConcatWakeWord(session_id, wake_word));
+    });
+    printf("Average message size: %.1f bytes\n", double(protocol.sent_bytes) / protocol.sent_count);
+
+    // 栈上缓冲区的控制消息不应分配内存
+    return listen.allocs_per_op == 0 && wake.allocs_per_op == 0 ? 0 : 1;
+}
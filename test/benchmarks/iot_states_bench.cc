@@ -0,0 +1,78 @@
+// ThingManager::GetStatesJson 的增量更新：24 个推送模式的设备对比加入 24 个轮询设备之后
+// getter 只读内存中的值，实际设备的 getter 可能访问外设，轮询的代价更高
+#include <cstdio>
+#include <string>
+
+#include "bench.h"
+#include "thing_manager.h"
+
+namespace {
+
+constexpr int kThingCount = 24;
+
+class BenchThing : public iot::Thing {
+public:
+    BenchThing(const std::string& name, bool push) : Thing(name, "Benchmark thing") {
+        properties_.AddNumberProperty("volume", "Volume", [this]() -> int { return volume_; });
+        properties_.AddBooleanProperty("power", "Power", [this]() -> bool { return power_; });
+        properties_.AddStringProperty("mode", "Mode", [this]() -> std::string { return mode_; });
+        if (push) {
+            EnableStatePush();
+        }
+    }
+
+    void SetVolume(int volume) {
+        volume_ = volume;
+        NotifyStateChanged();
+    }
+
+private:
+    int volume_ = 50;
+    bool power_ = true;
+    std::string mode_ = "auto";
+};
+
+} // namespace
+
+int main() {
+    const int iterations = 100000;
+    auto& manager = iot::ThingManager::GetInstance();
+    BenchThing* first = nullptr;
+    for (int i = 0; i < kThingCount; i++) {
+        auto thing = new BenchThing("Push" + std::to_string(i), true);
+        manager.AddThing(thing);
+        if (first == nullptr) {
+            first = thing;
+        }
+    }
+
+    std::string json;
+    std::string names;
+    // 完整状态作为基线，同时清掉初始的脏标记
+    RunBench("full snapshot, 24 push things", iterations / 10, [&] {
+        manager.GetStatesJson(json, false);
+    });
+    auto push_idle = RunBench("idle delta, 24 push things", iterations, [&] {
+        manager.GetStatesJson(json, true, &names);
+    });
+    bool idle_empty = json == "[]";
+    int volume = 0;
+    RunBench("one thing changed, 24 push things", iterations, [&] {
+        first->SetVolume(volume++ % 100);
+        manager.GetStatesJson(json, true, &names);
+    });
+    bool one_changed = names == "Push0";
+
+    for (int i = 0; i < kThingCount; i++) {
+        manager.AddThing(new BenchThing("Poll" + std::to_string(i), false));
+    }
+    manager.GetStatesJson(json, false);
+    auto poll_idle = RunBench("idle delta, 24 push + 24 polled things", iterations, [&] {
+        manager.GetStatesJson(json, true, &names);
+    });
+    bool polled_empty = json == "[]";
+
+    // 推送模式的空闲增量不调用 getter，应当比轮询快得多且不分配内存
+    printf("Idle delta: polling costs %.1fx push mode\n", poll_idle.ns_per_op / push_idle.ns_per_op);
+    return idle_empty && one_changed && polled_empty && push_idle.allocs_per_op == 0 ? 0 : 1;
+}
@@ -0,0 +1,82 @@
+// 入站控制消息解析：流式 JsonReader 对比 cJSON DOM
+#include <cJSON.h>
+
+#include <cstring>
+#include <string>
+
+#include "bench.h"
+#include "json_reader.h"
+
+namespace {
+
+const char* kMessages[] = {
+    R"({"session_id":"4b1e6f1c","type":"stt","text":"今天天气怎么样"})",
+    R"({"session_id":"4b1e6f1c","type":"tts","state":"sentence_start","text":"今天北京晴，气温二十度左右，适合出门散步。"})",
+    R"({"session_id":"4b1e6f1c","type":"llm","text":"😊","emotion":"happy"})",
+    R"({"session_id":"4b1e6f1c","type":"tts","state":"stop"})",
+};
+
+// 与 Application::OnIncomingJson 相同的工作量：取出 type 和对应消息用到的字段
+size_t HandleWithReader(const char* json) {
+    ControlMessage message;
+    if (!ParseControlMessage(json, strlen(json), message)) {
+        return 0;
+    }
+    size_t used = message.type.raw.size();
+    if (message.type == "tts") {
+        used += message.state.raw.size() + message.text.raw.size();
+    } else if (message.type == "stt") {
+        used += message.text.raw.size();
+    } else if (message.type == "llm") {
+        used += message.emotion.raw.size();
+    }
+    return used;
+}
+
+size_t HandleWithCJson(const char* json) {
+    cJSON* root = cJSON_Parse(json);
+    if (root == nullptr) {
+        return 0;
+    }
+    size_t used = 0;
+    auto type = cJSON_GetObjectItem(root, "type");
+    if (cJSON_IsString(type)) {
+        used = strlen(type->valuestring);
+        if (strcmp(type->valuestring, "tts") == 0) {
+            auto state = cJSON_GetObjectItem(root, "state");
+            auto text = cJSON_GetObjectItem(root, "text");
+            used += cJSON_IsString(state) ? strlen(state->valuestring) : 0;
+            used += cJSON_IsString(text) ? strlen(text->valuestring) : 0;
+        } else if (strcmp(type->valuestring, "stt") == 0) {
+            auto text = cJSON_GetObjectItem(root, "text");
+            used += cJSON_IsString(text) ? strlen(text->valuestring) : 0;
+        } else if (strcmp(type->valuestring, "llm") == 0) {
+            auto emotion = cJSON_GetObjectItem(root, "emotion");
+            used += cJSON_IsString(emotion) ? strlen(emotion->valuestring) : 0;
+        }
+    }
+    cJSON_Delete(root);
+    return used;
+}
+
+} // namespace
+
+int main() {
+    cJSON_Hooks hooks = {CountedMalloc, CountedFree};
+    cJSON_InitHooks(&hooks);
+
+    const int iterations = 200000;
+    size_t index = 0;
+    auto reader = RunBench("JsonReader ParseControlMessage", iterations, [&] {
+        DoNotOptimize(HandleWithReader(kMessages[index++ % 4]));
+    });
+    index = 0;
+    auto cjson = RunBench("cJSON_Parse + GetObjectItem", iterations, [&] {
+        DoNotOptimize(HandleWithCJson(kMessages[index++ % 4]));
+    });
+    printf("JsonReader speedup: %.1fx, allocations saved per message: %.2f\n",
+        cjson.ns_per_op / reader.ns_per_op, cjson.allocs_per_op - reader.allocs_per_op);
+
+    // 流式读取不应分配内存
+    return reader.allocs_per_op == 0 ? 0 : 1;
+}
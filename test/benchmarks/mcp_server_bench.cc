@@ -0,0 +1,115 @@
+// McpServer 的回复耗时：60 个工具时的 tools/list，以及 tools/call 的单次调用开销，
+// 都从解析请求算到回复交给传输层为止。传输层是只记录消息的回调，不含协议层加信封和网络发送
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <cJSON.h>
+
+#include "bench.h"
+#include "mcp_server.h"
+
+namespace {
+
+constexpr int kToolCount = 60;
+
+// 与设备工具相近的描述长度和参数个数
+void RegisterTools(McpServer& server) {
+    for (int i = 0; i < kToolCount; i++) {
+        std::string name = "self.bench.tool_" + std::to_string(i);
+        std::string description = "Benchmark tool " + std::to_string(i) +
+            ". Set the level and the mode of the simulated peripheral; use `self.get_device_status` first if the current level is unknown.";
+        server.AddTool(name, description,
+            McpArgs(McpArg<int>("level", 50, 0, 100), McpArg<bool>("enabled", true), McpArg<std::string>("mode")),
+            [](int level, bool enabled, const std::string& mode) -> ReturnValue {
+                return level;
+            });
+    }
+}
+
+std::string ToolsListRequest(const std::string& cursor) {
+    std::string request = R"({"jsonrpc":"2.0","id":1,"method":"tools/list","params":{)";
+    if (!cursor.empty()) {
+        request += R"("cursor":")" + cursor + "\"";
+    }
+    return request + "}}";
+}
+
+// 按 nextCursor 翻完所有页，返回工具总数，页数写入 pages
+int WalkPages(McpServer& server, std::shared_ptr<EnvelopeBuffer>& reply, int& pages) {
+    int tools = 0;
+    std::string cursor;
+    pages = 0;
+    do {
+        reply.reset();
+        server.ParseMessage(ToolsListRequest(cursor));
+        if (!reply) {
+            return -1;
+        }
+        cJSON* json = cJSON_Parse(std::string(reply->payload()).c_str());
+        cJSON* result = cJSON_GetObjectItem(json, "result");
+        tools += cJSON_GetArraySize(cJSON_GetObjectItem(result, "tools"));
+        cJSON* next = cJSON_GetObjectItem(result, "nextCursor");
+        cursor = cJSON_IsString(next) ? next->valuestring : "";
+        cJSON_Delete(json);
+        pages++;
+    } while (!cursor.empty());
+    return tools;
+}
+
+} // namespace
+
+int main() {
+    const int iterations = 20000;
+    auto& server = McpServer::GetInstance();
+    // tools/call 的回复来自线程池的工作线程
+    std::mutex mutex;
+    std::condition_variable replied;
+    std::shared_ptr<EnvelopeBuffer> reply;
+    size_t reply_bytes = 0;
+    server.OnOutgoingMessage([&](std::shared_ptr<EnvelopeBuffer> message) {
+        std::lock_guard<std::mutex> lock(mutex);
+        reply_bytes += message->payload().size();
+        reply = std::move(message);
+        replied.notify_one();
+    });
+    RegisterTools(server);
+
+    // 第一次请求时按注册时缓存的描述分页
+    auto start = std::chrono::steady_clock::now();
+    server.ParseMessage(ToolsListRequest(""));
+    auto cold = std::chrono::steady_clock::now() - start;
+    printf("%-48s %10.1f us (once)\n", "tools/list first page, pages not built",
+        std::chrono::duration<double, std::micro>(cold).count());
+
+    int pages = 0;
+    int tools = WalkPages(server, reply, pages);
+    printf("%d tools in %d pages\n", tools, pages);
+
+    reply_bytes = 0;
+    RunBench("tools/list first page (cached)", iterations, [&] {
+        server.ParseMessage(ToolsListRequest(""));
+    });
+    printf("Average reply size: %.1f bytes\n", double(reply_bytes) / (iterations + iterations / 10 + 1));
+
+    // 单次调用：解析、按槽位绑定参数、交给线程池、工具返回后生成回复，等回复到达后再发下一次
+    // 分配统计只含主线程，不含工作线程中的执行和回复
+    const std::string call = R"({"jsonrpc":"2.0","id":2,"method":"tools/call","params":{"name":"self.bench.tool_7","arguments":{"level":30,"enabled":false,"mode":"eco"}}})";
+    bool call_ok = true;
+    RunBench("tools/call round trip (3 arguments)", iterations, [&] {
+        std::unique_lock<std::mutex> lock(mutex);
+        reply.reset();
+        lock.unlock();
+        server.ParseMessage(call);
+        lock.lock();
+        replied.wait(lock, [&] { return reply != nullptr; });
+        call_ok = call_ok && reply->payload().find("\"isError\":false") != std::string_view::npos;
+    });
+
+    // 所有工具都必须出现且分到多页，调用都必须成功
+    return tools == kToolCount && pages > 1 && call_ok ? 0 : 1;
+}
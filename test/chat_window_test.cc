@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "chat_window.h"
+
+// 用数组模拟气泡池：按 ChatWindowChange 更新槽位内容，和 LcdDisplay 的处理方式相同
+namespace {
+
+constexpr size_t kPoolSize = 4;
+constexpr size_t kMaxMessages = 10;
+
+class ChatWindowTest : public ::testing::Test {
+protected:
+    ChatWindow window{kPoolSize, kMaxMessages};
+    std::vector<std::string> slots = std::vector<std::string>(kPoolSize);
+    int rebinds = 0;
+    int recycled = 0;
+
+    void Append(ChatRole role, const std::string& text) {
+        auto change = window.Append(role, text.c_str());
+        if (change.rebind_all) {
+            rebinds++;
+            for (size_t i = 0; i < window.size(); i++) {
+                slots[window.slot(i)] = window.message(i).text;
+            }
+        } else {
+            slots[change.slot] = window.message(window.size() - 1).text;
+        }
+        recycled += change.recycled;
+    }
+
+    // 按显示顺序读出槽位中的文本，同时检查它们和窗口中的消息一致
+    std::vector<std::string> Visible() {
+        std::vector<std::string> texts;
+        std::set<size_t> used;
+        for (size_t i = 0; i < window.size(); i++) {
+            EXPECT_TRUE(used.insert(window.slot(i)).second) << "slot bound twice";
+            EXPECT_EQ(slots[window.slot(i)], window.message(i).text);
+            texts.push_back(slots[window.slot(i)]);
+        }
+        return texts;
+    }
+};
+
+} // namespace
+
+TEST_F(ChatWindowTest, FillsPoolThenRecyclesOldestSlot) {
+    for (int i = 0; i < 3; i++) {
+        Append(kChatRoleUser, "m" + std::to_string(i));
+    }
+    EXPECT_EQ(window.size(), 3u);
+    EXPECT_FALSE(window.full());
+    EXPECT_EQ(Visible(), (std::vector<std::string>{"m0", "m1", "m2"}));
+
+    for (int i = 3; i < 7; i++) {
+        Append(kChatRoleAssistant, "m" + std::to_string(i));
+    }
+    // 池满之后每条新消息都回收一个槽位，不需要整体重绑
+    EXPECT_EQ(recycled, 3);
+    EXPECT_EQ(rebinds, 0);
+    EXPECT_EQ(window.start(), 3u);
+    EXPECT_TRUE(window.at_tail());
+    EXPECT_EQ(Visible(), (std::vector<std::string>{"m3", "m4", "m5", "m6"}));
+}
+
+TEST_F(ChatWindowTest, FoldsConsecutiveSystemMessages) {
+    Append(kChatRoleUser, "hello");
+    Append(kChatRoleSystem, "connecting");
+    auto change = window.Append(kChatRoleSystem, "connected");
+    EXPECT_TRUE(change.folded);
+    EXPECT_FALSE(change.move_to_end);
+    EXPECT_EQ(change.slot, window.slot(1));
+    EXPECT_EQ(window.history_size(), 2u);
+    EXPECT_EQ(window.message(1).text, "connected");
+}
+
+TEST_F(ChatWindowTest, HistoryIsCappedAtMaxMessages) {
+    for (size_t i = 0; i < kMaxMessages + 5; i++) {
+        Append(kChatRoleUser, "m" + std::to_string(i));
+    }
+    EXPECT_EQ(window.history_size(), kMaxMessages);
+    EXPECT_EQ(window.start(), kMaxMessages - kPoolSize);
+    EXPECT_EQ(Visible(), (std::vector<std::string>{"m11", "m12", "m13", "m14"}));
+}
+
+TEST_F(ChatWindowTest, ShiftsThroughHistoryAndJumpsBackOnNewMessage) {
+    for (int i = 0; i < 8; i++) {
+        Append(kChatRoleUser, "m" + std::to_string(i));
+    }
+    EXPECT_FALSE(window.CanShiftForward());
+
+    // 向前翻到最早的消息，每次只换绑一个槽位
+    while (window.CanShiftBackward()) {
+        size_t slot = window.ShiftBackward();
+        EXPECT_EQ(slot, window.slot(0));
+        slots[slot] = window.message(0).text;
+    }
+    EXPECT_EQ(window.start(), 0u);
+    EXPECT_EQ(Visible(), (std::vector<std::string>{"m0", "m1", "m2", "m3"}));
+
+    size_t slot = window.ShiftForward();
+    EXPECT_EQ(slot, window.slot(window.size() - 1));
+    slots[slot] = window.message(window.size() - 1).text;
+    EXPECT_EQ(Visible(), (std::vector<std::string>{"m1", "m2", "m3", "m4"}));
+
+    // 查看历史时来了新消息：跳回最新的窗口
+    Append(kChatRoleAssistant, "m8");
+    EXPECT_EQ(rebinds, 1);
+    EXPECT_TRUE(window.at_tail());
+    EXPECT_EQ(Visible(), (std::vector<std::string>{"m5", "m6", "m7", "m8"}));
+
+    // 查看历史时折叠系统消息也会跳回
+    Append(kChatRoleSystem, "s0");
+    window.ShiftBackward();
+    Append(kChatRoleSystem, "s1");
+    EXPECT_EQ(rebinds, 2);
+    EXPECT_EQ(Visible(), (std::vector<std::string>{"m6", "m7", "m8", "s1"}));
+}
+
+TEST_F(ChatWindowTest, WindowThatIsNotFullNeverShifts) {
+    Append(kChatRoleUser, "m0");
+    Append(kChatRoleUser, "m1");
+    EXPECT_FALSE(window.CanShiftBackward());
+    EXPECT_FALSE(window.CanShiftForward());
+}
@@ -0,0 +1,185 @@
+#include <gtest/gtest.h>
+
+#include <deque>
+
+#include "audio_aggregator.h"
+#include "congestion_controller.h"
+#include "fake_protocol.h"
+
+namespace {
+
+constexpr int kFrameMs = 60;
+constexpr size_t kMaxQueue = 2400 / kFrameMs;
+
+// 限速链路：每个传输帧固定耗时，按虚拟时间推进，聚合逻辑与真实协议相同
+class ThrottledProtocol : public FakeProtocol {
+public:
+    ThrottledProtocol(int packet_cost_ms, bool multi_frame) : packet_cost_ms_(packet_cost_ms), multi_frame_(multi_frame) {}
+
+    int64_t now_ms = 0;
+    size_t packets_on_wire = 0;
+    // 每个 Opus 帧离开设备的时间减去它的采集时间
+    int max_latency_ms = 0;
+
+    bool SendAudio(const AudioStreamPacket& packet) override {
+        if (!multi_frame_) {
+            Transmit(packet.timestamp);
+            return true;
+        }
+        if (aggregator_.Append(packet)) {
+            uint32_t first = aggregator_.timestamp();
+            aggregator_.Clear();
+            Transmit(first);
+            aggregator_.OnSent(true, packet_cost_ms_);
+        }
+        return true;
+    }
+    bool IsAggregationEnabled() override { return multi_frame_; }
+    void SetMinAggregationLevel(int level) override { aggregator_.SetMinLevel(level); }
+    int aggregation_level() const { return aggregator_.level(); }
+
+private:
+    void Transmit(uint32_t oldest_timestamp) {
+        now_ms += packet_cost_ms_;
+        packets_on_wire++;
+        max_latency_ms = std::max<int>(max_latency_ms, now_ms - oldest_timestamp);
+    }
+
+    int packet_cost_ms_;
+    bool multi_frame_;
+    AudioAggregator aggregator_;
+};
+
+struct SimulationResult {
+    CongestionState state;
+    int aggregation_level;
+    int max_latency_ms;
+    size_t queue_full_drops = 0;
+    size_t congestion_drops = 0;
+};
+
+// 按 Application::MainEventLoop 的方式发送：每批取出队列中所有帧，严重拥塞时先丢弃最旧的
+SimulationResult Simulate(ThrottledProtocol& protocol, CongestionController& congestion, int seconds,
+    bool control = true) {
+    congestion.Reset();
+    congestion.SetAggregationAvailable(protocol.IsAggregationEnabled());
+    protocol.SetMinAggregationLevel(congestion.aggregation_level());
+
+    SimulationResult result{};
+    std::deque<AudioStreamPacket> queue;
+    int64_t next_frame_ms = 0;
+    const int64_t end_ms = seconds * 1000;
+    while (protocol.now_ms < end_ms) {
+        // 编码任务在发送期间持续产生新帧
+        while (next_frame_ms <= protocol.now_ms) {
+            if (queue.size() >= kMaxQueue) {
+                queue.pop_front();
+                result.queue_full_drops++;
+                congestion.OnDropped(kAudioDropQueueFull);
+            }
+            AudioStreamPacket packet;
+            packet.frame_duration = kFrameMs;
+            packet.timestamp = next_frame_ms;
+            packet.payload.assign(80, 0);
+            queue.push_back(std::move(packet));
+            next_frame_ms += kFrameMs;
+        }
+        if (queue.empty()) {
+            protocol.now_ms = next_frame_ms;
+            continue;
+        }
+
+        auto packets = std::move(queue);
+        queue.clear();
+        size_t excess = control ? congestion.ExcessBacklog(packets.size()) : 0;
+        for (size_t i = 0; i < excess; i++) {
+            packets.pop_front();
+        }
+        if (excess > 0) {
+            result.congestion_drops += excess;
+            congestion.OnDropped(kAudioDropCongestion, excess);
+        }
+
+        int64_t start_ms = protocol.now_ms;
+        for (auto& packet : packets) {
+            protocol.SendAudio(packet);
+        }
+        int level = congestion.aggregation_level();
+        congestion.OnBatchSent(packets.size(), packets.size(), true, protocol.now_ms - start_ms);
+        if (control && congestion.aggregation_level() != level) {
+            protocol.SetMinAggregationLevel(congestion.aggregation_level());
+        }
+    }
+    result.state = congestion.state();
+    result.aggregation_level = protocol.aggregation_level();
+    result.max_latency_ms = protocol.max_latency_ms;
+    return result;
+}
+
+} // namespace
+
+TEST(CongestionControllerTest, FastLinkStaysUncongested) {
+    ThrottledProtocol protocol(5, true);
+    CongestionController congestion(kFrameMs, kMaxQueue);
+    auto result = Simulate(protocol, congestion, 60);
+    EXPECT_EQ(result.state, kCongestionNone);
+    EXPECT_EQ(result.aggregation_level, 1);
+    EXPECT_EQ(result.queue_full_drops + result.congestion_drops, 0u);
+    EXPECT_LE(result.max_latency_ms, 2 * kFrameMs);
+}
+
+TEST(CongestionControllerTest, SlowLinkIsAbsorbedByAggregation) {
+    // 每个传输帧 100ms，逐帧发送跟不上 60ms 的编码速度
+    ThrottledProtocol protocol(100, true);
+    CongestionController congestion(kFrameMs, kMaxQueue);
+    auto result = Simulate(protocol, congestion, 120);
+    EXPECT_GE(result.aggregation_level, 2);
+    EXPECT_EQ(result.queue_full_drops, 0u);
+    // 聚合后链路跟得上，延迟保持在队列上限之内
+    EXPECT_LT(result.max_latency_ms, (int)(kMaxQueue * kFrameMs));
+    EXPECT_LT(protocol.packets_on_wire, 120u * 1000 / kFrameMs / 2 + 10);
+}
+
+TEST(CongestionControllerTest, WithoutAggregationOnlySevereDropsApply) {
+    ThrottledProtocol protocol(100, false);
+    CongestionController congestion(kFrameMs, kMaxQueue);
+    auto result = Simulate(protocol, congestion, 120);
+    EXPECT_EQ(congestion.aggregation_level(), 1);
+    EXPECT_NE(result.state, kCongestionMild);
+    // 链路容量只有需求的 60%，主动丢弃最旧的帧，队列不会溢出
+    EXPECT_GT(result.congestion_drops, 0u);
+    EXPECT_EQ(result.queue_full_drops, 0u);
+    EXPECT_LT(result.max_latency_ms, (int)(kMaxQueue * kFrameMs));
+}
+
+TEST(CongestionControllerTest, UncontrolledSlowLinkOverflowsQueue) {
+    ThrottledProtocol protocol(100, false);
+    CongestionController congestion(kFrameMs, kMaxQueue);
+    auto result = Simulate(protocol, congestion, 120, false);
+    EXPECT_GT(result.queue_full_drops, 0u);
+    EXPECT_GE(result.max_latency_ms, (int)(kMaxQueue * kFrameMs));
+}
+
+TEST(CongestionControllerTest, LinkStatsSetStateFloor) {
+    CongestionController congestion(kFrameMs, kMaxQueue);
+    congestion.SetAggregationAvailable(true);
+    LinkStats stats;
+    stats.valid = true;
+    stats.rtt_ms = 800;
+    congestion.OnLinkStats(stats);
+    congestion.OnBatchSent(1, 1, true, 1);
+    EXPECT_EQ(congestion.state(), kCongestionMild);
+    EXPECT_EQ(congestion.aggregation_level(), 2);
+
+    congestion.SetAggregationAvailable(false);
+    EXPECT_EQ(congestion.state(), kCongestionNone);
+    EXPECT_EQ(congestion.aggregation_level(), 1);
+    congestion.OnBatchSent(1, 1, true, 1);
+    EXPECT_EQ(congestion.state(), kCongestionNone);
+
+    stats.loss = 0.5f;
+    congestion.OnLinkStats(stats);
+    congestion.OnBatchSent(1, 1, true, 1);
+    EXPECT_EQ(congestion.state(), kCongestionSevere);
+    EXPECT_EQ(congestion.ExcessBacklog(kMaxQueue), kMaxQueue - kMaxQueue / 4);
+}
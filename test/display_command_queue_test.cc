@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "display_command_queue.h"
+
+namespace {
+
+std::vector<std::string> TakeChat(DisplayCommandQueue& queue) {
+    std::vector<std::string> messages;
+    queue.TakeChatMessages([&messages](const ChatCommand& command) {
+        messages.push_back(command.role + ":" + command.content);
+    });
+    return messages;
+}
+
+} // namespace
+
+TEST(DisplayCommandQueueTest, KeepsOnlyNewestStatusAndEmotion) {
+    DisplayCommandQueue queue;
+    EXPECT_TRUE(queue.empty());
+    queue.SetStatus("connecting");
+    queue.SetStatus("listening");
+    queue.SetEmotion("happy", false);
+    queue.SetEmotion("wifi", true);
+    EXPECT_FALSE(queue.empty());
+
+    auto status = queue.TakeStatus();
+    ASSERT_NE(status, nullptr);
+    EXPECT_EQ(status->text, "listening");
+    auto emotion = queue.TakeEmotion();
+    ASSERT_NE(emotion, nullptr);
+    EXPECT_TRUE(emotion->is_icon);
+    EXPECT_EQ(emotion->text, "wifi");
+
+    EXPECT_EQ(queue.TakeStatus(), nullptr);
+    EXPECT_EQ(queue.TakeEmotion(), nullptr);
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(DisplayCommandQueueTest, StatusAndNotificationKeepEnqueueOrder) {
+    DisplayCommandQueue queue;
+    queue.ShowNotification("volume 50", 3000);
+    queue.SetStatus("speaking");
+    auto status = queue.TakeStatus();
+    auto notification = queue.TakeNotification();
+    ASSERT_NE(status, nullptr);
+    ASSERT_NE(notification, nullptr);
+    EXPECT_LT(notification->seq, status->seq);
+    EXPECT_EQ(notification->duration_ms, 3000);
+
+    // 被替换的通知仍然按最新一条的序号排序
+    queue.SetStatus("idle");
+    queue.ShowNotification("a", 1000);
+    queue.ShowNotification("b", 2000);
+    status = queue.TakeStatus();
+    notification = queue.TakeNotification();
+    EXPECT_EQ(notification->text, "b");
+    EXPECT_GT(notification->seq, status->seq);
+}
+
+TEST(DisplayCommandQueueTest, HideOnlyWhenNoNewerNotification) {
+    DisplayCommandQueue queue;
+    EXPECT_FALSE(queue.TakeHideNotification());
+
+    queue.ShowNotification("first", 1000);
+    queue.TakeNotification();
+    queue.HideNotification();
+    EXPECT_FALSE(queue.empty());
+    EXPECT_TRUE(queue.TakeHideNotification());
+    EXPECT_TRUE(queue.empty());
+
+    // 定时器到期时已有新通知排队：不隐藏，由新通知重新计时
+    queue.ShowNotification("second", 1000);
+    queue.HideNotification();
+    EXPECT_FALSE(queue.TakeHideNotification());
+    EXPECT_EQ(queue.TakeNotification()->text, "second");
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(DisplayCommandQueueTest, ChatMessagesAreDeliveredInOrder) {
+    DisplayCommandQueue queue;
+    queue.SetChatMessage("user", "hi");
+    queue.SetChatMessage("assistant", "hello");
+    queue.SetChatMessage("system", "done");
+    EXPECT_EQ(TakeChat(queue), (std::vector<std::string>{"user:hi", "assistant:hello", "system:done"}));
+    EXPECT_TRUE(TakeChat(queue).empty());
+    EXPECT_TRUE(queue.empty());
+
+    // 未取出的消息由析构函数释放
+    queue.SetChatMessage("user", "pending");
+    queue.SetStatus("pending");
+}
+
+TEST(DisplayCommandQueueTest, ConcurrentProducersLoseNothing) {
+    constexpr int kThreads = 4;
+    constexpr int kMessages = 2000;
+    DisplayCommandQueue queue;
+    std::vector<std::vector<int>> received(kThreads);
+    std::atomic<bool> done = false;
+
+    // 消费者模拟 LVGL 任务，和生产者同时运行
+    std::thread consumer([&] {
+        auto drain = [&] {
+            queue.TakeStatus();
+            queue.TakeChatMessages([&received](const ChatCommand& command) {
+                received[std::stoi(command.role)].push_back(std::stoi(command.content));
+            });
+        };
+        while (!done) {
+            drain();
+        }
+        drain();
+    });
+
+    std::vector<std::thread> producers;
+    for (int t = 0; t < kThreads; t++) {
+        producers.emplace_back([&queue, t] {
+            for (int i = 0; i < kMessages; i++) {
+                queue.SetChatMessage(std::to_string(t).c_str(), std::to_string(i).c_str());
+                queue.SetStatus("busy");
+            }
+        });
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    done = true;
+    consumer.join();
+
+    // 每个生产者的消息都完整且保持顺序，状态全部合并或取出后队列为空
+    for (int t = 0; t < kThreads; t++) {
+        ASSERT_EQ(received[t].size(), size_t(kMessages)) << t;
+        for (int i = 0; i < kMessages; i++) {
+            ASSERT_EQ(received[t][i], i) << t;
+        }
+    }
+    EXPECT_TRUE(queue.empty());
+}
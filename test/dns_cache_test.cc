@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include <esp_timer.h>
+#include <lwip/netdb.h>
+
+#include "dns_cache.h"
+#include "settings.h"
+
+// DnsCache 是单例，第一次 GetInstance 时从 Settings 加载，各用例使用不同的主机名
+namespace {
+
+void WaitForAddress(const std::string& host, const std::string& address) {
+    for (int i = 0; i < 200; i++) {
+        if (host_settings_store()["dns.entries"].find(host + " " + address) != std::string::npos) {
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+}
+
+} // namespace
+
+TEST(DnsCacheTest, RestoredEntryIsServedStaleAndRefreshedInBackground) {
+    host_settings_store()["dns.entries"] = "restored.example 10.0.0.1\n";
+    host_dns_records().Set("restored.example", "10.0.0.2");
+
+    auto& cache = DnsCache::GetInstance();
+    EXPECT_EQ(cache.Resolve("restored.example"), "10.0.0.1");
+    EXPECT_EQ(cache.stale_hits(), 1u);
+    WaitForAddress("restored.example", "10.0.0.2");
+    EXPECT_EQ(cache.Resolve("restored.example"), "10.0.0.2");
+    EXPECT_EQ(cache.hits(), 1u);
+}
+
+TEST(DnsCacheTest, MissResolvesSynchronously) {
+    auto& cache = DnsCache::GetInstance();
+    host_dns_records().Set("miss.example", "10.0.1.1");
+    int lookups = host_dns_records().lookups;
+    EXPECT_EQ(cache.Resolve("miss.example"), "10.0.1.1");
+    EXPECT_EQ(cache.Resolve("miss.example"), "10.0.1.1");
+    EXPECT_EQ(host_dns_records().lookups, lookups + 1);
+
+    // 解析失败和 IP 地址原样返回
+    EXPECT_EQ(cache.Resolve("unknown.example"), "unknown.example");
+    EXPECT_EQ(cache.Resolve("192.168.1.1"), "192.168.1.1");
+}
+
+TEST(DnsCacheTest, ExpiredEntryIsServedStale) {
+    auto& cache = DnsCache::GetInstance();
+    host_dns_records().Set("expire.example", "10.0.2.1");
+    EXPECT_EQ(cache.Resolve("expire.example"), "10.0.2.1");
+
+    host_dns_records().Set("expire.example", "10.0.2.2");
+    host_timer_advance_us(601LL * 1000000);
+    EXPECT_EQ(cache.Resolve("expire.example"), "10.0.2.1");
+    WaitForAddress("expire.example", "10.0.2.2");
+    EXPECT_EQ(cache.Resolve("expire.example"), "10.0.2.2");
+}
+
+TEST(DnsCacheTest, ResolveCachedNeverLooksUp) {
+    auto& cache = DnsCache::GetInstance();
+    host_dns_records().Set("modem.example", "10.0.3.1");
+    int lookups = host_dns_records().lookups;
+    EXPECT_EQ(cache.ResolveCached("modem.example"), "modem.example");
+    EXPECT_EQ(host_dns_records().lookups, lookups);
+
+    cache.Resolve("modem.example");
+    EXPECT_EQ(cache.ResolveCached("modem.example"), "10.0.3.1");
+}
+
+TEST(DnsCacheTest, EvictsLeastRecentlyUsed) {
+    auto& cache = DnsCache::GetInstance();
+    for (int i = 0; i < 8; i++) {
+        std::string host = "lru" + std::to_string(i) + ".example";
+        host_dns_records().Set(host, "10.0.4." + std::to_string(i + 1));
+        cache.Resolve(host);
+        host_timer_advance_us(1000);
+    }
+    // 重新使用 lru0，最久未使用的变成 lru1
+    cache.Resolve("lru0.example");
+    host_timer_advance_us(1000);
+    host_dns_records().Set("lru8.example", "10.0.4.9");
+    cache.Resolve("lru8.example");
+
+    EXPECT_NE(cache.GetStatsJson().find("\"entries\":8}"), std::string::npos) << cache.GetStatsJson();
+    const auto& saved = host_settings_store()["dns.entries"];
+    EXPECT_NE(saved.find("lru0.example"), std::string::npos);
+    EXPECT_EQ(saved.find("lru1.example"), std::string::npos);
+    EXPECT_NE(saved.find("lru8.example"), std::string::npos);
+
+    int lookups = host_dns_records().lookups;
+    cache.Resolve("lru0.example");
+    EXPECT_EQ(host_dns_records().lookups, lookups);
+    cache.Resolve("lru1.example");
+    EXPECT_EQ(host_dns_records().lookups, lookups + 1);
+}
+
+TEST(DnsCacheTest, InvalidateForcesLookup) {
+    auto& cache = DnsCache::GetInstance();
+    host_dns_records().Set("invalid.example", "10.0.5.1");
+    cache.Resolve("invalid.example");
+    host_dns_records().Set("invalid.example", "10.0.5.2");
+    cache.Invalidate("invalid.example");
+    EXPECT_EQ(cache.Resolve("invalid.example"), "10.0.5.2");
+}
@@ -0,0 +1,8 @@
+// 主机测试用的 main/mcp_common_tools.cc：没有 Board，不注册设备工具，也不处理摄像头能力
+#include "mcp_server.h"
+
+void McpServer::AddCommonTools() {
+}
+
+void McpServer::ParseCapabilities(const cJSON* capabilities) {
+}
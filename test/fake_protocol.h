@@ -0,0 +1,43 @@
+#pragma once
+// 主机测试用的 Protocol 实现：不连接网络，只记录发出的消息
+#include <string>
+#include <vector>
+
+#include "protocol.h"
+
+class FakeProtocol : public Protocol {
+public:
+    bool record_messages = true;
+    std::vector<std::string> messages;
+    // 与 messages 一一对应，未要求合并的消息为空
+    std::vector<std::string> coalesce_keys;
+    size_t sent_count = 0;
+    size_t sent_bytes = 0;
+
+    void set_session_id(const std::string& session_id) { session_id_ = session_id; }
+
+    bool Start() override { return true; }
+    bool OpenAudioChannel() override { return true; }
+    void CloseAudioChannel() override {}
+    bool IsAudioChannelOpened() const override { return true; }
+    bool MigrateTransport() override { return true; }
+    bool SendAudio(const AudioStreamPacket& packet) override { return true; }
+
+protected:
+    bool SendText(std::string_view text) override {
+        sent_count++;
+        sent_bytes += text.size();
+        if (record_messages) {
+            messages.emplace_back(text);
+            coalesce_keys.emplace_back();
+        }
+        return true;
+    }
+    bool SendCoalescedText(std::string_view text, std::string_view key) override {
+        bool sent = SendText(text);
+        if (record_messages) {
+            coalesce_keys.back() = key;
+        }
+        return sent;
+    }
+};
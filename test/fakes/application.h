@@ -0,0 +1,15 @@
+#pragma once
+// 主机测试用的 application.h：Schedule 直接在调用方线程执行
+#include <functional>
+
+#define OPUS_FRAME_DURATION_MS 60
+
+class Application {
+public:
+    static Application& GetInstance() {
+        static Application instance;
+        return instance;
+    }
+
+    void Schedule(std::function<void()> callback) { callback(); }
+};
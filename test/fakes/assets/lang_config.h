@@ -0,0 +1,10 @@
+#pragma once
+// 主机测试用的 lang_config.h：固件构建时由语言包生成，这里只提供协议层用到的字符串
+namespace Lang {
+namespace Strings {
+constexpr const char* SERVER_ERROR = "SERVER_ERROR";
+constexpr const char* SERVER_NOT_FOUND = "SERVER_NOT_FOUND";
+constexpr const char* SERVER_NOT_CONNECTED = "SERVER_NOT_CONNECTED";
+constexpr const char* SERVER_TIMEOUT = "SERVER_TIMEOUT";
+} // namespace Strings
+} // namespace Lang
@@ -0,0 +1,23 @@
+#pragma once
+// 主机测试用的 board.h：只提供协议层用到的接口，创建的连接对象由测试取出
+#include <string>
+
+#include <mqtt.h>
+#include <udp.h>
+
+class Board {
+public:
+    static Board& GetInstance() {
+        static Board instance;
+        return instance;
+    }
+
+    std::string board_type = "wifi";
+    FakeMqtt* last_mqtt = nullptr;
+    FakeUdp* last_udp = nullptr;
+
+    std::string GetBoardType() { return board_type; }
+    Mqtt* CreateMqtt() { return last_mqtt = new FakeMqtt(); }
+    Udp* CreateUdp() { return last_udp = new FakeUdp(); }
+    std::string ResolveHost(const std::string& host) { return host; }
+};
@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "json_reader.h"
+
+// 字段指向原始报文，报文必须比 message 活得久
+static bool Parse(const char* json, ControlMessage& message) {
+    return ParseControlMessage(json, strlen(json), message);
+}
+
+TEST(JsonReaderTest, ExtractsKnownFields) {
+    ControlMessage message;
+    ASSERT_TRUE(Parse(R"({"type":"tts","state":"sentence_start","text":"你好","session_id":"abc"})", message));
+    EXPECT_EQ(message.type, "tts");
+    EXPECT_EQ(message.state, "sentence_start");
+    EXPECT_EQ(message.text, "你好");
+    EXPECT_EQ(message.session_id, "abc");
+    EXPECT_FALSE(message.emotion.present);
+    EXPECT_FALSE(message.command.present);
+}
+
+TEST(JsonReaderTest, SkipsNestedValuesAndUnknownKeys) {
+    ControlMessage message;
+    std::string json = R"({ "payload" : {"type":"inner","list":[1,{"x":"}"}]}, "n": -1.5e3, "ok": true,)"
+                       R"( "none": null, "type" : "mcp" })";
+    ASSERT_TRUE(Parse(json.c_str(), message));
+    EXPECT_EQ(message.type, "mcp");
+    EXPECT_EQ(message.json, json.data());
+    EXPECT_EQ(message.length, json.size());
+}
+
+TEST(JsonReaderTest, NonStringFieldIsNotPresent) {
+    ControlMessage message;
+    ASSERT_TRUE(Parse(R"({"type":"iot","id":42})", message));
+    EXPECT_EQ(message.type, "iot");
+    EXPECT_FALSE(message.id.present);
+}
+
+TEST(JsonReaderTest, EmptyObject) {
+    ControlMessage message;
+    ASSERT_TRUE(Parse("{}", message));
+    EXPECT_FALSE(message.type.present);
+}
+
+TEST(JsonReaderTest, RejectsMalformedInput) {
+    ControlMessage message;
+    for (const char* json : {"", "[]", "{", R"({"type")", R"({"type":"tts")", R"({"type":"tts",})",
+                             R"({"type":"unterminated})", R"({"a":{"b":1})", R"({type:"tts"})"}) {
+        EXPECT_FALSE(Parse(json, message)) << json;
+    }
+}
+
+TEST(JsonReaderTest, EscapedStringsCompareOnlyAfterUnescape) {
+    ControlMessage message;
+    ASSERT_TRUE(Parse(R"({"type":"t\u0074s","text":"a\"b\\c\/d\n\t"})", message));
+    EXPECT_TRUE(message.type.escaped);
+    EXPECT_NE(message.type, "tts");
+    EXPECT_EQ(message.type.str(), "tts");
+    EXPECT_EQ(message.text.str(), "a\"b\\c/d\n\t");
+}
+
+TEST(JsonReaderTest, UnescapesUnicodeToUtf8) {
+    ControlMessage message;
+    ASSERT_TRUE(Parse(R"({"text":"\u00e9\u4f60\ud83d\ude00"})", message));
+    EXPECT_EQ(message.text.str(), "\xC3\xA9\xE4\xBD\xA0\xF0\x9F\x98\x80");
+}
+
+TEST(JsonReaderTest, LoneSurrogatesBecomeReplacementCharacter) {
+    const std::string replacement = "\xEF\xBF\xBD";
+    ControlMessage message;
+
+    ASSERT_TRUE(Parse(R"({"text":"a\ud83db"})", message));
+    EXPECT_EQ(message.text.str(), "a" + replacement + "b");
+
+    ASSERT_TRUE(Parse(R"({"text":"\ud83d"})", message));
+    EXPECT_EQ(message.text.str(), replacement);
+
+    // 高代理项后面的转义不是低代理项：高代理项被替换，后一个转义照常解码
+    ASSERT_TRUE(Parse(R"({"text":"\ud83d\u0041"})", message));
+    EXPECT_EQ(message.text.str(), replacement + "A");
+
+    ASSERT_TRUE(Parse(R"({"text":"\ude00x"})", message));
+    EXPECT_EQ(message.text.str(), replacement + "x");
+}
+
+TEST(JsonReaderTest, TruncatedUnicodeEscapeStops) {
+    ControlMessage message;
+    ASSERT_TRUE(Parse(R"({"text":"ab\u12"})", message));
+    EXPECT_EQ(message.text.str(), "ab");
+}
+
+TEST(JsonReaderTest, ForEachArrayElement) {
+    std::string json = R"([ {"type":"a"}, "s,t", [1,2], 3 ,null])";
+    std::vector<std::string> elements;
+    ASSERT_TRUE(ForEachArrayElement(json.data(), json.size(), [&](std::string_view element) {
+        elements.emplace_back(element);
+    }));
+    ASSERT_EQ(elements.size(), 5u);
+    EXPECT_EQ(elements[0], R"({"type":"a"})");
+    EXPECT_EQ(elements[1], R"("s,t")");
+    EXPECT_EQ(elements[2], "[1,2]");
+    EXPECT_EQ(elements[3], "3");
+    EXPECT_EQ(elements[4], "null");
+
+    int count = 0;
+    EXPECT_TRUE(ForEachArrayElement("[]", 2, [&](std::string_view) { count++; }));
+    EXPECT_EQ(count, 0);
+    EXPECT_FALSE(ForEachArrayElement("{}", 2, [&](std::string_view) { count++; }));
+    EXPECT_FALSE(ForEachArrayElement("[1,", 3, [&](std::string_view) { count++; }));
+}
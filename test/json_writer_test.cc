@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "json_writer.h"
+
+TEST(JsonWriterTest, WritesNestedContainersWithCommas) {
+    StaticJsonWriter<256> writer;
+    writer.BeginObject()
+        .Field("type", "listen")
+        .Field("id", -42)
+        .Field("ok", true)
+        .Key("list").BeginArray().Number(1).String("a").BeginObject().EndObject().EndArray()
+        .Key("empty").BeginArray().EndArray()
+        .RawField("raw", R"({"x":1})")
+        .EndObject();
+    EXPECT_FALSE(writer.overflow());
+    EXPECT_EQ(writer.view(), R"({"type":"listen","id":-42,"ok":true,"list":[1,"a",{}],"empty":[],"raw":{"x":1}})");
+}
+
+TEST(JsonWriterTest, EscapesStrings) {
+    StaticJsonWriter<128> writer;
+    std::string value("q\"b\\n\nr\rt\tb\bf\f");
+    value.push_back('\x01');
+    value += "中文";
+    writer.BeginObject().Field("text", value).EndObject();
+    EXPECT_EQ(writer.view(), "{\"text\":\"q\\\"b\\\\n\\nr\\rt\\tb\\bf\\f\\u0001中文\"}");
+    EXPECT_EQ(JsonWriter::EscapedLength(value), writer.size() - std::string("{\"text\":\"\"}").size());
+}
+
+TEST(JsonWriterTest, EmptyStringViewWithNullData) {
+    StaticJsonWriter<32> writer;
+    writer.BeginObject().Field("a", std::string_view()).RawField("b", std::string_view("1")).EndObject();
+    EXPECT_FALSE(writer.overflow());
+    EXPECT_EQ(writer.view(), R"({"a":"","b":1})");
+}
+
+TEST(JsonWriterTest, OverflowTruncatesAndIsReported) {
+    StaticJsonWriter<16> writer;
+    writer.BeginObject().Field("session_id", "0123456789abcdef").EndObject();
+    EXPECT_TRUE(writer.overflow());
+    EXPECT_EQ(writer.size(), 16u);
+
+    StaticJsonWriter<8> exact;
+    exact.BeginObject().Field("a", 1).EndObject();
+    EXPECT_FALSE(exact.overflow());
+    EXPECT_EQ(exact.view(), R"({"a":1})");
+}
+
+TEST(JsonWriterTest, ZeroCapacity) {
+    JsonWriter writer(nullptr, 0);
+    writer.BeginObject().Field("a", "").EndObject();
+    EXPECT_TRUE(writer.overflow());
+    EXPECT_EQ(writer.size(), 0u);
+}
+
+TEST(JsonWriterTest, TooDeepNestingOverflows) {
+    StaticJsonWriter<256> writer;
+    for (int i = 0; i < 33; i++) {
+        writer.BeginArray();
+    }
+    EXPECT_TRUE(writer.overflow());
+}
+
+TEST(JsonWriterTest, ValuesBeyondMaxDepthAreSafe) {
+    StaticJsonWriter<256> writer;
+    for (int i = 0; i < 33; i++) {
+        writer.BeginArray();
+    }
+    // 第 33、34 层写入元素不能越过 has_items_ 的位数
+    writer.Number(1).Number(2).BeginObject().Field("a", 1).EndObject();
+    for (int i = 0; i < 33; i++) {
+        writer.EndArray();
+    }
+    EXPECT_TRUE(writer.overflow());
+}
@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "lvgl_idle_tracker.h"
+
+// 按 LvglRefreshScheduler 的方式驱动：运行时每 LVGL_IDLE_CHECK_MS 检查一次，暂停期间定时器停止，
+// 只有对象失效才会唤醒。每次唤醒都伴随一次刷新
+namespace {
+
+constexpr int64_t kCheckUs = LVGL_IDLE_CHECK_MS * 1000;
+constexpr int64_t kMinuteUs = LVGL_STATS_INTERVAL_US;
+
+struct Simulation {
+    LvglIdleTracker tracker;
+    int64_t now = 0;
+    int64_t awake_us = 0;
+    bool sleeping = false;
+
+    // 运行到 until，invalidations 是对象失效的时间点（升序）
+    void Run(int64_t until, const std::vector<int64_t>& invalidations = {}, bool always_active = false) {
+        size_t next = 0;
+        while (now < until) {
+            if (sleeping) {
+                if (next >= invalidations.size() || invalidations[next] >= until) {
+                    now = until;
+                    break;
+                }
+                // 唤醒的这次失效留给下面的检查周期处理
+                now = invalidations[next];
+                tracker.OnWake(now);
+                sleeping = false;
+                continue;
+            }
+            int64_t check = now + kCheckUs;
+            bool active = always_active;
+            while (next < invalidations.size() && invalidations[next] < check) {
+                if (invalidations[next] >= now) {
+                    active = true;
+                    tracker.OnRefresh();
+                }
+                next++;
+            }
+            awake_us += check - now;
+            now = check;
+            if (tracker.Check(active)) {
+                tracker.OnSleep(now);
+                sleeping = true;
+            }
+        }
+    }
+};
+
+} // namespace
+
+TEST(LvglIdleTrackerTest, IdleMinuteHasNoWakeups) {
+    Simulation sim;
+    sim.tracker.Start(0);
+    sim.Run(kMinuteUs);
+    LvglIdleStats stats;
+    ASSERT_TRUE(sim.tracker.TakeStatsIfDue(sim.now, stats));
+    EXPECT_EQ(stats.elapsed_us, kMinuteUs);
+    EXPECT_EQ(stats.wakeups, 0u);
+    EXPECT_EQ(stats.refreshes, 0u);
+    // 开机后只运行 LVGL_IDLE_TIMEOUT_MS；暂停的时长在唤醒时才累计，一直暂停时也不会输出统计
+    EXPECT_EQ(sim.awake_us, LVGL_IDLE_TIMEOUT_MS * 1000);
+    EXPECT_EQ(stats.slept_us, 0);
+}
+
+TEST(LvglIdleTrackerTest, ClockUpdateCostsOneWakeupPerMinute) {
+    Simulation sim;
+    sim.tracker.Start(0);
+    // 状态栏时钟每分钟变化一次，其余时间没有失效
+    std::vector<int64_t> ticks;
+    for (int minute = 1; minute <= 3; minute++) {
+        ticks.push_back(minute * kMinuteUs - 500000);
+    }
+    sim.Run(kMinuteUs, ticks);
+    LvglIdleStats stats;
+    ASSERT_TRUE(sim.tracker.TakeStatsIfDue(sim.now, stats));
+
+    int64_t awake_before = sim.awake_us;
+    sim.Run(2 * kMinuteUs, ticks);
+    ASSERT_TRUE(sim.tracker.TakeStatsIfDue(sim.now, stats));
+    EXPECT_EQ(stats.wakeups, 1u);
+    EXPECT_EQ(stats.refreshes, 1u);
+    // 唤醒后再空闲 LVGL_IDLE_TIMEOUT_MS 就重新暂停，一分钟内运行的时间不超过一个超时加一个检查周期
+    EXPECT_LE(sim.awake_us - awake_before, LVGL_IDLE_TIMEOUT_MS * 1000 + kCheckUs);
+    EXPECT_GE(stats.slept_us * 100 / stats.elapsed_us, 95);
+}
+
+TEST(LvglIdleTrackerTest, ActivityKeepsLvglRunning) {
+    Simulation sim;
+    sim.tracker.Start(0);
+    sim.Run(kMinuteUs, {}, true);
+    EXPECT_FALSE(sim.sleeping);
+    EXPECT_EQ(sim.awake_us, kMinuteUs);
+
+    // 活动停止后连续空闲 LVGL_IDLE_TIMEOUT_MS 才暂停
+    for (int i = 1; i < LVGL_IDLE_TIMEOUT_MS / LVGL_IDLE_CHECK_MS; i++) {
+        EXPECT_FALSE(sim.tracker.Check(false));
+    }
+    EXPECT_TRUE(sim.tracker.Check(false));
+    sim.tracker.OnSleep(sim.now);
+    // 暂停后重新计时
+    EXPECT_FALSE(sim.tracker.Check(false));
+}
+
+TEST(LvglIdleTrackerTest, StatsAreTakenOncePerInterval) {
+    LvglIdleTracker tracker;
+    tracker.Start(1000);
+    LvglIdleStats stats;
+    EXPECT_FALSE(tracker.TakeStatsIfDue(1000 + kMinuteUs - 1, stats));
+
+    tracker.OnSleep(2000);
+    tracker.OnWake(5000);
+    tracker.OnRefresh();
+    ASSERT_TRUE(tracker.TakeStatsIfDue(1000 + kMinuteUs, stats));
+    EXPECT_EQ(stats.slept_us, 3000);
+    EXPECT_EQ(stats.wakeups, 1u);
+    EXPECT_EQ(stats.refreshes, 1u);
+
+    // 取出后清零并重新计时
+    EXPECT_FALSE(tracker.TakeStatsIfDue(1000 + kMinuteUs + 1, stats));
+    ASSERT_TRUE(tracker.TakeStatsIfDue(1000 + 2 * kMinuteUs, stats));
+    EXPECT_EQ(stats.slept_us, 0);
+    EXPECT_EQ(stats.wakeups, 0u);
+    EXPECT_EQ(stats.refreshes, 0u);
+}
@@ -0,0 +1,297 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <cJSON.h>
+
+#include "mcp_server.h"
+
+// McpServer 是单例，每个用例注册名字不同的工具；回复经 OnOutgoingMessage 收集
+namespace {
+
+class McpServerTest : public ::testing::Test {
+protected:
+    McpServer& server = McpServer::GetInstance();
+
+    void SetUp() override {
+        server.OnOutgoingMessage([this](std::shared_ptr<EnvelopeBuffer> message) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            messages_.emplace_back(message->payload());
+            cv_.notify_all();
+        });
+    }
+
+    void TearDown() override {
+        server.OnOutgoingMessage(nullptr);
+    }
+
+    // 工具调用的回复来自线程池，等到收齐 count 条或超时
+    std::vector<std::string> WaitForMessages(size_t count) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait_for(lock, std::chrono::seconds(5), [this, count] { return messages_.size() >= count; });
+        return messages_;
+    }
+
+    // 不等待，直接取当前已收到的消息
+    std::vector<std::string> Messages() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return messages_;
+    }
+
+    static std::string ToolsList(int id, const std::string& cursor) {
+        return R"({"jsonrpc":"2.0","id":)" + std::to_string(id) + R"(,"method":"tools/list","params":{"cursor":")" + cursor + "\"}}";
+    }
+
+    static std::string Call(int id, const std::string& name, const std::string& arguments) {
+        return R"({"jsonrpc":"2.0","id":)" + std::to_string(id) +
+            R"(,"method":"tools/call","params":{"name":")" + name + R"(","arguments":)" + arguments + "}}";
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<std::string> messages_;
+};
+
+} // namespace
+
+TEST_F(McpServerTest, BindsMoreThanThirtyTwoArguments) {
+    PropertyList properties;
+    for (int i = 0; i < 40; i++) {
+        properties.AddProperty(Property("p" + std::to_string(i), kPropertyTypeInteger));
+    }
+    server.AddTool("test.wide", "Tool with 40 required arguments", properties, [](const PropertyList& arguments) -> ReturnValue {
+        int sum = 0;
+        for (size_t slot = 0; slot < arguments.size(); slot++) {
+            sum += arguments[slot].value<int>();
+        }
+        return sum;
+    });
+
+    std::string all = "{";
+    for (int i = 0; i < 40; i++) {
+        all += (i ? "," : "") + std::string("\"p") + std::to_string(i) + "\":" + std::to_string(i);
+    }
+    server.ParseMessage(Call(1, "test.wide", all + "}"));
+    auto messages = WaitForMessages(1);
+    ASSERT_EQ(messages.size(), 1u);
+    EXPECT_NE(messages[0].find(R"("text":"780")"), std::string::npos) << messages[0];
+
+    // 槽位 35 超出 32 位掩码的范围，缺失时也必须报错
+    std::string missing = all.substr(0, all.find(",\"p35\"")) + all.substr(all.find(",\"p36\"")) + "}";
+    server.ParseMessage(Call(2, "test.wide", missing));
+    messages = WaitForMessages(2);
+    ASSERT_EQ(messages.size(), 2u);
+    EXPECT_NE(messages[1].find("Missing valid argument: p35"), std::string::npos) << messages[1];
+}
+
+// schema 在编译期生成，这里的 static_assert 本身就是测试
+constexpr McpArgs kLightArgs(McpArg<int>("level", 50, 0, 100), McpArg<bool>("enabled", true),
+    McpArg<std::string>("mode"), McpArg<std::string>("label", "a \"b\""));
+static_assert(kLightArgs.schema() ==
+    R"({"type":"object","properties":{"level":{"type":"integer","default":50,"minimum":0,"maximum":100},)"
+    R"("enabled":{"type":"boolean","default":true},"mode":{"type":"string"},"label":{"type":"string","default":"a \"b\""}},)"
+    R"("required":["mode"]})");
+static_assert(McpArgs().schema() == R"({"type":"object","properties":{}})");
+static_assert(McpArgs(McpArg<bool>("on", false)).schema() ==
+    R"({"type":"object","properties":{"on":{"type":"boolean","default":false}}})");
+
+TEST_F(McpServerTest, TypedSchemaMatchesPropertyList) {
+    PropertyList properties;
+    properties.AddProperty(Property("level", kPropertyTypeInteger, 50, 0, 100));
+    properties.AddProperty(Property("enabled", kPropertyTypeBoolean, true));
+    properties.AddProperty(Property("mode", kPropertyTypeString));
+    properties.AddProperty(Property("label", kPropertyTypeString, std::string("a \"b\"")));
+    McpTool legacy("test.schema", "Schema", properties, [](const PropertyList&) -> ReturnValue { return true; });
+    McpTool typed("test.schema", "Schema", kLightArgs.schema(), nullptr);
+    EXPECT_EQ(typed.to_json(), legacy.to_json());
+}
+
+TEST_F(McpServerTest, TypedArgumentsAreBoundAndChecked) {
+    server.AddTool("test.typed", "Typed tool",
+        McpArgs(McpArg<int>("level", 50, 0, 100), McpArg<bool>("enabled", true), McpArg<std::string>("mode")),
+        [](int level, bool enabled, const std::string& mode) -> ReturnValue {
+            return mode + ":" + std::to_string(level) + ":" + (enabled ? "on" : "off");
+        });
+
+    // 缺省参数取默认值，未声明的参数和类型不符的参数被忽略
+    server.ParseMessage(Call(1, "test.typed", R"({"mode":"eco","extra":1,"enabled":"yes"})"));
+    auto messages = WaitForMessages(1);
+    ASSERT_EQ(messages.size(), 1u);
+    EXPECT_NE(messages[0].find(R"("text":"eco:50:on")"), std::string::npos) << messages[0];
+
+    server.ParseMessage(Call(2, "test.typed", R"({"mode":"eco","level":101})"));
+    server.ParseMessage(Call(3, "test.typed", R"({"mode":1,"level":10})"));
+    messages = WaitForMessages(3);
+    ASSERT_EQ(messages.size(), 3u);
+    EXPECT_NE(messages[1].find("Value exceeds maximum allowed: 100"), std::string::npos) << messages[1];
+    EXPECT_NE(messages[2].find("Missing valid argument: mode"), std::string::npos) << messages[2];
+}
+
+TEST_F(McpServerTest, BatchRepliesAreSentAsOneMessage) {
+    server.AddTool("test.batch", "Batch tool", McpArgs(McpArg<int>("value")), [](int value) -> ReturnValue {
+        return value * 2;
+    });
+
+    // 线程池中的调用、同步回复和通知混在一个批量里，只回复一条消息
+    server.ParseMessage("[" + Call(1, "test.batch", R"({"value":21})") + "," +
+        R"({"jsonrpc":"2.0","method":"notifications/initialized"},)" +
+        R"({"jsonrpc":"2.0","id":2,"method":"no/such/method"},)" +
+        Call(3, "test.batch", R"({"value":1})") + "]");
+    auto messages = WaitForMessages(1);
+    ASSERT_EQ(messages.size(), 1u);
+    const auto& batch = messages[0];
+    EXPECT_EQ(batch.front(), '[');
+    EXPECT_EQ(batch.back(), ']');
+    EXPECT_NE(batch.find(R"("id":1,"result":{"content":[{"type":"text","text":"42"}])"), std::string::npos) << batch;
+    EXPECT_NE(batch.find(R"("id":2,"error":{"code":-32601)"), std::string::npos) << batch;
+    EXPECT_NE(batch.find(R"("id":3,"result")"), std::string::npos) << batch;
+
+    // 全是通知的批量不回复，空批量回复 -32600
+    server.ParseMessage(R"([{"jsonrpc":"2.0","method":"notifications/initialized"}])");
+    server.ParseMessage("[]");
+    messages = WaitForMessages(2);
+    ASSERT_EQ(messages.size(), 2u);
+    EXPECT_NE(messages[1].find(R"("id":null,"error":{"code":-32600)"), std::string::npos) << messages[1];
+}
+
+TEST_F(McpServerTest, ProgressIsSentOnlyWithToken) {
+    server.AddTool("test.progress", "Progress tool", McpArgs(), [this]() -> ReturnValue {
+        server.SendProgress(1, 2, "half \"way\"");
+        return true;
+    });
+
+    server.ParseMessage(R"({"jsonrpc":"2.0","id":1,"method":"tools/call","params":{"name":"test.progress","_meta":{"progressToken":"tok"}}})");
+    auto messages = WaitForMessages(2);
+    ASSERT_EQ(messages.size(), 2u);
+    EXPECT_EQ(messages[0], R"({"jsonrpc":"2.0","method":"notifications/progress","params":{"progressToken":"tok","progress":1,"total":2,"message":"half \"way\""}})");
+    EXPECT_NE(messages[1].find(R"("id":1,"result")"), std::string::npos) << messages[1];
+
+    server.ParseMessage(Call(2, "test.progress", "{}"));
+    messages = WaitForMessages(3);
+    ASSERT_EQ(messages.size(), 3u);
+    EXPECT_NE(messages[2].find(R"("id":2,"result")"), std::string::npos) << messages[2];
+}
+
+TEST_F(McpServerTest, QueuedCallsCanBeCancelledAndFullQueueIsRejected) {
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::atomic<int> running{0};
+    server.AddTool("test.block", "Blocking tool", McpArgs(), [released, &running]() -> ReturnValue {
+        running++;
+        released.wait();
+        return true;
+    });
+
+    // 占满小栈档位的两个工作线程
+    server.ParseMessage(Call(1, "test.block", "{}"));
+    server.ParseMessage(Call(2, "test.block", "{}"));
+    for (int i = 0; i < 500 && running < MCP_TOOL_POOL_SMALL_WORKERS; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_EQ(running, MCP_TOOL_POOL_SMALL_WORKERS);
+
+    // 排满队列，再多一个被拒绝
+    for (int id = 10; id < 10 + MCP_TOOL_POOL_QUEUE_DEPTH; id++) {
+        server.ParseMessage(Call(id, "test.block", "{}"));
+    }
+    server.ParseMessage(Call(99, "test.block", "{}"));
+    auto messages = Messages();
+    ASSERT_EQ(messages.size(), 1u);
+    EXPECT_NE(messages[0].find(R"("id":99,"error":{"code":-32000)"), std::string::npos) << messages[0];
+
+    // 取消排队中的调用，被取消的调用不回复；正在执行的调用无法取消
+    server.ParseMessage(R"({"jsonrpc":"2.0","method":"notifications/cancelled","params":{"requestId":10,"reason":"test"}})");
+    server.ParseMessage(R"({"jsonrpc":"2.0","method":"notifications/cancelled","params":{"requestId":1}})");
+    release.set_value();
+
+    messages = WaitForMessages(1 + 1 + MCP_TOOL_POOL_QUEUE_DEPTH);
+    ASSERT_EQ(messages.size(), 1u + 1 + MCP_TOOL_POOL_QUEUE_DEPTH);
+    std::string all;
+    for (const auto& message : messages) {
+        all += message;
+    }
+    EXPECT_NE(all.find(R"("id":1,"result")"), std::string::npos);
+    EXPECT_NE(all.find(R"("id":2,"result")"), std::string::npos);
+    EXPECT_EQ(all.find(R"("id":10,)"), std::string::npos);
+    EXPECT_NE(all.find(R"("id":11,"result")"), std::string::npos);
+    // 统计包含被拒绝和被取消的调用
+    server.LogStats();
+}
+
+TEST_F(McpServerTest, ToolsListPagesCoverEveryToolOnce) {
+    // 描述足够长，30 个工具放不进一页
+    std::string description(400, 'd');
+    for (int i = 0; i < 30; i++) {
+        server.AddTool("test.page_" + std::to_string(i), description, McpArgs(), []() -> ReturnValue { return true; });
+    }
+
+    // 空 cursor 取第一页，按 nextCursor 翻到最后一页
+    std::vector<std::string> names;
+    std::string cursor;
+    int pages = 0;
+    do {
+        server.ParseMessage(ToolsList(pages + 1, cursor));
+        auto messages = Messages();
+        ASSERT_EQ(messages.size(), size_t(pages + 1));
+        cJSON* root = cJSON_Parse(messages.back().c_str());
+        ASSERT_NE(root, nullptr) << messages.back();
+        EXPECT_LE(messages.back().size(), 8000u + 64);
+        cJSON* result = cJSON_GetObjectItem(root, "result");
+        cJSON* tool = nullptr;
+        cJSON_ArrayForEach(tool, cJSON_GetObjectItem(result, "tools")) {
+            names.push_back(cJSON_GetObjectItem(tool, "name")->valuestring);
+        }
+        cJSON* next = cJSON_GetObjectItem(result, "nextCursor");
+        cursor = cJSON_IsString(next) ? next->valuestring : "";
+        cJSON_Delete(root);
+        pages++;
+    } while (!cursor.empty() && pages < 100);
+    EXPECT_GT(pages, 1);
+    for (int i = 0; i < 30; i++) {
+        EXPECT_EQ(std::count(names.begin(), names.end(), "test.page_" + std::to_string(i)), 1) << i;
+    }
+
+    // 不是某一页起点的 cursor 都无效
+    for (const char* invalid : {"abc", "1x", "100000"}) {
+        server.ParseMessage(ToolsList(200, invalid));
+    }
+    auto messages = Messages();
+    ASSERT_EQ(messages.size(), size_t(pages + 3));
+    for (size_t i = pages; i < messages.size(); i++) {
+        EXPECT_NE(messages[i].find(R"("id":200,"error":{"code":-32602)"), std::string::npos) << messages[i];
+    }
+}
+
+// 超大的工具会让之后的 tools/list 页都报错，必须是最后一个用例
+TEST_F(McpServerTest, OversizedToolIsReportedAfterEarlierPages) {
+    server.AddTool("test.oversized", std::string(9000, 'd'), McpArgs(), []() -> ReturnValue { return true; });
+
+    std::string cursor;
+    std::string last;
+    for (int id = 1; id < 100; id++) {
+        server.ParseMessage(ToolsList(id, cursor));
+        auto messages = Messages();
+        ASSERT_EQ(messages.size(), size_t(id));
+        last = messages.back();
+        if (last.find("\"error\"") != std::string::npos) {
+            break;
+        }
+        // 超大工具之前的页正常返回
+        cJSON* root = cJSON_Parse(last.c_str());
+        ASSERT_NE(root, nullptr) << last;
+        cJSON* next = cJSON_GetObjectItem(cJSON_GetObjectItem(root, "result"), "nextCursor");
+        ASSERT_TRUE(cJSON_IsString(next)) << last;
+        cursor = next->valuestring;
+        cJSON_Delete(root);
+    }
+    EXPECT_NE(last.find("Failed to add tool test.oversized because of payload size limit"), std::string::npos) << last;
+}
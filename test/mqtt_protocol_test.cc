@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "board.h"
+#include "mqtt_protocol.h"
+#include "settings.h"
+
+// MqttProtocol 在 fakes/ 和 stubs/ 的替身上运行：FakeMqtt 收到 hello 后由测试回复服务器 hello
+namespace {
+
+const char* kServerHello =
+    R"({"type":"hello","transport":"udp","session_id":"s1",)"
+    R"("audio_params":{"sample_rate":24000,"frame_duration":60},)"
+    R"("udp":{"server":"10.0.0.1","port":8888,"key":"00112233445566778899AABBCCDDEEFF",)"
+    R"("nonce":"01000000000000000000000000000000","multi_frame":true}})";
+
+class MqttProtocolTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        host_settings_store().clear();
+        Settings settings("mqtt", true);
+        settings.SetString("endpoint", "broker.local:1883");
+        settings.SetString("publish_topic", "device/up");
+    }
+
+    void TearDown() override {
+        host_settings_store().clear();
+    }
+
+    // 在单独的线程中打开音频通道，超时说明打开过程卡死，此时泄漏协议对象而不是等待线程
+    bool OpenWithTimeout(MqttProtocol* protocol) {
+        auto result = std::make_shared<std::promise<bool>>();
+        auto future = result->get_future();
+        std::thread([protocol, result]() {
+            result->set_value(protocol->OpenAudioChannel());
+        }).detach();
+        if (future.wait_for(std::chrono::seconds(5)) != std::future_status::ready) {
+            ADD_FAILURE() << "OpenAudioChannel did not return";
+            return false;
+        }
+        return future.get();
+    }
+
+    // 与服务器相同的 UDP 包格式，替身的 AES-CTR 不加密，负载原样放在包头之后
+    static std::string UdpPacket(uint8_t type, uint8_t flags, uint32_t timestamp, uint32_t sequence, const std::string& payload) {
+        std::string packet(16, '\0');
+        packet[0] = type;
+        packet[1] = flags;
+        uint16_t size = htons(payload.size());
+        timestamp = htonl(timestamp);
+        sequence = htonl(sequence);
+        memcpy(&packet[2], &size, sizeof(size));
+        memcpy(&packet[8], &timestamp, sizeof(timestamp));
+        memcpy(&packet[12], &sequence, sizeof(sequence));
+        return packet + payload;
+    }
+};
+
+} // namespace
+
+TEST_F(MqttProtocolTest, OpenedCallbackCanQueryAggregation) {
+    auto protocol = std::make_unique<MqttProtocol>();
+    ASSERT_TRUE(protocol->Start());
+    Board::GetInstance().last_mqtt->on_publish = [](FakeMqtt& mqtt, const std::string& payload) {
+        if (payload.find("\"hello\"") != std::string::npos) {
+            mqtt.Receive(kServerHello);
+        }
+    };
+
+    // 和 Application 的回调相同：通道打开后查询聚合状态并设置最低聚合级别
+    bool aggregation_enabled = false;
+    protocol->OnAudioChannelOpened([&]() {
+        aggregation_enabled = protocol->IsAggregationEnabled();
+        protocol->SetMinAggregationLevel(2);
+    });
+
+    if (!OpenWithTimeout(protocol.get())) {
+        protocol.release();
+        FAIL();
+    }
+    EXPECT_TRUE(aggregation_enabled);
+    ASSERT_NE(Board::GetInstance().last_udp, nullptr);
+    EXPECT_EQ(Board::GetInstance().last_udp->host, "10.0.0.1");
+    EXPECT_EQ(Board::GetInstance().last_udp->port, 8888);
+}
+
+TEST_F(MqttProtocolTest, AggregatedAudioMustMatchFrameCount) {
+    auto protocol = std::make_unique<MqttProtocol>();
+    ASSERT_TRUE(protocol->Start());
+    Board::GetInstance().last_mqtt->on_publish = [](FakeMqtt& mqtt, const std::string& payload) {
+        if (payload.find("\"hello\"") != std::string::npos) {
+            mqtt.Receive(kServerHello);
+        }
+    };
+    std::vector<AudioStreamPacket> received;
+    protocol->OnIncomingAudio([&received](AudioStreamPacket&& packet) {
+        received.push_back(std::move(packet));
+    });
+    if (!OpenWithTimeout(protocol.get())) {
+        protocol.release();
+        FAIL();
+    }
+    auto udp = Board::GetInstance().last_udp;
+    ASSERT_NE(udp, nullptr);
+
+    // 三帧聚合负载，flags 声明的帧数不符时整包丢弃
+    std::string frames = std::string("\x02" "ab" "\x01" "c" "\x03" "def");
+    udp->Receive(UdpPacket(0x02, 2, 1000, 1, frames));
+    EXPECT_TRUE(received.empty());
+
+    udp->Receive(UdpPacket(0x02, 3, 1180, 2, frames));
+    ASSERT_EQ(received.size(), 3u);
+    EXPECT_EQ(received[2].timestamp, 1180u + 2 * 60);
+    EXPECT_EQ(received[2].sample_rate, 24000);
+    EXPECT_EQ(std::string(received[2].payload.begin(), received[2].payload.end()), "def");
+}
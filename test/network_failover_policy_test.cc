@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+
+#include "network_failover_policy.h"
+
+// 采样间隔与 DualNetworkBoard 一致，时间全部由用例传入
+namespace {
+
+constexpr int64_t kSampleMs = 5000;
+constexpr int64_t kMinute = 60 * 1000;
+
+NetworkSample Good() {
+    NetworkSample sample;
+    sample.rssi = -55;
+    sample.rtt_ms = 80;
+    return sample;
+}
+
+NetworkSample WeakWifi() {
+    auto sample = Good();
+    sample.rssi = -85;
+    return sample;
+}
+
+NetworkSample Disconnected() {
+    NetworkSample sample;
+    sample.connected = false;
+    return sample;
+}
+
+} // namespace
+
+TEST(NetworkFailoverPolicyTest, SwitchesAfterConsecutiveBadSamples) {
+    NetworkFailoverPolicy policy(NetworkType::WIFI);
+    int64_t now = 0;
+    EXPECT_EQ(policy.Evaluate(NetworkType::WIFI, WeakWifi(), now += kSampleMs), FailoverAction::kNone);
+    EXPECT_EQ(policy.Evaluate(NetworkType::WIFI, WeakWifi(), now += kSampleMs), FailoverAction::kNone);
+    EXPECT_EQ(policy.Evaluate(NetworkType::WIFI, WeakWifi(), now += kSampleMs), FailoverAction::kSwitchToMl307);
+}
+
+TEST(NetworkFailoverPolicyTest, GoodSampleResetsTheCount) {
+    NetworkFailoverPolicy policy(NetworkType::WIFI);
+    int64_t now = 0;
+    policy.Evaluate(NetworkType::WIFI, WeakWifi(), now += kSampleMs);
+    policy.Evaluate(NetworkType::WIFI, WeakWifi(), now += kSampleMs);
+    EXPECT_EQ(policy.Evaluate(NetworkType::WIFI, Good(), now += kSampleMs), FailoverAction::kNone);
+    EXPECT_EQ(policy.bad_samples(), 0);
+    EXPECT_EQ(policy.Evaluate(NetworkType::WIFI, WeakWifi(), now += kSampleMs), FailoverAction::kNone);
+}
+
+TEST(NetworkFailoverPolicyTest, HighRttAndLossAreBad) {
+    NetworkFailoverPolicy policy(NetworkType::ML307);
+    auto slow = Good();
+    slow.rtt_ms = 2000;
+    auto lossy = Good();
+    lossy.loss = 0.5f;
+    int64_t now = 0;
+    policy.Evaluate(NetworkType::ML307, slow, now += kSampleMs);
+    policy.Evaluate(NetworkType::ML307, lossy, now += kSampleMs);
+    EXPECT_EQ(policy.Evaluate(NetworkType::ML307, slow, now += kSampleMs), FailoverAction::kSwitchToWifi);
+}
+
+TEST(NetworkFailoverPolicyTest, RssiIsIgnoredOnCellular) {
+    NetworkFailoverPolicy policy(NetworkType::ML307);
+    int64_t now = 0;
+    for (int i = 0; i < 5; i++) {
+        EXPECT_EQ(policy.Evaluate(NetworkType::ML307, WeakWifi(), now += kSampleMs), FailoverAction::kNone);
+    }
+}
+
+TEST(NetworkFailoverPolicyTest, ConnectFailuresCountDouble) {
+    NetworkFailoverPolicy policy(NetworkType::WIFI);
+    auto failed = Good();
+    failed.connect_failures = 1;
+    int64_t now = 0;
+    EXPECT_EQ(policy.Evaluate(NetworkType::WIFI, failed, now += kSampleMs), FailoverAction::kNone);
+    EXPECT_EQ(policy.bad_samples(), 2);
+    EXPECT_EQ(policy.Evaluate(NetworkType::WIFI, failed, now += kSampleMs), FailoverAction::kSwitchToMl307);
+}
+
+TEST(NetworkFailoverPolicyTest, DwellTimePreventsFlapping) {
+    NetworkFailoverPolicy policy(NetworkType::WIFI);
+    int64_t now = 0;
+    policy.OnSwitched(NetworkType::ML307, true, now);
+    // 备用网络立即变差，也要等到最短停留时间之后
+    for (int i = 0; i < 11; i++) {
+        EXPECT_EQ(policy.Evaluate(NetworkType::ML307, Disconnected(), now += kSampleMs), FailoverAction::kNone);
+    }
+    EXPECT_EQ(policy.Evaluate(NetworkType::ML307, Disconnected(), now += kSampleMs), FailoverAction::kSwitchToWifi);
+}
+
+TEST(NetworkFailoverPolicyTest, FailsBackAfterInitialBackoff) {
+    NetworkFailoverPolicy policy(NetworkType::WIFI);
+    int64_t now = 0;
+    policy.OnSwitched(NetworkType::ML307, true, now);
+    EXPECT_EQ(policy.failback_backoff_ms(), 5 * kMinute);
+    EXPECT_EQ(policy.Evaluate(NetworkType::ML307, Good(), 5 * kMinute - kSampleMs), FailoverAction::kNone);
+    EXPECT_EQ(policy.Evaluate(NetworkType::ML307, Good(), 5 * kMinute), FailoverAction::kSwitchToWifi);
+
+    policy.OnSwitched(NetworkType::WIFI, true, 5 * kMinute);
+    EXPECT_EQ(policy.failback_backoff_ms(), 0);
+    EXPECT_EQ(policy.Evaluate(NetworkType::WIFI, Good(), 10 * kMinute), FailoverAction::kNone);
+}
+
+TEST(NetworkFailoverPolicyTest, FailedFailbackDoublesBackoffUpToTheLimit) {
+    NetworkFailoverPolicy policy(NetworkType::WIFI);
+    int64_t now = 0;
+    policy.OnSwitched(NetworkType::ML307, true, now);
+    int64_t expected[] = {10, 20, 40, 60, 60};
+    for (auto minutes : expected) {
+        now += policy.failback_backoff_ms();
+        ASSERT_EQ(policy.Evaluate(NetworkType::ML307, Good(), now), FailoverAction::kSwitchToWifi);
+        policy.OnSwitched(NetworkType::WIFI, false, now);
+        EXPECT_EQ(policy.failback_backoff_ms(), minutes * kMinute);
+        EXPECT_EQ(policy.Evaluate(NetworkType::ML307, Good(), now + kSampleMs), FailoverAction::kNone);
+    }
+}
+
+TEST(NetworkFailoverPolicyTest, FailedFailoverStaysOnPreferred) {
+    NetworkFailoverPolicy policy(NetworkType::WIFI);
+    int64_t now = 0;
+    for (int i = 0; i < 3; i++) {
+        policy.Evaluate(NetworkType::WIFI, Disconnected(), now += kSampleMs);
+    }
+    policy.OnSwitched(NetworkType::ML307, false, now);
+    EXPECT_EQ(policy.bad_samples(), 0);
+    // 最短停留时间内不再尝试
+    for (int i = 0; i < 3; i++) {
+        EXPECT_EQ(policy.Evaluate(NetworkType::WIFI, Disconnected(), now += kSampleMs), FailoverAction::kNone);
+    }
+    now += kMinute;
+    EXPECT_EQ(policy.Evaluate(NetworkType::WIFI, Disconnected(), now), FailoverAction::kSwitchToMl307);
+}
@@ -0,0 +1,69 @@
+#!/usr/bin/env bash
+# 替身服务器 + 压测工具的端到端测试：
+# ws、wss、MQTT + UDP、MQTT over TLS 各跑两轮对话，wss 和 MQTT TLS 的第二轮必须恢复第一轮的 TLS 会话。
+# 用法: protocol_bench_e2e.sh <stand_in_server> <load_generator> <工作目录>
+set -u
+
+SERVER=$1
+GENERATOR=$2
+WORK_DIR=$3
+mkdir -p "$WORK_DIR"
+rm -f "$WORK_DIR"/events.jsonl "$WORK_DIR"/*.json
+
+# 按进程号错开端口，避免并行运行时冲突
+BASE=$((20000 + ($$ % 2000) * 10))
+WS_PORT=$BASE
+WSS_PORT=$((BASE + 1))
+MQTT_PORT=$((BASE + 2))
+MQTTS_PORT=$((BASE + 3))
+UDP_PORT=$((BASE + 4))
+
+"$SERVER" --host 127.0.0.1 --ws-port $WS_PORT --wss-port $WSS_PORT --mqtt-port $MQTT_PORT \
+    --mqtts-port $MQTTS_PORT --udp-port $UDP_PORT --ota-port 0 --control-port 0 \
+    --stt-delay 0.05 --tts-delay 0.05 --tts-duration 0.3 --log "$WORK_DIR/events.jsonl" &
+SERVER_PID=$!
+trap 'kill $SERVER_PID 2>/dev/null' EXIT
+
+for _ in $(seq 50); do
+    if (exec 3<>/dev/tcp/127.0.0.1/$WS_PORT) 2>/dev/null; then
+        break
+    fi
+    sleep 0.1
+done
+
+FAILED=0
+run() {
+    local name=$1
+    shift
+    echo "== $name"
+    if ! "$GENERATOR" -n 3 --sessions 2 --ramp 0 --think-time 0.1 --utterance 0.6 --progress-interval 0 \
+        --timeout 5 --tts-timeout 5 --json-out "$WORK_DIR/$name.json" "$@"; then
+        echo "FAILED: $name"
+        FAILED=1
+    fi
+}
+
+# 压测工具的样本中必须有会话恢复的握手
+expect_resumed() {
+    if ! grep -q '"tls_resumed_ms": \[[0-9]' "$WORK_DIR/$1.json"; then
+        echo "FAILED: $1 没有恢复 TLS 会话"
+        FAILED=1
+    fi
+}
+
+run ws-v3 --url ws://127.0.0.1:$WS_PORT/xiaozhi/v1/ --version 3
+run wss-v4 --url wss://127.0.0.1:$WSS_PORT/xiaozhi/v1/ --version 4 --aggregate 2 --insecure
+expect_resumed wss-v4
+run mqtt --transport mqtt --mqtt-endpoint 127.0.0.1:$MQTT_PORT --aggregate 2
+run mqtts --transport mqtt --mqtt-endpoint 127.0.0.1:$MQTTS_PORT --mqtt-tls --insecure
+expect_resumed mqtts
+
+# 服务器侧也要记录到会话恢复
+if ! grep '"event":"tls_handshake"' "$WORK_DIR/events.jsonl" | grep -q '"resumed":true'; then
+    echo "FAILED: 服务器没有记录到 TLS 会话恢复"
+    FAILED=1
+fi
+
+kill -TERM $SERVER_PID
+wait $SERVER_PID
+exit $FAILED
@@ -0,0 +1,192 @@
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "audio_framing.h"
+#include "mqtt_codec.h"
+#include "udp_cipher.h"
+#include "websocket.h"
+#include "protocol.h"
+
+// 压测工具的编解码，音频格式与固件的 BinaryProtocol 结构体对照
+namespace {
+
+struct Message {
+    WebSocketCodec::Opcode opcode;
+    std::string payload;
+};
+
+std::vector<Message> FeedBytewise(WebSocketCodec& codec, const std::string& data) {
+    std::vector<Message> messages;
+    for (char c : data) {
+        auto byte = static_cast<uint8_t>(c);
+        EXPECT_TRUE(codec.Feed(&byte, 1, [&messages](WebSocketCodec::Opcode opcode, std::string_view payload) {
+            messages.push_back({opcode, std::string(payload)});
+        }));
+    }
+    return messages;
+}
+
+} // namespace
+
+TEST(ProtocolBenchTest, WebSocketFramesRoundTripAllLengthEncodings) {
+    for (size_t size : {0u, 125u, 126u, 0xFFFFu, 0x10000u}) {
+        std::string payload(size, 'x');
+        for (bool mask : {false, true}) {
+            WebSocketCodec codec;
+            auto frame = WebSocketCodec::EncodeFrame(WebSocketCodec::kBinary, payload, mask);
+            std::vector<Message> messages;
+            ASSERT_TRUE(codec.Feed(reinterpret_cast<const uint8_t*>(frame.data()), frame.size(),
+                [&messages](WebSocketCodec::Opcode opcode, std::string_view data) {
+                    messages.push_back({opcode, std::string(data)});
+                }));
+            ASSERT_EQ(messages.size(), 1u) << size;
+            EXPECT_EQ(messages[0].opcode, WebSocketCodec::kBinary);
+            EXPECT_EQ(messages[0].payload, payload);
+        }
+    }
+}
+
+TEST(ProtocolBenchTest, WebSocketJoinsFragmentsAroundControlFrames) {
+    // 第一片不带 FIN，中间插入 ping
+    std::string first = WebSocketCodec::EncodeFrame(WebSocketCodec::kText, "hel", true);
+    first[0] &= 0x7F;
+    std::string data = first +
+        WebSocketCodec::EncodeFrame(WebSocketCodec::kPing, "p", true) +
+        WebSocketCodec::EncodeFrame(WebSocketCodec::kContinuation, "lo", true);
+
+    WebSocketCodec codec;
+    auto messages = FeedBytewise(codec, data);
+    ASSERT_EQ(messages.size(), 2u);
+    EXPECT_EQ(messages[0].opcode, WebSocketCodec::kPing);
+    EXPECT_EQ(messages[1].opcode, WebSocketCodec::kText);
+    EXPECT_EQ(messages[1].payload, "hello");
+}
+
+TEST(ProtocolBenchTest, WebSocketAcceptKeyMatchesRfcExample) {
+    EXPECT_EQ(WebSocketCodec::AcceptKey("dGhlIHNhbXBsZSBub25jZQ=="), "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+}
+
+TEST(ProtocolBenchTest, FindsHttpHeadersCaseInsensitively) {
+    std::string_view headers = "HTTP/1.1 101 Switching Protocols\r\nsec-websocket-accept:  abc \r\nX: y\r\n";
+    EXPECT_EQ(FindHttpHeader(headers, "Sec-WebSocket-Accept"), "abc");
+    EXPECT_EQ(FindHttpHeader(headers, "x"), "y");
+    EXPECT_TRUE(FindHttpHeader(headers, "Missing").empty());
+}
+
+TEST(ProtocolBenchTest, ParsesWebSocketUrls) {
+    bool secure;
+    std::string host, path;
+    int port;
+    ASSERT_TRUE(WebSocketClient::ParseUrl("wss://api.example.com/xiaozhi/v1/", secure, host, port, path));
+    EXPECT_TRUE(secure);
+    EXPECT_EQ(host, "api.example.com");
+    EXPECT_EQ(port, 443);
+    EXPECT_EQ(path, "/xiaozhi/v1/");
+    ASSERT_TRUE(WebSocketClient::ParseUrl("ws://127.0.0.1:8000", secure, host, port, path));
+    EXPECT_FALSE(secure);
+    EXPECT_EQ(port, 8000);
+    EXPECT_EQ(path, "/");
+    EXPECT_FALSE(WebSocketClient::ParseUrl("http://example.com/", secure, host, port, path));
+}
+
+TEST(ProtocolBenchTest, MqttPacketsSurviveArbitrarySplits) {
+    std::string payload(300, 'j');
+    std::string data = MqttCodec::Packet(MqttCodec::kConnAck, std::string("\0\0", 2)) +
+        MqttCodec::Publish("devices/p2p/a", payload) +
+        MqttCodec::Packet(MqttCodec::kPingResp);
+
+    for (size_t split = 1; split < data.size(); split += 37) {
+        MqttCodec codec;
+        std::vector<MqttCodec::PacketType> types;
+        std::string received;
+        auto callback = [&](MqttCodec::PacketType type, uint8_t flags, std::string_view body) {
+            types.push_back(type);
+            std::string_view topic, message;
+            if (type == MqttCodec::kPublish) {
+                ASSERT_TRUE(MqttCodec::ParsePublish(flags, body, topic, message));
+                EXPECT_EQ(topic, "devices/p2p/a");
+                received = message;
+            }
+        };
+        auto bytes = reinterpret_cast<const uint8_t*>(data.data());
+        ASSERT_TRUE(codec.Feed(bytes, split, callback));
+        ASSERT_TRUE(codec.Feed(bytes + split, data.size() - split, callback));
+        ASSERT_EQ(types.size(), 3u);
+        EXPECT_EQ(types[1], MqttCodec::kPublish);
+        EXPECT_EQ(received, payload);
+    }
+}
+
+TEST(ProtocolBenchTest, MqttRejectsMalformedRemainingLength) {
+    MqttCodec codec;
+    const uint8_t data[] = {0x30, 0xFF, 0xFF, 0xFF, 0xFF, 0x01};
+    EXPECT_FALSE(codec.Feed(data, sizeof(data), [](MqttCodec::PacketType, uint8_t, std::string_view) {}));
+}
+
+TEST(ProtocolBenchTest, MqttConnectCarriesClientId) {
+    auto packet = MqttCodec::Connect("GID_test@@@02_00", "user", "pass", 120);
+    MqttCodec codec;
+    std::string client_id;
+    ASSERT_TRUE(codec.Feed(reinterpret_cast<const uint8_t*>(packet.data()), packet.size(),
+        [&](MqttCodec::PacketType type, uint8_t, std::string_view body) {
+            ASSERT_EQ(type, MqttCodec::kConnect);
+            ASSERT_TRUE(MqttCodec::ParseConnect(body, client_id));
+            EXPECT_FALSE(MqttCodec::ParseConnect(body.substr(0, 11), client_id));
+        }));
+    EXPECT_EQ(client_id, "GID_test@@@02_00");
+}
+
+TEST(ProtocolBenchTest, UdpHeaderFollowsNonceTemplate) {
+    std::string key(16, '\x11');
+    std::string nonce = std::string("\x01\x00\x00\x00", 4) + "SSRC" + std::string(8, '\0');
+    UdpCipher cipher(key, nonce);
+    auto packet = cipher.Seal(UDP_PACKET_TYPE_AGGREGATED, 3, 1200, 7, "opus");
+
+    ASSERT_EQ(packet.size(), UDP_PACKET_HEADER_SIZE + 4);
+    EXPECT_EQ(static_cast<uint8_t>(packet[0]), UDP_PACKET_TYPE_AGGREGATED);
+    EXPECT_EQ(static_cast<uint8_t>(packet[1]), 3);
+    EXPECT_EQ(packet.substr(4, 4), "SSRC");
+    EXPECT_NE(packet.substr(UDP_PACKET_HEADER_SIZE), "opus");
+
+    UdpPacket opened;
+    ASSERT_TRUE(cipher.Open(reinterpret_cast<const uint8_t*>(packet.data()), packet.size(), opened));
+    EXPECT_EQ(opened.timestamp, 1200u);
+    EXPECT_EQ(opened.sequence, 7u);
+    EXPECT_EQ(opened.payload, "opus");
+}
+
+TEST(ProtocolBenchTest, WebSocketAudioUsesFirmwareHeaders) {
+    std::vector<std::string> frames = {"a", std::string(200, 'b'), "c"};
+
+    auto v2 = PackWebsocketAudio(2, frames.data(), 1, 60);
+    ASSERT_EQ(v2.size(), 1u);
+    ASSERT_EQ(v2[0].size(), sizeof(BinaryProtocol2) + 1);
+    auto bp2 = reinterpret_cast<const BinaryProtocol2*>(v2[0].data());
+    EXPECT_EQ(ntohs(bp2->version), 2);
+    EXPECT_EQ(ntohl(bp2->timestamp), 60u);
+
+    auto v3 = PackWebsocketAudio(3, frames.data(), frames.size(), 0);
+    ASSERT_EQ(v3.size(), 3u);
+    EXPECT_EQ(ntohs(reinterpret_cast<const BinaryProtocol3*>(v3[1].data())->payload_size), 200);
+
+    auto v4 = PackWebsocketAudio(4, frames.data(), frames.size(), 120);
+    ASSERT_EQ(v4.size(), 1u);
+    auto bp4 = reinterpret_cast<const BinaryProtocol4*>(v4[0].data());
+    EXPECT_EQ(bp4->frame_count, 3);
+    std::vector<std::pair<uint32_t, std::string>> unpacked;
+    ASSERT_TRUE(UnpackWebsocketAudio(4, v4[0], [&unpacked](uint32_t timestamp, std::string_view opus) {
+        unpacked.emplace_back(timestamp, std::string(opus));
+    }));
+    ASSERT_EQ(unpacked.size(), 3u);
+    EXPECT_EQ(unpacked[1].first, 180u);
+    EXPECT_EQ(unpacked[1].second, frames[1]);
+    EXPECT_EQ(unpacked[2].first, 240u);
+
+    // 截断的包不能越界读取
+    EXPECT_FALSE(UnpackWebsocketAudio(4, std::string_view(v4[0]).substr(0, v4[0].size() - 1), [](uint32_t, std::string_view) {}));
+    EXPECT_FALSE(UnpackWebsocketAudio(2, std::string_view(v2[0]).substr(0, 10), [](uint32_t, std::string_view) {}));
+}
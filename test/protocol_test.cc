@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "fake_protocol.h"
+
+TEST(ProtocolTest, ControlMessages) {
+    FakeProtocol protocol;
+    protocol.set_session_id("s1");
+    protocol.SendStartListening(kListeningModeAutoStop);
+    protocol.SendStopListening();
+    protocol.SendAbortSpeaking(kAbortReasonWakeWordDetected);
+    ASSERT_EQ(protocol.messages.size(), 3u);
+    EXPECT_EQ(protocol.messages[0], R"({"session_id":"s1","type":"listen","state":"start","mode":"auto"})");
+    EXPECT_EQ(protocol.messages[1], R"({"session_id":"s1","type":"listen","state":"stop"})");
+    EXPECT_EQ(protocol.messages[2], R"({"session_id":"s1","type":"abort","reason":"wake_word_detected"})");
+}
+
+TEST(ProtocolTest, WakeWordIsEscaped) {
+    FakeProtocol protocol;
+    protocol.SendWakeWordDetected("你好\"小智\"\n");
+    ASSERT_EQ(protocol.messages.size(), 1u);
+    EXPECT_EQ(protocol.messages[0],
+        "{\"session_id\":\"\",\"type\":\"listen\",\"state\":\"detect\",\"text\":\"你好\\\"小智\\\"\\n\"}");
+}
+
+TEST(ProtocolTest, OversizedControlMessageIsNotSent) {
+    FakeProtocol protocol;
+    protocol.SendWakeWordDetected(std::string(CONTROL_MESSAGE_BUFFER_SIZE, 'x'));
+    EXPECT_TRUE(protocol.messages.empty());
+}
+
+TEST(ProtocolTest, McpEnvelopeIsWrittenInPlace) {
+    FakeProtocol protocol;
+    protocol.set_session_id("s1");
+    auto message = std::make_shared<EnvelopeBuffer>(32);
+    std::string payload = R"({"jsonrpc":"2.0","id":1})";
+    payload.copy(message->payload_data(), payload.size());
+    message->set_payload_size(payload.size());
+    protocol.SendMcpMessage(message);
+    ASSERT_EQ(protocol.messages.size(), 1u);
+    EXPECT_EQ(protocol.messages[0], R"({"session_id":"s1","type":"mcp","payload":{"jsonrpc":"2.0","id":1}})");
+    EXPECT_EQ(message->copied_bytes(), 0u);
+}
+
+TEST(ProtocolTest, IotStatesCoalesceOnlyTheSameThings) {
+    FakeProtocol protocol;
+    protocol.set_session_id("s1");
+    protocol.SendIotStates(R"([{"name":"Speaker","state":{"volume":50}},{"name":"Lamp","state":{"power":true}}])");
+    protocol.SendIotStates(R"([{"name":"Speaker","state":{"volume":60}}])", "Speaker");
+    protocol.SendIotStates(R"([{"name":"Speaker","state":{"volume":70}},{"name":"Lamp","state":{"power":false}}])",
+        "Speaker,Lamp");
+    ASSERT_EQ(protocol.messages.size(), 3u);
+    EXPECT_EQ(protocol.messages[0],
+        R"({"session_id":"s1","type":"iot","update":true,"states":[{"name":"Speaker","state":{"volume":50}},{"name":"Lamp","state":{"power":true}}]})");
+    // 完整状态不带 key，不会被增量替换
+    EXPECT_EQ(protocol.coalesce_keys[0], "");
+    EXPECT_EQ(protocol.coalesce_keys[1], "iot_states:Speaker");
+    EXPECT_EQ(protocol.coalesce_keys[2], "iot_states:Speaker,Lamp");
+}
+
+TEST(ProtocolTest, IotDescriptorsAreRebuiltWhenGenerationChanges) {
+    FakeProtocol protocol;
+    protocol.set_session_id("s1");
+    std::vector<std::string> descriptors = {R"({"name":"Lamp"})"};
+    protocol.SendIotDescriptors(descriptors, 1);
+    // 内容变了但代数没变，仍然使用缓存；同一个 vector 的地址不变也能发现代数变化
+    descriptors[0] = R"({"name":"Speaker"})";
+    protocol.set_session_id("s2");
+    protocol.SendIotDescriptors(descriptors, 1);
+    protocol.SendIotDescriptors(descriptors, 2);
+    ASSERT_EQ(protocol.messages.size(), 3u);
+    EXPECT_EQ(protocol.messages[0], R"({"session_id":"s1","type":"iot","update":true,"descriptors":[{"name":"Lamp"}]})");
+    EXPECT_EQ(protocol.messages[1], R"({"session_id":"s2","type":"iot","update":true,"descriptors":[{"name":"Lamp"}]})");
+    EXPECT_EQ(protocol.messages[2], R"({"session_id":"s2","type":"iot","update":true,"descriptors":[{"name":"Speaker"}]})");
+}
@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "publish_queue.h"
+
+using namespace std::string_view_literals;
+
+namespace {
+
+// 发布回调在放行之前一直阻塞，让消息留在队列中
+class GatedPublisher {
+public:
+    bool Publish(const std::string& payload) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        started_ = true;
+        condition_variable_.notify_all();
+        condition_variable_.wait(lock, [this]() { return open_; });
+        published_.push_back(payload);
+        condition_variable_.notify_all();
+        return true;
+    }
+
+    // 等待发布任务取走第一条消息并阻塞在回调中
+    void WaitStarted() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        condition_variable_.wait(lock, [this]() { return started_; });
+    }
+
+    void Open() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        open_ = true;
+        condition_variable_.notify_all();
+    }
+
+    std::vector<std::string> WaitPublished(size_t count) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        condition_variable_.wait_for(lock, std::chrono::seconds(5), [&]() { return published_.size() >= count; });
+        return published_;
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable condition_variable_;
+    bool started_ = false;
+    bool open_ = false;
+    std::vector<std::string> published_;
+};
+
+} // namespace
+
+TEST(PublishQueueTest, CoalescesOnlyTheSameKey) {
+    GatedPublisher publisher;
+    PublishQueue queue([&](const std::string& payload) { return publisher.Publish(payload); });
+    ASSERT_TRUE(queue.Enqueue("hello"sv));
+    publisher.WaitStarted();
+
+    EXPECT_TRUE(queue.Enqueue("full"sv, ""));
+    EXPECT_TRUE(queue.Enqueue("speaker 1"sv, "iot_states:Speaker"));
+    EXPECT_TRUE(queue.Enqueue("lamp 1"sv, "iot_states:Lamp"));
+    EXPECT_TRUE(queue.Enqueue("speaker 2"sv, "iot_states:Speaker"));
+    publisher.Open();
+
+    auto published = publisher.WaitPublished(4);
+    EXPECT_EQ(published, (std::vector<std::string>{"hello", "full", "speaker 2", "lamp 1"}));
+}
+
+TEST(PublishQueueTest, FullQueueDropsOnlyKeyedMessages) {
+    GatedPublisher publisher;
+    PublishQueue queue([&](const std::string& payload) { return publisher.Publish(payload); });
+    ASSERT_TRUE(queue.Enqueue("in flight"sv));
+    publisher.WaitStarted();
+
+    ASSERT_TRUE(queue.Enqueue("hello"sv));
+    ASSERT_TRUE(queue.Enqueue("state 0"sv, "key0"));
+    ASSERT_TRUE(queue.Enqueue("state 1"sv, "key1"));
+    for (int i = 3; i < PUBLISH_QUEUE_MAX_MESSAGES; i++) {
+        ASSERT_TRUE(queue.Enqueue("mcp " + std::to_string(i)));
+    }
+    // 队列已满：先丢弃最旧的带 key 消息
+    EXPECT_TRUE(queue.Enqueue("goodbye"sv));
+    EXPECT_TRUE(queue.Enqueue("mcp last"sv));
+    // 没有可丢弃的消息时拒绝，而不是丢掉 hello
+    EXPECT_FALSE(queue.Enqueue("rejected"sv));
+    publisher.Open();
+
+    auto published = publisher.WaitPublished(PUBLISH_QUEUE_MAX_MESSAGES + 1);
+    ASSERT_EQ(published.size(), (size_t)PUBLISH_QUEUE_MAX_MESSAGES + 1);
+    EXPECT_EQ(published[1], "hello");
+    EXPECT_EQ(published[2], "mcp 3");
+    EXPECT_EQ(published[published.size() - 2], "goodbye");
+    EXPECT_EQ(published.back(), "mcp last");
+    for (const auto& payload : published) {
+        EXPECT_NE(payload.rfind("state", 0), 0u) << payload;
+    }
+}
+
+TEST(PublishQueueTest, ByteLimitRejectsOversizedUnkeyedMessage) {
+    GatedPublisher publisher;
+    PublishQueue queue([&](const std::string& payload) { return publisher.Publish(payload); });
+    ASSERT_TRUE(queue.Enqueue("in flight"sv));
+    publisher.WaitStarted();
+
+    ASSERT_TRUE(queue.Enqueue(std::string(PUBLISH_QUEUE_MAX_BYTES / 2, 's'), "iot_states:Speaker"));
+    ASSERT_TRUE(queue.Enqueue(std::string(PUBLISH_QUEUE_MAX_BYTES / 2, 'm')));
+    // 丢弃状态后放得下
+    EXPECT_TRUE(queue.Enqueue(std::string(PUBLISH_QUEUE_MAX_BYTES / 4, 'n')));
+    EXPECT_FALSE(queue.Enqueue(std::string(PUBLISH_QUEUE_MAX_BYTES / 2, 'x')));
+    publisher.Open();
+    auto published = publisher.WaitPublished(3);
+    EXPECT_EQ(published.size(), 3u);
+}
+
+TEST(PublishQueueTest, ByteLimitAppliesToCoalescedMessage) {
+    GatedPublisher publisher;
+    PublishQueue queue([&](const std::string& payload) { return publisher.Publish(payload); });
+    ASSERT_TRUE(queue.Enqueue("in flight"sv));
+    publisher.WaitStarted();
+
+    ASSERT_TRUE(queue.Enqueue("speaker 1"sv, "iot_states:Speaker"));
+    ASSERT_TRUE(queue.Enqueue(std::string(PUBLISH_QUEUE_MAX_BYTES / 4, 'l'), "iot_states:Lamp"));
+    ASSERT_TRUE(queue.Enqueue(std::string(PUBLISH_QUEUE_MAX_BYTES / 2, 'm')));
+    // 替换后超出字节上限：先丢弃其他带 key 的消息
+    EXPECT_TRUE(queue.Enqueue(std::string(PUBLISH_QUEUE_MAX_BYTES / 2, 's'), "iot_states:Speaker"));
+    // 没有可丢弃的消息时拒绝，保留原来排队的那一条
+    EXPECT_FALSE(queue.Enqueue(std::string(PUBLISH_QUEUE_MAX_BYTES / 2 + 1, 'x'), "iot_states:Speaker"));
+    publisher.Open();
+
+    auto published = publisher.WaitPublished(3);
+    ASSERT_EQ(published.size(), 3u);
+    EXPECT_EQ(published[1], std::string(PUBLISH_QUEUE_MAX_BYTES / 2, 's'));
+    EXPECT_EQ(published[2], std::string(PUBLISH_QUEUE_MAX_BYTES / 2, 'm'));
+}
@@ -0,0 +1,11 @@
+#pragma once
+// 主机测试用的 esp_app_desc.h：只提供 MCP initialize 用到的版本号
+typedef struct {
+    char version[32];
+    char project_name[32];
+} esp_app_desc_t;
+
+inline const esp_app_desc_t* esp_app_get_description() {
+    static const esp_app_desc_t desc = {"host", "xiaozhi"};
+    return &desc;
+}
@@ -0,0 +1,10 @@
+#pragma once
+// 主机测试用的 esp_log.h：只输出警告和错误，其余级别只做格式检查
+#include <cstdio>
+
+#define HOST_LOG(level, tag, format, ...) fprintf(stderr, level " (%s) " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGE(tag, format, ...) HOST_LOG("E", tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) HOST_LOG("W", tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) do { if (0) HOST_LOG("I", tag, format, ##__VA_ARGS__); } while (0)
+#define ESP_LOGD(tag, format, ...) do { if (0) HOST_LOG("D", tag, format, ##__VA_ARGS__); } while (0)
+#define ESP_LOGV(tag, format, ...) do { if (0) HOST_LOG("V", tag, format, ##__VA_ARGS__); } while (0)
@@ -0,0 +1,19 @@
+#pragma once
+// 主机测试用的 esp_pthread.h：线程配置只做记录，std::thread 使用系统默认栈
+#include <cstddef>
+
+typedef struct {
+    size_t stack_size;
+    size_t prio;
+    bool inherit_cfg;
+    const char* thread_name;
+    int pin_to_core;
+} esp_pthread_cfg_t;
+
+inline esp_pthread_cfg_t esp_pthread_get_default_config() {
+    return esp_pthread_cfg_t{4096, 5, false, nullptr, -1};
+}
+
+inline int esp_pthread_set_cfg(const esp_pthread_cfg_t* cfg) {
+    return 0;
+}
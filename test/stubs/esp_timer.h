@@ -0,0 +1,19 @@
+#pragma once
+// 主机测试用的 esp_timer.h：esp_timer_get_time 返回单调时钟的微秒数，可由测试拨快
+#include <chrono>
+#include <cstdint>
+
+inline int64_t& host_timer_offset_us() {
+    static int64_t offset = 0;
+    return offset;
+}
+
+// 让依赖时间的逻辑（超时、统计周期）不必真的等待
+inline void host_timer_advance_us(int64_t us) {
+    host_timer_offset_us() += us;
+}
+
+inline int64_t esp_timer_get_time() {
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::microseconds>(now).count() + host_timer_offset_us();
+}
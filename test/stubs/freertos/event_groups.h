@@ -0,0 +1,50 @@
+#pragma once
+// 主机测试用的 event_groups.h：用互斥锁和条件变量实现事件位
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+#include "FreeRTOS.h"
+
+typedef uint32_t EventBits_t;
+
+struct HostEventGroup {
+    std::mutex mutex;
+    std::condition_variable cv;
+    EventBits_t bits = 0;
+};
+typedef HostEventGroup* EventGroupHandle_t;
+
+inline EventGroupHandle_t xEventGroupCreate() {
+    return new HostEventGroup();
+}
+
+inline void vEventGroupDelete(EventGroupHandle_t group) {
+    delete group;
+}
+
+inline EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+    std::lock_guard<std::mutex> lock(group->mutex);
+    group->bits |= bits;
+    group->cv.notify_all();
+    return group->bits;
+}
+
+inline EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+    std::lock_guard<std::mutex> lock(group->mutex);
+    EventBits_t old = group->bits;
+    group->bits &= ~bits;
+    return old;
+}
+
+inline EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear_on_exit,
+    BaseType_t wait_for_all, TickType_t ticks) {
+    std::unique_lock<std::mutex> lock(group->mutex);
+    auto ready = [&] { return wait_for_all ? (group->bits & bits) == bits : (group->bits & bits) != 0; };
+    group->cv.wait_for(lock, std::chrono::milliseconds(ticks), ready);
+    EventBits_t result = group->bits;
+    if (ready() && clear_on_exit) {
+        group->bits &= ~bits;
+    }
+    return result;
+}
@@ -0,0 +1,25 @@
+#pragma once
+// 主机测试用的 task.h：任务用分离的 std::thread 实现，任务函数结尾的 vTaskDelete(NULL) 不做任何事
+#include <chrono>
+#include <thread>
+
+#include "FreeRTOS.h"
+
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+inline BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stack_depth, void* arg,
+    UBaseType_t priority, TaskHandle_t* handle) {
+    static int dummy_task;
+    std::thread(function, arg).detach();
+    if (handle != nullptr) {
+        *handle = &dummy_task;
+    }
+    return pdPASS;
+}
+
+inline void vTaskDelete(TaskHandle_t task) {}
+
+inline void vTaskDelay(TickType_t ticks) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
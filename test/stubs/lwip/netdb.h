@@ -0,0 +1,54 @@
+#pragma once
+// 主机测试用的 lwip/netdb.h：getaddrinfo 查询测试预置的表，不访问网络
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <string>
+
+struct HostDnsRecords {
+    std::mutex mutex;
+    std::map<std::string, std::string> addresses;
+    std::atomic<int> lookups = 0;
+
+    void Set(const std::string& host, const std::string& address) {
+        std::lock_guard<std::mutex> lock(mutex);
+        addresses[host] = address;
+    }
+};
+
+inline HostDnsRecords& host_dns_records() {
+    static HostDnsRecords records;
+    return records;
+}
+
+inline int host_getaddrinfo(const char* node, const char* service, const struct addrinfo* hints,
+    struct addrinfo** result) {
+    auto& records = host_dns_records();
+    records.lookups++;
+    std::lock_guard<std::mutex> lock(records.mutex);
+    auto it = records.addresses.find(node);
+    if (it == records.addresses.end()) {
+        return EAI_NONAME;
+    }
+    auto info = (struct addrinfo*)calloc(1, sizeof(struct addrinfo) + sizeof(struct sockaddr_in));
+    auto sin = (struct sockaddr_in*)(info + 1);
+    sin->sin_family = AF_INET;
+    inet_pton(AF_INET, it->second.c_str(), &sin->sin_addr);
+    info->ai_family = AF_INET;
+    info->ai_addr = (struct sockaddr*)sin;
+    info->ai_addrlen = sizeof(struct sockaddr_in);
+    *result = info;
+    return 0;
+}
+
+inline void host_freeaddrinfo(struct addrinfo* info) {
+    free(info);
+}
+
+#define getaddrinfo host_getaddrinfo
+#define freeaddrinfo host_freeaddrinfo
@@ -0,0 +1,3 @@
+#pragma once
+// 主机测试用：Mqtt 的实现见 mqtt.h 中的 FakeMqtt
+#include "mqtt.h"
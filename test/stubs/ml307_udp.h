@@ -0,0 +1,3 @@
+#pragma once
+// 主机测试用：Udp 的实现见 udp.h 中的 FakeUdp
+#include "udp.h"
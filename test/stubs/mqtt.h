@@ -0,0 +1,58 @@
+#pragma once
+// 主机测试用的 mqtt.h：接口与 esp-ml307 的 Mqtt 相同，FakeMqtt 记录发布的消息，由测试模拟服务器
+#include <functional>
+#include <string>
+#include <vector>
+
+class Mqtt {
+public:
+    virtual ~Mqtt() = default;
+
+    void SetKeepAlive(int keep_alive_seconds) { keep_alive_seconds_ = keep_alive_seconds; }
+    virtual bool Connect(const std::string broker_address, int broker_port, const std::string client_id,
+        const std::string username, const std::string password) = 0;
+    virtual void Disconnect() = 0;
+    virtual bool Publish(const std::string topic, const std::string payload, int qos = 0) = 0;
+    virtual bool IsConnected() = 0;
+
+    void OnDisconnected(std::function<void()> callback) { on_disconnected_ = callback; }
+    void OnMessage(std::function<void(const std::string& topic, const std::string& payload)> callback) {
+        on_message_ = callback;
+    }
+
+protected:
+    int keep_alive_seconds_ = 120;
+    std::function<void()> on_disconnected_;
+    std::function<void(const std::string& topic, const std::string& payload)> on_message_;
+};
+
+class FakeMqtt : public Mqtt {
+public:
+    std::vector<std::string> published;
+    // 收到发布的消息时调用，测试在这里回复服务器消息
+    std::function<void(FakeMqtt& mqtt, const std::string& payload)> on_publish;
+
+    bool Connect(const std::string broker_address, int broker_port, const std::string client_id,
+        const std::string username, const std::string password) override {
+        connected_ = true;
+        return true;
+    }
+    void Disconnect() override { connected_ = false; }
+    bool Publish(const std::string topic, const std::string payload, int qos = 0) override {
+        published.push_back(payload);
+        if (on_publish) {
+            on_publish(*this, payload);
+        }
+        return true;
+    }
+    bool IsConnected() override { return connected_; }
+
+    void Receive(const std::string& payload) {
+        if (on_message_) {
+            on_message_("", payload);
+        }
+    }
+
+private:
+    bool connected_ = false;
+};
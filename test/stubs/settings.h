@@ -0,0 +1,36 @@
+#pragma once
+// 主机测试用的 settings.h：NVS 换成进程内的 map，测试可以预置和检查内容
+#include <cstdint>
+#include <map>
+#include <string>
+
+inline std::map<std::string, std::string>& host_settings_store() {
+    static std::map<std::string, std::string> store;
+    return store;
+}
+
+class Settings {
+public:
+    Settings(const std::string& ns, bool read_write = false) : ns_(ns) {}
+
+    std::string GetString(const std::string& key, const std::string& default_value = "") {
+        auto it = host_settings_store().find(ns_ + "." + key);
+        return it != host_settings_store().end() ? it->second : default_value;
+    }
+    void SetString(const std::string& key, const std::string& value) {
+        host_settings_store()[ns_ + "." + key] = value;
+    }
+    int32_t GetInt(const std::string& key, int32_t default_value = 0) {
+        auto it = host_settings_store().find(ns_ + "." + key);
+        return it != host_settings_store().end() ? std::stoi(it->second) : default_value;
+    }
+    void SetInt(const std::string& key, int32_t value) {
+        host_settings_store()[ns_ + "." + key] = std::to_string(value);
+    }
+    void EraseKey(const std::string& key) {
+        host_settings_store().erase(ns_ + "." + key);
+    }
+
+private:
+    std::string ns_;
+};
@@ -0,0 +1,41 @@
+#pragma once
+// 主机测试用的 udp.h：接口与 esp-ml307 的 Udp 相同，FakeUdp 记录发出的数据包，由测试注入收到的数据包
+#include <functional>
+#include <string>
+#include <vector>
+
+class Udp {
+public:
+    virtual ~Udp() = default;
+    virtual bool Connect(const std::string& host, int port) = 0;
+    virtual void Disconnect() = 0;
+    virtual int Send(const std::string& data) = 0;
+    virtual void OnMessage(std::function<void(const std::string& data)> callback) { message_callback_ = callback; }
+
+protected:
+    std::function<void(const std::string& data)> message_callback_;
+};
+
+class FakeUdp : public Udp {
+public:
+    std::string host;
+    int port = 0;
+    std::vector<std::string> sent;
+
+    bool Connect(const std::string& host, int port) override {
+        this->host = host;
+        this->port = port;
+        return true;
+    }
+    void Disconnect() override {}
+    int Send(const std::string& data) override {
+        sent.push_back(data);
+        return data.size();
+    }
+
+    void Receive(const std::string& data) {
+        if (message_callback_) {
+            message_callback_(data);
+        }
+    }
+};
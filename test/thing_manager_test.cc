@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <cJSON.h>
+
+#include "thing_manager.h"
+
+// ThingManager 是单例，每个用例使用名字不同的设备；命令经 SetScheduler 收集，由用例决定何时执行
+namespace {
+
+class RecordingThing : public iot::Thing {
+public:
+    std::vector<std::string> calls;
+
+    explicit RecordingThing(const std::string& name) : Thing(name, "Test thing") {
+        iot::ParameterList volume;
+        volume.AddParameter(iot::Parameter("volume", "Volume", iot::kValueTypeNumber));
+        methods_.AddMethod("SetVolume", "Set the volume", volume, [this](const iot::ParameterList& parameters) {
+            calls.push_back("volume=" + std::to_string(parameters["volume"].number()));
+        });
+
+        iot::ParameterList mode;
+        mode.AddParameter(iot::Parameter("mode", "Mode", iot::kValueTypeString));
+        mode.AddParameter(iot::Parameter("fast", "Fast", iot::kValueTypeBoolean, false));
+        methods_.AddMethod("SetMode", "Set the mode", mode, [this](const iot::ParameterList& parameters) {
+            calls.push_back("mode=" + parameters["mode"].string() + (parameters["fast"].boolean() ? ",fast" : ""));
+        });
+    }
+};
+
+class ThingManagerTest : public ::testing::Test {
+protected:
+    iot::ThingManager& manager = iot::ThingManager::GetInstance();
+    std::vector<std::function<void()>> scheduled;
+
+    void SetUp() override {
+        manager.SetScheduler([this](std::function<void()> callback) {
+            scheduled.push_back(std::move(callback));
+        });
+    }
+
+    void TearDown() override {
+        manager.SetScheduler(nullptr);
+    }
+
+    // ThingManager 不释放设备，由测试进程持有到退出，避免被 LeakSanitizer 报告
+    RecordingThing* AddThing(const std::string& name) {
+        static std::vector<std::unique_ptr<RecordingThing>> things;
+        things.push_back(std::make_unique<RecordingThing>(name));
+        manager.AddThing(things.back().get());
+        return things.back().get();
+    }
+
+    void RunScheduled() {
+        auto callbacks = std::move(scheduled);
+        scheduled.clear();
+        for (auto& callback : callbacks) {
+            callback();
+        }
+    }
+
+    // 解析后的 JSON 由用例负责释放
+    static cJSON* Parse(const std::string& json) {
+        cJSON* root = cJSON_Parse(json.c_str());
+        EXPECT_NE(root, nullptr) << json;
+        return root;
+    }
+};
+
+} // namespace
+
+TEST_F(ThingManagerTest, InvokesMethodByName) {
+    auto thing = AddThing("InvokeThing");
+
+    cJSON* command = Parse(R"({"name":"InvokeThing","method":"SetMode","parameters":{"mode":"eco","fast":true}})");
+    manager.Invoke(command);
+    cJSON_Delete(command);
+    // 命令在调度后才执行，参数已经拷贝到参数帧中，不依赖原始 JSON
+    EXPECT_TRUE(thing->calls.empty());
+    ASSERT_EQ(scheduled.size(), 1u);
+    RunScheduled();
+    ASSERT_EQ(thing->calls.size(), 1u);
+    EXPECT_EQ(thing->calls[0], "mode=eco,fast");
+}
+
+TEST_F(ThingManagerTest, RejectsUnknownThingMethodAndMissingParameter) {
+    auto thing = AddThing("RejectThing");
+
+    for (const char* json : {
+            R"({"name":"NoSuchThing","method":"SetVolume","parameters":{"volume":1}})",
+            R"({"method":"SetVolume","parameters":{"volume":1}})",
+            R"({"name":"RejectThing","method":"NoSuchMethod"})",
+            R"({"name":"RejectThing","method":"SetVolume","parameters":{}})"}) {
+        cJSON* command = Parse(json);
+        manager.Invoke(command);
+        cJSON_Delete(command);
+    }
+    EXPECT_TRUE(scheduled.empty());
+    EXPECT_TRUE(thing->calls.empty());
+}
+
+TEST_F(ThingManagerTest, CommandsRunInOneScheduleInOrder) {
+    auto first = AddThing("BatchFirst");
+    auto second = AddThing("BatchSecond");
+
+    // 无效的命令被跳过，其余的在同一次调度中按顺序执行
+    cJSON* commands = Parse(R"([
+        {"name":"BatchFirst","method":"SetVolume","parameters":{"volume":10}},
+        {"name":"BatchSecond","method":"NoSuchMethod"},
+        {"name":"BatchSecond","method":"SetMode","parameters":{"mode":"quiet"}},
+        {"name":"BatchFirst","method":"SetVolume","parameters":{"volume":20}}
+    ])");
+    manager.InvokeCommands(commands);
+    cJSON_Delete(commands);
+    ASSERT_EQ(scheduled.size(), 1u);
+    RunScheduled();
+    EXPECT_EQ(first->calls, (std::vector<std::string>{"volume=10", "volume=20"}));
+    EXPECT_EQ(second->calls, (std::vector<std::string>{"mode=quiet"}));
+
+    // 全部无效时不调度
+    commands = Parse(R"([{"name":"BatchFirst","method":"NoSuchMethod"}])");
+    manager.InvokeCommands(commands);
+    cJSON_Delete(commands);
+    EXPECT_TRUE(scheduled.empty());
+}
+
+TEST_F(ThingManagerTest, InterleavedInvocationsKeepTheirOwnArguments) {
+    RecordingThing thing("FrameThing");
+    cJSON* loud = Parse(R"({"name":"FrameThing","method":"SetVolume","parameters":{"volume":90}})");
+    cJSON* quiet = Parse(R"({"name":"FrameThing","method":"SetVolume","parameters":{"volume":5}})");
+    iot::Invocation first;
+    iot::Invocation second;
+    ASSERT_TRUE(thing.Bind(loud, first));
+    ASSERT_TRUE(thing.Bind(quiet, second));
+    cJSON_Delete(loud);
+    cJSON_Delete(quiet);
+
+    // 后绑定的调用不会覆盖先绑定的参数
+    second.Run();
+    first.Run();
+    EXPECT_EQ(thing.calls, (std::vector<std::string>{"volume=5", "volume=90"}));
+}